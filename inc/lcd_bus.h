@@ -0,0 +1,120 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+#ifndef LCD_BUS_H
+#define LCD_BUS_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*==============================================================================
+        Public Definitions
+==============================================================================*/
+
+/*! I2C bus device used when none is specified.  It may be overridden
+    at build time, eg -DLCD_BUS_DEFAULT_DEVICE=\"/dev/i2c-0\" */
+#ifndef LCD_BUS_DEFAULT_DEVICE
+#define LCD_BUS_DEFAULT_DEVICE  "/dev/i2c-1"
+#endif
+
+/*! default time (ms) an unused I2C bus connection is held open */
+#define LCD_BUS_IDLE_TIMEOUT_MS ( 1000 )
+
+typedef struct _LCDBus LCDBus;
+
+/*! The LCDBusXfer type describes one message of a combined transfer */
+typedef struct _LCDBusXfer
+{
+    /*! true to read from the device, false to write to it */
+    bool read;
+
+    /*! pointer to the message data */
+    uint8_t *buf;
+
+    /*! number of bytes to transfer */
+    size_t len;
+
+} LCDBusXfer;
+
+/*! The LCDBusStats type counts the activity on an I2C bus connection */
+typedef struct _LCDBusStats
+{
+    /*! number of system calls made on the bus device */
+    uint64_t syscalls;
+
+    /*! number of bytes on the wire, including one address byte
+        per message */
+    uint64_t bytes;
+
+    /*! number of single message writes */
+    uint64_t writes;
+
+    /*! number of single message reads */
+    uint64_t reads;
+
+    /*! number of combined (I2C_RDWR) transfers */
+    uint64_t transfers;
+
+    /*! number of times the bus device was opened */
+    uint64_t opens;
+
+    /*! number of times the bus device was closed */
+    uint64_t closes;
+
+} LCDBusStats;
+
+/*==============================================================================
+        Public Function Declarations
+==============================================================================*/
+
+LCDBus *BusInit( char *device );
+int BusDelete( LCDBus *pBus );
+int BusOpen( LCDBus *pBus );
+int BusRelease( LCDBus *pBus );
+int BusClose( LCDBus *pBus );
+int BusCheckIdle( LCDBus *pBus, int *remaining );
+bool BusIsOpen( LCDBus *pBus );
+int BusWrite( LCDBus *pBus, uint8_t address, uint8_t *buf, size_t len );
+int BusRead( LCDBus *pBus, uint8_t address, uint8_t *buf, size_t len );
+int BusBeginBatch( LCDBus *pBus );
+int BusEndBatch( LCDBus *pBus );
+int BusFlush( LCDBus *pBus );
+int BusTransfer( LCDBus *pBus,
+                 uint8_t address,
+                 LCDBusXfer *xfers,
+                 int n );
+
+int GetBusStats( LCDBus *pBus, LCDBusStats *pStats );
+int ResetBusStats( LCDBus *pBus );
+
+int GetIdleTimeout( LCDBus *pBus, int *timeout );
+int SetIdleTimeout( LCDBus *pBus, int timeout );
+int GetBusDevice( LCDBus *pBus, char **name );
+int SetBusDevice( LCDBus *pBus, char *name );
+
+#endif
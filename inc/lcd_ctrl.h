@@ -35,12 +35,25 @@ SOFTWARE.
 ==============================================================================*/
 
 int LCDInit( LCDDev *pDev );
+int LCDWarmInit( LCDDev *pDev, bool *warm );
+int LCDRestore( LCDDev *pDev, const LCDShadow *pSaved );
+int LCDResync( LCDDev *pDev );
 int ClearDisplay( LCDDev *pDev );
 int Cursor( LCDDev *pDev );
 int CursorHome( LCDDev *pDev );
 int GetStatus( LCDDev *pDev );
 int SetADD( LCDDev *pDev, uint8_t loc );
 int DisplayLine( LCDDev *pDev, int offset, char *line );
+int DisplayText( LCDDev *pDev, int offset, char *text, int width );
+int DisplayFrame( LCDDev *pDev,
+                  int col,
+                  char frame[][LCD_DDRAM_COLS + 1],
+                  int rows,
+                  int width );
+int ShiftDisplay( LCDDev *pDev, bool left );
+int SetDisplayOrigin( LCDDev *pDev, int col );
+int RegisterGlyph( uint16_t id, const uint8_t *bitmap );
+int LoadGlyph( LCDDev *pDev, uint16_t id, uint8_t *code );
 
 #endif
 
@@ -0,0 +1,77 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+#ifndef LCD_EMU_H
+#define LCD_EMU_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "lcd_io.h"
+
+/*==============================================================================
+        Public Definitions
+==============================================================================*/
+
+/*! The LCDEmuStats type counts the activity of an emulated display */
+typedef struct _LCDEmuStats
+{
+    /*! number of transport transactions addressed to the display */
+    uint64_t transactions;
+
+    /*! number of PCF8574 bytes written to or read from the display */
+    uint64_t bytes;
+
+    /*! number of HD44780 instructions executed */
+    uint32_t instructions;
+
+    /*! number of HD44780 data bytes written */
+    uint32_t data;
+
+    /*! number of status reads which returned busy */
+    uint32_t busyReads;
+
+    /*! number of instructions or data written while the display was busy */
+    uint32_t busyWrites;
+
+} LCDEmuStats;
+
+/*==============================================================================
+        Public Function Declarations
+==============================================================================*/
+
+int EmuGetStats( const char *device, uint8_t address, LCDEmuStats *pStats );
+int EmuGetText( const char *device,
+                uint8_t address,
+                int row,
+                char *buf,
+                size_t len );
+int EmuSetPinMap( const char *device,
+                  uint8_t address,
+                  const LCDPinMap *pPinMap );
+int EmuReset( void );
+
+#endif
@@ -30,13 +30,189 @@ SOFTWARE.
 ==============================================================================*/
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "lcd_bus.h"
+#include "lcd_trace.h"
 
 /*==============================================================================
         Public Definitions
 ==============================================================================*/
 
+/*! number of rows in the HD44780 display data RAM */
+#define LCD_DDRAM_ROWS  ( 2 )
+
+/*! number of columns per row in the HD44780 display data RAM */
+#define LCD_DDRAM_COLS  ( 40 )
+
+/*! maximum number of display rows supported by a display geometry */
+#define LCD_MAX_ROWS    ( 4 )
+
+/*! display geometry used when none is specified.  It may be overridden
+    at build time, eg -DLCD_GEOMETRY=\"20x4\" */
+#ifndef LCD_GEOMETRY
+#define LCD_GEOMETRY    "16x2"
+#endif
+
+/*! number of custom character slots in the HD44780 character
+    generator RAM */
+#define LCD_CGRAM_SLOTS ( 8 )
+
+/*! number of rows in a 5x8 custom character bitmap */
+#define LCD_GLYPH_ROWS  ( 8 )
+
 typedef struct _LCDDev LCDDev;
 
+/*! LCD write completion modes */
+typedef enum _LCDWriteMode
+{
+    /*! poll the busy flag after each write */
+    LCD_WRITE_BUSY_POLL = 0,
+
+    /*! wait for the datasheet execution time after each write */
+    LCD_WRITE_TIMED
+
+} LCDWriteMode;
+
+/*! The LCDDevStats type counts the activity of an LCD device */
+typedef struct _LCDDevStats
+{
+    /*! number of bytes written with writeByte() */
+    uint32_t writes;
+
+    /*! number of status register reads */
+    uint32_t statusReads;
+
+    /*! number of busy flag polls made after writes */
+    uint32_t polls;
+
+    /*! largest number of busy flag polls for one write */
+    uint32_t maxPolls;
+
+    /*! number of times the device was ready after the first poll */
+    uint32_t firstPollReady;
+
+    /*! number of writes abandoned because the device stayed busy */
+    uint32_t pollTimeouts;
+
+    /*! number of failed bus writes and reads */
+    uint32_t ioErrors;
+
+    /*! total time (us) slept while waiting to poll the busy flag */
+    uint64_t pollWaitUs;
+
+    /*! learned execution time (us) of a data write */
+    uint32_t dataExecUs;
+
+    /*! learned execution time (us) of a short instruction */
+    uint32_t instrExecUs;
+
+    /*! learned execution time (us) of clear display and return home */
+    uint32_t longExecUs;
+
+} LCDDevStats;
+
+/*! The LCDGeometry type describes the layout of a display panel */
+typedef struct _LCDGeometry
+{
+    /*! geometry name, eg "16x2" */
+    char *name;
+
+    /*! number of visible columns */
+    uint8_t cols;
+
+    /*! number of visible rows */
+    uint8_t rows;
+
+    /*! display data address of the start of each row */
+    uint8_t rowAddr[LCD_MAX_ROWS];
+
+} LCDGeometry;
+
+/*! The LCDPinMap type describes how the HD44780 interface signals are
+    wired to the PCF8574 port.  Each signal is given as a port bit
+    number (0 - 7) */
+typedef struct _LCDPinMap
+{
+    /*! pin map name, eg "standard" */
+    char *name;
+
+    /*! port bit driving the register select (RS) signal */
+    uint8_t rs;
+
+    /*! port bit driving the read/write (RW) signal */
+    uint8_t rw;
+
+    /*! port bit driving the enable (EN) signal */
+    uint8_t en;
+
+    /*! port bit driving the backlight */
+    uint8_t led;
+
+    /*! port bits driving the D4, D5, D6 and D7 signals */
+    uint8_t data[4];
+
+    /*! the backlight is on when its port bit is low */
+    bool ledActiveLow;
+
+} LCDPinMap;
+
+/*! The LCDGlyphSlot type records the custom character held in one
+    character generator RAM slot (see lcd_ctrl LoadGlyph()) */
+typedef struct _LCDGlyphSlot
+{
+    /*! identifier of the glyph loaded into the slot */
+    uint16_t id;
+
+    /*! the slot has been loaded */
+    bool loaded;
+
+    /*! glyph cache use stamp of the last use of the slot */
+    uint32_t lastUse;
+
+} LCDGlyphSlot;
+
+/*! The LCDShadow type holds the state of a display which is tracked by
+    the driver as it is written.  By default it is held in the device
+    object, but it may be kept elsewhere, for example in a memory mapped
+    state file which outlives the service (see AttachShadow()) */
+typedef struct _LCDShadow
+{
+    /*! identifies the owner of the shadow state (not used by the driver) */
+    uint32_t magic;
+
+    /*! a transaction has been started and has not yet been completed,
+        so the shadow state may not match the display */
+    bool pending;
+
+    /*! shadow DDRAM contents are known to match the display */
+    bool ddramValid;
+
+    /*! shadow copy of the display data RAM */
+    uint8_t ddram[LCD_DDRAM_ROWS][LCD_DDRAM_COLS];
+
+    /*! shadow copy of the character generator RAM */
+    uint8_t cgram[LCD_CGRAM_SLOTS][LCD_GLYPH_ROWS];
+
+    /*! bitmap of the shadow CGRAM rows which are known, per slot */
+    uint8_t cgramKnown[LCD_CGRAM_SLOTS];
+
+    /*! custom character slot usage */
+    LCDGlyphSlot glyphs[LCD_CGRAM_SLOTS];
+
+    /*! backlight state last written to the PCF8574 */
+    bool backlight;
+
+    /*! last display on/off control instruction, or 0 if not known */
+    uint8_t control;
+
+    /*! last entry mode set instruction, or 0 if not known */
+    uint8_t entryMode;
+
+    /*! number of columns the display is shifted left (0 to 39) */
+    uint8_t shift;
+
+} LCDShadow;
+
 /*==============================================================================
         Public Function Declarations
 ==============================================================================*/
@@ -49,6 +225,9 @@ int readByte( LCDDev *pDev, uint8_t *val );
 int writeByte( LCDDev *pDev, uint8_t rs, uint8_t val );
 int latch( LCDDev *pDev );
 int writeReg( LCDDev *pDev );
+int BeginTransaction( LCDDev *pDev );
+int EndTransaction( LCDDev *pDev );
+int FlushTransaction( LCDDev *pDev );
 int readStatus( LCDDev *pDev );
 int readReg( LCDDev *pDev );
 
@@ -56,11 +235,39 @@ int GetCursorX( LCDDev *pDev, int *pX );
 int GetCursorY( LCDDev *pDev, int *pY );
 int GetBacklight( LCDDev *pDev, bool *backlight );
 int SetBacklight( LCDDev *pDev, bool backlight );
+int RequestBacklight( LCDDev *pDev, bool backlight );
+int SyncBacklight( LCDDev *pDev );
 int GetExclusive( LCDDev *pDev, bool *exclusive );
 int SetExclusive( LCDDev *pDev, bool exclusive );
+int GetSyncLost( LCDDev *pDev, bool *lost );
+int ClearSyncLost( LCDDev *pDev );
+int GetWriteMode( LCDDev *pDev, LCDWriteMode *mode );
+int SetWriteMode( LCDDev *pDev, LCDWriteMode mode );
+int GetReadyDelay( LCDDev *pDev, int *us );
+int GetShadowDDRAM( LCDDev *pDev, uint8_t addr, const uint8_t **data );
+int InvalidateShadowDDRAM( LCDDev *pDev );
+int ValidateShadowDDRAM( LCDDev *pDev );
+int GetShadowCGRAM( LCDDev *pDev, int slot, const uint8_t **data );
+int GetGlyphSlots( LCDDev *pDev, LCDGlyphSlot **ppSlots );
+int AttachShadow( LCDDev *pDev, LCDShadow *pShadow );
+int GetShadow( LCDDev *pDev, const LCDShadow **ppShadow );
+int ResetShadow( LCDDev *pDev );
+int GetDevStats( LCDDev *pDev, LCDDevStats *pStats );
 int GetAddress( LCDDev *pDev, uint8_t *address );
 int SetAddress( LCDDev *pDev, uint8_t address );
 int SetDeviceName( LCDDev *pDev, char *name );
 int GetDeviceName( LCDDev *pDev, char **name );
+int GetBus( LCDDev *pDev, LCDBus **ppBus );
+const LCDGeometry *FindGeometry( char *name );
+int GetGeometry( LCDDev *pDev, const LCDGeometry **ppGeometry );
+int SetGeometry( LCDDev *pDev, const LCDGeometry *pGeometry );
+const LCDPinMap *FindPinMap( char *name );
+int GetPinMap( LCDDev *pDev, const LCDPinMap **ppPinMap );
+int CheckPinMap( const LCDPinMap *pPinMap );
+int SetPinMap( LCDDev *pDev, const LCDPinMap *pPinMap );
+int SetBus( LCDDev *pDev, LCDBus *pBus );
+int SetTrace( LCDDev *pDev, LCDTrace *pTrace );
+uint8_t BeginTrace( LCDDev *pDev, uint8_t origin );
+void EndTrace( LCDDev *pDev, uint8_t prev );
 
 #endif
@@ -0,0 +1,106 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+#ifndef LCD_RENDER_H
+#define LCD_RENDER_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lcd_bus.h"
+#include "lcd_io.h"
+#include "lcd_sched.h"
+
+/*==============================================================================
+        Public Definitions
+==============================================================================*/
+
+/*! default time (ms) allowed to display a line of text */
+#define LCD_RENDER_LINE_DEADLINE_MS ( 100 )
+
+typedef struct _LCDRender LCDRender;
+
+/*==============================================================================
+        Public Function Declarations
+==============================================================================*/
+
+LCDRender *RenderInit( LCDBus *pBus );
+int RenderStart( LCDRender *pRender );
+int RenderStop( LCDRender *pRender );
+int RenderLine( LCDRender *pRender, LCDDev *pDev, uint8_t offset, char *line );
+int RenderBacklight( LCDRender *pRender, LCDDev *pDev, bool backlight );
+int RenderGetStats( LCDRender *pRender, LCDSchedStats *pStats );
+int RenderGetEventFd( LCDRender *pRender );
+int RenderDispatch( LCDRender *pRender );
+
+int DisplayLineAsync( LCDRender *pRender,
+                      LCDDev *pDev,
+                      uint8_t offset,
+                      char *line,
+                      LCDCompletionFn done,
+                      void *arg );
+int DisplayTextAsync( LCDRender *pRender,
+                      LCDDev *pDev,
+                      uint8_t offset,
+                      char *text,
+                      int width,
+                      int deadline,
+                      LCDCompletionFn done,
+                      void *arg );
+int DisplayFrameAsync( LCDRender *pRender,
+                       LCDDev *pDev,
+                       uint8_t col,
+                       char frame[][LCD_DDRAM_COLS + 1],
+                       int rows,
+                       int width,
+                       int deadline,
+                       LCDCompletionFn done,
+                       void *arg );
+int SetBacklightAsync( LCDRender *pRender,
+                       LCDDev *pDev,
+                       bool backlight,
+                       LCDCompletionFn done,
+                       void *arg );
+int ClearDisplayAsync( LCDRender *pRender,
+                       LCDDev *pDev,
+                       LCDCompletionFn done,
+                       void *arg );
+int CursorHomeAsync( LCDRender *pRender,
+                     LCDDev *pDev,
+                     LCDCompletionFn done,
+                     void *arg );
+int ShiftDisplayAsync( LCDRender *pRender,
+                       LCDDev *pDev,
+                       bool left,
+                       LCDCompletionFn done,
+                       void *arg );
+int SetDisplayOriginAsync( LCDRender *pRender,
+                           LCDDev *pDev,
+                           uint8_t col,
+                           LCDCompletionFn done,
+                           void *arg );
+
+#endif
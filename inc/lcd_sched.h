@@ -0,0 +1,176 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+#ifndef LCD_SCHED_H
+#define LCD_SCHED_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "lcd_bus.h"
+#include "lcd_io.h"
+
+/*==============================================================================
+        Public Definitions
+==============================================================================*/
+
+/*! operation priorities, highest priority first */
+typedef enum _LCDPriority
+{
+    /*! near-instant operations such as backlight changes */
+    LCD_PRIO_HIGH = 0,
+
+    /*! display text updates */
+    LCD_PRIO_NORMAL,
+
+    /*! bulk operations which may be delayed */
+    LCD_PRIO_LOW,
+
+    /*! number of priority levels */
+    LCD_PRIO_LEVELS
+
+} LCDPriority;
+
+/*! scheduled operation types */
+typedef enum _LCDOpType
+{
+    /*! display a line of text */
+    LCD_OP_LINE = 0,
+
+    /*! set the backlight state */
+    LCD_OP_BACKLIGHT,
+
+    /*! clear the display */
+    LCD_OP_CLEAR,
+
+    /*! move the cursor to the home position */
+    LCD_OP_HOME,
+
+    /*! shift the display window by one character */
+    LCD_OP_SHIFT,
+
+    /*! display several rows of text as one transaction */
+    LCD_OP_FRAME,
+
+    /*! shift the display to show a display data RAM column at the left */
+    LCD_OP_ORIGIN
+
+} LCDOpType;
+
+/*! operation completion function, called with the operation result */
+typedef void (*LCDCompletionFn)( void *arg, int result );
+
+/*! The LCDOp type describes one operation on an LCD device */
+typedef struct _LCDOp
+{
+    /*! operation type */
+    LCDOpType type;
+
+    /*! LCD device the operation applies to */
+    LCDDev *pDev;
+
+    /*! operation priority */
+    LCDPriority priority;
+
+    /*! time (CLOCK_MONOTONIC) by which the operation should be performed */
+    struct timespec deadline;
+
+    /*! display data address for LCD_OP_LINE, start column of each row
+        for LCD_OP_FRAME, or column to show for LCD_OP_ORIGIN */
+    uint8_t offset;
+
+    /*! field width for LCD_OP_LINE, or 0 for a standard display line.
+        row width for LCD_OP_FRAME */
+    uint8_t width;
+
+    /*! number of rows for LCD_OP_FRAME */
+    uint8_t rows;
+
+    /*! shift direction for LCD_OP_SHIFT */
+    bool left;
+
+    /*! backlight state for LCD_OP_BACKLIGHT */
+    bool backlight;
+
+    /*! NUL terminated line text for LCD_OP_LINE */
+    char text[LCD_DDRAM_COLS + 1];
+
+    /*! text of each row for LCD_OP_FRAME */
+    char frame[LCD_MAX_ROWS][LCD_DDRAM_COLS + 1];
+
+    /*! completion function, or NULL if no notification is required */
+    LCDCompletionFn done;
+
+    /*! argument passed to the completion function */
+    void *arg;
+
+} LCDOp;
+
+/*! The LCDSchedStats type reports the scheduler activity */
+typedef struct _LCDSchedStats
+{
+    /*! number of operations performed */
+    uint32_t ops;
+
+    /*! number of operations replaced by a newer operation */
+    uint32_t superseded;
+
+    /*! number of operations performed after their deadline */
+    uint32_t late;
+
+    /*! number of devices resynchronized after a failed operation */
+    uint32_t resyncs;
+
+    /*! number of failed attempts to resynchronize a device */
+    uint32_t resyncFailures;
+
+    /*! number of operations waiting to be performed */
+    int pending;
+
+    /*! percentage of time the bus was busy over the last interval */
+    int utilisation;
+
+} LCDSchedStats;
+
+typedef struct _LCDSched LCDSched;
+
+/*! scheduler notification function, called when an operation which has
+    a completion function is performed (or superseded) */
+typedef void (*LCDSchedNotifyFn)( void *ctx, LCDOp *pOp, int result );
+
+/*==============================================================================
+        Public Function Declarations
+==============================================================================*/
+
+LCDSched *SchedInit( LCDBus *pBus, LCDSchedNotifyFn notify, void *ctx );
+int SchedDelete( LCDSched *pSched );
+int SchedSubmit( LCDSched *pSched, LCDOp *pOp );
+int SchedRun( LCDSched *pSched, int *next );
+bool SchedFull( LCDSched *pSched );
+int SchedGetStats( LCDSched *pSched, LCDSchedStats *pStats );
+
+#endif
@@ -0,0 +1,190 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+#ifndef LCD_TRACE_H
+#define LCD_TRACE_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "lcd_bus.h"
+
+/*==============================================================================
+        Public Definitions
+==============================================================================*/
+
+/*! identifies a bus trace file */
+#define LCD_TRACE_MAGIC     ( 0x4C435452 )
+
+/*! bus trace file format version */
+#define LCD_TRACE_VERSION   ( 1 )
+
+/*! default number of bus bytes held in the trace ring */
+#define LCD_TRACE_EVENTS    ( 4096 )
+
+/*! largest number of devices whose wiring is recorded in a trace */
+#define LCD_TRACE_MAX_DEVICES   ( 16 )
+
+/*! the trace event is a byte read from the bus */
+#define LCD_TRACE_READ      ( 1 << 0 )
+
+/*! the trace event is the first byte of a bus message */
+#define LCD_TRACE_FIRST     ( 1 << 1 )
+
+/*! high level operations which bus bytes are recorded against */
+typedef enum _LCDTraceOrigin
+{
+    /*! not part of a traced operation */
+    LCD_TRACE_NONE = 0,
+
+    /*! display initialization (LCDInit(), LCDWarmInit()) */
+    LCD_TRACE_INIT,
+
+    /*! display restore (LCDRestore(), LCDResync()) */
+    LCD_TRACE_RESTORE,
+
+    /*! ClearDisplay() */
+    LCD_TRACE_CLEAR,
+
+    /*! CursorHome() */
+    LCD_TRACE_HOME,
+
+    /*! Cursor() */
+    LCD_TRACE_CURSOR,
+
+    /*! SetADD() */
+    LCD_TRACE_SETADD,
+
+    /*! DisplayLine() */
+    LCD_TRACE_LINE,
+
+    /*! DisplayText() */
+    LCD_TRACE_TEXT,
+
+    /*! DisplayFrame() */
+    LCD_TRACE_FRAME,
+
+    /*! ShiftDisplay() and SetDisplayOrigin() */
+    LCD_TRACE_SHIFT,
+
+    /*! LoadGlyph() */
+    LCD_TRACE_GLYPH,
+
+    /*! GetStatus() */
+    LCD_TRACE_STATUS,
+
+    /*! SyncBacklight() */
+    LCD_TRACE_BACKLIGHT,
+
+    /*! number of trace origins */
+    LCD_TRACE_ORIGINS
+
+} LCDTraceOrigin;
+
+/*! The LCDTraceEvent type records one byte sent to or read from the bus */
+typedef struct _LCDTraceEvent
+{
+    /*! time (ns) since the trace was created */
+    uint64_t ns;
+
+    /*! I2C address of the device */
+    uint8_t address;
+
+    /*! PCF8574 port value.  The port bit of each signal is given by
+        the wiring of the device (see LCDTraceWiring) */
+    uint8_t value;
+
+    /*! LCD_TRACE_READ and LCD_TRACE_FIRST flags */
+    uint8_t flags;
+
+    /*! operation which caused the bus byte (see LCDTraceOrigin) */
+    uint8_t origin;
+
+} LCDTraceEvent;
+
+/*! The LCDTraceWiring type records which PCF8574 port bit drives each
+    display interface signal of a traced device (see SetPinMap()) */
+typedef struct _LCDTraceWiring
+{
+    /*! I2C address of the device */
+    uint8_t address;
+
+    /*! port bit of the register select signal */
+    uint8_t rs;
+
+    /*! port bit of the read/write signal */
+    uint8_t rw;
+
+    /*! port bit of the enable strobe */
+    uint8_t en;
+
+    /*! port bit of the backlight control */
+    uint8_t led;
+
+    /*! port bits of D4-D7 */
+    uint8_t data[4];
+
+    /*! non-zero if the backlight is on when its port bit is low */
+    uint8_t ledActiveLow;
+
+} LCDTraceWiring;
+
+typedef struct _LCDTrace LCDTrace;
+
+/*==============================================================================
+        Public Function Declarations
+==============================================================================*/
+
+LCDTrace *TraceInit( size_t size );
+int TraceRecord( LCDTrace *pTrace,
+                 uint8_t address,
+                 uint8_t flags,
+                 uint8_t origin,
+                 const uint8_t *buf,
+                 size_t len );
+int TraceSnapshot( LCDTrace *pTrace,
+                   LCDTraceEvent *events,
+                   size_t max,
+                   size_t *n,
+                   uint64_t *dropped );
+int TraceSetWiring( LCDTrace *pTrace, const LCDTraceWiring *pWiring );
+int TracePrint( LCDTrace *pTrace, int fd );
+int TraceSave( LCDTrace *pTrace, const char *name );
+int TraceLoad( const char *name,
+               LCDTraceEvent **events,
+               size_t *n,
+               LCDTraceWiring *wiring,
+               size_t *devices );
+int TraceReplay( LCDBus *pBus,
+                 LCDTraceEvent *events,
+                 size_t n,
+                 bool paced,
+                 int fd );
+const char *TraceOriginName( uint8_t origin );
+
+#endif
+
@@ -0,0 +1,81 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+#ifndef LCD_TRANSPORT_H
+#define LCD_TRANSPORT_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <linux/i2c.h>
+
+/*==============================================================================
+        Public Definitions
+==============================================================================*/
+
+/*! The LCDTransport type is the set of operations used by the bus
+    connection manager to communicate with the devices on an I2C bus.
+    Each operation returns EOK on success, or an errno value. */
+typedef struct _LCDTransport
+{
+    /*! transport name */
+    char *name;
+
+    /*! open the bus device and return a transport handle */
+    int (*open)( char *device, void **handle );
+
+    /*! close the bus device */
+    int (*close)( void *handle );
+
+    /*! check if combined (I2C_RDWR) transfers are supported */
+    bool (*combined)( void *handle );
+
+    /*! select the slave address for subsequent reads and writes */
+    int (*select)( void *handle, uint8_t address );
+
+    /*! write data to the selected slave */
+    int (*write)( void *handle, uint8_t *buf, size_t len );
+
+    /*! read data from the selected slave */
+    int (*read)( void *handle, uint8_t *buf, size_t len );
+
+    /*! perform a combined transfer of several messages */
+    int (*transfer)( void *handle, struct i2c_msg *msgs, int n );
+
+} LCDTransport;
+
+/*! device name prefix which selects the in-process emulator */
+#define LCD_EMU_PREFIX  "emu:"
+
+/*==============================================================================
+        Public Function Declarations
+==============================================================================*/
+
+const LCDTransport *GetI2CDevTransport( void );
+const LCDTransport *GetEmuTransport( void );
+
+#endif
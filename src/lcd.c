@@ -42,9 +42,17 @@ SOFTWARE.
 
     /HW/LCD1602/LINE1
     /HW/LCD1602/LINE2
+    /HW/LCD1602/LINE3 (4 row displays)
+    /HW/LCD1602/LINE4 (4 row displays)
+    /HW/LCD1602/FRAME
     /HW/LCD1602/BACKLIGHT
     /HW/LCD1602/STATUS
 
+    Several displays at different addresses on the same I2C bus can be
+    driven by one instance of the application.  In that case (or if an
+    instance ID is specified) the variables for each display are placed
+    in a per-instance namespace, eg /HW/LCD1602/1/LINE1
+
 */
 /*============================================================================*/
 
@@ -64,50 +72,497 @@ SOFTWARE.
 #include <unistd.h>
 #include <stdbool.h>
 #include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
 #include <varserver/varserver.h>
+#include "lcd_bus.h"
 #include "lcd_io.h"
 #include "lcd_ctrl.h"
+#include "lcd_render.h"
+#include "lcd_bench.h"
+#include "lcd_state.h"
+#include "lcd_trace.h"
+#include "lcd_emu.h"
 
 /*==============================================================================
         Private definitions
 ==============================================================================*/
 
+/*! default maximum display refresh rate (Hz) */
+#define LCD_DEFAULT_REFRESH_RATE    ( 25 )
+
+/*! the backlight variable has changed */
+#define LCD_DIRTY_BACKLIGHT ( 1 << 0 )
+
+/*! one or more gauge variables have changed */
+#define LCD_DIRTY_GAUGES    ( 1 << 1 )
+
+/*! the frame variable has changed */
+#define LCD_DIRTY_FRAME     ( 1 << 2 )
+
+/*! the line 1 variable has changed */
+#define LCD_DIRTY_LINE1     ( 1 << 3 )
+
+/*! the variable of the specified line (0 = line 1) has changed */
+#define LCD_DIRTY_LINE(n)   ( LCD_DIRTY_LINE1 << ( n ) )
+
+/*! all of the line variables */
+#define LCD_DIRTY_LINES     ( ( ( 1 << LCD_MAX_LINES ) - 1 ) * \
+                              LCD_DIRTY_LINE1 )
+
+/*! all of the display variables */
+#define LCD_DIRTY_ALL       ( LCD_DIRTY_BACKLIGHT | \
+                              LCD_DIRTY_LINES | \
+                              LCD_DIRTY_GAUGES | \
+                              LCD_DIRTY_FRAME )
+
+/*! number of line variables on each display (LINE1 to LINE4).  Only
+    the lines of the display geometry are used */
+#define LCD_MAX_LINES       ( 4 )
+
+/*! number of line variables every display must have (LINE1 and LINE2) */
+#define LCD_REQUIRED_LINES  ( 2 )
+
+/*! maximum number of update policies */
+#define LCD_MAX_POLICIES    ( 16 )
+
+/*! maximum number of gauges on one display */
+#define LCD_MAX_GAUGES      ( 8 )
+
+/*! maximum number of labels on one display */
+#define LCD_MAX_LABELS      ( 8 )
+
+/*! number of partially filled bar graph cells (1 to 4 columns lit) */
+#define LCD_BAR_STEPS       ( 4 )
+
+/*! number of pixel columns in a character cell */
+#define LCD_CELL_COLS       ( 5 )
+
+/*! glyph identifier of the first partially filled bar graph cell */
+#define LCD_GLYPH_BAR       ( 0x100 )
+
+/*! HD44780 character ROM code of the full block character */
+#define LCD_FULL_BLOCK      ( 0xFF )
+
+/*! maximum number of displays managed by one instance */
+#define LCD_MAX_PANELS      ( 8 )
+
+/*! maximum number of I2C buses managed by one instance */
+#define LCD_MAX_BUSES       ( 4 )
+
+/*! default PCF8574 device address */
+#define LCD_DEFAULT_ADDRESS ( 0x27 )
+
+/*! lowest and highest 7 bit I2C addresses which are not reserved */
+#define LCD_MIN_ADDRESS     ( 0x03 )
+#define LCD_MAX_ADDRESS     ( 0x77 )
+
+/*! default I2C bus device */
+#define LCD_DEFAULT_DEVICE  LCD_BUS_DEFAULT_DEVICE
+
+/*! maximum length of a system variable name */
+#define LCD_VARNAME_LEN     ( 64 )
+
+/*! number of marquee steps to pause at each end of the text */
+#define LCD_MARQUEE_PAUSE   ( 4 )
+
+/*! maximum number of events handled per event loop wakeup */
+#define LCD_MAX_EVENTS      ( 8 )
+
+/*! number of line update latency histogram buckets.  Bucket n counts
+    updates which took less than 2^n microseconds, and the last bucket
+    counts all longer updates */
+#define LCD_LATENCY_BUCKETS ( 20 )
+
+/*! number of queued display updates whose latency can be measured */
+#define LCD_UPDATE_TAGS     ( 64 )
+
 /*==============================================================================
         Type definitions
 ==============================================================================*/
 
+/*! The LCDPolicy structure holds an update policy specified on the
+ *  command line */
+typedef struct _LCDPolicy
+{
+    /*! variable name (BACKLIGHT, LINE1 to LINE4, FRAME or a gauge
+        variable) */
+    char *name;
+
+    /*! minimum time (ms) between updates, 0 = no limit */
+    int interval;
+
+    /*! time (ms) allowed to write an update to the display */
+    int deadline;
+
+} LCDPolicy;
+
+/*! The LCDUpdatePolicy structure applies an update policy to one
+ *  display variable */
+typedef struct _LCDUpdatePolicy
+{
+    /*! minimum time (ms) between updates, 0 = no limit */
+    int interval;
+
+    /*! time (ms) allowed to write an update to the display */
+    int deadline;
+
+    /*! time of the last update */
+    struct timespec last;
+
+    /*! time at which the oldest change which has not been read yet was
+        received (0 = none) */
+    struct timespec received;
+
+    /*! time at which the oldest change read by the last update was
+        received (0 = none) */
+    struct timespec started;
+
+} LCDUpdatePolicy;
+
+/*! gauge rendering modes */
+typedef enum _LCDGaugeMode
+{
+    /*! right aligned numeric field */
+    LCD_GAUGE_NUMBER = 0,
+
+    /*! horizontal bar graph */
+    LCD_GAUGE_BAR,
+
+    /*! left aligned text field */
+    LCD_GAUGE_TEXT
+
+} LCDGaugeMode;
+
+/*! the LCDGauge structure renders a system variable into a fixed region
+ *  of one row of a display */
+typedef struct _LCDGauge
+{
+    /*! name of the system variable */
+    char *name;
+
+    /*! handle to the system variable */
+    VAR_HANDLE hVar;
+
+    /*! rendering mode */
+    LCDGaugeMode mode;
+
+    /*! display row (0 = first row) */
+    int row;
+
+    /*! first display column (0 = left) */
+    int col;
+
+    /*! field width in characters */
+    int width;
+
+    /*! value displayed as an empty bar */
+    double min;
+
+    /*! value displayed as a full bar */
+    double max;
+
+    /*! the variable has changed since it was last rendered */
+    bool dirty;
+
+    /*! update policy */
+    LCDUpdatePolicy policy;
+
+    /*! rendered field contents */
+    char cells[LCD_DDRAM_COLS + 1];
+
+} LCDGauge;
+
+/*! the LCDLabel structure holds static text shown at a fixed position
+ *  of a display */
+typedef struct _LCDLabel
+{
+    /*! display row (0 = first row) */
+    int row;
+
+    /*! first display column (0 = left) */
+    int col;
+
+    /*! label text */
+    char *text;
+
+    /*! number of characters of the label shown */
+    int width;
+
+} LCDLabel;
+
+typedef struct _LCDBusWorker LCDBusWorker;
+typedef struct _LCDUpdateTag LCDUpdateTag;
+
+/*! the LCDPanel structure manages one character LCD display
+ *  and its system variables */
+typedef struct _LCDPanel
+{
+    /*! panel instance identifier */
+    uint32_t instanceID;
+
+    /*! PCF8574 device address */
+    uint8_t address;
+
+    /*! frame buffer holding the text of each row as it is written to
+        the display: the line variable is read directly into its row,
+        padded with blanks, and overlaid with the labels and gauges on
+        the row */
+    char frame[LCD_MAX_ROWS][LCD_DDRAM_COLS + 1];
+
+    /*! length of the longest line (marquee mode) */
+    int textLen;
+
+    /*! number of columns the display is shifted left (marquee mode) */
+    int shift;
+
+    /*! number of marquee steps to wait before the next shift */
+    int pause;
+
+    /*! LCD Device */
+    LCDDev *pDev;
+
+    /*! I2C bus the display is attached to */
+    LCDBusWorker *pWorker;
+
+    /*! wiring of the PCF8574 backpack, or a NULL name for the standard
+        wiring */
+    LCDPinMap pinMap;
+
+    /*! display state mapped from the state file, or NULL */
+    LCDShadow *pState;
+
+    /*! display data RAM column shown at the left of the display (0, or
+        the display width when the second page is shown) */
+    int origin;
+
+    /*! a new page has been drawn off screen, but has not been shifted
+        into view yet (page flip mode) */
+    bool flipPending;
+
+    /*! latency tag of the page waiting to be shifted into view, or NULL */
+    LCDUpdateTag *pFlipTag;
+
+    /*! handle to backlight system variable */
+    VAR_HANDLE hVarBacklight;
+
+    /*! handles to the LINE1 to LINE4 system variables */
+    VAR_HANDLE hVarLine[LCD_MAX_LINES];
+
+    /*! handle to the optional FRAME system variable */
+    VAR_HANDLE hVarFrame;
+
+    /*! handle to status system variable */
+    VAR_HANDLE hVarStatus;
+
+    /*! variables which have changed since the last refresh */
+    uint32_t dirty;
+
+    /*! number of changes dropped because a newer value superseded them */
+    uint32_t coalesced;
+
+    /*! rows which must be redrawn (bit n = row n) */
+    uint32_t redraw;
+
+    /*! first column of each row which must be redrawn */
+    int redrawFirst[LCD_MAX_ROWS];
+
+    /*! column after the last column of each row which must be redrawn */
+    int redrawEnd[LCD_MAX_ROWS];
+
+    /*! deadline (ms) of the next update of each row */
+    int rowDeadline[LCD_MAX_ROWS];
+
+    /*! time at which the oldest change to each row which has not been
+        queued to the display yet was received (0 = none) */
+    struct timespec received[LCD_MAX_ROWS];
+
+    /*! latest queued update of each row, or NULL */
+    LCDUpdateTag *pUpdate[LCD_MAX_ROWS];
+
+    /*! backlight update policy */
+    LCDUpdatePolicy backlightPolicy;
+
+    /*! LINE1 to LINE4 update policies */
+    LCDUpdatePolicy linePolicy[LCD_MAX_LINES];
+
+    /*! FRAME update policy */
+    LCDUpdatePolicy framePolicy;
+
+    /*! number of gauges */
+    int numGauges;
+
+    /*! gauges drawn over the line text */
+    LCDGauge gauges[LCD_MAX_GAUGES];
+
+    /*! number of labels */
+    int numLabels;
+
+    /*! static labels drawn over the line text, under the gauges */
+    LCDLabel labels[LCD_MAX_LABELS];
+
+    /*! character codes of the partially filled bar graph cells */
+    char barCodes[LCD_BAR_STEPS];
+} LCDPanel;
+
+typedef struct _LCD1602 LCD1602;
+typedef struct _LCDEventSource LCDEventSource;
+
+/*! event handler function, called when an event source is readable */
+typedef int (*LCDEventFn)( LCD1602 *pLCD, LCDEventSource *pSource );
+
+/*! The LCDEventSource structure associates a file descriptor in the
+ *  event loop with its handler */
+struct _LCDEventSource
+{
+    /*! file descriptor monitored by the event loop */
+    int fd;
+
+    /*! function called when the file descriptor is readable */
+    LCDEventFn handler;
+};
+
+/*! The LCDUpdateTag structure follows a row or frame update queued to
+ *  the render thread, so its latency can be recorded when it completes */
+struct _LCDUpdateTag
+{
+    /*! the tag belongs to a queued update */
+    bool inUse;
+
+    /*! pointer to the LCD1602 state object */
+    LCD1602 *pLCD;
+
+    /*! display being updated */
+    LCDPanel *pPanel;
+
+    /*! updated rows (bit n = row n) */
+    uint32_t rows;
+
+    /*! time at which the oldest change shown by the update was received */
+    struct timespec received;
+};
+
+/*! The LCDBusWorker structure holds one I2C bus and the render thread
+ *  which performs all of the I/O of the displays attached to it, so the
+ *  displays on different buses are updated in parallel */
+struct _LCDBusWorker
+{
+    /*! I2C bus */
+    LCDBus *pBus;
+
+    /*! render thread which performs the I/O on the bus */
+    LCDRender *pRender;
+
+    /*! render thread completion events */
+    LCDEventSource completions;
+
+    /*! bus trace of the displays on the bus, or NULL */
+    LCDTrace *pTrace;
+};
+
 /*! the LCD1602 structure manages the interface to the
- *  16 char by 2 line LCD display via the PCF8574 8-bit serial to
- *  parallel I/O expander */
-typedef struct _LCD1602
+ *  character LCD displays of the configured geometry via the PCF8574
+ *  8-bit serial to parallel I/O expanders on one or more I2C buses */
+struct _LCD1602
 {
-    /*! instance identifier */
+    /*! instance identifier of the first display */
     uint32_t instanceID;
 
     /*! verbose mode */
     bool verbose;
 
+    /*! exclusive I2C access requested */
+    bool exclusive;
+
+    /*! write completion mode */
+    LCDWriteMode writeMode;
+
+    /*! display panel geometry */
+    const LCDGeometry *pGeometry;
+
+    /*! run the driver benchmark instead of the service */
+    bool benchmark;
+
+    /*! display state file for warm starts, or NULL for a cold start */
+    char *stateFile;
+
+    /*! number of bus bytes held in the trace ring, 0 = no tracing */
+    size_t traceEvents;
+
+    /*! file the bus trace is saved to on exit, or NULL */
+    char *traceFile;
+
+    /*! bus trace file to replay instead of running the service, or NULL */
+    char *replayFile;
+
+    /*! replay the bus trace with its original timing */
+    bool replayPaced;
+
     /*! handle to the variable server */
     VARSERVER_HANDLE hVarServer;
 
-    /*! line 1 */
-    char line1[17];
+    /*! number of I2C buses */
+    int numBuses;
 
-    /*! line 2 */
-    char line2[17];
+    /*! the device of the first bus has been set with -d */
+    bool busNamed;
 
-    /*! LCD Device */
-    LCDDev *pDev;
+    /*! I2C buses, each with its own render thread */
+    LCDBusWorker buses[LCD_MAX_BUSES];
 
-    /*! handle to backlight system variable */
-    VAR_HANDLE hVarBacklight;
+    /*! number of displays */
+    int numPanels;
+
+    /*! displays */
+    LCDPanel panels[LCD_MAX_PANELS];
+
+    /*! default minimum time (ms) between line updates, 0 = no limit */
+    int refreshInterval;
+
+    /*! number of update policies */
+    int numPolicies;
+
+    /*! update policies */
+    LCDPolicy policies[LCD_MAX_POLICIES];
+
+    /*! line update latency histogram */
+    uint32_t latency[LCD_LATENCY_BUCKETS];
+
+    /*! queued display updates whose latency is being measured */
+    LCDUpdateTag updates[LCD_UPDATE_TAGS];
+
+    /*! index of the next update tag to allocate */
+    int nextUpdate;
+
+    /*! event loop epoll instance */
+    int epfd;
+
+    /*! variable server notification signals */
+    LCDEventSource signals;
 
-    /*! handle to line1 system variable */
-    VAR_HANDLE hVarLine1;
+    /*! display refresh timer */
+    LCDEventSource refreshTimer;
 
-    /*! handle to line2 system variable */
-    VAR_HANDLE hVarLine2;
-} LCD1602;
+    /*! time (CLOCK_MONOTONIC) the refresh timer is armed for,
+        or zero if it is not armed */
+    struct timespec refreshDue;
+
+    /*! time (ms) between marquee steps, 0 = long lines are truncated */
+    int marqueeInterval;
+
+    /*! marquee step timer */
+    LCDEventSource marqueeTimer;
+
+    /*! the marquee timer is running */
+    bool marqueeArmed;
+
+    /*! draw updates of several rows off screen, then shift them into view */
+    bool pageFlip;
+
+    /*! a termination signal was received through the event loop */
+    bool terminate;
+};
 
 /*==============================================================================
         Private file scoped variables
@@ -116,6 +571,15 @@ typedef struct _LCD1602
 /*! pointer to the LCD1602 state object */
 LCD1602 *pLCD;
 
+/*! names of the line variables (relative to the display namespace) */
+static char *lineNames[LCD_MAX_LINES] =
+{
+    "LINE1",
+    "LINE2",
+    "LINE3",
+    "LINE4"
+};
+
 /*==============================================================================
         Private function declarations
 ==============================================================================*/
@@ -126,22 +590,107 @@ static void usage( char *cmdname );
 static void SetupTerminationHandler( void );
 static void TerminationHandler( int signum, siginfo_t *info, void *ptr );
 static int run( LCD1602 *pLCD );
-static int WaitSignal( int *signum, int *id );
+static void BlockSignals( sigset_t *mask );
+static int SetupEventLoop( LCD1602 *pLCD );
+static int AddEventSource( LCD1602 *pLCD,
+                           LCDEventSource *pSource,
+                           int fd,
+                           LCDEventFn handler );
+static int OnSignalEvent( LCD1602 *pLCD, LCDEventSource *pSource );
+static int OnRefreshTimer( LCD1602 *pLCD, LCDEventSource *pSource );
+static int OnCompletionEvent( LCD1602 *pLCD, LCDEventSource *pSource );
+static int OnMarqueeTimer( LCD1602 *pLCD, LCDEventSource *pSource );
+static void ScheduleRefresh( LCD1602 *pLCD );
 static int HandleSignal( LCD1602 *pLCD, int signum, int id );
-static int SetupPrintNotifications( LCD1602 *pLCD );
-static int PrintStatus (LCD1602 *pLCD, int fd );
-
+static int SetupPrintNotifications( LCD1602 *pLCD, LCDPanel *pPanel );
+static int PrintStatus( LCD1602 *pLCD, LCDPanel *pPanel, int fd );
+
+static int InitPanels( LCD1602 *pLCD );
+static int AddBus( LCD1602 *pLCD, char *device );
+static int AddPinMap( LCD1602 *pLCD, char *spec );
+static int StartRender( LCD1602 *pLCD );
+static void StopRender( LCD1602 *pLCD );
+static int RunBenchmark( LCD1602 *pLCD );
+static int CheckBusyWrites( LCDPanel *pPanel );
+static int CheckSupersede( LCDPanel *pPanel );
+static int RunReplay( LCD1602 *pLCD );
+static void SaveTrace( LCD1602 *pLCD );
+static LCDPanel *FindPanel( LCD1602 *pLCD, VAR_HANDLE hVar );
+static int GetVarName( LCD1602 *pLCD,
+                       LCDPanel *pPanel,
+                       char *suffix,
+                       char *name,
+                       size_t len );
 
 static int SetupNotifications( LCD1602 *pLCD );
-static int SetupModifiedNotifications( LCD1602 *pLCD );
-static int SetupModifiedNotification( VARSERVER_HANDLE hVarServer,
-                                      char *name,
+static int SetupModifiedNotifications( LCD1602 *pLCD, LCDPanel *pPanel );
+static int SetupModifiedNotification( LCD1602 *pLCD,
+                                      LCDPanel *pPanel,
+                                      char *suffix,
                                       VAR_HANDLE *hVar );
 
 static int OnChange( LCD1602 *pLCD, VAR_HANDLE hVar );
-static int UpdateBacklight( LCD1602 *pLCD, VAR_HANDLE hVar );
-static int UpdateLine1( LCD1602 *pLCD );
-static int UpdateLine2( LCD1602 *pLCD );
+static int Refresh( LCD1602 *pLCD );
+static int NextRefresh( LCD1602 *pLCD );
+static int UpdateBacklight( LCD1602 *pLCD, LCDPanel *pPanel );
+static int UpdateLine( LCD1602 *pLCD, LCDPanel *pPanel, int line );
+static int UpdateFrame( LCD1602 *pLCD, LCDPanel *pPanel );
+static void ClearFrame( LCD1602 *pLCD, LCDPanel *pPanel );
+static void DrawFields( LCDPanel *pPanel, int row );
+static int UpdateGauges( LCD1602 *pLCD,
+                         LCDPanel *pPanel,
+                         struct timespec *now );
+static int DrawRow( LCD1602 *pLCD, LCDPanel *pPanel, int row );
+static int DrawFrame( LCD1602 *pLCD, LCDPanel *pPanel );
+static int FlipPage( LCD1602 *pLCD, LCDPanel *pPanel );
+static int AddGauge( LCD1602 *pLCD, char *spec );
+static int InitGauges( LCD1602 *pLCD, LCDPanel *pPanel );
+static int AddLabel( LCD1602 *pLCD, char *spec );
+static void InitLabels( LCD1602 *pLCD, LCDPanel *pPanel );
+static int SetupGaugeNotifications( LCD1602 *pLCD, LCDPanel *pPanel );
+static void LoadBarGlyphs( LCDPanel *pPanel );
+static void RenderGauge( LCDPanel *pPanel, LCDGauge *pGauge, VarObject *obj );
+static void RenderText( LCDGauge *pGauge, VarObject *obj );
+static void MarkRow( LCDPanel *pPanel,
+                     int row,
+                     int col,
+                     int width,
+                     LCDUpdatePolicy *pPolicy );
+static int AddPolicy( LCD1602 *pLCD, char *spec );
+static void InitPolicy( LCD1602 *pLCD,
+                        char *name,
+                        int interval,
+                        int deadline,
+                        LCDUpdatePolicy *pPolicy );
+static int TimeToUpdate( LCDUpdatePolicy *pPolicy, struct timespec *now );
+static int NextUpdate( LCDUpdatePolicy *pPolicy,
+                       struct timespec *now,
+                       int next );
+static bool StartUpdate( LCDUpdatePolicy *pPolicy, struct timespec *now );
+static void ResetMarquee( LCD1602 *pLCD, LCDPanel *pPanel );
+static void StepMarquee( LCD1602 *pLCD, LCDPanel *pPanel );
+static void UpdateMarqueeTimer( LCD1602 *pLCD );
+static int TextLength( char *text, int len );
+static void RecordLatency( LCD1602 *pLCD, struct timespec *start );
+static void MarkReceived( struct timespec *pReceived, struct timespec *t );
+static LCDUpdateTag *NewUpdateTag( LCD1602 *pLCD,
+                                   LCDPanel *pPanel,
+                                   uint32_t rows );
+static void UpdateQueued( LCDPanel *pPanel,
+                          LCDUpdateTag *pTag,
+                          uint32_t rows,
+                          int result );
+static void UpdateDone( void *arg, int result );
+static void PrintCounters( LCD1602 *pLCD, LCDPanel *pPanel, int fd );
+static int InitDisplay( LCD1602 *pLCD, LCDPanel *pPanel );
+static int InitPage( LCD1602 *pLCD, LCDPanel *pPanel );
+static int GetStateFileName( LCD1602 *pLCD,
+                             LCDPanel *pPanel,
+                             char *name,
+                             size_t len );
+static int MapDisplayState( LCD1602 *pLCD,
+                            LCDPanel *pPanel,
+                            LCDShadow *pSaved );
 
 /*==============================================================================
         Private function definitions
@@ -169,15 +718,26 @@ static int UpdateLine2( LCD1602 *pLCD );
 void main(int argc, char **argv)
 {
     LCD1602 state;
+    LCDPanel *pPanel;
+    sigset_t mask;
     int rc;
-    bool exclusive;
+    int i;
 
     /* clear the smartlcd_1602 state object */
     memset( &state, 0, sizeof( LCD1602 ) );
+    state.epfd = -1;
+    state.marqueeTimer.fd = -1;
 
     /* set default state */
     state.instanceID = 0;
-    state.pDev = InitDev();
+    state.buses[0].pBus = BusInit( LCD_DEFAULT_DEVICE );
+    state.numBuses = 1;
+    state.refreshInterval = 1000 / LCD_DEFAULT_REFRESH_RATE;
+    state.pGeometry = FindGeometry( LCD_GEOMETRY );
+    if ( state.pGeometry == NULL )
+    {
+        state.pGeometry = FindGeometry( "16x2" );
+    }
 
     pLCD = &state;
 
@@ -187,443 +747,4428 @@ void main(int argc, char **argv)
     /* process the command line options */
     ProcessOptions( argc, argv, &state );
 
+    if ( ( state.marqueeInterval > 0 ) &&
+         ( state.pGeometry->rows > 2 ) )
+    {
+        /* the display shift would move rows 3 and 4 into rows 1 and 2 */
+        syslog( LOG_WARNING,
+                "Marquee mode is not supported on %s displays\n",
+                state.pGeometry->name );
+        state.marqueeInterval = 0;
+    }
+
+    if ( ( state.pageFlip == true ) &&
+         ( ( state.marqueeInterval > 0 ) ||
+           ( state.pGeometry->rows > 2 ) ||
+           ( state.pGeometry->cols * 2 > LCD_DDRAM_COLS ) ) )
+    {
+        /* the second page needs display data RAM columns which are
+           not used for anything else */
+        syslog( LOG_WARNING,
+                "Page flipping is not supported on %s displays%s\n",
+                state.pGeometry->name,
+                ( state.marqueeInterval > 0 ) ? " in marquee mode" : "" );
+        state.pageFlip = false;
+    }
+
+    if ( state.replayFile != NULL )
+    {
+        /* feed a recorded trace into the bus without the displays */
+        exit( ( RunReplay( &state ) == EOK ) ? 0 : 1 );
+    }
+
+    for ( i = 0;
+          ( i < state.numBuses ) &&
+          ( ( state.traceEvents > 0 ) || ( state.traceFile != NULL ) );
+          i++ )
+    {
+        /* record the bus traffic of the displays on each bus */
+        state.buses[i].pTrace = TraceInit( ( state.traceEvents > 0 )
+                                             ? state.traceEvents
+                                             : LCD_TRACE_EVENTS );
+        if ( state.buses[i].pTrace == NULL )
+        {
+            syslog( LOG_ERR, "Cannot create the bus trace\n" );
+        }
+    }
+
+    /* create the LCD devices */
+    if ( InitPanels( &state ) != EOK )
+    {
+        syslog( LOG_ERR, "Cannot initialize LCD devices\n" );
+        exit( 1 );
+    }
+
+    if ( state.benchmark == true )
+    {
+        /* measure the driver without the variable server */
+        exit( ( RunBenchmark( &state ) == EOK ) ? 0 : 1 );
+    }
+
+    /* restore the displays without waiting for the variable server */
+    for ( i = 0; i < state.numPanels; i++ )
+    {
+        pPanel = &state.panels[i];
+        if ( InitDisplay( &state, pPanel ) != EOK )
+        {
+            syslog( LOG_ERR,
+                    "Cannot initialize LCD at 0x%02x\n",
+                    pPanel->address );
+        }
+
+        /* load the bar graph glyphs before the render
+           thread takes over the bus */
+        LoadBarGlyphs( pPanel );
+
+        /* display the initial content */
+        pPanel->dirty = LCD_DIRTY_ALL & ~LCD_DIRTY_BACKLIGHT;
+    }
+
+    /* notifications are received through the event loop */
+    BlockSignals( &mask );
+
     /* get a handle to the VAR server */
     state.hVarServer = VARSERVER_Open();
     if( state.hVarServer != NULL )
     {
-        /* open the LCD in exclusive mode if requested */
-        GetExclusive( pLCD->pDev, &exclusive );
-        rc = (exclusive == true) ? LCDOpen( pLCD->pDev ) : EOK;
+        /* open the LCDs in exclusive mode if requested */
+        rc = EOK;
+        for ( i = 0; ( i < state.numPanels ) && ( rc == EOK ); i++ )
+        {
+            rc = state.exclusive ? LCDOpen( state.panels[i].pDev ) : EOK;
+        }
+
         if ( rc == EOK )
         {
             /* set up notifications */
             if ( SetupNotifications( &state ) == EOK )
             {
-                if (LCDInit( pLCD->pDev ) == EOK )
+                /* hand the I2C buses over to the render threads */
+                if ( ( StartRender( &state ) == EOK ) &&
+                     ( SetupEventLoop( &state ) == EOK ) )
                 {
-                    UpdateLine1( pLCD );
-                    UpdateLine2( pLCD );
-
                     /* run the LCD1602 controller */
                     run( &state );
                 }
+
+                StopRender( &state );
+
             }
+        }
 
-            /* close the LCD device (if it is still open) */
-            SetExclusive( pLCD->pDev, false );
-            LCDClose( pLCD->pDev );
+        /* close the LCD devices (if they are still open) */
+        for ( i = 0; i < state.numPanels; i++ )
+        {
+            SetExclusive( state.panels[i].pDev, false );
+            LCDClose( state.panels[i].pDev );
         }
 
         /* close the variable server */
         VARSERVER_Close( state.hVarServer );
     }
+
+    /* the render threads have stopped, so the traces are complete */
+    SaveTrace( &state );
 }
 
 /*============================================================================*/
-/*  usage                                                                     */
+/*  InitPanels                                                                */
 /*!
-    Display the application usage
+    Create the LCD devices
 
-    The usage function dumps the application usage message
-    to stderr.
+    The InitPanels function creates an LCD device for each display
+    specified on the command line, or a single display at the default
+    address if none were specified.  Each LCD device uses the connection
+    of the bus it was added to (see AddBus()), which is shared with the
+    other displays on that bus, and is wired according to its pin map.
 
     @param[in]
-       cmdname
-            pointer to the invoked command name
+        pLCD
+            pointer to the LCD1602 controller state object
 
-    @return none
+    @retval EOK the LCD devices were created
+    @retval ENOMEM memory allocation failed
+    @retval EINVAL invalid arguments
 
 ==============================================================================*/
-static void usage( char *cmdname )
+static int InitPanels( LCD1602 *pLCD )
 {
-    if( cmdname != NULL )
+    int result = EINVAL;
+    LCDPanel *pPanel;
+    char *device = NULL;
+    int i;
+    int j;
+
+    if ( ( pLCD != NULL ) &&
+         ( pLCD->buses[0].pBus != NULL ) )
     {
-        fprintf(stderr,
-                "usage: %s [-a address] [-i instanceID] [-h] [-v]\n"
-                " [-h] : display this help\n"
-                " [-a address] : set PCF8574 device address\n"
-                " [-i instanceID] : set LCD instance ID\n"
-                " [-v] : verbose output\n",
-                cmdname );
+        result = EOK;
+
+        if ( pLCD->numPanels == 0 )
+        {
+            /* use a single display at the default address */
+            pLCD->panels[0].address = LCD_DEFAULT_ADDRESS;
+            pLCD->numPanels = 1;
+        }
+
+        for ( i = 0; ( i < pLCD->numPanels ) && ( result == EOK ); i++ )
+        {
+            pPanel = &pLCD->panels[i];
+            pPanel->instanceID = pLCD->instanceID + i;
+
+            if ( pPanel->pWorker == NULL )
+            {
+                /* displays added before any bus are on the first bus */
+                pPanel->pWorker = &pLCD->buses[0];
+            }
+
+            pPanel->pDev = InitDev();
+            if ( pPanel->pDev != NULL )
+            {
+                SetBus( pPanel->pDev, pPanel->pWorker->pBus );
+                SetAddress( pPanel->pDev, pPanel->address );
+                SetWriteMode( pPanel->pDev, pLCD->writeMode );
+                SetGeometry( pPanel->pDev, pLCD->pGeometry );
+                SetTrace( pPanel->pDev, pPanel->pWorker->pTrace );
+
+                if ( ( pPanel->pinMap.name != NULL ) &&
+                     ( SetPinMap( pPanel->pDev, &pPanel->pinMap ) != EOK ) )
+                {
+                    syslog( LOG_ERR,
+                            "Invalid pin map for LCD at 0x%02x\n",
+                            pPanel->address );
+                }
+                else if ( ( pPanel->pinMap.name != NULL ) &&
+                          ( GetBusDevice( pPanel->pWorker->pBus,
+                                          &device ) == EOK ) )
+                {
+                    /* an emulated display is wired in the same way */
+                    EmuSetPinMap( device, pPanel->address, &pPanel->pinMap );
+                }
+
+                /* the backlight is updated immediately by default */
+                InitPolicy( pLCD,
+                            "BACKLIGHT",
+                            0,
+                            0,
+                            &pPanel->backlightPolicy );
+
+                for ( j = 0; j < LCD_MAX_LINES; j++ )
+                {
+                    InitPolicy( pLCD,
+                                lineNames[j],
+                                pLCD->refreshInterval,
+                                LCD_RENDER_LINE_DEADLINE_MS,
+                                &pPanel->linePolicy[j] );
+                }
+
+                InitPolicy( pLCD,
+                            "FRAME",
+                            pLCD->refreshInterval,
+                            LCD_RENDER_LINE_DEADLINE_MS,
+                            &pPanel->framePolicy );
+
+                result = InitGauges( pLCD, pPanel );
+                InitLabels( pLCD, pPanel );
+                ClearFrame( pLCD, pPanel );
+                SetExclusive( pPanel->pDev, pLCD->exclusive );
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
     }
+
+    return result;
 }
 
 /*============================================================================*/
-/*  ProcessOptions                                                            */
+/*  AddBus                                                                    */
 /*!
-    Process the command line options
-
-    The ProcessOptions function processes the command line options and
-    populates the iotsend state object
+    Add an I2C bus
 
-    @param[in]
-        argC
-            number of arguments
-            (including the command itself)
+    The AddBus function processes a -d option.  The first -d option sets
+    the device of the default bus, and each further -d option adds
+    another bus.  The displays added by the -a options which follow are
+    attached to the new bus.
 
     @param[in]
-        argv
-            array of pointers to the command line arguments
+        pLCD
+            pointer to the LCD1602 controller state object
 
     @param[in]
-        pLCD
-            pointer to the LCD1602 object
+        device
+            I2C bus device name, eg /dev/i2c-1, or emu: for the emulator
 
-    @return 0
+    @retval EOK the bus was added
+    @retval ENOSPC too many buses
+    @retval ENOMEM memory allocation failed
+    @retval EINVAL invalid arguments
 
 ==============================================================================*/
-static int ProcessOptions( int argC,
-                           char *argV[],
-                           LCD1602 *pLCD )
+static int AddBus( LCD1602 *pLCD, char *device )
 {
-    int c;
     int result = EINVAL;
-    const char *options = "a:i:hve";
+    LCDBus *pBus;
 
-    if( ( pLCD != NULL ) &&
-        ( argV != NULL ) )
+    if ( ( pLCD != NULL ) &&
+         ( device != NULL ) )
     {
-        while( ( c = getopt( argC, argV, options ) ) != -1 )
+        if ( pLCD->busNamed == false )
         {
-            switch( c )
+            /* select the device of the default bus */
+            result = SetBusDevice( pLCD->buses[0].pBus, device );
+            pLCD->busNamed = ( result == EOK ) ? true : false;
+        }
+        else if ( pLCD->numBuses < LCD_MAX_BUSES )
+        {
+            pBus = BusInit( device );
+            if ( pBus != NULL )
             {
-                case 'a':
-                    SetAddress( pLCD->pDev, atoi( optarg ) );
-                    break;
+                pLCD->buses[pLCD->numBuses++].pBus = pBus;
+                result = EOK;
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+        else
+        {
+            result = ENOSPC;
+        }
+    }
 
-                case 'i':
-                    pLCD->instanceID = atoi( optarg );
-                    break;
+    return result;
+}
 
-                case 'e':
-                    /* open I2C interface in exclusive mode */
-                    SetExclusive( pLCD->pDev, true );
-                    break;
+/*============================================================================*/
+/*  AddPinMap                                                                 */
+/*!
+    Set the PCF8574 wiring of the last display added
 
-                case 'v':
-                    pLCD->verbose = true;
-                    break;
+    The AddPinMap function processes a -P option, which selects one of
+    the supported backpack wirings by name (see FindPinMap()), or lists
+    the PCF8574 port bits of the RS, RW, EN, backlight and D4-D7 signals,
+    optionally followed by "low" if the backlight is active low.
 
-                case 'h':
-                    usage( argV[0] );
-                    break;
+    eg -P mjkdz, or -P 6,5,4,7,0,1,2,3,low
 
-                default:
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state object
+
+    @param[in]
+        spec
+            pin map specification
+
+    @retval EOK the pin map was set
+    @retval EINVAL invalid arguments or pin map specification, including
+            a port bit above 7 or a port bit used by more than one signal
+
+==============================================================================*/
+static int AddPinMap( LCD1602 *pLCD, char *spec )
+{
+    int result = EINVAL;
+    LCDPanel *pPanel;
+    const LCDPinMap *pPinMap;
+    LCDPinMap pinMap;
+    uint8_t bits[8];
+    unsigned long bit;
+    char *field;
+    char *save = NULL;
+    char *end;
+    int n = 0;
+
+    if ( ( pLCD != NULL ) &&
+         ( spec != NULL ) )
+    {
+        pPanel = &pLCD->panels[ ( pLCD->numPanels > 0 )
+                                ? pLCD->numPanels - 1
+                                : 0 ];
+
+        pPinMap = FindPinMap( spec );
+        if ( pPinMap != NULL )
+        {
+            pPanel->pinMap = *pPinMap;
+            result = EOK;
+        }
+        else
+        {
+            memset( &pinMap, 0, sizeof( pinMap ) );
+            pinMap.name = "custom";
+
+            field = strtok_r( spec, ",", &save );
+            while ( ( field != NULL ) && ( n < 8 ) )
+            {
+                bit = strtoul( field, &end, 0 );
+                if ( ( end == field ) || ( *end != '\0' ) || ( bit > 7 ) )
+                {
                     break;
+                }
+
+                bits[n++] = (uint8_t)bit;
+                field = strtok_r( NULL, ",", &save );
+            }
+
+            if ( ( field != NULL ) && ( strcmp( field, "low" ) == 0 ) )
+            {
+                pinMap.ledActiveLow = true;
+                field = strtok_r( NULL, ",", &save );
+            }
 
+            if ( ( n == 8 ) && ( field == NULL ) )
+            {
+                pinMap.rs = bits[0];
+                pinMap.rw = bits[1];
+                pinMap.en = bits[2];
+                pinMap.led = bits[3];
+                memcpy( pinMap.data, &bits[4], sizeof( pinMap.data ) );
+
+                /* each signal must have its own port bit */
+                result = CheckPinMap( &pinMap );
+                if ( result == EOK )
+                {
+                    pPanel->pinMap = pinMap;
+                }
             }
         }
     }
 
-    return 0;
+    return result;
 }
 
 /*============================================================================*/
-/*  SetupTerminationHandler                                                   */
+/*  StartRender                                                               */
 /*!
-    Set up an abnormal termination handler
+    Start the render threads
 
-    The SetupTerminationHandler function registers a termination handler
-    function with the kernel in case of an abnormal termination of this
-    process.
+    The StartRender function creates and starts a render thread for each
+    I2C bus, which takes over all of the I/O of the displays on the bus.
+    The render threads of different buses run independently, so a slow
+    or busy bus does not hold up the displays on the others.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state object
+
+    @retval EOK the render threads were started
+    @retval ENOMEM memory allocation failed
+    @retval EINVAL invalid arguments
+    @retval other error from RenderStart()
 
 ==============================================================================*/
-static void SetupTerminationHandler( void )
+static int StartRender( LCD1602 *pLCD )
 {
-    static struct sigaction sigact;
-
-    memset( &sigact, 0, sizeof(sigact) );
+    int result = EINVAL;
+    LCDBusWorker *pWorker;
+    int i;
 
-    sigact.sa_sigaction = TerminationHandler;
-    sigact.sa_flags = SA_SIGINFO;
+    if ( pLCD != NULL )
+    {
+        result = EOK;
 
-    sigaction( SIGTERM, &sigact, NULL );
-    sigaction( SIGINT, &sigact, NULL );
+        for ( i = 0; ( i < pLCD->numBuses ) && ( result == EOK ); i++ )
+        {
+            pWorker = &pLCD->buses[i];
+            pWorker->pRender = RenderInit( pWorker->pBus );
+            result = ( pWorker->pRender != NULL )
+                     ? RenderStart( pWorker->pRender )
+                     : ENOMEM;
+        }
+    }
 
+    return result;
 }
 
 /*============================================================================*/
-/*  TerminationHandler                                                        */
+/*  StopRender                                                                */
 /*!
-    Abnormal termination handler
-
-    The TerminationHandler function will be invoked in case of an abnormal
-    termination of this process.  The termination handler closes
-    the connection with the variable server.
-
-@param[in]
-    signum
-        The signal which caused the abnormal termination (unused)
+    Stop the render threads
 
-@param[in]
-    info
-        pointer to a siginfo_t object (unused)
+    The StopRender function stops the render thread of each I2C bus
+    which was started by StartRender().
 
-@param[in]
-    ptr
-        signal context information (ucontext_t) (unused)
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state object
 
 ==============================================================================*/
-static void TerminationHandler( int signum, siginfo_t *info, void *ptr )
+static void StopRender( LCD1602 *pLCD )
 {
-    syslog( LOG_ERR, "Abnormal termination of statemachine\n" );
+    int i;
 
     if ( pLCD != NULL )
     {
-        if ( pLCD->hVarServer != NULL )
+        for ( i = 0; i < pLCD->numBuses; i++ )
         {
-            VARSERVER_Close( pLCD->hVarServer );
-            pLCD->hVarServer = NULL;
-
-            SetExclusive( pLCD->pDev, false );
-            LCDClose( pLCD->pDev );
-            pLCD = NULL;
+            if ( pLCD->buses[i].pRender != NULL )
+            {
+                RenderStop( pLCD->buses[i].pRender );
+            }
         }
     }
-
-    exit( 1 );
 }
 
 /*============================================================================*/
-/*  run                                                                       */
+/*  RunBenchmark                                                              */
 /*!
-    Run the LCD1602 controller
+    Run the driver benchmark
 
-    The run function loops forever waiting for signals from the
-    variable server or timer events.
+    The RunBenchmark function initializes the first display and runs
+    the driver benchmark on it, writing the results to stdout.
 
     @param[in]
         pLCD
             pointer to the LCD1602 controller state object
 
-    @retval EOK the LCD1602 controller completed successfully
+    @retval EOK the benchmark completed
     @retval EINVAL invalid arguments
+    @retval other error from LCDOpen(), LCDInit(), Benchmark(),
+            CheckBusyWrites() or CheckSupersede()
 
 ==============================================================================*/
-static int run( LCD1602 *pLCD )
+static int RunBenchmark( LCD1602 *pLCD )
 {
     int result = EINVAL;
-    int signum;
-    int id;
-    if ( pLCD != NULL )
+    LCDDev *pDev;
+
+    if ( ( pLCD != NULL ) &&
+         ( pLCD->numPanels > 0 ) )
     {
-        result = EOK;
+        pDev = pLCD->panels[0].pDev;
+
+        result = pLCD->exclusive ? LCDOpen( pDev ) : EOK;
+        if ( result == EOK )
+        {
+            result = LCDInit( pDev );
+        }
+
+        if ( result == EOK )
+        {
+            result = Benchmark( pDev, LCD_BENCH_ITERATIONS, STDOUT_FILENO );
+            if ( result == EOK )
+            {
+                result = CheckBusyWrites( &pLCD->panels[0] );
+            }
 
-        while( true )
+            if ( result == EOK )
+            {
+                result = CheckSupersede( &pLCD->panels[0] );
+            }
+        }
+        else
         {
-            WaitSignal( &signum, &id );
-            HandleSignal( pLCD, signum, id );
+            fprintf( stderr,
+                     "Cannot initialize LCD at 0x%02x: %s\n",
+                     pLCD->panels[0].address,
+                     strerror( result ) );
         }
+
+        SetExclusive( pDev, false );
+        LCDClose( pDev );
+
+        SaveTrace( pLCD );
     }
 
     return result;
 }
 
 /*============================================================================*/
-/*  WaitSignal                                                                */
+/*  CheckBusyWrites                                                           */
 /*!
-    Wait for a signal from the system
+    Check that the display was never written while it was busy
 
-    The WaitSignal function waits for either a variable calculation request
-    or timer expired signal from the system
+    When the benchmark is run on the emulator, the CheckBusyWrites
+    function reports the number of instructions and data bytes which
+    reached the emulated display while it was still executing the
+    previous one.  Neither write mode should ever do this, so the
+    benchmark fails if there were any.
 
-@param[in,out]
-    signum
-        Pointer to a location to store the received signal
-
-@param[in,out]
-    id
-        Pointer to a location to store the signal identifier
+    @param[in]
+        pPanel
+            pointer to the display which was benchmarked
 
-@retval 0 signal received successfully
-@retval -1 an error occurred
+    @retval EOK there were no busy writes, or the display is not emulated
+    @retval EIO the display was written while it was busy
+    @retval EINVAL invalid arguments
 
 ==============================================================================*/
-static int WaitSignal( int *signum, int *id )
+static int CheckBusyWrites( LCDPanel *pPanel )
 {
-    sigset_t mask;
-    siginfo_t info;
     int result = EINVAL;
-    int sig;
+    LCDEmuStats stats;
+    char *device = NULL;
 
-    if( ( signum != NULL ) &&
-        ( id != NULL ) )
+    if ( pPanel != NULL )
     {
-        /* create an empty signal set */
-        sigemptyset( &mask );
+        result = EOK;
+
+        if ( ( GetBusDevice( pPanel->pWorker->pBus, &device ) == EOK ) &&
+             ( EmuGetStats( device, pPanel->address, &stats ) == EOK ) )
+        {
+            dprintf( STDOUT_FILENO,
+                     "Emulator Busy Writes: %u\n",
+                     stats.busyWrites );
 
+            if ( stats.busyWrites != 0 )
+            {
+                fprintf( stderr,
+                         "LCD at 0x%02x was written while busy\n",
+                         pPanel->address );
+                result = EIO;
+            }
+        }
+    }
 
-        /* calc notification */
-        sigaddset( &mask, SIG_VAR_MODIFIED );
+    return result;
+}
 
-        /* print notification */
-        sigaddset( &mask, SIG_VAR_PRINT );
+/*============================================================================*/
+/*  CheckSupersede                                                            */
+/*!
+    Check that a narrower line update does not drop a wider one
 
-        /* apply signal mask */
-        sigprocmask( SIG_BLOCK, &mask, NULL );
+    When the benchmark is run on the emulator, the CheckSupersede
+    function submits a full row update followed by a narrower update at
+    the same display data address to a bus scheduler, and checks that
+    the characters of both updates reach the emulated display.
 
-        /* wait for the signal */
-        sig = sigwaitinfo( &mask, &info );
+    @param[in]
+        pPanel
+            pointer to the display which was benchmarked
 
-        /* return the signal information */
-        *signum = sig;
-        *id = info._sifields._timer.si_sigval.sival_int;
+    @retval EOK both updates were displayed, or the display is not emulated
+    @retval EIO the display does not show both updates
+    @retval ENOMEM the scheduler could not be created
+    @retval EINVAL invalid arguments
+    @retval other error from SchedSubmit() or SchedRun()
 
-        /* indicate success */
+==============================================================================*/
+static int CheckSupersede( LCDPanel *pPanel )
+{
+    int result = EINVAL;
+    LCDSched *pSched;
+    LCDOp op;
+    char *device = NULL;
+    const LCDGeometry *pGeometry;
+    char text[LCD_DDRAM_COLS + 1];
+    char expected[LCD_DDRAM_COLS + 1];
+    char *row = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123";
+    char *field = "wxyz";
+    int next = -1;
+
+    if ( pPanel != NULL )
+    {
         result = EOK;
+
+        if ( ( GetBusDevice( pPanel->pWorker->pBus, &device ) == EOK ) &&
+             ( EmuGetText( device,
+                           pPanel->address,
+                           0,
+                           text,
+                           sizeof( text ) ) == EOK ) )
+        {
+            pSched = SchedInit( pPanel->pWorker->pBus, NULL, NULL );
+            result = ( pSched != NULL ) ? BusOpen( pPanel->pWorker->pBus )
+                                        : ENOMEM;
+            if ( result == EOK )
+            {
+                /* start from a blank row so dropped characters show */
+                ClearDisplay( pPanel->pDev );
+
+                memset( &op, 0, sizeof( op ) );
+                op.type = LCD_OP_LINE;
+                op.pDev = pPanel->pDev;
+                op.priority = LCD_PRIO_NORMAL;
+                clock_gettime( CLOCK_MONOTONIC, &op.deadline );
+                strcpy( op.text, row );
+                result = SchedSubmit( pSched, &op );
+
+                op.width = strlen( field );
+                strcpy( op.text, field );
+                if ( result == EOK )
+                {
+                    result = SchedSubmit( pSched, &op );
+                }
+
+                do
+                {
+                    if ( next > 0 )
+                    {
+                        usleep( next * 1000 );
+                    }
+
+                    if ( result == EOK )
+                    {
+                        result = SchedRun( pSched, &next );
+                    }
+                } while ( ( result == EOK ) && ( next >= 0 ) );
+
+                BusRelease( pPanel->pWorker->pBus );
+            }
+
+            if ( result == EOK )
+            {
+                result = EmuGetText( device,
+                                     pPanel->address,
+                                     0,
+                                     text,
+                                     sizeof( text ) );
+            }
+
+            if ( ( result == EOK ) &&
+                 ( GetGeometry( pPanel->pDev, &pGeometry ) == EOK ) )
+            {
+                /* the field overwrites the start of the row */
+                strcpy( expected, row );
+                memcpy( expected, field, strlen( field ) );
+                if ( strncmp( text, expected, pGeometry->cols ) != 0 )
+                {
+                    fprintf( stderr,
+                             "LCD at 0x%02x shows '%.*s' not '%.*s'\n",
+                             pPanel->address,
+                             pGeometry->cols,
+                             text,
+                             pGeometry->cols,
+                             expected );
+                    result = EIO;
+                }
+            }
+
+            SchedDelete( pSched );
+        }
     }
 
     return result;
 }
 
 /*============================================================================*/
-/*  HandleSignal                                                              */
+/*  RunReplay                                                                 */
 /*!
-    Handle Received Signals
+    Replay a recorded bus trace
 
-    The HandleSignal function handles signals received from the system,
-    such as one of the following:
-        - SIG_VAR_PRINT
-        - SIG_VAR_MODIFIED
+    The RunReplay function loads the bus trace named by the -R option
+    and sends its bytes to the I2C bus (or emulator), writing the replay
+    statistics to stdout.  When replaying into the emulator, each
+    emulated display is wired in the same way as the recorded display.
 
     @param[in]
         pLCD
             pointer to the LCD1602 controller state object
 
-    @param[in]
-        signum
-            the number of the received signal. One of:
-            SIG_VAR_PRINT
-            SIG_VAR_MODIFIED
-
-    @param[in]
-        id
-            the id of the signal source
-
-    @retval EOK the signal was handled successfully
-    @retval ENOTSUP the signal was not supported
-    @retval ENOENT the channel was invalid
+    @retval EOK the trace was replayed
     @retval EINVAL invalid arguments
+    @retval other error from TraceLoad() or TraceReplay()
 
 ==============================================================================*/
-static int HandleSignal( LCD1602 *pLCD, int signum, int id )
+static int RunReplay( LCD1602 *pLCD )
 {
-    int sig;
-    VAR_HANDLE hVar;
-    int fd = -1;
     int result = EINVAL;
-    int ch;
+    LCDTraceEvent *events = NULL;
+    LCDTraceWiring wiring[LCD_TRACE_MAX_DEVICES];
+    LCDPinMap pinMap;
+    char *device = NULL;
+    size_t devices = 0;
+    size_t n = 0;
+    size_t i;
 
-    if ( pLCD != NULL )
+    if ( ( pLCD != NULL ) &&
+         ( pLCD->replayFile != NULL ) )
     {
-        if( sig == SIG_VAR_MODIFIED )
+        result = TraceLoad( pLCD->replayFile,
+                            &events,
+                            &n,
+                            wiring,
+                            &devices );
+        if ( result == EOK )
         {
-            /* get a handle to the ADC channel associated with
-             * the specified variable */
-            hVar = (VAR_HANDLE)id;
-            result = OnChange( pLCD, hVar );
+            GetBusDevice( pLCD->buses[0].pBus, &device );
+            for ( i = 0; i < devices; i++ )
+            {
+                /* wire each emulated display like the recorded one */
+                pinMap.name = "trace";
+                pinMap.rs = wiring[i].rs;
+                pinMap.rw = wiring[i].rw;
+                pinMap.en = wiring[i].en;
+                pinMap.led = wiring[i].led;
+                memcpy( pinMap.data, wiring[i].data, sizeof( pinMap.data ) );
+                pinMap.ledActiveLow = ( wiring[i].ledActiveLow != 0 );
+                EmuSetPinMap( device, wiring[i].address, &pinMap );
+            }
+
+            result = TraceReplay( pLCD->buses[0].pBus,
+                                  events,
+                                  n,
+                                  pLCD->replayPaced,
+                                  STDOUT_FILENO );
+            free( events );
         }
-        else if ( sig == SIG_VAR_PRINT )
+        else
         {
-            /* open a print session */
-            VAR_OpenPrintSession( pLCD->hVarServer,
-                                  id,
-                                  &hVar,
-                                  &fd );
+            fprintf( stderr,
+                     "Cannot load trace %s: %s\n",
+                     pLCD->replayFile,
+                     strerror( result ) );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SaveTrace                                                                 */
+/*!
+    Save the bus trace
 
-            /* print the file variable */
-            PrintStatus( pLCD, fd );
+    The SaveTrace function writes the recorded bus traces to the file
+    named by the -o option, if there is one.  The trace of the first bus
+    is written to the named file, and the traces of any further buses to
+    the named file with the bus number appended, eg lcd.trace.1
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state object
+
+==============================================================================*/
+static void SaveTrace( LCD1602 *pLCD )
+{
+    char name[BUFSIZ];
+    int rc;
+    int i;
+
+    if ( ( pLCD != NULL ) &&
+         ( pLCD->traceFile != NULL ) )
+    {
+        for ( i = 0; i < pLCD->numBuses; i++ )
+        {
+            if ( i == 0 )
+            {
+                snprintf( name, sizeof( name ), "%s", pLCD->traceFile );
+            }
+            else
+            {
+                snprintf( name, sizeof( name ), "%s.%d", pLCD->traceFile, i );
+            }
+
+            rc = ( pLCD->buses[i].pTrace != NULL )
+                 ? TraceSave( pLCD->buses[i].pTrace, name )
+                 : EOK;
+            if ( rc != EOK )
+            {
+                syslog( LOG_ERR,
+                        "Cannot save trace %s: %s\n",
+                        name,
+                        strerror( rc ) );
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  usage                                                                     */
+/*!
+    Display the application usage
+
+    The usage function dumps the application usage message
+    to stderr.
+
+    @param[in]
+       cmdname
+            pointer to the invoked command name
+
+    @return none
+
+==============================================================================*/
+static void usage( char *cmdname )
+{
+    if( cmdname != NULL )
+    {
+        fprintf(stderr,
+                "usage: %s [-a address] [-d device] [-i instanceID] [-h] [-v]"
+                " [-e] [-t] [-k idle_ms] [-r rate] [-g geometry]"
+                " [-m step_ms] [-n gauge] [-l label] [-p policy]"
+                " [-w statefile] [-f] [-b] [-c events] [-o tracefile]"
+                " [-R tracefile[,fast]] [-P pinmap]\n"
+                " [-h] : display this help\n"
+                " [-a address] : add a PCF8574 device address (0x03-0x77)"
+                " on the last\n"
+                "     bus added (may be repeated)\n"
+                " [-d device] : add an I2C bus device, or emu: for the"
+                " emulator\n"
+                "     (may be repeated, each bus has its own thread)\n"
+                " [-P standard|mjkdz|rs,rw,en,bl,d4,d5,d6,d7[,low]] :"
+                " PCF8574 wiring\n"
+                "     of the last display added\n"
+                " [-i instanceID] : set LCD instance ID of the first display\n"
+                " [-e] : exclusive I2C access\n"
+                " [-t] : timed writes (do not poll the busy flag)\n"
+                " [-k idle_ms] : hold idle I2C connection of the last bus"
+                " added open (ms)\n"
+                " [-r rate] : maximum line refresh rate (Hz), 0=no limit\n"
+                " [-g geometry] : display geometry, 16x2, 20x4 or 40x2\n"
+                " [-m step_ms] : scroll lines longer than the display"
+                " (ms per step)\n"
+                " [-n var,row,col,width[,num|bar|text[,min,max]]] :"
+                " show a variable\n"
+                "     on the last display added (may be repeated)\n"
+                " [-l row,col,text] : show a label on the last display added"
+                " (may be repeated)\n"
+                " [-p var,rate[,deadline_ms]] : update policy for a variable"
+                " (may be repeated)\n"
+                " [-w statefile] : warm start, keeping the display contents"
+                " if it is\n"
+                "     already set up, using the contents saved in statefile\n"
+                " [-f] : draw frames off screen and flip them into view\n"
+                " [-b] : benchmark the driver on the first display and exit\n"
+                " [-c events] : record the bus traffic in a ring of events\n"
+                " [-o tracefile] : save the bus traffic to tracefile on exit\n"
+                " [-R tracefile[,fast]] : replay tracefile into the bus"
+                " device and exit\n"
+                " [-v] : verbose output\n",
+                cmdname );
+    }
+}
+
+/*============================================================================*/
+/*  ProcessOptions                                                            */
+/*!
+    Process the command line options
+
+    The ProcessOptions function processes the command line options and
+    populates the iotsend state object
+
+    @param[in]
+        argC
+            number of arguments
+            (including the command itself)
+
+    @param[in]
+        argv
+            array of pointers to the command line arguments
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 object
+
+    @return 0
+
+==============================================================================*/
+static int ProcessOptions( int argC,
+                           char *argV[],
+                           LCD1602 *pLCD )
+{
+    int c;
+    int result = EINVAL;
+    const char *options = "a:d:i:hvetk:r:g:m:n:l:p:w:fbc:o:R:P:";
+    const LCDGeometry *pGeometry;
+    unsigned long address;
+    char *pFast;
+    char *end;
+    int rate;
+
+    if( ( pLCD != NULL ) &&
+        ( argV != NULL ) )
+    {
+        while( ( c = getopt( argC, argV, options ) ) != -1 )
+        {
+            switch( c )
+            {
+                case 'a':
+                    /* add a display on the last bus added */
+                    address = strtoul( optarg, &end, 0 );
+                    if ( ( end == optarg ) ||
+                         ( *end != '\0' ) ||
+                         ( address < LCD_MIN_ADDRESS ) ||
+                         ( address > LCD_MAX_ADDRESS ) )
+                    {
+                        fprintf( stderr, "Invalid address: %s\n", optarg );
+                    }
+                    else if ( pLCD->numPanels < LCD_MAX_PANELS )
+                    {
+                        pLCD->panels[pLCD->numPanels].pWorker =
+                            &pLCD->buses[pLCD->numBuses - 1];
+                        pLCD->panels[pLCD->numPanels++].address =
+                            (uint8_t)address;
+                    }
+                    break;
+
+                case 'd':
+                    /* add an I2C bus device (or emulator) */
+                    if ( AddBus( pLCD, optarg ) != EOK )
+                    {
+                        fprintf( stderr, "Cannot add bus: %s\n", optarg );
+                    }
+                    break;
+
+                case 'P':
+                    /* set the pin map of the last display added */
+                    if ( AddPinMap( pLCD, optarg ) != EOK )
+                    {
+                        fprintf( stderr, "Invalid pin map: %s\n", optarg );
+                    }
+                    break;
+
+                case 'i':
+                    pLCD->instanceID = atoi( optarg );
+                    break;
+
+                case 'e':
+                    /* open I2C interface in exclusive mode */
+                    pLCD->exclusive = true;
+                    break;
+
+                case 't':
+                    /* wait execution times instead of polling busy flag */
+                    pLCD->writeMode = LCD_WRITE_TIMED;
+                    break;
+
+                case 'k':
+                    /* set the idle timeout of the last bus added */
+                    SetIdleTimeout( pLCD->buses[pLCD->numBuses - 1].pBus,
+                                    atoi( optarg ) );
+                    break;
+
+                case 'r':
+                    /* set the maximum refresh rate */
+                    rate = atoi( optarg );
+                    pLCD->refreshInterval = ( rate > 0 ) ? 1000 / rate : 0;
+                    break;
+
+                case 'g':
+                    /* select the display geometry */
+                    pGeometry = FindGeometry( optarg );
+                    if ( pGeometry != NULL )
+                    {
+                        pLCD->pGeometry = pGeometry;
+                    }
+                    else
+                    {
+                        fprintf( stderr, "Unknown geometry: %s\n", optarg );
+                    }
+                    break;
+
+                case 'm':
+                    /* scroll long lines with the given step interval */
+                    pLCD->marqueeInterval = atoi( optarg );
+                    break;
+
+                case 'n':
+                    /* add a gauge to the last display added */
+                    if ( AddGauge( pLCD, optarg ) != EOK )
+                    {
+                        fprintf( stderr, "Invalid gauge: %s\n", optarg );
+                    }
+                    break;
+
+                case 'l':
+                    /* add a label to the last display added */
+                    if ( AddLabel( pLCD, optarg ) != EOK )
+                    {
+                        fprintf( stderr, "Invalid label: %s\n", optarg );
+                    }
+                    break;
+
+                case 'p':
+                    /* set the update policy of a variable */
+                    if ( AddPolicy( pLCD, optarg ) != EOK )
+                    {
+                        fprintf( stderr, "Invalid policy: %s\n", optarg );
+                    }
+                    break;
+
+                case 'w':
+                    /* warm start */
+                    pLCD->stateFile = optarg;
+                    break;
+
+                case 'f':
+                    /* double buffer the display in off screen columns */
+                    pLCD->pageFlip = true;
+                    break;
+
+                case 'b':
+                    /* run the driver benchmark */
+                    pLCD->benchmark = true;
+                    break;
+
+                case 'c':
+                    /* record the bus traffic */
+                    pLCD->traceEvents = strtoul( optarg, NULL, 0 );
+                    break;
+
+                case 'o':
+                    /* save the bus traffic on exit */
+                    pLCD->traceFile = optarg;
+                    break;
+
+                case 'R':
+                    /* replay a bus trace, with its timing unless ,fast */
+                    pLCD->replayFile = optarg;
+                    pLCD->replayPaced = true;
+                    pFast = strchr( optarg, ',' );
+                    if ( pFast != NULL )
+                    {
+                        *pFast++ = '\0';
+                        pLCD->replayPaced = ( strcmp( pFast, "fast" ) != 0 );
+                    }
+                    break;
+
+                case 'v':
+                    pLCD->verbose = true;
+                    break;
+
+                case 'h':
+                    usage( argV[0] );
+                    break;
+
+                default:
+                    break;
+
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*============================================================================*/
+/*  SetupTerminationHandler                                                   */
+/*!
+    Set up an abnormal termination handler
+
+    The SetupTerminationHandler function registers a termination handler
+    function with the kernel in case of an abnormal termination of this
+    process.
+
+==============================================================================*/
+static void SetupTerminationHandler( void )
+{
+    static struct sigaction sigact;
+
+    memset( &sigact, 0, sizeof(sigact) );
+
+    sigact.sa_sigaction = TerminationHandler;
+    sigact.sa_flags = SA_SIGINFO;
+
+    sigaction( SIGTERM, &sigact, NULL );
+    sigaction( SIGINT, &sigact, NULL );
+
+}
+
+/*============================================================================*/
+/*  TerminationHandler                                                        */
+/*!
+    Abnormal termination handler
+
+    The TerminationHandler function will be invoked in case of an abnormal
+    termination of this process.  The termination handler closes
+    the connection with the variable server.  Once the event loop is
+    set up, SIGTERM and SIGINT are received through its signalfd
+    instead, and main() shuts the service down.
+
+@param[in]
+    signum
+        The signal which caused the abnormal termination (unused)
+
+@param[in]
+    info
+        pointer to a siginfo_t object (unused)
+
+@param[in]
+    ptr
+        signal context information (ucontext_t) (unused)
+
+==============================================================================*/
+static void TerminationHandler( int signum, siginfo_t *info, void *ptr )
+{
+    int i;
+
+    syslog( LOG_ERR, "Abnormal termination of statemachine\n" );
+
+    if ( pLCD != NULL )
+    {
+        if ( pLCD->hVarServer != NULL )
+        {
+            VARSERVER_Close( pLCD->hVarServer );
+            pLCD->hVarServer = NULL;
+
+            for ( i = 0; i < pLCD->numPanels; i++ )
+            {
+                SetExclusive( pLCD->panels[i].pDev, false );
+                LCDClose( pLCD->panels[i].pDev );
+            }
+
+            pLCD = NULL;
+        }
+    }
+
+    exit( 1 );
+}
+
+/*============================================================================*/
+/*  run                                                                       */
+/*!
+    Run the LCD1602 controller
+
+    The run function loops waiting for events on the event loop
+    (see SetupEventLoop()): signals from the variable server, the
+    display refresh timer, and render thread completions, until a
+    termination signal is received.  A single
+    epoll_wait() call serves all of the event sources.
+
+    Changes to the display variables are coalesced, and the display
+    is refreshed with the latest values no more often than the
+    refresh interval.
+
+    All of the LCD device I/O is performed by the render thread, so
+    handling of signals (eg print requests) never waits for the bus.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state object
+
+    @retval EOK the LCD1602 controller was terminated by a signal
+    @retval EINVAL invalid arguments
+    @retval other error from epoll_wait()
+
+==============================================================================*/
+static int run( LCD1602 *pLCD )
+{
+    int result = EINVAL;
+    struct epoll_event events[LCD_MAX_EVENTS];
+    LCDEventSource *pSource;
+    int n;
+    int i;
+
+    if ( pLCD != NULL )
+    {
+        result = EOK;
+
+        while( ( result == EOK ) && ( pLCD->terminate == false ) )
+        {
+            n = epoll_wait( pLCD->epfd, events, LCD_MAX_EVENTS, -1 );
+            if ( n < 0 )
+            {
+                result = ( errno == EINTR ) ? EOK : errno;
+                continue;
+            }
+
+            for ( i = 0; i < n; i++ )
+            {
+                pSource = (LCDEventSource *)events[i].data.ptr;
+                pSource->handler( pLCD, pSource );
+            }
+
+            /* refresh now, or arm the timer for the next refresh */
+            ScheduleRefresh( pLCD );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BlockSignals                                                              */
+/*!
+    Block the variable server notification and termination signals
+
+    The BlockSignals function blocks normal delivery of the variable
+    server notification signals and of SIGTERM and SIGINT, so they can
+    be received through a signalfd by the event loop.  It must be called
+    before any notifications are requested, and before any other threads
+    are created, so that no notification is delivered to a thread which
+    does not expect it.
+
+    @param[out]
+        mask
+            pointer to the location to store the blocked signal set
+
+==============================================================================*/
+static void BlockSignals( sigset_t *mask )
+{
+    sigemptyset( mask );
+
+    /* calc notification */
+    sigaddset( mask, SIG_VAR_MODIFIED );
+
+    /* print notification */
+    sigaddset( mask, SIG_VAR_PRINT );
+
+    /* termination requests */
+    sigaddset( mask, SIGTERM );
+    sigaddset( mask, SIGINT );
+
+    /* apply signal mask */
+    sigprocmask( SIG_BLOCK, mask, NULL );
+}
+
+/*============================================================================*/
+/*  SetupEventLoop                                                            */
+/*!
+    Set up the LCD1602 controller event loop
+
+    The SetupEventLoop function creates the epoll instance used by run(),
+    and adds the following event sources to it:
+
+    - a signalfd for the variable server notification signals
+    - a timerfd for the display refresh timer
+    - the completion eventfd of the render thread of each bus
+    - a timerfd for the marquee steps (if marquee mode is enabled)
+
+    Further event sources can be added with AddEventSource().
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state object
+
+    @retval EOK the event loop was set up
+    @retval EINVAL invalid arguments
+    @retval other error from epoll_create1(), signalfd() or timerfd_create()
+
+==============================================================================*/
+static int SetupEventLoop( LCD1602 *pLCD )
+{
+    int result = EINVAL;
+    LCDBusWorker *pWorker;
+    sigset_t mask;
+    int fd;
+    int i;
+
+    if ( pLCD != NULL )
+    {
+        pLCD->epfd = epoll_create1( EPOLL_CLOEXEC );
+        result = ( pLCD->epfd != -1 ) ? EOK : errno;
+
+        if ( result == EOK )
+        {
+            BlockSignals( &mask );
+            fd = signalfd( -1, &mask, SFD_NONBLOCK | SFD_CLOEXEC );
+            result = ( fd != -1 )
+                   ? AddEventSource( pLCD, &pLCD->signals, fd, OnSignalEvent )
+                   : errno;
+        }
+
+        if ( result == EOK )
+        {
+            fd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+            result = ( fd != -1 )
+                   ? AddEventSource( pLCD,
+                                     &pLCD->refreshTimer,
+                                     fd,
+                                     OnRefreshTimer )
+                   : errno;
+        }
+
+        if ( ( result == EOK ) && ( pLCD->marqueeInterval > 0 ) )
+        {
+            fd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+            result = ( fd != -1 )
+                   ? AddEventSource( pLCD,
+                                     &pLCD->marqueeTimer,
+                                     fd,
+                                     OnMarqueeTimer )
+                   : errno;
+        }
+
+        for ( i = 0; ( i < pLCD->numBuses ) && ( result == EOK ); i++ )
+        {
+            pWorker = &pLCD->buses[i];
+            result = AddEventSource( pLCD,
+                                     &pWorker->completions,
+                                     RenderGetEventFd( pWorker->pRender ),
+                                     OnCompletionEvent );
+        }
+
+        if ( result == EOK )
+        {
+            /* show the initial content */
+            ScheduleRefresh( pLCD );
+        }
+        else
+        {
+            syslog( LOG_ERR,
+                    "Cannot set up event loop: %s\n",
+                    strerror( result ) );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  AddEventSource                                                            */
+/*!
+    Add an event source to the event loop
+
+    The AddEventSource function adds a file descriptor to the event loop.
+    The handler is called from run() whenever the file descriptor is
+    readable.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state object
+
+    @param[in]
+        pSource
+            pointer to the event source object, which must remain valid
+            while the event loop is running
+
+    @param[in]
+        fd
+            file descriptor to monitor
+
+    @param[in]
+        handler
+            function to call when the file descriptor is readable
+
+    @retval EOK the event source was added
+    @retval EINVAL invalid arguments
+    @retval other error from epoll_ctl()
+
+==============================================================================*/
+static int AddEventSource( LCD1602 *pLCD,
+                           LCDEventSource *pSource,
+                           int fd,
+                           LCDEventFn handler )
+{
+    int result = EINVAL;
+    struct epoll_event ev;
+
+    if ( ( pLCD != NULL ) &&
+         ( pSource != NULL ) &&
+         ( fd != -1 ) &&
+         ( handler != NULL ) )
+    {
+        pSource->fd = fd;
+        pSource->handler = handler;
+
+        memset( &ev, 0, sizeof( ev ) );
+        ev.events = EPOLLIN;
+        ev.data.ptr = pSource;
+
+        result = ( epoll_ctl( pLCD->epfd, EPOLL_CTL_ADD, fd, &ev ) == 0 )
+                    ? EOK
+                    : errno;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  OnSignalEvent                                                             */
+/*!
+    Handle the variable server notification and termination signals
+
+    The OnSignalEvent function reads all of the pending signals from
+    the signalfd and handles each of them.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state object
+
+    @param[in]
+        pSource
+            pointer to the signalfd event source
+
+    @retval EOK the signals were handled
+
+==============================================================================*/
+static int OnSignalEvent( LCD1602 *pLCD, LCDEventSource *pSource )
+{
+    struct signalfd_siginfo info;
+
+    while ( read( pSource->fd, &info, sizeof( info ) ) == sizeof( info ) )
+    {
+        HandleSignal( pLCD, info.ssi_signo, info.ssi_int );
+    }
+
+    return EOK;
+}
+
+/*============================================================================*/
+/*  OnRefreshTimer                                                            */
+/*!
+    Handle the display refresh timer
+
+    The OnRefreshTimer function acknowledges the refresh timer.  The
+    refresh itself is performed by ScheduleRefresh() once all of the
+    events have been handled.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state object
+
+    @param[in]
+        pSource
+            pointer to the timerfd event source
+
+    @retval EOK the timer was acknowledged
+
+==============================================================================*/
+static int OnRefreshTimer( LCD1602 *pLCD, LCDEventSource *pSource )
+{
+    uint64_t expirations;
+
+    if ( read( pSource->fd, &expirations, sizeof( expirations ) ) > 0 )
+    {
+        memset( &pLCD->refreshDue, 0, sizeof( pLCD->refreshDue ) );
+    }
+
+    return EOK;
+}
+
+/*============================================================================*/
+/*  OnCompletionEvent                                                         */
+/*!
+    Handle render thread completion events
+
+    The OnCompletionEvent function delivers the completions of
+    asynchronous render operations on the bus which owns the event
+    source.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state object
+
+    @param[in]
+        pSource
+            pointer to the completion eventfd event source of a bus
+
+    @retval EOK the completions were delivered
+
+==============================================================================*/
+static int OnCompletionEvent( LCD1602 *pLCD, LCDEventSource *pSource )
+{
+    int i;
+
+    for ( i = 0; i < pLCD->numBuses; i++ )
+    {
+        if ( &pLCD->buses[i].completions == pSource )
+        {
+            RenderDispatch( pLCD->buses[i].pRender );
+        }
+    }
+
+    return EOK;
+}
+
+/*============================================================================*/
+/*  OnMarqueeTimer                                                            */
+/*!
+    Handle the marquee step timer
+
+    The OnMarqueeTimer function advances the marquee on each display
+    which has a line too long to be shown at once.  Missed timer
+    expirations are not caught up, the marquee simply moves on by one
+    step.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state object
+
+    @param[in]
+        pSource
+            pointer to the timerfd event source
+
+    @retval EOK the timer was handled
+
+==============================================================================*/
+static int OnMarqueeTimer( LCD1602 *pLCD, LCDEventSource *pSource )
+{
+    uint64_t expirations;
+    int i;
+
+    if ( read( pSource->fd, &expirations, sizeof( expirations ) ) > 0 )
+    {
+        for ( i = 0; i < pLCD->numPanels; i++ )
+        {
+            StepMarquee( pLCD, &pLCD->panels[i] );
+        }
+    }
+
+    return EOK;
+}
+
+/*============================================================================*/
+/*  ScheduleRefresh                                                           */
+/*!
+    Refresh the displays, or schedule the next refresh
+
+    The ScheduleRefresh function refreshes the displays if a refresh is
+    due now.  Otherwise, if there are pending changes, it arms the
+    refresh timer for the time the refresh will be due.  The timer is
+    only re-armed if it has expired, or if the refresh is due before
+    the time it is armed for, so no system call is made while an early
+    enough refresh is already scheduled.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state object
+
+==============================================================================*/
+static void ScheduleRefresh( LCD1602 *pLCD )
+{
+    struct itimerspec its;
+    struct timespec due;
+    int timeout;
+
+    timeout = NextRefresh( pLCD );
+    if ( timeout == 0 )
+    {
+        Refresh( pLCD );
+
+        /* changes which could not be queued are retried later */
+        timeout = NextRefresh( pLCD );
+        if ( timeout == 0 )
+        {
+            timeout = 1;
+        }
+    }
+
+    if ( timeout > 0 )
+    {
+        clock_gettime( CLOCK_MONOTONIC, &due );
+        due.tv_sec += timeout / 1000;
+        due.tv_nsec += ( timeout % 1000 ) * 1000000L;
+        if ( due.tv_nsec >= 1000000000L )
+        {
+            due.tv_sec++;
+            due.tv_nsec -= 1000000000L;
+        }
+
+        /* a faster variable may need the refresh before the timer
+           expires */
+        if ( ( ( pLCD->refreshDue.tv_sec == 0 ) &&
+               ( pLCD->refreshDue.tv_nsec == 0 ) ) ||
+             ( due.tv_sec < pLCD->refreshDue.tv_sec ) ||
+             ( ( due.tv_sec == pLCD->refreshDue.tv_sec ) &&
+               ( due.tv_nsec < pLCD->refreshDue.tv_nsec ) ) )
+        {
+            memset( &its, 0, sizeof( its ) );
+            its.it_value = due;
+
+            if ( timerfd_settime( pLCD->refreshTimer.fd,
+                                  TFD_TIMER_ABSTIME,
+                                  &its,
+                                  NULL ) == 0 )
+            {
+                pLCD->refreshDue = due;
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  HandleSignal                                                              */
+/*!
+    Handle Received Signals
+
+    The HandleSignal function handles signals received from the system,
+    such as one of the following:
+        - SIG_VAR_PRINT
+        - SIG_VAR_MODIFIED
+        - SIGTERM
+        - SIGINT
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state object
+
+    @param[in]
+        signum
+            the number of the received signal. One of:
+            SIG_VAR_PRINT
+            SIG_VAR_MODIFIED
+            SIGTERM
+            SIGINT
+
+    @param[in]
+        id
+            the id of the signal source
+
+    @retval EOK the signal was handled successfully
+    @retval ENOTSUP the signal was not supported
+    @retval ENOENT the channel was invalid
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int HandleSignal( LCD1602 *pLCD, int signum, int id )
+{
+    VAR_HANDLE hVar;
+    LCDPanel *pPanel;
+    int fd = -1;
+    int result = EINVAL;
+
+    if ( pLCD != NULL )
+    {
+        if( signum == SIG_VAR_MODIFIED )
+        {
+            /* get a handle to the ADC channel associated with
+             * the specified variable */
+            hVar = (VAR_HANDLE)id;
+            result = OnChange( pLCD, hVar );
+        }
+        else if ( signum == SIG_VAR_PRINT )
+        {
+            /* open a print session */
+            VAR_OpenPrintSession( pLCD->hVarServer,
+                                  id,
+                                  &hVar,
+                                  &fd );
+
+            /* print the status of the display which owns the variable */
+            pPanel = FindPanel( pLCD, hVar );
+            if ( pPanel != NULL )
+            {
+                PrintStatus( pLCD, pPanel, fd );
+            }
+
+            /* Close the print session */
+            VAR_ClosePrintSession( pLCD->hVarServer,
+                                   id,
+                                   fd );
+
+            result = EOK;
+        }
+        else if ( ( signum == SIGTERM ) || ( signum == SIGINT ) )
+        {
+            /* leave the event loop so main() can shut down */
+            pLCD->terminate = true;
+            result = EOK;
+        }
+        else
+        {
+            /* unsupported notification type */
+            result = ENOTSUP;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetupNotifications                                                        */
+/*!
+    Set up notifications for the LCD1602 controller
+
+    The SetupNotifications function sets up the modified and render
+    notifications for each display managed by the LCD1602 controller.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state which contains a handle
+            to the variable server for requesting the notifications.
+
+    @retval EOK the notification was successfully requested
+    @retval ENOENT one or more of the requested variables was not found
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int SetupNotifications( LCD1602 *pLCD )
+{
+    int result = EINVAL;
+    LCDPanel *pPanel;
+    int i;
+
+    if ( pLCD != NULL )
+    {
+        result = EOK;
+
+        for ( i = 0; ( i < pLCD->numPanels ) && ( result == EOK ); i++ )
+        {
+            pPanel = &pLCD->panels[i];
+
+            result = SetupPrintNotifications( pLCD, pPanel );
+            if ( result == EOK )
+            {
+                result = SetupModifiedNotifications( pLCD, pPanel );
+            }
+
+            if ( result == EOK )
+            {
+                result = SetupGaugeNotifications( pLCD, pPanel );
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetupPrintNotifications                                                   */
+/*!
+    Set up a render notifications for a display
+
+    The SetupPrintNotifications function sets up the render notifications
+    for the STATUS variable of the specified display.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state which contains a handle
+            to the variable server for requesting the notifications.
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @retval EOK the notification was successfully requested
+    @retval ENOENT the requested variable was not found
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int SetupPrintNotifications( LCD1602 *pLCD, LCDPanel *pPanel )
+{
+    int result = EINVAL;
+    char name[LCD_VARNAME_LEN];
+    VAR_HANDLE hVar;
+
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) )
+    {
+        /* get a handle to the STATUS variable */
+        GetVarName( pLCD, pPanel, "STATUS", name, sizeof( name ) );
+        hVar = VAR_FindByName( pLCD->hVarServer, name );
+        if( hVar != VAR_INVALID )
+        {
+            /* request render notification for the status variable */
+            result = VAR_Notify( pLCD->hVarServer,
+                                 hVar,
+                                 NOTIFY_PRINT );
+            if ( result == EOK )
+            {
+                pPanel->hVarStatus = hVar;
+            }
+        }
+        else
+        {
+            /* requested variable not found */
+            result = ENOENT;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetupModifiedNotifications                                                */
+/*!
+    Set up modified notifications for a display
+
+    The SetupModifiedNotifications function sets up the modified
+    notifications for the specified display.
+
+    The variables being monitored are (relative to the display namespace):
+
+    BACKLIGHT
+    LINE1
+    LINE2
+    LINE3 and LINE4 (optional, displays with 4 rows)
+    FRAME (optional)
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state which contains a handle
+            to the variable server for requesting the notifications.
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @retval EOK the notifications were successfully requested
+    @retval ENOENT the requested variable was not found
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int SetupModifiedNotifications( LCD1602 *pLCD, LCDPanel *pPanel )
+{
+    int result = EINVAL;
+    int rc;
+    int i;
+
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) )
+    {
+        result = EOK;
+
+        rc = SetupModifiedNotification( pLCD,
+                                        pPanel,
+                                        "BACKLIGHT",
+                                        &(pPanel->hVarBacklight ) );
+        if ( rc != EOK )
+        {
+            result = rc;
+        }
+
+        for ( i = 0; i < pLCD->pGeometry->rows; i++ )
+        {
+            /* the rows after the second can also be set through FRAME,
+               so their line variables only need to exist if used */
+            rc = SetupModifiedNotification( pLCD,
+                                            pPanel,
+                                            lineNames[i],
+                                            &(pPanel->hVarLine[i] ) );
+            if ( ( rc != EOK ) &&
+                 ( ( rc != ENOENT ) || ( i < LCD_REQUIRED_LINES ) ) )
+            {
+                result = rc;
+            }
+        }
+
+        /* the frame variable only needs to exist if it is used */
+        rc = SetupModifiedNotification( pLCD,
+                                        pPanel,
+                                        "FRAME",
+                                        &(pPanel->hVarFrame ) );
+        if ( ( rc != EOK ) && ( rc != ENOENT ) )
+        {
+            result = rc;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetupModifiedNotification                                                 */
+/*!
+    Set up a modified notification for a display variable
+
+    The SetupModifiedNotification function sets up a modified notification
+    for the LCD1602 controller for the specified system variable of
+    a display.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @param[in]
+        suffix
+            name of the variable to monitor within the display namespace
+
+    @param[in]
+        hVar
+            pointer to a location to store the variable handle of
+            the variable being monitored
+
+    @retval EOK the notification was successfully requested
+    @retval ENOENT the requested variable was not found
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int SetupModifiedNotification( LCD1602 *pLCD,
+                                      LCDPanel *pPanel,
+                                      char *suffix,
+                                      VAR_HANDLE *hVar )
+{
+    int result = EINVAL;
+    char name[LCD_VARNAME_LEN];
+    VAR_HANDLE hdl;
+
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) &&
+         ( hVar != NULL ) &&
+         ( suffix != NULL ) )
+    {
+        /* get the variable handle given its name */
+        GetVarName( pLCD, pPanel, suffix, name, sizeof( name ) );
+        hdl = VAR_FindByName( pLCD->hVarServer, name );
+        if( hdl != VAR_INVALID )
+        {
+            /* request MODIFIED notification */
+            result = VAR_Notify( pLCD->hVarServer,
+                                 hdl,
+                                 NOTIFY_MODIFIED );
+            if ( result == EOK )
+            {
+                *hVar = hdl;
+            }
+        }
+        else
+        {
+            result = ENOENT;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GetVarName                                                                */
+/*!
+    Get the name of a display system variable
+
+    The GetVarName function builds the full name of a system variable
+    for the specified display.  If the controller manages a single
+    display with instance ID 0, the variables are /HW/LCD1602/<suffix>.
+    Otherwise each display has its own namespace
+    /HW/LCD1602/<instanceID>/<suffix>
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @param[in]
+        suffix
+            name of the variable within the display namespace, eg LINE1
+
+    @param[out]
+        name
+            pointer to the buffer to store the variable name
+
+    @param[in]
+        len
+            size of the name buffer
+
+    @retval EOK the name was created
+    @retval E2BIG the name buffer is too small
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int GetVarName( LCD1602 *pLCD,
+                       LCDPanel *pPanel,
+                       char *suffix,
+                       char *name,
+                       size_t len )
+{
+    int result = EINVAL;
+    int n;
+
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) &&
+         ( suffix != NULL ) &&
+         ( name != NULL ) )
+    {
+        if ( ( pLCD->numPanels == 1 ) && ( pPanel->instanceID == 0 ) )
+        {
+            n = snprintf( name, len, "/HW/LCD1602/%s", suffix );
+        }
+        else
+        {
+            n = snprintf( name,
+                          len,
+                          "/HW/LCD1602/%u/%s",
+                          pPanel->instanceID,
+                          suffix );
+        }
+
+        result = ( ( n >= 0 ) && ( (size_t)n < len ) ) ? EOK : E2BIG;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  FindPanel                                                                 */
+/*!
+    Find the display which owns a system variable
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        hVar
+            handle to one of the display system variables
+
+    @retval pointer to the display which owns the variable
+    @retval NULL the variable does not belong to any display
+
+==============================================================================*/
+static LCDPanel *FindPanel( LCD1602 *pLCD, VAR_HANDLE hVar )
+{
+    LCDPanel *pPanel = NULL;
+    LCDPanel *p;
+    int i;
+    int j;
+
+    if ( pLCD != NULL )
+    {
+        for ( i = 0; ( i < pLCD->numPanels ) && ( pPanel == NULL ); i++ )
+        {
+            p = &pLCD->panels[i];
+            if ( ( hVar == p->hVarBacklight ) ||
+                 ( hVar == p->hVarFrame ) ||
+                 ( hVar == p->hVarStatus ) )
+            {
+                pPanel = p;
+            }
+
+            for ( j = 0; ( j < LCD_MAX_LINES ) && ( pPanel == NULL ); j++ )
+            {
+                if ( hVar == p->hVarLine[j] )
+                {
+                    pPanel = p;
+                }
+            }
+
+            for ( j = 0; ( j < p->numGauges ) && ( pPanel == NULL ); j++ )
+            {
+                if ( hVar == p->gauges[j].hVar )
+                {
+                    pPanel = p;
+                }
+            }
+        }
+    }
+
+    return pPanel;
+}
+
+/*============================================================================*/
+/*  PrintStatus                                                               */
+/*!
+    Output the status of the LCD1602
+
+    The PrintStatus function prints the status of a display managed
+    by the LCD1602 controller.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @param[in]
+        fd
+            output file descriptor
+
+    @retval EOK the status was output successfully
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int PrintStatus( LCD1602 *pLCD, LCDPanel *pPanel, int fd )
+{
+    int result = EINVAL;
+    bool backlight = false;
+    int cx = 0;
+    int cy = 0;
+    char *device = "none";
+    uint8_t address = 0;
+    bool exclusive = false;
+    int idleTimeout = 0;
+    LCDBus *pBus = NULL;
+    LCDWriteMode mode = LCD_WRITE_BUSY_POLL;
+    const LCDGeometry *pGeometry = NULL;
+    const LCDPinMap *pPinMap = NULL;
+    LCDSchedStats stats;
+    LCDDev *pDev;
+    int row;
+
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) &&
+         ( fd != -1 ) )
+    {
+        pDev = pPanel->pDev;
+
+        GetBacklight( pDev, &backlight );
+        GetExclusive( pDev, &exclusive );
+        GetCursorX( pDev, &cx );
+        GetCursorY( pDev, &cy );
+        GetDeviceName( pDev, &device );
+        GetAddress( pDev, &address );
+        GetWriteMode( pDev, &mode );
+        GetGeometry( pDev, &pGeometry );
+        GetBus( pDev, &pBus );
+        GetIdleTimeout( pBus, &idleTimeout );
+
+        GetPinMap( pDev, &pPinMap );
+
+        memset( &stats, 0, sizeof( stats ) );
+        RenderGetStats( pPanel->pWorker->pRender, &stats );
+
+        dprintf(fd, "LCD1602 Status:\n");
+        dprintf(fd, "Instance: %u\n", pPanel->instanceID );
+        dprintf(fd, "Device: %s\n", device );
+        dprintf(fd, "Address: 0x%02x\n", address );
+        dprintf(fd, "Pin Map: %s\n",
+                ( pPinMap != NULL ) ? pPinMap->name : "unknown" );
+        dprintf(fd, "Geometry: %s\n",
+                ( pGeometry != NULL ) ? pGeometry->name : "unknown" );
+        dprintf(fd, "Exclusive: %s\n", exclusive ? "true" : "false" );
+        dprintf(fd, "Idle Timeout: %d ms\n", idleTimeout );
+        dprintf(fd, "Write Mode: %s\n",
+                mode == LCD_WRITE_TIMED ? "timed" : "busy-poll" );
+        dprintf(fd, "Refresh Interval: %d ms\n", pLCD->refreshInterval );
+        dprintf(fd, "Page Flip: %s\n", pLCD->pageFlip ? "true" : "false" );
+        dprintf(fd, "Display Origin: %d\n", pPanel->origin );
+        dprintf(fd, "Backlight Policy: %d ms, deadline %d ms\n",
+                pPanel->backlightPolicy.interval,
+                pPanel->backlightPolicy.deadline );
+        dprintf(fd, "Line1 Policy: %d ms, deadline %d ms\n",
+                pPanel->linePolicy[0].interval,
+                pPanel->linePolicy[0].deadline );
+        dprintf(fd, "Line2 Policy: %d ms, deadline %d ms\n",
+                pPanel->linePolicy[1].interval,
+                pPanel->linePolicy[1].deadline );
+        dprintf(fd, "Frame Policy: %d ms, deadline %d ms\n",
+                pPanel->framePolicy.interval,
+                pPanel->framePolicy.deadline );
+        dprintf(fd, "Bus Utilisation: %d%%\n", stats.utilisation );
+        dprintf(fd, "Pending Operations: %d\n", stats.pending );
+        dprintf(fd, "Late Operations: %u\n", stats.late );
+        dprintf(fd, "Resyncs: %u (%u failed)\n",
+                stats.resyncs,
+                stats.resyncFailures );
+        dprintf(fd, "Verbose: %s\n", pLCD->verbose ? "true" : "false" );
+        dprintf(fd, "Backlight: %s\n", backlight ? "ON" : "OFF" );
+
+        for ( row = 0; row < pLCD->pGeometry->rows; row++ )
+        {
+            dprintf(fd, "Line%d: %s\n", row + 1, pPanel->frame[row] );
+        }
+
+        dprintf(fd, "Cursor X: %d\n", cx );
+        dprintf(fd, "Cursor Y: %d\n", cy );
+
+        PrintCounters( pLCD, pPanel, fd );
+
+        if ( pPanel->pWorker->pTrace != NULL )
+        {
+            TracePrint( pPanel->pWorker->pTrace, fd );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  PrintCounters                                                             */
+/*!
+    Print the activity counters
+
+    The PrintCounters function prints the I2C bus and LCD device activity
+    counters, the number of coalesced updates, and the line update
+    latency histogram to the specified output file descriptor.
+
+    The counters are maintained by the render thread without locking,
+    so they are a close approximation while the display is being updated.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 state object
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @param[in]
+        fd
+            output file descriptor
+
+==============================================================================*/
+static void PrintCounters( LCD1602 *pLCD, LCDPanel *pPanel, int fd )
+{
+    LCDBusStats bus;
+    LCDDevStats dev;
+    int i;
+
+    memset( &bus, 0, sizeof( bus ) );
+    memset( &dev, 0, sizeof( dev ) );
+
+    GetBusStats( pPanel->pWorker->pBus, &bus );
+    GetDevStats( pPanel->pDev, &dev );
+
+    dprintf(fd, "Bus Writes: %llu\n", (unsigned long long)bus.writes );
+    dprintf(fd, "Bus Reads: %llu\n", (unsigned long long)bus.reads );
+    dprintf(fd, "Bus Transfers: %llu\n", (unsigned long long)bus.transfers );
+    dprintf(fd, "Bus Bytes: %llu\n", (unsigned long long)bus.bytes );
+    dprintf(fd, "Bus Syscalls: %llu\n", (unsigned long long)bus.syscalls );
+    dprintf(fd, "Bus Opens: %llu\n", (unsigned long long)bus.opens );
+    dprintf(fd, "Bus Closes: %llu\n", (unsigned long long)bus.closes );
+    dprintf(fd, "LCD Writes: %u\n", dev.writes );
+    dprintf(fd, "LCD Status Reads: %u\n", dev.statusReads );
+    dprintf(fd, "LCD Busy Polls: %u (max %u per write)\n",
+            dev.polls,
+            dev.maxPolls );
+    dprintf(fd, "LCD Poll Wait: %llu us\n",
+            (unsigned long long)dev.pollWaitUs );
+    dprintf(fd, "LCD Poll Timeouts: %u\n", dev.pollTimeouts );
+    dprintf(fd, "LCD I/O Errors: %u\n", dev.ioErrors );
+    dprintf(fd, "LCD Execution Time: data %u us, instruction %u us, "
+                "clear/home %u us\n",
+            dev.dataExecUs,
+            dev.instrExecUs,
+            dev.longExecUs );
+    dprintf(fd, "Coalesced Updates: %u\n", pPanel->coalesced );
+    dprintf(fd, "Line Update Latency:\n" );
+
+    for ( i = 0; i < LCD_LATENCY_BUCKETS; i++ )
+    {
+        if ( pLCD->latency[i] == 0 )
+        {
+            continue;
+        }
+
+        if ( i < LCD_LATENCY_BUCKETS - 1 )
+        {
+            dprintf(fd, "  < %u us: %u\n", 1U << i, pLCD->latency[i] );
+        }
+        else
+        {
+            dprintf(fd, "  >= %u us: %u\n", 1U << ( i - 1 ), pLCD->latency[i] );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  RecordLatency                                                             */
+/*!
+    Record the latency of a line update
+
+    The RecordLatency function adds the time since the start of a line
+    update to the line update latency histogram.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 state object
+
+    @param[in]
+        start
+            pointer to the time the change shown by the update was received
+
+==============================================================================*/
+static void RecordLatency( LCD1602 *pLCD, struct timespec *start )
+{
+    struct timespec now;
+    long us;
+    int i = 0;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    us = ( now.tv_sec - start->tv_sec ) * 1000000L +
+         ( now.tv_nsec - start->tv_nsec ) / 1000L;
+
+    while ( ( i < LCD_LATENCY_BUCKETS - 1 ) && ( us >= ( 1L << i ) ) )
+    {
+        i++;
+    }
+
+    pLCD->latency[i]++;
+}
+
+/*============================================================================*/
+/*  MarkReceived                                                              */
+/*!
+    Record the time at which a change was received
+
+    The MarkReceived function records the time at which a change was
+    received, unless an earlier change is already recorded, so the
+    latency of the update which shows the change is measured from the
+    oldest change it shows.
+
+    @param[in,out]
+        pReceived
+            pointer to the recorded time (0 = none)
+
+    @param[in]
+        t
+            pointer to the time the change was received (0 = none)
+
+==============================================================================*/
+static void MarkReceived( struct timespec *pReceived, struct timespec *t )
+{
+    if ( ( ( t->tv_sec != 0 ) || ( t->tv_nsec != 0 ) ) &&
+         ( ( ( pReceived->tv_sec == 0 ) && ( pReceived->tv_nsec == 0 ) ) ||
+           ( t->tv_sec < pReceived->tv_sec ) ||
+           ( ( t->tv_sec == pReceived->tv_sec ) &&
+             ( t->tv_nsec < pReceived->tv_nsec ) ) ) )
+    {
+        *pReceived = *t;
+    }
+}
+
+/*============================================================================*/
+/*  NewUpdateTag                                                              */
+/*!
+    Allocate a tag to measure the latency of a display update
+
+    The NewUpdateTag function allocates a tag for an update of the
+    specified rows, which records when the oldest change shown by the
+    update was received.  The tag is passed to the completion function
+    of the update (see UpdateDone()), and must be handed back with
+    UpdateQueued() once the update has been submitted.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 state object
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @param[in]
+        rows
+            rows shown by the update (bit n = row n)
+
+    @retval pointer to the update tag
+    @retval NULL none of the rows have changed, or there is no free tag,
+            so the latency of the update is not measured
+
+==============================================================================*/
+static LCDUpdateTag *NewUpdateTag( LCD1602 *pLCD,
+                                   LCDPanel *pPanel,
+                                   uint32_t rows )
+{
+    LCDUpdateTag *pTag = NULL;
+    struct timespec oldest;
+    int row;
+    int i;
+
+    memset( &oldest, 0, sizeof( oldest ) );
+
+    for ( row = 0; row < LCD_MAX_ROWS; row++ )
+    {
+        if ( rows & ( 1 << row ) )
+        {
+            MarkReceived( &oldest, &pPanel->received[row] );
+        }
+    }
+
+    for ( i = 0;
+          ( i < LCD_UPDATE_TAGS ) &&
+          ( ( oldest.tv_sec != 0 ) || ( oldest.tv_nsec != 0 ) );
+          i++ )
+    {
+        pTag = &pLCD->updates[pLCD->nextUpdate];
+        pLCD->nextUpdate = ( pLCD->nextUpdate + 1 ) % LCD_UPDATE_TAGS;
+
+        if ( pTag->inUse == false )
+        {
+            pTag->inUse = true;
+            pTag->pLCD = pLCD;
+            pTag->pPanel = pPanel;
+            pTag->rows = rows;
+            pTag->received = oldest;
+            break;
+        }
+
+        pTag = NULL;
+    }
+
+    return pTag;
+}
+
+/*============================================================================*/
+/*  UpdateQueued                                                              */
+/*!
+    Hand back an update tag once the update has been submitted
+
+    The UpdateQueued function records that the changes to the specified
+    rows have been queued to the display, so the next change to one of
+    them starts a new latency measurement.  If the update could not be
+    queued, the tag is freed and the changes remain waiting.
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @param[in]
+        pTag
+            pointer to the update tag, or NULL
+
+    @param[in]
+        rows
+            rows shown by the update (bit n = row n)
+
+    @param[in]
+        result
+            result of submitting the update
+
+==============================================================================*/
+static void UpdateQueued( LCDPanel *pPanel,
+                          LCDUpdateTag *pTag,
+                          uint32_t rows,
+                          int result )
+{
+    int row;
+
+    if ( result == EOK )
+    {
+        for ( row = 0; row < LCD_MAX_ROWS; row++ )
+        {
+            if ( rows & ( 1 << row ) )
+            {
+                pPanel->received[row].tv_sec = 0;
+                pPanel->received[row].tv_nsec = 0;
+
+                if ( pTag != NULL )
+                {
+                    pPanel->pUpdate[row] = pTag;
+                }
+            }
+        }
+    }
+    else if ( pTag != NULL )
+    {
+        pTag->inUse = false;
+    }
+}
+
+/*============================================================================*/
+/*  UpdateDone                                                                */
+/*!
+    Handle the completion of a display update
+
+    The UpdateDone function is the completion function of the row and
+    frame updates (see DrawRow() and DrawFrame()).  It is called on the
+    main thread once the update has been written to the display, and
+    records the latency of the update from when the oldest change it
+    shows was received.
+
+    An update which was replaced by a later update of the same rows
+    completes with ECANCELED.  Its changes are shown by the later
+    update, so the later update is measured from when they were received.
+
+    @param[in]
+        arg
+            pointer to the update tag
+
+    @param[in]
+        result
+            result of the update
+
+==============================================================================*/
+static void UpdateDone( void *arg, int result )
+{
+    LCDUpdateTag *pTag = (LCDUpdateTag *)arg;
+    LCDPanel *pPanel;
+    LCDUpdateTag *pLatest;
+    int row;
+
+    if ( pTag != NULL )
+    {
+        pPanel = pTag->pPanel;
+
+        if ( result == EOK )
+        {
+            RecordLatency( pTag->pLCD, &pTag->received );
+        }
+
+        for ( row = 0; row < LCD_MAX_ROWS; row++ )
+        {
+            if ( ( pTag->rows & ( 1 << row ) ) == 0 )
+            {
+                continue;
+            }
+
+            pLatest = pPanel->pUpdate[row];
+            if ( pLatest == pTag )
+            {
+                pPanel->pUpdate[row] = NULL;
+            }
+            else if ( ( result == ECANCELED ) && ( pLatest != NULL ) )
+            {
+                MarkReceived( &pLatest->received, &pTag->received );
+            }
+        }
+
+        pTag->inUse = false;
+    }
+}
+
+/*============================================================================*/
+/*  OnChange                                                                  */
+/*!
+    Handle a change to a system variable
+
+    The OnChange function handles a change to one of the following
+    variables of any of the displays:
+
+    /HW/LCD1602/BACKLIGHT
+    /HW/LCD1602/LINE1 to /HW/LCD1602/LINE4
+    /HW/LCD1602/FRAME
+
+    Any change to these variables marks the variable as dirty.  The
+    attached LCD1602 hardware is updated with the latest value of each
+    dirty variable on the next display refresh (see Refresh()), so
+    intermediate values of rapidly changing variables are dropped.
+    The time of the oldest change which has not been read yet is kept
+    with the update policy of the variable, so the latency of the row
+    update which shows it can be measured (see UpdateDone()).
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        hVar
+            handle to the variable which changed
+
+    @retval EOK the change was handled successfully
+    @retval ENOENT the variable is not one of the display variables
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int OnChange( LCD1602 *pLCD, VAR_HANDLE hVar )
+{
+    int result = EINVAL;
+    LCDPanel *pPanel;
+    uint32_t flag = 0;
+    struct timespec now;
+    int i;
+
+    if ( pLCD != NULL )
+    {
+        clock_gettime( CLOCK_MONOTONIC, &now );
+
+        pPanel = FindPanel( pLCD, hVar );
+        if ( pPanel != NULL )
+        {
+            if ( hVar == pPanel->hVarBacklight )
+            {
+                flag = LCD_DIRTY_BACKLIGHT;
+            }
+            else if ( hVar == pPanel->hVarFrame )
+            {
+                flag = LCD_DIRTY_FRAME;
+                MarkReceived( &pPanel->framePolicy.received, &now );
+            }
+
+            for ( i = 0; i < LCD_MAX_LINES; i++ )
+            {
+                if ( hVar == pPanel->hVarLine[i] )
+                {
+                    flag = LCD_DIRTY_LINE( i );
+                    MarkReceived( &pPanel->linePolicy[i].received, &now );
+                }
+            }
+
+            for ( i = 0; i < pPanel->numGauges; i++ )
+            {
+                if ( hVar == pPanel->gauges[i].hVar )
+                {
+                    pPanel->gauges[i].dirty = true;
+                    flag = LCD_DIRTY_GAUGES;
+                    MarkReceived( &pPanel->gauges[i].policy.received, &now );
+                }
+            }
+        }
+
+        if ( flag != 0 )
+        {
+            if ( pPanel->dirty & flag )
+            {
+                /* the pending update is superseded by this one */
+                pPanel->coalesced++;
+            }
+
+            pPanel->dirty |= flag;
+            result = EOK;
+        }
+        else
+        {
+            result = ENOENT;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  NextRefresh                                                               */
+/*!
+    Get the time until the next display refresh is due
+
+    The NextRefresh function calculates how long to wait before the
+    next pending display change may be written to the hardware.  Each
+    changed variable is due when the minimum time between updates set
+    by its update policy has passed since it was last updated, so the
+    refresh is due when the first of the changed variables is due.  A
+    row which could not be queued on the previous refresh, or a page
+    which could not be shifted into view, is due now.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @retval -1 there are no pending changes
+    @retval 0 the refresh is due now
+    @retval >0 time (ms) until the refresh is due
+
+==============================================================================*/
+static int NextRefresh( LCD1602 *pLCD )
+{
+    int result = -1;
+    struct timespec now;
+    LCDPanel *pPanel;
+    int i;
+    int j;
+
+    if ( pLCD != NULL )
+    {
+        clock_gettime( CLOCK_MONOTONIC, &now );
+
+        for ( i = 0; ( i < pLCD->numPanels ) && ( result != 0 ); i++ )
+        {
+            pPanel = &pLCD->panels[i];
+
+            if ( ( pPanel->redraw != 0 ) ||
+                 ( pPanel->flipPending == true ) )
+            {
+                result = 0;
+                continue;
+            }
+
+            if ( pPanel->dirty & LCD_DIRTY_BACKLIGHT )
+            {
+                result = NextUpdate( &pPanel->backlightPolicy, &now, result );
+            }
+
+            for ( j = 0; j < pLCD->pGeometry->rows; j++ )
+            {
+                if ( pPanel->dirty & LCD_DIRTY_LINE( j ) )
+                {
+                    result = NextUpdate( &pPanel->linePolicy[j],
+                                         &now,
+                                         result );
+                }
+            }
+
+            if ( pPanel->dirty & LCD_DIRTY_FRAME )
+            {
+                result = NextUpdate( &pPanel->framePolicy, &now, result );
+            }
+
+            for ( j = 0; j < pPanel->numGauges; j++ )
+            {
+                if ( pPanel->gauges[j].dirty == true )
+                {
+                    result = NextUpdate( &pPanel->gauges[j].policy,
+                                         &now,
+                                         result );
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Refresh                                                                   */
+/*!
+    Refresh the displays
+
+    The Refresh function gets the latest value of each changed variable
+    whose update is due according to its update policy, and queues the
+    rows of the displays which they affect to the render thread for
+    output to the LCD1602 hardware.  A changed variable which is not yet
+    due remains pending until a later refresh, so intermediate values
+    of a rapidly changing variable are dropped.
+
+    Each row is composed from its line text and the labels and gauges
+    drawn over it, and is queued once however many of its variables
+    have changed, with the shortest deadline of those variables, and
+    only the span of the row holding them.  When more than one
+    row of a display has changed, all of its rows are queued together
+    as one frame (see DrawFrame()), so the display never shows some
+    rows updated and others not.  Any row or frame which could not be
+    queued because the render thread is behind remains pending, and is
+    retried on the next refresh.  A frame is always retried as a whole.
+
+    The updates for all of the displays are queued together, so the
+    render thread can submit them to the bus in one batch.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @retval EOK the display refresh was queued successfully
+    @retval EINVAL invalid arguments
+    @retval other error from one of the update functions or DrawRow()
+
+==============================================================================*/
+static int Refresh( LCD1602 *pLCD )
+{
+    int result = EINVAL;
+    LCDPanel *pPanel;
+    struct timespec now;
+    bool restart;
+    int rc;
+    int i;
+    int row;
+
+    if ( pLCD != NULL )
+    {
+        result = EOK;
+
+        clock_gettime( CLOCK_MONOTONIC, &now );
+
+        for ( i = 0; i < pLCD->numPanels; i++ )
+        {
+            pPanel = &pLCD->panels[i];
+            restart = false;
+
+            if ( ( pPanel->dirty & LCD_DIRTY_BACKLIGHT ) &&
+                 ( StartUpdate( &pPanel->backlightPolicy, &now ) == true ) )
+            {
+                pPanel->dirty &= ~LCD_DIRTY_BACKLIGHT;
+
+                rc = UpdateBacklight( pLCD, pPanel );
+                if ( rc == EAGAIN )
+                {
+                    /* try again on the next refresh */
+                    pPanel->dirty |= LCD_DIRTY_BACKLIGHT;
+                }
+                else if ( rc != EOK )
+                {
+                    result = rc;
+                }
+            }
+
+            for ( row = 0; row < pLCD->pGeometry->rows; row++ )
+            {
+                if ( ( ( pPanel->dirty & LCD_DIRTY_LINE( row ) ) == 0 ) ||
+                     ( StartUpdate( &pPanel->linePolicy[row],
+                                    &now ) == false ) )
+                {
+                    continue;
+                }
+
+                pPanel->dirty &= ~LCD_DIRTY_LINE( row );
+
+                rc = UpdateLine( pLCD, pPanel, row );
+                if ( rc == EOK )
+                {
+                    MarkRow( pPanel,
+                             row,
+                             0,
+                             LCD_DDRAM_COLS,
+                             &pPanel->linePolicy[row] );
+                    restart = true;
+                }
+                else
+                {
+                    result = rc;
+                }
+            }
+
+            if ( ( pPanel->dirty & LCD_DIRTY_FRAME ) &&
+                 ( StartUpdate( &pPanel->framePolicy, &now ) == true ) )
+            {
+                pPanel->dirty &= ~LCD_DIRTY_FRAME;
+
+                rc = UpdateFrame( pLCD, pPanel );
+                if ( rc == EOK )
+                {
+                    for ( row = 0; row < pLCD->pGeometry->rows; row++ )
+                    {
+                        MarkRow( pPanel,
+                                 row,
+                                 0,
+                                 LCD_DDRAM_COLS,
+                                 &pPanel->framePolicy );
+                    }
+
+                    restart = true;
+                }
+                else if ( rc != ENODATA )
+                {
+                    result = rc;
+                }
+            }
+
+            if ( pPanel->dirty & LCD_DIRTY_GAUGES )
+            {
+                rc = UpdateGauges( pLCD, pPanel, &now );
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+            }
+
+            if ( pPanel->flipPending == true )
+            {
+                /* a new page has been drawn but is not shown yet.  Only
+                   the flip is retried, and nothing is drawn until it is
+                   shown, as a row would be drawn on the page which is
+                   about to be hidden */
+                rc = FlipPage( pLCD, pPanel );
+                if ( ( rc != EOK ) && ( rc != EAGAIN ) )
+                {
+                    result = rc;
+                }
+            }
+            else if ( ( pPanel->redraw & ( pPanel->redraw - 1 ) ) != 0 )
+            {
+                /* several rows have changed, draw them together.  If the
+                   frame cannot be queued, the rows stay marked and the
+                   whole frame is tried again on the next refresh, so
+                   they are never drawn one at a time */
+                rc = DrawFrame( pLCD, pPanel );
+                if ( rc != EAGAIN )
+                {
+                    pPanel->redraw = 0;
+                }
+
+                if ( ( rc != EOK ) && ( rc != EAGAIN ) )
+                {
+                    result = rc;
+                }
+            }
+            else
+            {
+                for ( row = 0; row < pLCD->pGeometry->rows; row++ )
+                {
+                    if ( ( pPanel->redraw & ( 1 << row ) ) == 0 )
+                    {
+                        continue;
+                    }
+
+                    rc = DrawRow( pLCD, pPanel, row );
+                    if ( rc != EAGAIN )
+                    {
+                        /* the row is done, unless it must be tried
+                           again on the next refresh */
+                        pPanel->redraw &= ~( 1 << row );
+                    }
+
+                    if ( ( rc != EOK ) && ( rc != EAGAIN ) )
+                    {
+                        result = rc;
+                    }
+                }
+            }
+
+            if ( ( restart == true ) && ( pLCD->marqueeInterval > 0 ) )
+            {
+                /* the text has changed, start the marquee again */
+                ResetMarquee( pLCD, pPanel );
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MarkRow                                                                   */
+/*!
+    Mark a display row for redrawing
+
+    The MarkRow function marks the columns of a row of a display which
+    hold a variable to be redrawn by DrawRow() because the variable has
+    changed.  Only the span of the row from the first to the last marked
+    column is redrawn, so a change to one field does not resend the rest
+    of the row.  The row is drawn with the shortest deadline of the
+    variables which have changed since it was last drawn, and its
+    latency is measured from the oldest change it shows.
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @param[in]
+        row
+            display row (0 = first row)
+
+    @param[in]
+        col
+            first column of the variable
+
+    @param[in]
+        width
+            number of columns of the variable
+
+    @param[in]
+        pPolicy
+            pointer to the update policy of the changed variable
+
+==============================================================================*/
+static void MarkRow( LCDPanel *pPanel,
+                     int row,
+                     int col,
+                     int width,
+                     LCDUpdatePolicy *pPolicy )
+{
+    MarkReceived( &pPanel->received[row], &pPolicy->started );
+
+    if ( ( pPanel->redraw & ( 1 << row ) ) == 0 )
+    {
+        pPanel->rowDeadline[row] = pPolicy->deadline;
+        pPanel->redrawFirst[row] = col;
+        pPanel->redrawEnd[row] = col + width;
+        pPanel->redraw |= ( 1 << row );
+    }
+    else
+    {
+        if ( pPolicy->deadline < pPanel->rowDeadline[row] )
+        {
+            pPanel->rowDeadline[row] = pPolicy->deadline;
+        }
+
+        if ( col < pPanel->redrawFirst[row] )
+        {
+            pPanel->redrawFirst[row] = col;
+        }
+
+        if ( col + width > pPanel->redrawEnd[row] )
+        {
+            pPanel->redrawEnd[row] = col + width;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  TimeToUpdate                                                              */
+/*!
+    Get the time until a variable may be updated
+
+    The TimeToUpdate function calculates how long to wait before a
+    changed variable may be written to the display, so that it is not
+    updated more often than its update policy allows.
+
+    @param[in]
+        pPolicy
+            pointer to the update policy of the variable
+
+    @param[in]
+        now
+            pointer to the current time
+
+    @retval 0 the update is due now
+    @retval >0 time (ms) until the update is due
+
+==============================================================================*/
+static int TimeToUpdate( LCDUpdatePolicy *pPolicy, struct timespec *now )
+{
+    long elapsed;
+
+    elapsed = ( now->tv_sec - pPolicy->last.tv_sec ) * 1000L +
+              ( now->tv_nsec - pPolicy->last.tv_nsec ) / 1000000L;
+
+    return ( elapsed >= pPolicy->interval )
+            ? 0
+            : pPolicy->interval - (int)elapsed;
+}
+
+/*============================================================================*/
+/*  NextUpdate                                                                */
+/*!
+    Get the time until the first of the pending updates is due
+
+    The NextUpdate function adds a changed variable to the pending
+    updates, and gets the time until the first of them is due.
+
+    @param[in]
+        pPolicy
+            pointer to the update policy of the changed variable
+
+    @param[in]
+        now
+            pointer to the current time
+
+    @param[in]
+        next
+            time (ms) until the first of the other pending updates is
+            due, or -1 if there are none
+
+    @retval time (ms) until the first pending update is due
+
+==============================================================================*/
+static int NextUpdate( LCDUpdatePolicy *pPolicy,
+                       struct timespec *now,
+                       int next )
+{
+    int t = TimeToUpdate( pPolicy, now );
+
+    return ( ( next < 0 ) || ( t < next ) ) ? t : next;
+}
+
+/*============================================================================*/
+/*  StartUpdate                                                               */
+/*!
+    Start the update of a variable if it is due
+
+    The StartUpdate function checks whether a changed variable may be
+    written to the display, and if so records the time of the update.
+    The update reads the latest value of the variable, so it shows all
+    of the changes received so far (see MarkRow()).
+
+    @param[in]
+        pPolicy
+            pointer to the update policy of the variable
+
+    @param[in]
+        now
+            pointer to the current time
+
+    @retval true the update is due and has been started
+    @retval false the update is not yet due
+
+==============================================================================*/
+static bool StartUpdate( LCDUpdatePolicy *pPolicy, struct timespec *now )
+{
+    bool result = false;
+
+    if ( TimeToUpdate( pPolicy, now ) == 0 )
+    {
+        pPolicy->last = *now;
+        pPolicy->started = pPolicy->received;
+        memset( &pPolicy->received, 0, sizeof( struct timespec ) );
+        result = true;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  AddPolicy                                                                 */
+/*!
+    Add an update policy from its command line specification
+
+    The AddPolicy function adds an update policy for a display variable
+    from a specification of the form:
+
+    name,rate[,deadline_ms]
+
+    where name is BACKLIGHT, LINE1 to LINE4 or FRAME for the display
+    variables, or the name of a gauge variable, rate is the maximum
+    update rate (Hz) of the variable (0 = no limit), and deadline_ms is
+    the time allowed to write an update to the display.  A policy for a
+    display variable applies to all of the displays.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        spec
+            pointer to the policy specification
+
+    @retval EOK the policy was added
+    @retval ENOSPC too many policies
+    @retval ENOMEM memory allocation failed
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int AddPolicy( LCD1602 *pLCD, char *spec )
+{
+    int result = EINVAL;
+    LCDPolicy *pPolicy;
+    char *copy;
+    char *name;
+    char *rate;
+    char *deadline;
+    char *saveptr = NULL;
+
+    if ( ( pLCD != NULL ) &&
+         ( spec != NULL ) )
+    {
+        if ( pLCD->numPolicies >= LCD_MAX_POLICIES )
+        {
+            result = ENOSPC;
+        }
+        else if ( ( copy = strdup( spec ) ) == NULL )
+        {
+            result = ENOMEM;
+        }
+        else
+        {
+            name = strtok_r( copy, ",", &saveptr );
+            rate = strtok_r( NULL, ",", &saveptr );
+            deadline = strtok_r( NULL, ",", &saveptr );
+
+            if ( ( name != NULL ) &&
+                 ( rate != NULL ) &&
+                 ( atoi( rate ) >= 0 ) &&
+                 ( ( deadline == NULL ) || ( atoi( deadline ) >= 0 ) ) )
+            {
+                pPolicy = &pLCD->policies[pLCD->numPolicies++];
+                pPolicy->name = name;
+                pPolicy->interval = ( atoi( rate ) > 0 )
+                                        ? 1000 / atoi( rate )
+                                        : 0;
+                pPolicy->deadline = ( deadline != NULL )
+                                        ? atoi( deadline )
+                                        : -1;
+                result = EOK;
+            }
+            else
+            {
+                free( copy );
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  InitPolicy                                                                */
+/*!
+    Initialize the update policy of a display variable
+
+    The InitPolicy function sets up the update policy of a display
+    variable from the policy specified on the command line for the
+    named variable, or from the specified defaults if there is none.
+    The last policy specified for a variable is used.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        name
+            name of the variable (BACKLIGHT, LINE1 to LINE4, FRAME, or a
+            gauge variable name)
+
+    @param[in]
+        interval
+            default minimum time (ms) between updates, 0 = no limit
+
+    @param[in]
+        deadline
+            default time (ms) allowed to write an update
+
+    @param[out]
+        pPolicy
+            pointer to the update policy to initialize
+
+==============================================================================*/
+static void InitPolicy( LCD1602 *pLCD,
+                        char *name,
+                        int interval,
+                        int deadline,
+                        LCDUpdatePolicy *pPolicy )
+{
+    int i;
+
+    memset( pPolicy, 0, sizeof( LCDUpdatePolicy ) );
+    pPolicy->interval = interval;
+    pPolicy->deadline = deadline;
+
+    for ( i = 0; i < pLCD->numPolicies; i++ )
+    {
+        if ( strcmp( pLCD->policies[i].name, name ) == 0 )
+        {
+            pPolicy->interval = pLCD->policies[i].interval;
+            if ( pLCD->policies[i].deadline >= 0 )
+            {
+                pPolicy->deadline = pLCD->policies[i].deadline;
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  UpdateBacklight                                                           */
+/*!
+    Handle a change to the /HW/LCD1602/BACKLIGHT system variable
+
+    The UpdateBacklight function handles a change to the backlight
+    system variable and queues an update of the state of the backlight
+    on the LCD module to the render thread
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @retval EOK the backlight update was queued successfully
+    @retval EAGAIN the render thread command ring is full
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int UpdateBacklight( LCD1602 *pLCD, LCDPanel *pPanel )
+{
+    int result = EINVAL;
+    VarObject obj;
+    bool backlight;
+
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) )
+    {
+        /* get the value of the backlight variable */
+        if ( VAR_Get( pLCD->hVarServer, pPanel->hVarBacklight, &obj ) == EOK )
+        {
+            /* get the requested backlight status */
+            backlight = obj.val.ui == 0 ? false : true;
+
+            result = RenderBacklight( pPanel->pWorker->pRender,
+                                      pPanel->pDev,
+                                      backlight );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  UpdateLine                                                                */
+/*!
+    Handle a change to a /HW/LCD1602/LINEn system variable
+
+    The UpdateLine function handles a change to one of the LINE1 to
+    LINE4 system variables by reading the new contents of the line
+    directly into its row of the display frame buffer.  The row is padded with
+    blanks after the end of the text, and the labels and gauges on the
+    row are drawn over it.  The row is drawn by DrawRow().
+
+    If the line cannot be retrieved, the row keeps its previous contents,
+    so a variable server error does not blank the line on the display.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @param[in]
+        line
+            line number (0 = LINE1)
+
+    @retval EOK the contents of the line were retrieved successfully
+    @retval EINVAL invalid arguments
+    @retval other error from VAR_Get()
+
+==============================================================================*/
+static int UpdateLine( LCD1602 *pLCD, LCDPanel *pPanel, int line )
+{
+    int result = EINVAL;
+    VarObject obj;
+    char previous[LCD_DDRAM_COLS + 1];
+    char *text;
+    int width;
+    int i;
+
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) &&
+         ( line >= 0 ) &&
+         ( line < LCD_MAX_LINES ) &&
+         ( line < pLCD->pGeometry->rows ) )
+    {
+        width = ( pLCD->marqueeInterval > 0 ) ? LCD_DDRAM_COLS
+                                              : pLCD->pGeometry->cols;
+        text = pPanel->frame[line];
+        memcpy( previous, text, sizeof( previous ) );
+        text[0] = 0;
+
+        obj.len = width;
+        obj.type = VARTYPE_STR;
+        obj.val.str = text;
+
+        /* get the value of the line variable */
+        result = VAR_Get( pLCD->hVarServer, pPanel->hVarLine[line], &obj );
+        if ( result == EOK )
+        {
+            /* blank the row after the end of the text */
+            for ( i = strnlen( text, width ); i < width; i++ )
+            {
+                text[i] = ' ';
+            }
+
+            text[width] = 0;
+
+            DrawFields( pPanel, line );
+        }
+        else
+        {
+            /* keep what is on the display */
+            memcpy( text, previous, sizeof( previous ) );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  UpdateFrame                                                               */
+/*!
+    Handle a change to a /HW/LCD1602/FRAME system variable
+
+    The UpdateFrame function handles a change to the FRAME system
+    variable, which holds the text of every row of the display, with
+    the rows separated by newline characters.  Each row of the display
+    frame buffer is replaced by the corresponding row of the frame,
+    padded with blanks, and the labels and gauges on the row are drawn
+    over it.  Text past the width of the display is ignored, and rows
+    missing from the end of the frame are blanked.  An empty frame
+    leaves the display unchanged.
+
+    Changing several rows with one variable means they are updated with
+    a single notification, and the rows are drawn together by
+    DrawFrame().
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @retval EOK the frame was retrieved successfully
+    @retval ENODATA the frame is empty
+    @retval EINVAL invalid arguments
+    @retval other error from VAR_Get()
+
+==============================================================================*/
+static int UpdateFrame( LCD1602 *pLCD, LCDPanel *pPanel )
+{
+    int result = EINVAL;
+    char buf[LCD_MAX_ROWS * ( LCD_DDRAM_COLS + 1 ) + 1];
+    VarObject obj;
+    char *text;
+    char *p;
+    int width;
+    int row;
+    int i;
+
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) )
+    {
+        width = ( pLCD->marqueeInterval > 0 ) ? LCD_DDRAM_COLS
+                                              : pLCD->pGeometry->cols;
+        buf[0] = 0;
+
+        obj.len = sizeof( buf ) - 1;
+        obj.type = VARTYPE_STR;
+        obj.val.str = buf;
+
+        /* get the value of the frame variable */
+        result = VAR_Get( pLCD->hVarServer, pPanel->hVarFrame, &obj );
+        buf[sizeof( buf ) - 1] = 0;
+
+        if ( ( result == EOK ) && ( buf[0] == 0 ) )
+        {
+            result = ENODATA;
+        }
+
+        p = buf;
+        for ( row = 0; row < pLCD->pGeometry->rows; row++ )
+        {
+            if ( result != EOK )
+            {
+                break;
+            }
+
+            text = pPanel->frame[row];
+
+            /* copy the row, and blank it after the end of its text */
+            for ( i = 0; i < width; i++ )
+            {
+                text[i] = ( ( *p != 0 ) && ( *p != '\n' ) ) ? *p++ : ' ';
+            }
+
+            text[width] = 0;
+
+            /* skip to the start of the next row */
+            while ( ( *p != 0 ) && ( *p != '\n' ) )
+            {
+                p++;
+            }
+
+            if ( *p == '\n' )
+            {
+                p++;
+            }
+
+            DrawFields( pPanel, row );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ClearFrame                                                                */
+/*!
+    Clear the display frame buffer
+
+    The ClearFrame function fills each row of the display frame buffer
+    with blanks, and draws the labels and gauges over it.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+==============================================================================*/
+static void ClearFrame( LCD1602 *pLCD, LCDPanel *pPanel )
+{
+    int width;
+    int row;
+
+    width = ( pLCD->marqueeInterval > 0 ) ? LCD_DDRAM_COLS
+                                          : pLCD->pGeometry->cols;
+
+    for ( row = 0; row < LCD_MAX_ROWS; row++ )
+    {
+        memset( pPanel->frame[row], ' ', width );
+        pPanel->frame[row][width] = 0;
+        DrawFields( pPanel, row );
+    }
+}
+
+/*============================================================================*/
+/*  DrawFields                                                                */
+/*!
+    Draw the labels and gauges of a row into the display frame buffer
+
+    The DrawFields function copies the labels, and then the rendered
+    fields of the gauges, on the specified row over the line text in
+    the display frame buffer.
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @param[in]
+        row
+            display row (0 = first row)
+
+==============================================================================*/
+static void DrawFields( LCDPanel *pPanel, int row )
+{
+    LCDLabel *pLabel;
+    LCDGauge *pGauge;
+    int i;
+
+    for ( i = 0; i < pPanel->numLabels; i++ )
+    {
+        pLabel = &pPanel->labels[i];
+        if ( pLabel->row == row )
+        {
+            memcpy( &pPanel->frame[row][pLabel->col],
+                    pLabel->text,
+                    pLabel->width );
+        }
+    }
+
+    for ( i = 0; i < pPanel->numGauges; i++ )
+    {
+        pGauge = &pPanel->gauges[i];
+        if ( pGauge->row == row )
+        {
+            memcpy( &pPanel->frame[row][pGauge->col],
+                    pGauge->cells,
+                    pGauge->width );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  UpdateGauges                                                              */
+/*!
+    Handle changes to the gauge variables of a display
+
+    The UpdateGauges function gets the value of each gauge variable
+    which has changed and whose update is due, and renders it into the
+    gauge field.  The rows of the gauges whose contents have changed
+    are marked for redrawing by DrawRow().  The display remains marked
+    for a gauge update while any changed gauge is not yet due.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @param[in]
+        now
+            pointer to the current time
+
+    @retval EOK the gauges were updated successfully
+    @retval EINVAL invalid arguments
+    @retval other error from VAR_Get()
+
+==============================================================================*/
+static int UpdateGauges( LCD1602 *pLCD,
+                         LCDPanel *pPanel,
+                         struct timespec *now )
+{
+    int result = EINVAL;
+    LCDGauge *pGauge;
+    char cells[LCD_DDRAM_COLS + 1];
+    char text[LCD_DDRAM_COLS + 1];
+    VarObject obj;
+    int rc;
+    int i;
+
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) &&
+         ( now != NULL ) )
+    {
+        result = EOK;
+        pPanel->dirty &= ~LCD_DIRTY_GAUGES;
+
+        for ( i = 0; i < pPanel->numGauges; i++ )
+        {
+            pGauge = &pPanel->gauges[i];
+            if ( pGauge->dirty == false )
+            {
+                continue;
+            }
+
+            if ( StartUpdate( &pGauge->policy, now ) == false )
+            {
+                /* try again when the gauge update is due */
+                pPanel->dirty |= LCD_DIRTY_GAUGES;
+                continue;
+            }
+
+            pGauge->dirty = false;
+
+            memset( &obj, 0, sizeof( obj ) );
+            if ( pGauge->mode == LCD_GAUGE_TEXT )
+            {
+                /* get the text directly into a buffer */
+                text[0] = 0;
+                obj.len = sizeof( text ) - 1;
+                obj.type = VARTYPE_STR;
+                obj.val.str = text;
+            }
+
+            rc = VAR_Get( pLCD->hVarServer, pGauge->hVar, &obj );
+            if ( rc == EOK )
+            {
+                memcpy( cells, pGauge->cells, sizeof( cells ) );
+                if ( pGauge->mode == LCD_GAUGE_TEXT )
+                {
+                    RenderText( pGauge, &obj );
+                }
+                else
+                {
+                    RenderGauge( pPanel, pGauge, &obj );
+                }
+
+                if ( memcmp( cells, pGauge->cells, sizeof( cells ) ) != 0 )
+                {
+                    memcpy( &pPanel->frame[pGauge->row][pGauge->col],
+                            pGauge->cells,
+                            pGauge->width );
+                    MarkRow( pPanel,
+                             pGauge->row,
+                             pGauge->col,
+                             pGauge->width,
+                             &pGauge->policy );
+                }
+            }
+            else
+            {
+                result = rc;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RenderGauge                                                               */
+/*!
+    Render a gauge value
+
+    The RenderGauge function renders a numeric value into the field of
+    a gauge, either as right aligned text, or as a bar graph with a
+    resolution of one pixel column using the partially filled bar graph
+    glyphs.  A number which does not fit in the field is shown as #.
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @param[in]
+        pGauge
+            pointer to the gauge
+
+    @param[in]
+        obj
+            pointer to the numeric variable value
+
+==============================================================================*/
+static void RenderGauge( LCDPanel *pPanel, LCDGauge *pGauge, VarObject *obj )
+{
+    char text[LCD_DDRAM_COLS + 1];
+    double value;
+    int level;
+    int n;
+    int i;
+
+    switch( obj->type )
+    {
+        case VARTYPE_UINT16:
+            value = obj->val.ui;
+            n = snprintf( text, sizeof( text ), "%*u",
+                          pGauge->width, obj->val.ui );
+            break;
+
+        case VARTYPE_INT16:
+            value = obj->val.i;
+            n = snprintf( text, sizeof( text ), "%*d",
+                          pGauge->width, obj->val.i );
+            break;
+
+        case VARTYPE_UINT32:
+            value = obj->val.ul;
+            n = snprintf( text, sizeof( text ), "%*lu",
+                          pGauge->width, (unsigned long)obj->val.ul );
+            break;
+
+        case VARTYPE_INT32:
+            value = obj->val.l;
+            n = snprintf( text, sizeof( text ), "%*ld",
+                          pGauge->width, (long)obj->val.l );
+            break;
+
+        case VARTYPE_UINT64:
+            value = obj->val.ull;
+            n = snprintf( text, sizeof( text ), "%*llu",
+                          pGauge->width, (unsigned long long)obj->val.ull );
+            break;
+
+        case VARTYPE_INT64:
+            value = obj->val.ll;
+            n = snprintf( text, sizeof( text ), "%*lld",
+                          pGauge->width, (long long)obj->val.ll );
+            break;
+
+        case VARTYPE_FLOAT:
+            value = obj->val.f;
+            n = snprintf( text, sizeof( text ), "%*.1f",
+                          pGauge->width, obj->val.f );
+            break;
+
+        default:
+            /* not a numeric variable */
+            value = pGauge->min;
+            n = -1;
+            break;
+    }
+
+    if ( pGauge->mode == LCD_GAUGE_BAR )
+    {
+        /* number of lit pixel columns */
+        value = ( value - pGauge->min ) / ( pGauge->max - pGauge->min );
+        value = ( value < 0.0 ) ? 0.0 : ( value > 1.0 ) ? 1.0 : value;
+        level = (int)( value * pGauge->width * LCD_CELL_COLS + 0.5 );
+
+        for ( i = 0; i < pGauge->width; i++ )
+        {
+            if ( level >= LCD_CELL_COLS )
+            {
+                pGauge->cells[i] = (char)LCD_FULL_BLOCK;
+            }
+            else if ( level > 0 )
+            {
+                pGauge->cells[i] = pPanel->barCodes[level - 1];
+            }
+            else
+            {
+                pGauge->cells[i] = ' ';
+            }
+
+            level = ( level > LCD_CELL_COLS ) ? level - LCD_CELL_COLS : 0;
+        }
+    }
+    else if ( ( n > 0 ) && ( n <= pGauge->width ) )
+    {
+        memcpy( pGauge->cells, text, pGauge->width );
+    }
+    else
+    {
+        memset( pGauge->cells, '#', pGauge->width );
+    }
+}
+
+/*============================================================================*/
+/*  RenderText                                                                */
+/*!
+    Render the value of a text field
+
+    The RenderText function renders a string value into the field of a
+    text gauge, left aligned and filled with blanks after the end of the
+    text.  Text longer than the field is truncated, and a variable which
+    is not a string is shown as a blank field.
+
+    @param[in]
+        pGauge
+            pointer to the text gauge
+
+    @param[in]
+        obj
+            pointer to the variable value
+
+==============================================================================*/
+static void RenderText( LCDGauge *pGauge, VarObject *obj )
+{
+    bool end;
+    int i;
+
+    end = ( ( obj->type != VARTYPE_STR ) || ( obj->val.str == NULL ) );
+
+    for ( i = 0; i < pGauge->width; i++ )
+    {
+        end = ( end || ( obj->val.str[i] == 0 ) );
+        pGauge->cells[i] = end ? ' ' : obj->val.str[i];
+    }
+}
+
+/*============================================================================*/
+/*  DrawRow                                                                   */
+/*!
+    Queue a row of a display to the render thread
+
+    The DrawRow function queues a row of the display frame buffer to
+    the render thread.  The row already holds the line text, filled
+    with blanks after the end of the text, with the labels and the
+    fields of the gauges on the row drawn over it (see UpdateLine() and
+    UpdateGauges()).  Only the span of the row which holds the changed
+    variables is queued (see MarkRow()), and the render thread only
+    writes the characters which differ from the display contents.  The
+    latency of the row update is recorded when it has been written (see
+    UpdateDone()).
+
+    In marquee mode the whole 40 column display data RAM row is written,
+    so that text longer than the display can later be scrolled into view
+    one display shift instruction at a time.  In page flip mode the row
+    is written to the page which is currently shown.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @param[in]
+        row
+            display row (0 = first row)
+
+    @retval EOK the row was queued successfully
+    @retval EAGAIN the render thread command ring is full
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int DrawRow( LCD1602 *pLCD, LCDPanel *pPanel, int row )
+{
+    int result = EINVAL;
+    LCDUpdateTag *pTag;
+    int width;
+    int first;
+    int end;
+
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) &&
+         ( row >= 0 ) &&
+         ( row < pLCD->pGeometry->rows ) )
+    {
+        width = ( pLCD->marqueeInterval > 0 ) ? LCD_DDRAM_COLS
+                                              : pLCD->pGeometry->cols;
+
+        /* only send the span of the row which has changed */
+        first = pPanel->redrawFirst[row];
+        end = ( pPanel->redrawEnd[row] < width ) ? pPanel->redrawEnd[row]
+                                                 : width;
+        if ( ( first < 0 ) || ( first >= end ) )
+        {
+            first = 0;
+            end = width;
+        }
+
+        pTag = NewUpdateTag( pLCD, pPanel, 1 << row );
+
+        result = DisplayTextAsync( pPanel->pWorker->pRender,
+                                   pPanel->pDev,
+                                   pLCD->pGeometry->rowAddr[row] +
+                                   pPanel->origin + first,
+                                   &pPanel->frame[row][first],
+                                   end - first,
+                                   pPanel->rowDeadline[row],
+                                   ( pTag != NULL ) ? UpdateDone : NULL,
+                                   pTag );
+
+        UpdateQueued( pPanel, pTag, 1 << row, result );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  DrawFrame                                                                 */
+/*!
+    Queue all of the rows of a display to the render thread
+
+    The DrawFrame function queues every row of the display frame buffer
+    to the render thread as one frame, which is written to the display
+    in a single bus transaction (see DisplayFrameAsync()).  As with
+    DrawRow(), only the characters which differ from the display
+    contents are written, so the rows which have not changed cost
+    nothing.  The frame is drawn with the shortest deadline of the rows
+    which have changed, and its latency is recorded once it is shown
+    (see UpdateDone()).
+
+    In page flip mode (-f) the frame is written to the display data RAM
+    columns just past the visible ones, while the current page is still
+    shown, and the display is then shifted to show it (see
+    SetDisplayOriginAsync()).  The two pages take turns, so the new frame
+    appears all at once with a few shift instructions, however long it
+    took to write.  If the shift cannot be queued, the new page is kept
+    and only the shift is retried on the next refresh (see FlipPage()).
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @retval EOK the frame was queued successfully (in page flip mode, it
+            may still be waiting to be shifted into view)
+    @retval EAGAIN the render thread command ring is full
+    @retval EINVAL invalid arguments
+    @retval other error from FlipPage()
+
+==============================================================================*/
+static int DrawFrame( LCD1602 *pLCD, LCDPanel *pPanel )
+{
+    int result = EINVAL;
+    LCDUpdateTag *pTag;
+    uint32_t rows;
+    int deadline = -1;
+    int origin = 0;
+    int width;
+    int row;
+
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) )
+    {
+        width = ( pLCD->marqueeInterval > 0 ) ? LCD_DDRAM_COLS
+                                              : pLCD->pGeometry->cols;
+
+        for ( row = 0; row < pLCD->pGeometry->rows; row++ )
+        {
+            if ( ( pPanel->redraw & ( 1 << row ) ) &&
+                 ( ( deadline < 0 ) ||
+                   ( pPanel->rowDeadline[row] < deadline ) ) )
+            {
+                deadline = pPanel->rowDeadline[row];
+            }
+        }
+
+        if ( pLCD->pageFlip == true )
+        {
+            /* draw the frame on the page which is not shown */
+            origin = ( pPanel->origin == 0 ) ? pLCD->pGeometry->cols : 0;
+        }
+
+        /* the frame shows every row, and is measured when it is shown */
+        rows = ( 1 << pLCD->pGeometry->rows ) - 1;
+        pTag = NewUpdateTag( pLCD, pPanel, rows );
+
+        result = DisplayFrameAsync( pPanel->pWorker->pRender,
+                                    pPanel->pDev,
+                                    origin,
+                                    pPanel->frame,
+                                    pLCD->pGeometry->rows,
+                                    width,
+                                    deadline,
+                                    ( ( pTag != NULL ) &&
+                                      ( origin == pPanel->origin ) )
+                                        ? UpdateDone : NULL,
+                                    pTag );
+
+        UpdateQueued( pPanel, pTag, rows, result );
+
+        if ( ( result == EOK ) && ( origin != pPanel->origin ) )
+        {
+            /* the new page is drawn, flip it into view now, or on a
+               later refresh if the render thread is behind */
+            pPanel->flipPending = true;
+            pPanel->pFlipTag = pTag;
+
+            result = FlipPage( pLCD, pPanel );
+            if ( result == EAGAIN )
+            {
+                result = EOK;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  FlipPage                                                                  */
+/*!
+    Shift a page drawn off screen into view
+
+    The FlipPage function queues the display shift which shows the page
+    drawn off screen by DrawFrame() in page flip mode.  If the shift
+    cannot be queued because the render thread is behind, the page
+    remains pending and the shift alone is retried on the next refresh.
+    The latency of the frame is recorded once the shift has been
+    performed.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @retval EOK the shift was queued successfully
+    @retval EAGAIN the render thread command ring is full
+    @retval EINVAL invalid arguments
+    @retval other error from SetDisplayOriginAsync()
+
+==============================================================================*/
+static int FlipPage( LCD1602 *pLCD, LCDPanel *pPanel )
+{
+    int result = EINVAL;
+    LCDUpdateTag *pTag;
+    int origin;
+
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) &&
+         ( pPanel->flipPending == true ) )
+    {
+        pTag = pPanel->pFlipTag;
+        origin = ( pPanel->origin == 0 ) ? pLCD->pGeometry->cols : 0;
+
+        result = SetDisplayOriginAsync( pPanel->pWorker->pRender,
+                                        pPanel->pDev,
+                                        origin,
+                                        ( pTag != NULL ) ? UpdateDone : NULL,
+                                        pTag );
+        if ( result == EOK )
+        {
+            pPanel->origin = origin;
+        }
+        else if ( ( result != EAGAIN ) && ( pTag != NULL ) )
+        {
+            /* the page will not be shown, release its latency tag */
+            UpdateDone( pTag, result );
+        }
+
+        if ( result != EAGAIN )
+        {
+            pPanel->flipPending = false;
+            pPanel->pFlipTag = NULL;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  AddGauge                                                                  */
+/*!
+    Add a gauge from its command line specification
+
+    The AddGauge function adds a gauge to the last display added with
+    the -a option (or the first display), from a specification of the
+    form:
+
+    name,row,col,width[,num|bar|text[,min,max]]
+
+    where row and col are the 1 based position of the start of the field.
+    Bar graphs are scaled from min to max (default 0 to 100).  A text
+    field shows the value of a string variable.  The specification
+    string is modified, and must remain valid.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        spec
+            pointer to the gauge specification
+
+    @retval EOK the gauge was added
+    @retval ENOSPC the display has too many gauges
+    @retval EINVAL invalid specification
+
+==============================================================================*/
+static int AddGauge( LCD1602 *pLCD, char *spec )
+{
+    int result = EINVAL;
+    LCDPanel *pPanel;
+    LCDGauge gauge;
+    char *fields[7];
+    char *save = NULL;
+    int n = 0;
+
+    if ( ( pLCD != NULL ) &&
+         ( spec != NULL ) )
+    {
+        pPanel = &pLCD->panels[ ( pLCD->numPanels > 0 )
+                                ? pLCD->numPanels - 1
+                                : 0 ];
+
+        fields[n] = strtok_r( spec, ",", &save );
+        while ( ( fields[n] != NULL ) && ( ++n < 7 ) )
+        {
+            fields[n] = strtok_r( NULL, ",", &save );
+        }
+
+        memset( &gauge, 0, sizeof( gauge ) );
+        gauge.min = 0.0;
+        gauge.max = 100.0;
+
+        if ( ( n >= 4 ) && ( n != 6 ) )
+        {
+            gauge.name = fields[0];
+            gauge.row = atoi( fields[1] ) - 1;
+            gauge.col = atoi( fields[2] ) - 1;
+            gauge.width = atoi( fields[3] );
+            gauge.mode = LCD_GAUGE_NUMBER;
+            if ( ( n > 4 ) && ( strcmp( fields[4], "bar" ) == 0 ) )
+            {
+                gauge.mode = LCD_GAUGE_BAR;
+            }
+            else if ( ( n > 4 ) && ( strcmp( fields[4], "text" ) == 0 ) )
+            {
+                gauge.mode = LCD_GAUGE_TEXT;
+            }
+
+            if ( n == 7 )
+            {
+                gauge.min = atof( fields[5] );
+                gauge.max = atof( fields[6] );
+            }
+
+            if ( ( gauge.row >= 0 ) &&
+                 ( gauge.row < LCD_MAX_ROWS ) &&
+                 ( gauge.col >= 0 ) &&
+                 ( gauge.width > 0 ) &&
+                 ( gauge.col + gauge.width <= LCD_DDRAM_COLS ) &&
+                 ( gauge.max > gauge.min ) )
+            {
+                result = ( pPanel->numGauges < LCD_MAX_GAUGES ) ? EOK : ENOSPC;
+            }
+        }
+
+        if ( result == EOK )
+        {
+            pPanel->gauges[pPanel->numGauges++] = gauge;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  InitGauges                                                                */
+/*!
+    Prepare the gauges of a display
+
+    The InitGauges function removes any gauge which does not fit on the
+    display geometry, blanks the gauge fields, and registers the bar
+    graph glyphs if any of the gauges is a bar graph.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @retval EOK the gauges were prepared
+    @retval EINVAL invalid arguments
+    @retval other error from RegisterGlyph()
+
+==============================================================================*/
+static int InitGauges( LCD1602 *pLCD, LCDPanel *pPanel )
+{
+    int result = EINVAL;
+    LCDGauge *pGauge;
+    uint8_t bitmap[LCD_GLYPH_ROWS];
+    int n = 0;
+    int i;
+    int j;
+
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) )
+    {
+        result = EOK;
+
+        for ( i = 0; i < pPanel->numGauges; i++ )
+        {
+            pGauge = &pPanel->gauges[i];
+            if ( ( pGauge->row >= pLCD->pGeometry->rows ) ||
+                 ( pGauge->col + pGauge->width > pLCD->pGeometry->cols ) )
+            {
+                syslog( LOG_ERR,
+                        "Gauge %s does not fit on the display\n",
+                        pGauge->name );
+                continue;
+            }
+
+            memset( pGauge->cells, ' ', pGauge->width );
+            pGauge->hVar = VAR_INVALID;
+            InitPolicy( pLCD,
+                        pGauge->name,
+                        pLCD->refreshInterval,
+                        LCD_RENDER_LINE_DEADLINE_MS,
+                        &pGauge->policy );
+            pPanel->gauges[n++] = *pGauge;
+
+            if ( pGauge->mode == LCD_GAUGE_BAR )
+            {
+                /* partially filled cells light 1 to 4 columns from
+                   the left */
+                for ( j = 1; ( j <= LCD_BAR_STEPS ) && ( result == EOK ); j++ )
+                {
+                    memset( bitmap,
+                            ( 0x1F << ( LCD_CELL_COLS - j ) ) & 0x1F,
+                            sizeof( bitmap ) );
+                    result = RegisterGlyph( LCD_GLYPH_BAR + j - 1, bitmap );
+                }
+            }
+        }
+
+        pPanel->numGauges = n;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  AddLabel                                                                  */
+/*!
+    Add a label from its command line specification
+
+    The AddLabel function adds a static label to the last display added
+    with the -a option (or the first display), from a specification of
+    the form:
+
+    row,col,text
+
+    where row and col are the 1 based position of the start of the text.
+    The text may contain commas.  Together with the gauges, labels lay
+    out a screen of fixed text and variable fields, so the producers of
+    the variables do not need to format whole lines.  The specification
+    string is modified, and must remain valid.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        spec
+            pointer to the label specification
+
+    @retval EOK the label was added
+    @retval ENOSPC the display has too many labels
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int AddLabel( LCD1602 *pLCD, char *spec )
+{
+    int result = EINVAL;
+    LCDPanel *pPanel;
+    LCDLabel label;
+    char *row;
+    char *col;
+    char *save = NULL;
+
+    if ( ( pLCD != NULL ) &&
+         ( spec != NULL ) )
+    {
+        pPanel = &pLCD->panels[ ( pLCD->numPanels > 0 )
+                                ? pLCD->numPanels - 1
+                                : 0 ];
+
+        row = strtok_r( spec, ",", &save );
+        col = strtok_r( NULL, ",", &save );
+
+        memset( &label, 0, sizeof( label ) );
+        if ( ( row != NULL ) &&
+             ( col != NULL ) &&
+             ( save != NULL ) )
+        {
+            /* the rest of the specification is the text */
+            label.row = atoi( row ) - 1;
+            label.col = atoi( col ) - 1;
+            label.text = save;
+            label.width = strlen( save );
+
+            if ( ( label.row >= 0 ) &&
+                 ( label.row < LCD_MAX_ROWS ) &&
+                 ( label.col >= 0 ) &&
+                 ( label.col < LCD_DDRAM_COLS ) &&
+                 ( label.width > 0 ) )
+            {
+                result = ( pPanel->numLabels < LCD_MAX_LABELS ) ? EOK
+                                                                : ENOSPC;
+            }
+        }
+
+        if ( result == EOK )
+        {
+            pPanel->labels[pPanel->numLabels++] = label;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  InitLabels                                                                */
+/*!
+    Prepare the labels of a display
+
+    The InitLabels function removes any label which does not start on
+    the display geometry, and truncates the labels at the right hand
+    edge of the display.
+
+    @param[in]
+        pLCD
+            pointer to the LCD1602 controller state
+
+    @param[in]
+        pPanel
+            pointer to the display
 
-            /* Close the print session */
-            VAR_ClosePrintSession( pLCD->hVarServer,
-                                   id,
-                                   fd );
+==============================================================================*/
+static void InitLabels( LCD1602 *pLCD, LCDPanel *pPanel )
+{
+    LCDLabel *pLabel;
+    int n = 0;
+    int i;
 
-            result = EOK;
+    for ( i = 0; i < pPanel->numLabels; i++ )
+    {
+        pLabel = &pPanel->labels[i];
+        if ( ( pLabel->row >= pLCD->pGeometry->rows ) ||
+             ( pLabel->col >= pLCD->pGeometry->cols ) )
+        {
+            syslog( LOG_ERR,
+                    "Label %s does not fit on the display\n",
+                    pLabel->text );
+            continue;
         }
-        else
+
+        if ( pLabel->col + pLabel->width > pLCD->pGeometry->cols )
         {
-            /* unsupported notification type */
-            result = ENOTSUP;
+            pLabel->width = pLCD->pGeometry->cols - pLabel->col;
         }
+
+        pPanel->labels[n++] = *pLabel;
     }
 
-    return result;
+    pPanel->numLabels = n;
 }
 
 /*============================================================================*/
-/*  SetupNotifications                                                        */
+/*  LoadBarGlyphs                                                             */
 /*!
-    Set up notifications for the LCD1602 controller
+    Load the bar graph glyphs onto a display
 
-    The SetupNotifications function sets up the modified and render
-    notifications for the LCD1602 controller.
+    The LoadBarGlyphs function loads the partially filled bar graph
+    glyphs into the character generator RAM of a display which has
+    bar graph gauges, and records their character codes.  It must be
+    called before the render thread is started.  If a glyph cannot be
+    loaded, the corresponding partial cell is drawn blank.
 
     @param[in]
-        pLCD
-            pointer to the LCD1602 controller state which contains a handle
-            to the variable server for requesting the notifications.
-
-    @retval EOK the notification was successfully requested
-    @retval ENOENT one or more of the requested variables was not found
-    @retval EINVAL invalid arguments
+        pPanel
+            pointer to the display
 
 ==============================================================================*/
-static int SetupNotifications( LCD1602 *pLCD )
+static void LoadBarGlyphs( LCDPanel *pPanel )
 {
-    int result = EINVAL;
-    int rc;
+    uint8_t code;
+    bool required = false;
+    int i;
 
-    if ( pLCD != NULL )
+    for ( i = 0; i < pPanel->numGauges; i++ )
     {
-        result = SetupPrintNotifications( pLCD );
-        if ( result == EOK )
+        if ( pPanel->gauges[i].mode == LCD_GAUGE_BAR )
         {
-            result = SetupModifiedNotifications( pLCD );
+            required = true;
         }
     }
 
-    return result;
+    for ( i = 0; ( required == true ) && ( i < LCD_BAR_STEPS ); i++ )
+    {
+        pPanel->barCodes[i] =
+            ( LoadGlyph( pPanel->pDev, LCD_GLYPH_BAR + i, &code ) == EOK )
+                ? (char)code
+                : ' ';
+    }
 }
 
 /*============================================================================*/
-/*  SetupPrintNotifications                                                   */
+/*  SetupGaugeNotifications                                                   */
 /*!
-    Set up a render notifications for the LCD1602 controller
+    Set up modified notifications for the gauges of a display
 
-    The SetupPrintNotifications function sets up the render notifications
-    for the LCD1602 controller.
+    The SetupGaugeNotifications function sets up a modified notification
+    for the numeric variable of each gauge of the display.  A gauge
+    whose variable is not found is left blank.
 
     @param[in]
         pLCD
-            pointer to the LCD1602 controller state which contains a handle
-            to the variable server for requesting the notifications.
+            pointer to the LCD1602 controller state
 
-    @retval EOK the notification was successfully requested
-    @retval ENOENT the requested variable was not found
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @retval EOK the notifications were set up
     @retval EINVAL invalid arguments
 
 ==============================================================================*/
-static int SetupPrintNotifications( LCD1602 *pLCD )
+static int SetupGaugeNotifications( LCD1602 *pLCD, LCDPanel *pPanel )
 {
     int result = EINVAL;
+    LCDGauge *pGauge;
     VAR_HANDLE hVar;
+    int i;
 
-    if ( pLCD != NULL )
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) )
     {
-        /* get a handle to the STATUS variable */
-        hVar = VAR_FindByName( pLCD->hVarServer, "/HW/LCD1602/STATUS" );
-        if( hVar != VAR_INVALID )
-        {
-            /* request render notification for the status variable */
-            result = VAR_Notify( pLCD->hVarServer,
-                                 hVar,
-                                 NOTIFY_PRINT );
-        }
-        else
+        result = EOK;
+
+        for ( i = 0; i < pPanel->numGauges; i++ )
         {
-            /* requested variable not found */
-            result = ENOENT;
+            pGauge = &pPanel->gauges[i];
+
+            /* get the variable handle given its name */
+            hVar = VAR_FindByName( pLCD->hVarServer, pGauge->name );
+            if ( ( hVar != VAR_INVALID ) &&
+                 ( VAR_Notify( pLCD->hVarServer,
+                               hVar,
+                               NOTIFY_MODIFIED ) == EOK ) )
+            {
+                pGauge->hVar = hVar;
+                pGauge->dirty = true;
+            }
+            else
+            {
+                syslog( LOG_ERR,
+                        "Cannot monitor gauge variable %s\n",
+                        pGauge->name );
+            }
         }
     }
 
@@ -631,224 +5176,264 @@ static int SetupPrintNotifications( LCD1602 *pLCD )
 }
 
 /*============================================================================*/
-/*  SetupModifiedNotifications                                                */
+/*  ResetMarquee                                                              */
 /*!
-    Set up modified notifications for the LCD1602 controller
-
-    The SetupModifiedNotifications function sets up the render notifications
-    for the LCD1602 controller.
-
-    The variables being monitored are:
+    Restart the marquee of a display
 
-    /HW/LCD1602/BACKLIGHT
-    /HW/LCD1602/LINE1
-    /HW/LCD1602/LINE2
+    The ResetMarquee function is called when the text on a display has
+    changed.  It measures the new text, shifts the display back to the
+    start of the text if it is not already there, and starts or stops
+    the marquee timer as required.
 
     @param[in]
         pLCD
-            pointer to the LCD1602 controller state which contains a handle
-            to the variable server for requesting the notifications.
+            pointer to the LCD1602 controller state
 
-    @retval EOK the notifications were successfully requested
-    @retval ENOENT the requested variable was not found
-    @retval EINVAL invalid arguments
+    @param[in]
+        pPanel
+            pointer to the display
 
 ==============================================================================*/
-static int SetupModifiedNotifications( LCD1602 *pLCD )
+static void ResetMarquee( LCD1602 *pLCD, LCDPanel *pPanel )
 {
-    int result = EINVAL;
-    int rc;
+    int len;
+    int row;
 
-    if ( pLCD != NULL )
+    pPanel->textLen = 0;
+    for ( row = 0; row < pLCD->pGeometry->rows; row++ )
     {
-        result = EOK;
-
-        rc = SetupModifiedNotification( pLCD->hVarServer,
-                                        "/HW/LCD1602/BACKLIGHT",
-                                        &(pLCD->hVarBacklight ) );
-        if ( rc != EOK )
+        len = TextLength( pPanel->frame[row], LCD_DDRAM_COLS );
+        if ( len > pPanel->textLen )
         {
-            result = rc;
-        }
-
-        rc = SetupModifiedNotification( pLCD->hVarServer,
-                                        "/HW/LCD1602/LINE1",
-                                        &(pLCD->hVarLine1 ) );
-        if ( rc != EOK )
-        {
-            result = rc;
+            pPanel->textLen = len;
         }
+    }
+    pPanel->pause = LCD_MARQUEE_PAUSE;
 
-
-        rc = SetupModifiedNotification( pLCD->hVarServer,
-                                        "/HW/LCD1602/LINE2",
-                                        &(pLCD->hVarLine2 ) );
-        if ( rc != EOK )
-        {
-            result = rc;
-        }
+    if ( ( pPanel->shift != 0 ) &&
+         ( CursorHomeAsync( pPanel->pWorker->pRender,
+                            pPanel->pDev,
+                            NULL,
+                            NULL ) == EOK ) )
+    {
+        pPanel->shift = 0;
     }
 
-    return result;
+    UpdateMarqueeTimer( pLCD );
 }
 
 /*============================================================================*/
-/*  SetupModifiedNotification                                                 */
+/*  StepMarquee                                                               */
 /*!
-    Set up a modified notification for the LCD1602 controller
+    Advance the marquee of a display by one step
 
-    The SetupModifiedNotification function sets up a modified notification
-    for the LCD1602 controller for the specified system variable.
+    The StepMarquee function scrolls the text on a display which does not
+    fit on the screen one column to the left, using a single display
+    shift instruction.  Once the end of the text is visible, and after
+    a short pause, the display is returned to the start of the text with
+    the cursor home instruction.
 
-    @param[in]
-        hVarServer
-            handle to the variable server
+    The HD44780 shifts both lines of the display together, so the
+    marquee scrolls until the end of the longer line is visible.
 
     @param[in]
-        name
-            name of the variable to monitor
+        pLCD
+            pointer to the LCD1602 controller state
 
     @param[in]
-        hVar
-            pointer to a location to store the variable handle of
-            the variable being monitored
-
-    @retval EOK the notification was successfully requested
-    @retval ENOENT the requested variable was not found
-    @retval EINVAL invalid arguments
+        pPanel
+            pointer to the display
 
 ==============================================================================*/
-static int SetupModifiedNotification( VARSERVER_HANDLE hVarServer,
-                                      char *name,
-                                      VAR_HANDLE *hVar )
+static void StepMarquee( LCD1602 *pLCD, LCDPanel *pPanel )
 {
-    int result = EINVAL;
-    VAR_HANDLE hdl;
+    /* number of columns the text must be shifted to show its end */
+    int travel = pPanel->textLen - pLCD->pGeometry->cols;
 
-    if ( ( pLCD != NULL ) &&
-         ( hVar != NULL ) &&
-         ( name != NULL ) )
+    if ( travel <= 0 )
     {
-        /* get the variable handle given its name */
-        hdl = VAR_FindByName( hVarServer, name );
-        if( hdl != VAR_INVALID )
+        /* the text fits on the display */
+    }
+    else if ( pPanel->pause > 0 )
+    {
+        pPanel->pause--;
+    }
+    else if ( pPanel->shift < travel )
+    {
+        if ( ShiftDisplayAsync( pPanel->pWorker->pRender,
+                                pPanel->pDev,
+                                true,
+                                NULL,
+                                NULL ) == EOK )
         {
-            /* request MODIFIED notification */
-            result = VAR_Notify( hVarServer,
-                                 hdl,
-                                 NOTIFY_MODIFIED );
-            if ( result == EOK )
+            pPanel->shift++;
+            if ( pPanel->shift == travel )
             {
-                *hVar = hdl;
+                /* hold the end of the text on the display */
+                pPanel->pause = LCD_MARQUEE_PAUSE;
             }
         }
-        else
-        {
-            result = ENOENT;
-        }
     }
-
-    return result;
+    else if ( CursorHomeAsync( pPanel->pWorker->pRender,
+                               pPanel->pDev,
+                               NULL,
+                               NULL ) == EOK )
+    {
+        /* back to the start of the text */
+        pPanel->shift = 0;
+        pPanel->pause = LCD_MARQUEE_PAUSE;
+    }
 }
 
 /*============================================================================*/
-/*  PrintStatus                                                               */
+/*  UpdateMarqueeTimer                                                        */
 /*!
-    Output the status of the LCD1602
+    Start or stop the marquee timer
 
-    The PrintStatus function prints the status of the LCD1602 controller.
+    The UpdateMarqueeTimer function runs the periodic marquee timer
+    while any display has text which is too long to be shown at once,
+    so no timer events are generated when there is nothing to scroll.
 
     @param[in]
         pLCD
             pointer to the LCD1602 controller state
 
-    @retval EOK the status was output successfully
-    @retval EINVAL invalid arguments
-
 ==============================================================================*/
-static int PrintStatus (LCD1602 *pLCD, int fd )
+static void UpdateMarqueeTimer( LCD1602 *pLCD )
 {
-    int result = EINVAL;
-    bool backlight = false;
-    int cx = 0;
-    int cy = 0;
-    char *device = "none";
-    uint8_t address = 0;
-    bool exclusive = false;
+    struct itimerspec its;
+    bool required = false;
+    int i;
 
-    if ( ( pLCD != NULL ) &&
-         ( fd != -1 ) )
+    for ( i = 0; i < pLCD->numPanels; i++ )
     {
-        GetBacklight( pLCD->pDev, &backlight );
-        GetExclusive( pLCD->pDev, &exclusive );
-        GetCursorX( pLCD->pDev, &cx );
-        GetCursorY( pLCD->pDev, &cy );
-        GetDeviceName( pLCD->pDev, &device );
-        GetAddress( pLCD->pDev, &address );
-
-        dprintf(fd, "LCD1602 Status:\n");
-        dprintf(fd, "Device: %s\n", device );
-        dprintf(fd, "Address: 0x%02x\n", address );
-        dprintf(fd, "Exclusive: %s\n", exclusive ? "true" : "false" );
-        dprintf(fd, "Verbose: %s\n", pLCD->verbose ? "true" : "false" );
-        dprintf(fd, "Backlight: %s\n", backlight ? "ON" : "OFF" );
-        dprintf(fd, "Line1: %s\n", pLCD->line1 );
-        dprintf(fd, "Line2: %s\n", pLCD->line2 );
-        dprintf(fd, "Cursor X: %d\n", cx );
-        dprintf(fd, "Cursor Y: %d\n", cy );
+        if ( ( pLCD->panels[i].textLen > pLCD->pGeometry->cols ) ||
+             ( pLCD->panels[i].shift != 0 ) )
+        {
+            required = true;
+        }
     }
 
-    return result;
+    if ( ( pLCD->marqueeTimer.fd != -1 ) &&
+         ( required != pLCD->marqueeArmed ) )
+    {
+        memset( &its, 0, sizeof( its ) );
+        if ( required == true )
+        {
+            its.it_value.tv_sec = pLCD->marqueeInterval / 1000;
+            its.it_value.tv_nsec = ( pLCD->marqueeInterval % 1000 ) * 1000000L;
+            its.it_interval = its.it_value;
+        }
+
+        if ( timerfd_settime( pLCD->marqueeTimer.fd, 0, &its, NULL ) == 0 )
+        {
+            pLCD->marqueeArmed = required;
+        }
+    }
 }
 
 /*============================================================================*/
-/*  OnChange                                                                  */
+/*  TextLength                                                                */
 /*!
-    Handle a change to a system variable
+    Get the displayed length of a line of text
 
-    The OnChange function handles a change to one of the following
-    variables:
+    The TextLength function gets the number of characters in a line up
+    to and including the last non-blank character.
 
-    /HW/LCD1602/BACKLIGHT
-    /HW/LCD1602/LINE1
-    /HW/LCD1602/LINE2
+    @param[in]
+        text
+            pointer to the line text
+
+    @param[in]
+        len
+            maximum number of characters in the line
+
+    @return the displayed length of the line
+
+==============================================================================*/
+static int TextLength( char *text, int len )
+{
+    int result = 0;
+    int i;
+
+    for ( i = 0; ( i < len ) && ( text[i] != 0 ); i++ )
+    {
+        if ( text[i] != 0x20 )
+        {
+            result = i + 1;
+        }
+    }
+
+    return result;
+}
 
-    Any change to these variables will cause an update to the
-    attached LCD1602 hardware
+/*============================================================================*/
+/*  InitDisplay                                                               */
+/*!
+    Initialize the LCD hardware of a display
+
+    The InitDisplay function initializes the LCD hardware of a display.
+    If warm starts are enabled with a state file, the shadow state of
+    the display is kept in the state file (see MapDisplayState()).  If
+    the display is already set up (see LCDWarmInit()) it keeps its
+    contents, otherwise it is initialized and the saved contents, custom
+    characters, cursor mode and backlight are written back to it (see
+    LCDRestore()).  Without a state file the display is cleared (see
+    LCDInit()).  In page flip mode the page to draw on is then selected
+    (see InitPage()).
 
     @param[in]
         pLCD
             pointer to the LCD1602 controller state
 
     @param[in]
-        hVar
-            handle to the variable which changed
+        pPanel
+            pointer to the display
 
-    @retval EOK the change was handled successfully
+    @retval EOK the display was initialized
     @retval EINVAL invalid arguments
+    @retval other error from LCDInit(), LCDWarmInit() or LCDRestore()
 
 ==============================================================================*/
-static int OnChange( LCD1602 *pLCD, VAR_HANDLE hVar )
+static int InitDisplay( LCD1602 *pLCD, LCDPanel *pPanel )
 {
     int result = EINVAL;
+    LCDShadow saved;
+    bool valid = false;
+    bool warm = false;
 
-    if ( pLCD != NULL )
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) )
     {
-        if ( hVar == pLCD->hVarBacklight )
+        if ( pLCD->stateFile != NULL )
         {
-            result = UpdateBacklight( pLCD, hVar );
+            valid = ( MapDisplayState( pLCD, pPanel, &saved ) == EOK );
+            result = LCDWarmInit( pPanel->pDev, &warm );
+            if ( ( result == EOK ) && ( valid == true ) )
+            {
+                result = LCDRestore( pPanel->pDev, &saved );
+            }
         }
-        else if ( hVar == pLCD->hVarLine1 )
+        else
         {
-            result = UpdateLine1( pLCD );
+            result = LCDInit( pPanel->pDev );
         }
-        else if ( hVar == pLCD->hVarLine2 )
+
+        if ( ( result == EOK ) && ( warm == true ) && ( pLCD->verbose ) )
         {
-            result = UpdateLine2( pLCD );
+            printf( "Warm start of LCD at 0x%02x\n", pPanel->address );
         }
-        else
+
+        if ( ( result == EOK ) && ( pLCD->marqueeInterval > 0 ) )
         {
-            result = ENOENT;
+            /* the display may have been left shifted */
+            CursorHome( pPanel->pDev );
+        }
+
+        if ( ( result == EOK ) && ( pLCD->pageFlip == true ) )
+        {
+            /* keep showing the page which was shown before the restart */
+            result = InitPage( pLCD, pPanel );
         }
     }
 
@@ -856,41 +5441,79 @@ static int OnChange( LCD1602 *pLCD, VAR_HANDLE hVar )
 }
 
 /*============================================================================*/
-/*  UpdateBacklight                                                           */
+/*  GetStateFileName                                                          */
 /*!
-    Handle a change to the /HW/LCD1602/BACKLIGHT system variable
+    Get the name of the state file of a display
 
-    The UpdateBacklight function handles a change to the backlight
-    system variable and updates the state of the backlight on the
-    LCD 16x2 module
+    The GetStateFileName function gets the name of the file used to
+    keep the contents of a display between runs of the service.  It
+    is the state file name specified with -w, followed by the PCF8574
+    address of the display, eg /run/lcd1602.27.  The names of the
+    displays on buses after the first also include the bus number, in
+    the same way as the trace files (see SaveTrace()), eg
+    /run/lcd1602.1.27
 
     @param[in]
         pLCD
             pointer to the LCD1602 controller state
 
     @param[in]
-        hVar
-            handle to the backlight variable
+        pPanel
+            pointer to the display
 
-    @retval EOK the backlight was updated successfully
+    @param[out]
+        name
+            pointer to the buffer to store the name
+
+    @param[in]
+        len
+            size of the name buffer
+
+    @retval EOK the name was generated
+    @retval ENOENT warm starts are not enabled
+    @retval E2BIG the name buffer is too small
     @retval EINVAL invalid arguments
 
 ==============================================================================*/
-static int UpdateBacklight( LCD1602 *pLCD, VAR_HANDLE hVar )
+static int GetStateFileName( LCD1602 *pLCD,
+                             LCDPanel *pPanel,
+                             char *name,
+                             size_t len )
 {
     int result = EINVAL;
-    VarObject obj;
-    bool backlight;
+    int bus;
+    int n;
 
-    if ( pLCD != NULL )
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) &&
+         ( name != NULL ) )
     {
-        /* get the value of the backlight variable */
-        if ( VAR_Get( pLCD->hVarServer, hVar, &obj ) == EOK )
-        {
-            /* get the requested backlight status */
-            backlight = obj.val.ui == 0 ? false : true;
+        bus = ( pPanel->pWorker != NULL )
+            ? (int)( pPanel->pWorker - pLCD->buses )
+            : 0;
 
-            result = SetBacklight( pLCD->pDev, backlight );
+        if ( pLCD->stateFile == NULL )
+        {
+            result = ENOENT;
+        }
+        else if ( bus == 0 )
+        {
+            n = snprintf( name,
+                          len,
+                          "%s.%02x",
+                          pLCD->stateFile,
+                          pPanel->address );
+            result = ( ( n > 0 ) && ( (size_t)n < len ) ) ? EOK : E2BIG;
+        }
+        else
+        {
+            n = snprintf( name,
+                          len,
+                          "%s.%d.%02x",
+                          pLCD->stateFile,
+                          bus,
+                          pPanel->address );
+            result = ( ( n > 0 ) && ( (size_t)n < len ) ) ? EOK : E2BIG;
         }
     }
 
@@ -898,39 +5521,70 @@ static int UpdateBacklight( LCD1602 *pLCD, VAR_HANDLE hVar )
 }
 
 /*============================================================================*/
-/*  UpdateLine1                                                               */
+/*  MapDisplayState                                                           */
 /*!
-    Handle a change to the /HW/LCD1602/LINE1 system variable
+    Keep the shadow state of a display in its state file
 
-    The UpdateLine1 function handles a change to the LCD Screen line 1
-    system variable and updates the contents of line 1 on the
-    LCD 16x2 module
+    The MapDisplayState function maps the state file of a display (see
+    StateMap()) and attaches it to the display as its shadow state, so
+    the state file is kept up to date by every write to the display,
+    and survives the service stopping for any reason.  The backlight
+    request of the display is set from the saved state so the backlight
+    does not flicker during the warm start.
 
     @param[in]
         pLCD
             pointer to the LCD1602 controller state
 
-    @retval EOK the contents of line 1 on the display were updated successfully
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @param[out]
+        pSaved
+            pointer to a buffer to store a copy of the saved state
+
+    @retval EOK the state file holds a saved state
+    @retval ENOENT warm starts are not enabled
+    @retval ENODATA there is no saved state
     @retval EINVAL invalid arguments
+    @retval other error from StateMap() or AttachShadow()
 
 ==============================================================================*/
-static int UpdateLine1( LCD1602 *pLCD )
+static int MapDisplayState( LCD1602 *pLCD,
+                            LCDPanel *pPanel,
+                            LCDShadow *pSaved )
 {
-    int result = EINVAL;
-    VarObject obj;
+    int result;
+    char name[BUFSIZ];
+    bool valid = false;
 
-    if ( pLCD != NULL )
+    result = GetStateFileName( pLCD, pPanel, name, sizeof( name ) );
+    if ( ( result == EOK ) && ( pSaved != NULL ) )
     {
-        memset( pLCD->line1, 0, 17 );
-        obj.len = 16;
-        obj.type = VARTYPE_STR;
-        obj.val.str = pLCD->line1;
+        pPanel->pState = StateMap( name, &valid );
+        if ( pPanel->pState != NULL )
+        {
+            *pSaved = *pPanel->pState;
+            RequestBacklight( pPanel->pDev,
+                              ( valid == true ) ? pSaved->backlight : true );
 
-        /* get the value of the backlight variable */
-        result = VAR_Get( pLCD->hVarServer, pLCD->hVarLine1, &obj );
-        if ( result == EOK )
+            result = AttachShadow( pPanel->pDev, pPanel->pState );
+            if ( ( result == EOK ) && ( valid == false ) )
+            {
+                ResetShadow( pPanel->pDev );
+                result = ENODATA;
+            }
+        }
+        else
         {
-            result = DisplayLine( pLCD->pDev, 0x00, pLCD->line1 );
+            result = ( errno != 0 ) ? errno : EIO;
+            if ( result == EWOULDBLOCK )
+            {
+                syslog( LOG_WARNING,
+                        "State file %s is in use by another instance\n",
+                        name );
+            }
         }
     }
 
@@ -938,46 +5592,47 @@ static int UpdateLine1( LCD1602 *pLCD )
 }
 
 /*============================================================================*/
-/*  UpdateLine2                                                               */
+/*  InitPage                                                                  */
 /*!
-    Handle a change to the /HW/LCD1602/LINE2 system variable
+    Select the page shown on a display in page flip mode
 
-    The UpdateLine2 function handles a change to the LCD Screen line 2
-    system variable and updates he contents of line 2 on the
-    LCD 16x2 module
+    The InitPage function finds which of the two pages of a display is
+    shown in page flip mode, from the display shift recorded in its
+    shadow state (see SetDisplayOrigin()), so a warm start carries on
+    from the page which was shown.  A display shifted to any other
+    position is shifted back to the first page.
 
     @param[in]
         pLCD
             pointer to the LCD1602 controller state
 
-    @retval EOK the contents of line 2 on the display were updated successfully
+    @param[in]
+        pPanel
+            pointer to the display
+
+    @retval EOK the page was selected
     @retval EINVAL invalid arguments
+    @retval other error from SetDisplayOrigin()
 
 ==============================================================================*/
-static int UpdateLine2( LCD1602 *pLCD )
+static int InitPage( LCD1602 *pLCD, LCDPanel *pPanel )
 {
     int result = EINVAL;
-    VarObject obj;
+    const LCDShadow *pShadow;
 
-    if ( pLCD != NULL )
+    if ( ( pLCD != NULL ) &&
+         ( pPanel != NULL ) &&
+         ( GetShadow( pPanel->pDev, &pShadow ) == EOK ) )
     {
-        memset( pLCD->line2, 0x20, 17 );
-        obj.len = 16;
-        obj.type = VARTYPE_STR;
-        obj.val.str = pLCD->line2;
+        pPanel->origin = ( pShadow->shift == pLCD->pGeometry->cols )
+                       ? pLCD->pGeometry->cols
+                       : 0;
 
-        /* get the value of the backlight variable */
-        result = VAR_Get( pLCD->hVarServer, pLCD->hVarLine2, &obj );
-        if ( result == EOK )
-        {
-            result = DisplayLine( pLCD->pDev, 0x40, pLCD->line2 );
-        }
+        result = SetDisplayOrigin( pPanel->pDev, pPanel->origin );
     }
 
     return result;
 }
 
-
 /*! @}
  * end of lcd1602 group */
-
@@ -0,0 +1,447 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup lcdbench lcdbench
+ * @brief Character LCD driver benchmark
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file lcd_bench.c
+
+    Benchmark for the character based display driver
+
+    The lcd_bench module measures the cost of the lcd_ctrl operations
+    on a real display, without the variable server or render thread.
+    Each operation is repeated a number of times, and the median, 99th
+    percentile and maximum latency are reported, together with the
+    number of system calls and bytes on the wire per operation.
+
+    The I2C bus connection is held open for the whole benchmark, so the
+    results show the steady state cost of each operation.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "lcd_bus.h"
+#include "lcd_io.h"
+#include "lcd_ctrl.h"
+#include "lcd_bench.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+#define EOK 0
+#endif
+
+/*==============================================================================
+        Data Types
+==============================================================================*/
+
+/*! benchmark operation function */
+typedef int (*LCDBenchFn)( LCDDev *pDev, int iteration );
+
+/*! The LCDBenchOp type describes one benchmark operation */
+typedef struct _LCDBenchOp
+{
+    /*! operation name */
+    char *name;
+
+    /*! function which performs one iteration of the operation */
+    LCDBenchFn fn;
+
+} LCDBenchOp;
+
+/*==============================================================================
+        Private Function Declarations
+==============================================================================*/
+
+static int benchRedraw( LCDDev *pDev, int iteration );
+static int benchCell( LCDDev *pDev, int iteration );
+static int benchClear( LCDDev *pDev, int iteration );
+static int benchBacklight( LCDDev *pDev, int iteration );
+static int benchStatus( LCDDev *pDev, int iteration );
+static int measure( LCDDev *pDev,
+                    LCDBenchOp *pOp,
+                    long *samples,
+                    int iterations,
+                    int fd );
+static int compare( const void *a, const void *b );
+
+/*==============================================================================
+        File Scoped Variables
+==============================================================================*/
+
+/*! benchmark operations */
+static LCDBenchOp ops[] =
+{
+    { "full redraw", benchRedraw },
+    { "single cell", benchCell },
+    { "clear", benchClear },
+    { "backlight", benchBacklight },
+    { "status read", benchStatus }
+};
+
+/*==============================================================================
+        Function Definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  Benchmark                                                                 */
+/*!
+    Benchmark the LCD driver
+
+    The Benchmark function runs each of the benchmark operations on the
+    specified LCD device and writes a report of the results to the
+    output file descriptor.  The LCD device must already have been
+    initialized with LCDInit().
+
+    @param[in]
+        pDev
+            pointer to the LCD device
+
+    @param[in]
+        iterations
+            number of times to repeat each operation
+
+    @param[in]
+        fd
+            output file descriptor for the report
+
+    @retval EOK the benchmark completed
+    @retval ENOMEM memory allocation failed
+    @retval EINVAL invalid arguments
+    @retval other error from the LCD operations
+
+==============================================================================*/
+int Benchmark( LCDDev *pDev, int iterations, int fd )
+{
+    int result = EINVAL;
+    LCDBus *pBus = NULL;
+    LCDWriteMode mode = LCD_WRITE_BUSY_POLL;
+    long *samples;
+    size_t i;
+    int rc;
+
+    if ( ( pDev != NULL ) &&
+         ( iterations > 0 ) &&
+         ( fd != -1 ) &&
+         ( GetBus( pDev, &pBus ) == EOK ) )
+    {
+        samples = calloc( iterations, sizeof( long ) );
+        if ( samples != NULL )
+        {
+            result = BusOpen( pBus );
+            if ( result == EOK )
+            {
+                GetWriteMode( pDev, &mode );
+
+                dprintf( fd, "LCD1602 Benchmark: %d iterations, %s mode\n",
+                         iterations,
+                         mode == LCD_WRITE_TIMED ? "timed" : "busy-poll" );
+                dprintf( fd, "%-12s %9s %9s %9s %12s %9s\n",
+                         "operation",
+                         "p50(us)",
+                         "p99(us)",
+                         "max(us)",
+                         "syscalls/op",
+                         "bytes/op" );
+
+                for ( i = 0; i < sizeof( ops ) / sizeof( ops[0] ); i++ )
+                {
+                    rc = measure( pDev, &ops[i], samples, iterations, fd );
+                    if ( rc != EOK )
+                    {
+                        result = rc;
+                    }
+                }
+
+                BusRelease( pBus );
+            }
+
+            free( samples );
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  measure                                                                   */
+/*!
+    Measure one benchmark operation
+
+    The measure function performs the benchmark operation the specified
+    number of times, and reports its latency distribution and bus cost.
+
+    @param[in]
+        pDev
+            pointer to the LCD device
+
+    @param[in]
+        pOp
+            pointer to the benchmark operation
+
+    @param[in]
+        samples
+            pointer to an array to store the latency samples
+
+    @param[in]
+        iterations
+            number of times to repeat the operation
+
+    @param[in]
+        fd
+            output file descriptor for the report
+
+    @retval EOK the operation completed every iteration
+    @retval other error from the operation
+
+==============================================================================*/
+static int measure( LCDDev *pDev,
+                    LCDBenchOp *pOp,
+                    long *samples,
+                    int iterations,
+                    int fd )
+{
+    int result = EOK;
+    LCDBus *pBus = NULL;
+    LCDBusStats stats;
+    struct timespec start;
+    struct timespec end;
+    int rc;
+    int i;
+
+    GetBus( pDev, &pBus );
+
+    /* one untimed iteration to set up the operation's starting state */
+    pOp->fn( pDev, iterations );
+    ResetBusStats( pBus );
+
+    for ( i = 0; i < iterations; i++ )
+    {
+        clock_gettime( CLOCK_MONOTONIC, &start );
+        rc = pOp->fn( pDev, i );
+        clock_gettime( CLOCK_MONOTONIC, &end );
+
+        if ( rc != EOK )
+        {
+            result = rc;
+        }
+
+        samples[i] = ( end.tv_sec - start.tv_sec ) * 1000000L +
+                     ( end.tv_nsec - start.tv_nsec ) / 1000L;
+    }
+
+    GetBusStats( pBus, &stats );
+    qsort( samples, iterations, sizeof( long ), compare );
+
+    dprintf( fd, "%-12s %9ld %9ld %9ld %12.1f %9.1f%s\n",
+             pOp->name,
+             samples[iterations / 2],
+             samples[( iterations * 99 ) / 100],
+             samples[iterations - 1],
+             (double)stats.syscalls / iterations,
+             (double)stats.bytes / iterations,
+             ( result == EOK ) ? "" : " (errors)" );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  benchRedraw                                                               */
+/*!
+    Redraw a whole line
+
+    The benchRedraw function alternates between two lines which differ
+    in every character, so every cell is rewritten on every iteration.
+
+    @param[in]
+        pDev
+            pointer to the LCD device
+
+    @param[in]
+        iteration
+            iteration number
+
+    @retval result of DisplayLine()
+
+==============================================================================*/
+static int benchRedraw( LCDDev *pDev, int iteration )
+{
+    return DisplayLine( pDev,
+                        0,
+                        ( iteration & 1 ) ? "abcdefghijklmnop"
+                                          : "ABCDEFGHIJKLMNOP" );
+}
+
+/*============================================================================*/
+/*  benchCell                                                                 */
+/*!
+    Update a single character
+
+    The benchCell function alternates between two lines which differ
+    in only one character, so a single cell is rewritten each iteration.
+
+    @param[in]
+        pDev
+            pointer to the LCD device
+
+    @param[in]
+        iteration
+            iteration number
+
+    @retval result of DisplayLine()
+
+==============================================================================*/
+static int benchCell( LCDDev *pDev, int iteration )
+{
+    return DisplayLine( pDev,
+                        0x40,
+                        ( iteration & 1 ) ? "Benchmark 1     "
+                                          : "Benchmark 2     " );
+}
+
+/*============================================================================*/
+/*  benchClear                                                                */
+/*!
+    Clear the display
+
+    The benchClear function clears the display.  In timed mode the
+    clear execution time is waited at the start of the next write, so
+    each sample includes the wait for the previous clear.
+
+    @param[in]
+        pDev
+            pointer to the LCD device
+
+    @param[in]
+        iteration
+            iteration number (unused)
+
+    @retval result of ClearDisplay()
+
+==============================================================================*/
+static int benchClear( LCDDev *pDev, int iteration )
+{
+    (void)iteration;
+
+    return ClearDisplay( pDev );
+}
+
+/*============================================================================*/
+/*  benchBacklight                                                            */
+/*!
+    Toggle the backlight
+
+    @param[in]
+        pDev
+            pointer to the LCD device
+
+    @param[in]
+        iteration
+            iteration number
+
+    @retval result of SetBacklight()
+
+==============================================================================*/
+static int benchBacklight( LCDDev *pDev, int iteration )
+{
+    return SetBacklight( pDev, ( iteration & 1 ) ? false : true );
+}
+
+/*============================================================================*/
+/*  benchStatus                                                               */
+/*!
+    Read the display status
+
+    @param[in]
+        pDev
+            pointer to the LCD device
+
+    @param[in]
+        iteration
+            iteration number (unused)
+
+    @retval EOK the status was read
+    @retval other error from GetStatus()
+
+==============================================================================*/
+static int benchStatus( LCDDev *pDev, int iteration )
+{
+    int result;
+
+    (void)iteration;
+
+    result = GetStatus( pDev );
+
+    /* a busy display is still a successful status read */
+    return ( result == EBUSY ) ? EOK : result;
+}
+
+/*============================================================================*/
+/*  compare                                                                   */
+/*!
+    Compare two latency samples for qsort()
+
+    @param[in]
+        a
+            pointer to the first sample
+
+    @param[in]
+        b
+            pointer to the second sample
+
+    @retval <0, 0 or >0 if a is less than, equal to, or greater than b
+
+==============================================================================*/
+static int compare( const void *a, const void *b )
+{
+    long x = *(const long *)a;
+    long y = *(const long *)b;
+
+    return ( x > y ) - ( x < y );
+}
+
+/*! @}
+ * end of lcdbench group */
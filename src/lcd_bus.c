@@ -0,0 +1,1218 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup lcdbus lcdbus
+ * @brief I2C bus connection manager
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file lcd_bus.c
+
+    I2C bus connection manager
+
+    The lcd_bus module manages the connection to the I2C bus device
+    driver used to communicate with the PCF8574 serial-to-parallel
+    I/O expanders.
+
+    Rather than opening and closing the I2C device for every access,
+    the file descriptor is held open while it is in use, and for a
+    configurable idle period afterwards.  It is closed lazily by
+    BusCheckIdle() once the idle period has elapsed, so the bus can be
+    shared with other masters without paying for a full open on every
+    access.
+
+    The slave address is selected per access using the I2C_SLAVE ioctl,
+    which is only issued when the address changes, so several devices
+    at different addresses can share one connection.
+
+    The bus device is accessed through a transport (see lcd_transport.h)
+    which is chosen from the device name when the connection is opened.
+    Device names starting with "emu:" select the in-process display
+    emulator (see lcd_emu.c), all others are opened as Linux i2c-dev
+    devices.
+
+    Writes to several devices can be batched together using
+    BusBeginBatch()/BusEndBatch().  On adapters which support plain I2C
+    transfers, a batch is submitted as a single I2C_RDWR ioctl with one
+    message per device, each carrying its own slave address.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include "lcd_transport.h"
+#include "lcd_bus.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+#define EOK 0
+#endif
+
+/*! size of the batch data buffer */
+#define LCD_BUS_BATCH_BUFSIZE   ( 4096 )
+
+/*! maximum number of messages in a batch */
+#define LCD_BUS_BATCH_MSGS      ( I2C_RDWR_IOCTL_MAX_MSGS )
+
+/*==============================================================================
+        Data Types
+==============================================================================*/
+
+/*! The LCDBus type manages a connection to an I2C bus device */
+struct _LCDBus
+{
+    /*! the I2C device */
+    char *device;
+
+    /*! transport used to access the I2C device */
+    const LCDTransport *pTransport;
+
+    /*! transport handle of the open connection, or NULL if not open */
+    void *handle;
+
+    /*! currently selected slave address, or -1 if none is selected */
+    int slave;
+
+    /*! number of users currently holding the connection open */
+    int users;
+
+    /*! time (ms) to hold the connection open after its last use */
+    int idleTimeout;
+
+    /*! time the connection was last released */
+    struct timespec lastUse;
+
+    /*! adapter supports combined I2C_RDWR transfers */
+    bool rdwr;
+
+    /*! batch nesting depth */
+    int batchDepth;
+
+    /*! number of batch data bytes in use */
+    size_t batchLen;
+
+    /*! number of messages in the batch */
+    int nmsgs;
+
+    /*! batched messages */
+    struct i2c_msg msgs[LCD_BUS_BATCH_MSGS];
+
+    /*! batched message data */
+    uint8_t batchBuf[LCD_BUS_BATCH_BUFSIZE];
+
+    /*! bus activity counters */
+    LCDBusStats stats;
+};
+
+/*==============================================================================
+        Private Function Declarations
+==============================================================================*/
+
+static int selectSlave( LCDBus *pBus, uint8_t address );
+static int writeDirect( LCDBus *pBus,
+                        uint8_t address,
+                        uint8_t *buf,
+                        size_t len );
+static int elapsed_ms( struct timespec *since );
+static void countMessages( LCDBus *pBus );
+static const LCDTransport *selectTransport( char *device );
+
+/*==============================================================================
+        Function Definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  BusInit                                                                   */
+/*!
+    Initialize an I2C bus connection
+
+    The BusInit function creates and intializes an I2C bus connection
+    object.  The connection is not opened until it is first used.
+
+    @param[in]
+        device
+            name of the I2C bus device, eg /dev/i2c-1
+
+    @retval pointer to the new LCDBus object
+    @retval NULL if the bus object could not be created
+
+==============================================================================*/
+LCDBus *BusInit( char *device )
+{
+    LCDBus *pBus = calloc( 1, sizeof( LCDBus ) );
+    if ( pBus != NULL )
+    {
+        pBus->device = device;
+        pBus->slave = -1;
+        pBus->idleTimeout = LCD_BUS_IDLE_TIMEOUT_MS;
+    }
+
+    return pBus;
+}
+
+/*============================================================================*/
+/*  BusDelete                                                                 */
+/*!
+    Delete an I2C bus connection
+
+    The BusDelete function closes the I2C bus connection and frees the
+    bus object.  The connection must not be in use.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @retval EOK the bus object was deleted
+    @retval EBUSY the connection is still in use
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int BusDelete( LCDBus *pBus )
+{
+    int result = EINVAL;
+
+    if ( pBus != NULL )
+    {
+        result = BusClose( pBus );
+        if ( result == EOK )
+        {
+            free( pBus );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BusOpen                                                                   */
+/*!
+    Acquire the I2C bus connection
+
+    The BusOpen function registers a user of the I2C bus connection,
+    opening the I2C device if it is not already open.  Each call to
+    BusOpen() must be balanced with a call to BusRelease().
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @retval EOK the connection is open
+    @retval ENODEV no i2c device has been specified
+    @retval EINVAL invalid arguments
+    @retval other error as reported by open()
+
+==============================================================================*/
+int BusOpen( LCDBus *pBus )
+{
+    int result = EINVAL;
+
+    if ( pBus != NULL )
+    {
+        if ( pBus->handle != NULL )
+        {
+            /* re-use the cached connection */
+            result = EOK;
+        }
+        else if ( pBus->device != NULL )
+        {
+            /* open the i2c device for reading and writing */
+            pBus->pTransport = selectTransport( pBus->device );
+            result = pBus->pTransport->open( pBus->device, &pBus->handle );
+            pBus->stats.syscalls++;
+            if ( result == EOK )
+            {
+                pBus->slave = -1;
+                pBus->stats.syscalls++;
+                pBus->stats.opens++;
+
+                /* check if combined transfers are available */
+                pBus->rdwr = pBus->pTransport->combined( pBus->handle );
+            }
+            else
+            {
+                pBus->handle = NULL;
+            }
+        }
+        else
+        {
+            result = ENODEV;
+        }
+
+        if ( result == EOK )
+        {
+            pBus->users++;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BusRelease                                                                */
+/*!
+    Release the I2C bus connection
+
+    The BusRelease function unregisters a user of the I2C bus connection.
+    When the last user releases the connection, it is held open for the
+    idle timeout period so it can be re-used without re-opening the
+    device.  If the idle timeout is zero, the connection is closed
+    immediately.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @retval EOK the connection was released
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int BusRelease( LCDBus *pBus )
+{
+    int result = EINVAL;
+
+    if ( pBus != NULL )
+    {
+        result = EOK;
+
+        if ( pBus->users > 0 )
+        {
+            pBus->users--;
+            if ( pBus->users == 0 )
+            {
+                clock_gettime( CLOCK_MONOTONIC, &pBus->lastUse );
+                if ( pBus->idleTimeout == 0 )
+                {
+                    result = BusClose( pBus );
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BusClose                                                                  */
+/*!
+    Close the I2C bus connection
+
+    The BusClose function closes the I2C device if it is open and
+    there are no users holding the connection.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @retval EOK the connection was closed (or was not open)
+    @retval EBUSY the connection is still in use
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int BusClose( LCDBus *pBus )
+{
+    int result = EINVAL;
+
+    if ( pBus != NULL )
+    {
+        if ( pBus->users > 0 )
+        {
+            result = EBUSY;
+        }
+        else
+        {
+            /* don't lose any batched writes */
+            BusFlush( pBus );
+
+            if ( pBus->handle != NULL )
+            {
+                pBus->pTransport->close( pBus->handle );
+                pBus->stats.syscalls++;
+                pBus->stats.closes++;
+                pBus->handle = NULL;
+                pBus->slave = -1;
+            }
+
+            result = EOK;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BusCheckIdle                                                              */
+/*!
+    Close the I2C bus connection if it has been idle too long
+
+    The BusCheckIdle function closes the I2C bus connection if it is
+    not in use and has been idle for longer than the idle timeout.
+    This should be called periodically by the application.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @param[out]
+        remaining
+            pointer to a location to store the time (ms) until the
+            connection should be checked again, or -1 if there is no need
+            to check again until the connection has been used.
+            May be NULL.
+
+    @retval EOK the check was performed
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int BusCheckIdle( LCDBus *pBus, int *remaining )
+{
+    int result = EINVAL;
+    int t = -1;
+    int idle;
+
+    if ( pBus != NULL )
+    {
+        result = EOK;
+
+        if ( ( pBus->handle != NULL ) &&
+             ( pBus->users == 0 ) )
+        {
+            idle = elapsed_ms( &pBus->lastUse );
+            if ( idle >= pBus->idleTimeout )
+            {
+                result = BusClose( pBus );
+            }
+            else
+            {
+                t = pBus->idleTimeout - idle;
+            }
+        }
+
+        if ( remaining != NULL )
+        {
+            *remaining = t;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BusIsOpen                                                                 */
+/*!
+    Check if the I2C bus connection is open
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @retval true the connection is open
+    @retval false the connection is not open
+
+==============================================================================*/
+bool BusIsOpen( LCDBus *pBus )
+{
+    return ( ( pBus != NULL ) && ( pBus->handle != NULL ) ) ? true : false;
+}
+
+/*============================================================================*/
+/*  BusWrite                                                                  */
+/*!
+    Write data to a device on the I2C bus
+
+    The BusWrite function writes one or more bytes to the specified
+    slave device.  The connection must have been acquired using BusOpen().
+
+    If a batch is open (see BusBeginBatch()), the data is added to the
+    batch and is sent when the batch is flushed.  Consecutive writes to
+    the same device are merged into a single message.  Otherwise the data
+    is sent immediately using a single write.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @param[in]
+        address
+            slave address of the device to write to
+
+    @param[in]
+        buf
+            pointer to the data to write
+
+    @param[in]
+        len
+            number of bytes to write
+
+    @retval EOK the write was successful
+    @retval EBADF the connection is not open
+    @retval ENXIO the slave address could not be selected
+    @retval EIO short write
+    @retval EINVAL invalid arguments
+    @retval other error from write()
+
+==============================================================================*/
+int BusWrite( LCDBus *pBus, uint8_t address, uint8_t *buf, size_t len )
+{
+    int result = EINVAL;
+    struct i2c_msg *msg;
+
+    if ( ( pBus != NULL ) &&
+         ( buf != NULL ) )
+    {
+        if ( ( pBus->batchDepth == 0 ) ||
+             ( len > LCD_BUS_BATCH_BUFSIZE ) )
+        {
+            result = BusFlush( pBus );
+            if ( result == EOK )
+            {
+                result = writeDirect( pBus, address, buf, len );
+            }
+        }
+        else
+        {
+            result = EOK;
+
+            if ( pBus->batchLen + len > LCD_BUS_BATCH_BUFSIZE )
+            {
+                /* no room for the data, send what we have so far */
+                result = BusFlush( pBus );
+            }
+
+            msg = ( pBus->nmsgs > 0 ) ? &pBus->msgs[pBus->nmsgs - 1] : NULL;
+            if ( ( msg == NULL ) ||
+                 ( msg->addr != address ) ||
+                 ( msg->buf + msg->len != &pBus->batchBuf[pBus->batchLen] ) )
+            {
+                if ( pBus->nmsgs == LCD_BUS_BATCH_MSGS )
+                {
+                    result = BusFlush( pBus );
+                }
+
+                /* start a new message */
+                msg = &pBus->msgs[pBus->nmsgs++];
+                msg->addr = address;
+                msg->flags = 0;
+                msg->len = 0;
+                msg->buf = &pBus->batchBuf[pBus->batchLen];
+            }
+
+            memcpy( &pBus->batchBuf[pBus->batchLen], buf, len );
+            pBus->batchLen += len;
+            msg->len += len;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  writeDirect                                                               */
+/*!
+    Write data to a device on the I2C bus immediately
+
+    The writeDirect function writes one or more bytes to the specified
+    slave device using a single write.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @param[in]
+        address
+            slave address of the device to write to
+
+    @param[in]
+        buf
+            pointer to the data to write
+
+    @param[in]
+        len
+            number of bytes to write
+
+    @retval EOK the write was successful
+    @retval EBADF the connection is not open
+    @retval ENXIO the slave address could not be selected
+    @retval EIO short write
+    @retval other error from write()
+
+==============================================================================*/
+static int writeDirect( LCDBus *pBus,
+                        uint8_t address,
+                        uint8_t *buf,
+                        size_t len )
+{
+    int result;
+
+    result = selectSlave( pBus, address );
+    if ( result == EOK )
+    {
+        result = pBus->pTransport->write( pBus->handle, buf, len );
+        pBus->stats.syscalls++;
+        pBus->stats.writes++;
+        pBus->stats.bytes += len + 1;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BusBeginBatch                                                             */
+/*!
+    Begin a batch of bus writes
+
+    The BusBeginBatch function acquires the bus connection and starts
+    collecting writes to any device on the bus into a batch, so that
+    they can be submitted together.  Batches may be nested.  The batch
+    is sent when the outermost batch is ended with BusEndBatch(),
+    or earlier if BusFlush() is called, the batch fills up, or data is
+    read from the bus.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @retval EOK the batch was started
+    @retval EINVAL invalid arguments
+    @retval other error from BusOpen()
+
+==============================================================================*/
+int BusBeginBatch( LCDBus *pBus )
+{
+    int result = EINVAL;
+
+    if ( pBus != NULL )
+    {
+        result = BusOpen( pBus );
+        if ( result == EOK )
+        {
+            pBus->batchDepth++;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BusEndBatch                                                               */
+/*!
+    End a batch of bus writes
+
+    The BusEndBatch function closes a batch opened with BusBeginBatch().
+    When the outermost batch is closed, the batched writes are sent
+    to the bus.  The bus connection is then released.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @retval EOK the batch was completed
+    @retval EINVAL invalid arguments
+    @retval other error from BusFlush()
+
+==============================================================================*/
+int BusEndBatch( LCDBus *pBus )
+{
+    int result = EINVAL;
+
+    if ( ( pBus != NULL ) &&
+         ( pBus->batchDepth > 0 ) )
+    {
+        result = EOK;
+
+        pBus->batchDepth--;
+        if ( pBus->batchDepth == 0 )
+        {
+            result = BusFlush( pBus );
+        }
+
+        BusRelease( pBus );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BusFlush                                                                  */
+/*!
+    Send the batched writes to the bus
+
+    The BusFlush function sends all of the batched writes to the bus.
+    If the adapter supports plain I2C transfers, all of the messages
+    are sent using a single I2C_RDWR ioctl.  Otherwise, each message is
+    sent using its own write.  The batch (if any) remains open.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @retval EOK the batch was sent (or there was nothing to send)
+    @retval EBADF the connection is not open
+    @retval EINVAL invalid arguments
+    @retval other error from ioctl() or write()
+
+==============================================================================*/
+int BusFlush( LCDBus *pBus )
+{
+    int result = EINVAL;
+    int rc;
+    int i;
+
+    if ( pBus != NULL )
+    {
+        result = EOK;
+
+        if ( pBus->nmsgs > 0 )
+        {
+            if ( pBus->handle == NULL )
+            {
+                result = EBADF;
+            }
+            else if ( pBus->rdwr == true )
+            {
+                countMessages( pBus );
+                result = pBus->pTransport->transfer( pBus->handle,
+                                                     pBus->msgs,
+                                                     pBus->nmsgs );
+            }
+            else
+            {
+                for ( i = 0; i < pBus->nmsgs; i++ )
+                {
+                    rc = writeDirect( pBus,
+                                      pBus->msgs[i].addr,
+                                      pBus->msgs[i].buf,
+                                      pBus->msgs[i].len );
+                    if ( rc != EOK )
+                    {
+                        result = rc;
+                    }
+                }
+            }
+
+            pBus->nmsgs = 0;
+            pBus->batchLen = 0;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BusRead                                                                   */
+/*!
+    Read data from a device on the I2C bus
+
+    The BusRead function reads one or more bytes from the specified
+    slave device using a single read.  The connection must have been
+    acquired using BusOpen().  Any batched writes are sent first.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @param[in]
+        address
+            slave address of the device to read from
+
+    @param[in]
+        buf
+            pointer to the location to store the data
+
+    @param[in]
+        len
+            number of bytes to read
+
+    @retval EOK the read was successful
+    @retval EBADF the connection is not open
+    @retval ENXIO the slave address could not be selected
+    @retval EIO short read
+    @retval EINVAL invalid arguments
+    @retval other error from read()
+
+==============================================================================*/
+int BusRead( LCDBus *pBus, uint8_t address, uint8_t *buf, size_t len )
+{
+    int result = EINVAL;
+
+    if ( ( pBus != NULL ) &&
+         ( buf != NULL ) )
+    {
+        /* batched writes must reach the bus before we read it back */
+        result = BusFlush( pBus );
+        if ( result == EOK )
+        {
+            result = selectSlave( pBus, address );
+        }
+
+        if ( result == EOK )
+        {
+            result = pBus->pTransport->read( pBus->handle, buf, len );
+            pBus->stats.syscalls++;
+            pBus->stats.reads++;
+            pBus->stats.bytes += len + 1;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BusTransfer                                                               */
+/*!
+    Perform a combined transfer with a device on the I2C bus
+
+    The BusTransfer function performs a sequence of reads and writes
+    with the specified slave device as a single I2C_RDWR transaction,
+    with a repeated start between the messages.  Any batched writes are
+    sent in the same transaction, ahead of the transfer messages.
+
+    Combined transfers are only available on adapters which support
+    plain I2C transfers.  On other (SMBus only) adapters the caller must
+    perform the transfer using BusWrite() and BusRead().
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @param[in]
+        address
+            slave address of the device to communicate with
+
+    @param[in,out]
+        xfers
+            pointer to an array of transfer messages
+
+    @param[in]
+        n
+            number of transfer messages
+
+    @retval EOK the transfer was successful
+    @retval ENOTSUP the adapter does not support combined transfers
+    @retval EBADF the connection is not open
+    @retval E2BIG too many transfer messages
+    @retval EINVAL invalid arguments
+    @retval other error from ioctl()
+
+==============================================================================*/
+int BusTransfer( LCDBus *pBus,
+                 uint8_t address,
+                 LCDBusXfer *xfers,
+                 int n )
+{
+    int result = EINVAL;
+    struct i2c_msg *pMsg;
+    int i;
+
+    if ( ( pBus != NULL ) &&
+         ( xfers != NULL ) &&
+         ( n > 0 ) )
+    {
+        if ( pBus->handle == NULL )
+        {
+            result = EBADF;
+        }
+        else if ( pBus->rdwr == false )
+        {
+            result = ENOTSUP;
+        }
+        else if ( n > LCD_BUS_BATCH_MSGS )
+        {
+            result = E2BIG;
+        }
+        else
+        {
+            result = EOK;
+
+            if ( pBus->nmsgs + n > LCD_BUS_BATCH_MSGS )
+            {
+                /* no room to combine the transfer with the batch */
+                result = BusFlush( pBus );
+            }
+
+            if ( result == EOK )
+            {
+                for ( i = 0; i < n; i++ )
+                {
+                    pMsg = &pBus->msgs[pBus->nmsgs++];
+                    pMsg->addr = address;
+                    pMsg->flags = xfers[i].read ? I2C_M_RD : 0;
+                    pMsg->len = xfers[i].len;
+                    pMsg->buf = xfers[i].buf;
+                }
+
+                countMessages( pBus );
+                result = pBus->pTransport->transfer( pBus->handle,
+                                                     pBus->msgs,
+                                                     pBus->nmsgs );
+
+                pBus->nmsgs = 0;
+                pBus->batchLen = 0;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  selectSlave                                                               */
+/*!
+    Select the slave device to communicate with
+
+    The selectSlave function sets the slave address used by subsequent
+    reads and writes on the I2C bus connection.  The I2C_SLAVE ioctl
+    is only issued if the address has changed since the last access.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @param[in]
+        address
+            slave address to select
+
+    @retval EOK the slave device was selected
+    @retval EBADF the connection is not open
+    @retval ENXIO cannot use ioctl to set the device as a slave device
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int selectSlave( LCDBus *pBus, uint8_t address )
+{
+    int result = EINVAL;
+
+    if ( pBus != NULL )
+    {
+        if ( pBus->handle == NULL )
+        {
+            result = EBADF;
+        }
+        else if ( pBus->slave == address )
+        {
+            result = EOK;
+        }
+        else
+        {
+            pBus->stats.syscalls++;
+            result = pBus->pTransport->select( pBus->handle, address );
+            pBus->slave = ( result == EOK ) ? address : -1;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  selectTransport                                                           */
+/*!
+    Select the transport for an I2C device
+
+    The selectTransport function chooses the transport used to access
+    the I2C device from its name.  Names starting with LCD_EMU_PREFIX
+    select the in-process display emulator.
+
+    @param[in]
+        device
+            name of the I2C device
+
+    @retval pointer to the transport operations
+
+==============================================================================*/
+static const LCDTransport *selectTransport( char *device )
+{
+    return ( strncmp( device,
+                      LCD_EMU_PREFIX,
+                      strlen( LCD_EMU_PREFIX ) ) == 0 ) ? GetEmuTransport()
+                                                        : GetI2CDevTransport();
+}
+
+/*============================================================================*/
+/*  countMessages                                                             */
+/*!
+    Count the bus activity of an I2C_RDWR transfer
+
+    The countMessages function updates the bus activity counters for
+    the batched messages which are about to be sent as one I2C_RDWR
+    transfer.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+==============================================================================*/
+static void countMessages( LCDBus *pBus )
+{
+    int i;
+
+    pBus->stats.syscalls++;
+    pBus->stats.transfers++;
+
+    for ( i = 0; i < pBus->nmsgs; i++ )
+    {
+        pBus->stats.bytes += pBus->msgs[i].len + 1;
+    }
+}
+
+/*============================================================================*/
+/*  elapsed_ms                                                                */
+/*!
+    Calculate the time elapsed since the specified time
+
+    @param[in]
+        since
+            pointer to the CLOCK_MONOTONIC start time
+
+    @retval number of milliseconds elapsed since the start time
+
+==============================================================================*/
+static int elapsed_ms( struct timespec *since )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( now.tv_sec - since->tv_sec ) * 1000 +
+           ( now.tv_nsec - since->tv_nsec ) / 1000000;
+}
+
+/*============================================================================*/
+/*  GetIdleTimeout                                                            */
+/*!
+    Get the idle timeout of the I2C bus connection
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @param[in]
+        timeout
+            pointer to the location to store the idle timeout (ms)
+
+    @retval EOK the query was successful
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GetIdleTimeout( LCDBus *pBus, int *timeout )
+{
+    int result = EINVAL;
+
+    if ( ( pBus != NULL ) &&
+         ( timeout != NULL ) )
+    {
+        *timeout = pBus->idleTimeout;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetIdleTimeout                                                            */
+/*!
+    Set the idle timeout of the I2C bus connection
+
+    The SetIdleTimeout function sets the time an unused I2C bus
+    connection is held open before it is closed.  A timeout of zero
+    closes the connection as soon as it is released.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @param[in]
+        timeout
+            idle timeout in milliseconds
+
+    @retval EOK the set was successful
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int SetIdleTimeout( LCDBus *pBus, int timeout )
+{
+    int result = EINVAL;
+
+    if ( ( pBus != NULL ) &&
+         ( timeout >= 0 ) )
+    {
+        pBus->idleTimeout = timeout;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GetBusDevice                                                              */
+/*!
+    Get the name of the i2c device
+
+    The GetBusDevice function gets the name of the i2c bus device
+    eg /dev/i2c-1.  The returned name should be considered constant.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @param[in]
+        name
+            pointer to the location to store the pointer to the device name
+
+    @retval EOK the query was successful
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GetBusDevice( LCDBus *pBus, char **name )
+{
+    int result = EINVAL;
+
+    if ( ( pBus != NULL ) &&
+         ( name != NULL ) )
+    {
+        *name = pBus->device;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetBusDevice                                                              */
+/*!
+    Set the name of the i2c device
+
+    The SetBusDevice function sets the name of the i2c device
+    eg /dev/i2c-1.  The name is used the next time the connection
+    is opened.  An idle connection to the previous device is closed.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @param[in]
+        name
+            pointer to the i2c device name
+
+    @retval EOK the set was successful
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int SetBusDevice( LCDBus *pBus, char *name )
+{
+    int result = EINVAL;
+
+    if ( pBus != NULL )
+    {
+        BusClose( pBus );
+        pBus->device = name;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GetBusStats                                                               */
+/*!
+    Get the bus activity counters
+
+    The GetBusStats function gets the number of system calls made on the
+    bus device, the number of bytes sent and received on the wire, and
+    the number of each type of bus operation, since the bus was created
+    or the counters were last reset.
+
+    The counters are updated without locking, so a snapshot taken on
+    another thread while the bus is in use is approximate.
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @param[out]
+        pStats
+            pointer to the location to store the counters
+
+    @retval EOK the counters were retrieved
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GetBusStats( LCDBus *pBus, LCDBusStats *pStats )
+{
+    int result = EINVAL;
+
+    if ( ( pBus != NULL ) &&
+         ( pStats != NULL ) )
+    {
+        *pStats = pBus->stats;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ResetBusStats                                                             */
+/*!
+    Reset the bus activity counters
+
+    @param[in]
+        pBus
+            pointer to the LCDBus object
+
+    @retval EOK the counters were reset
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int ResetBusStats( LCDBus *pBus )
+{
+    int result = EINVAL;
+
+    if ( pBus != NULL )
+    {
+        memset( &pBus->stats, 0, sizeof( pBus->stats ) );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of lcdbus group */
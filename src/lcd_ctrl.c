@@ -41,6 +41,12 @@ SOFTWARE.
     cusor, controlling cursor display modes, and writing to the display
     among other things.
 
+    It also manages the custom characters (glyphs) displayed by the
+    device.  Glyphs are registered by identifier with RegisterGlyph(),
+    and LoadGlyph() maps them onto the 8 character generator RAM slots
+    of a device, replacing the least recently used glyph which is not on
+    the display when a glyph which is not already loaded is required.
+
 */
 /*============================================================================*/
 
@@ -52,9 +58,11 @@ SOFTWARE.
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <stdatomic.h>
 #include <linux/i2c.h>
 #include <linux/i2c-dev.h>
 #include "lcd_ctrl.h"
@@ -68,6 +76,67 @@ SOFTWARE.
 #define EOK 0
 #endif
 
+/*! cost of re-addressing the display data RAM (one SetADD() instruction)
+    measured in character writes.  Unchanged gaps up to this length
+    are rewritten rather than skipped over */
+#define LCD_READDRESS_COST  ( 1 )
+
+/*! number of status reads to wait for a probe instruction to complete */
+#define LCD_PROBE_READS     ( 3 )
+
+/*! time (us) between probe status reads, longer than the execution time
+    of the set DDRAM address instruction */
+#define LCD_PROBE_WAIT_US   ( 50 )
+
+/*! maximum number of registered glyphs */
+#define LCD_MAX_GLYPHS      ( 32 )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! The LCDGlyph type holds a registered custom character bitmap */
+typedef struct _LCDGlyph
+{
+    /*! glyph identifier */
+    uint16_t id;
+
+    /*! the glyph entry is in use */
+    bool used;
+
+    /*! glyph bitmap, one row per byte, using the low 5 bits */
+    uint8_t bitmap[LCD_GLYPH_ROWS];
+
+} LCDGlyph;
+
+/*==============================================================================
+        Private File Scoped Variables
+==============================================================================*/
+
+/*! registered glyphs */
+static LCDGlyph glyphs[LCD_MAX_GLYPHS];
+
+/*! glyph use stamp, incremented on each LoadGlyph().  It is shared by the
+    displays on all of the buses, which may be driven by different
+    threads */
+static atomic_uint glyphUse;
+
+/*==============================================================================
+        Private Function Declarations
+==============================================================================*/
+
+static int writeRun( LCDDev *pDev, uint8_t addr, char *data, int len );
+static LCDGlyph *findGlyph( uint16_t id );
+static bool isLoaded( LCDDev *pDev,
+                      LCDGlyphSlot *pSlot,
+                      int slot,
+                      LCDGlyph *pGlyph );
+static bool isShown( LCDDev *pDev, int slot );
+static int uploadGlyph( LCDDev *pDev, int slot, LCDGlyph *pGlyph );
+static int coldInit( LCDDev *pDev );
+static int restoreCGRAM( LCDDev *pDev, const LCDShadow *pSaved );
+static int probe( LCDDev *pDev );
+
 /*============================================================================*/
 /*  LCDInit                                                                   */
 /*!
@@ -90,24 +159,458 @@ SOFTWARE.
 int LCDInit( LCDDev *pDev )
 {
     int result = EINVAL;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_INIT );
 
     if ( pDev != NULL )
     {
         result = LCDOpen( pDev );
         if ( result == EOK )
         {
+            result = coldInit( pDev );
+            LCDClose( pDev );
+        }
+    }
+
+    EndTrace( pDev, origin );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LCDWarmInit                                                               */
+/*!
+    Initialize the LCD device, keeping its contents if possible
+
+    The LCDWarmInit function checks whether the LCD device has already
+    been set up in 4-bit mode (for example by a previous instance of the
+    service) using probe().  If it has, the display is only switched on,
+    and its contents are left in place, so the display does not blank
+    and the clear and home instructions are not needed.  The shadow
+    state of the display is kept, so it should be reset with
+    ResetShadow() if it is not known to match the display.  Otherwise,
+    the device is fully initialized as by LCDInit().
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[out]
+        warm
+            set to true if the display contents were kept, false if
+            the device was fully initialized
+
+    @retval EOK the initialization was successful
+    @retval ENODEV no I2C device was specified
+    @retval ENXIO ioctl failed
+    @retval other error from open()
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int LCDWarmInit( LCDDev *pDev, bool *warm )
+{
+    int result = EINVAL;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_INIT );
+
+    if ( ( pDev != NULL ) &&
+         ( warm != NULL ) )
+    {
+        *warm = false;
+
+        result = LCDOpen( pDev );
+        if ( result == EOK )
+        {
+            if ( probe( pDev ) == EOK )
+            {
+                *warm = true;
+                result = Cursor( pDev );
+            }
+            else
+            {
+                result = coldInit( pDev );
+            }
+
+            LCDClose( pDev );
+        }
+    }
+
+    EndTrace( pDev, origin );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LCDRestore                                                                */
+/*!
+    Restore the display from a saved shadow state
+
+    The LCDRestore function brings the display back to a state saved
+    earlier, for example by a previous instance of the service (see
+    AttachShadow()).  The custom characters, the display data RAM, the
+    display on/off control and entry mode, the display shift, and the
+    backlight are restored.  Only the parts of the saved state which
+    differ from the current shadow state of the display are written, and
+    they are all sent as one bus transaction, so after a warm start (see
+    LCDWarmInit()) there is usually nothing to write.
+
+    @param[in]
+        pDev
+            pointer to the LCD device object
+
+    @param[in]
+        pSaved
+            pointer to a copy of the saved shadow state
+
+    @retval EOK the display was restored
+    @retval EINVAL invalid arguments
+    @retval other error from LCDOpen() or one of the writes
+
+==============================================================================*/
+int LCDRestore( LCDDev *pDev, const LCDShadow *pSaved )
+{
+    int result = EINVAL;
+    const LCDShadow *pShadow;
+    int rc;
+    int i;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_RESTORE );
+
+    if ( ( pDev != NULL ) &&
+         ( pSaved != NULL ) &&
+         ( GetShadow( pDev, &pShadow ) == EOK ) )
+    {
+        result = LCDOpen( pDev );
+        if ( result == EOK )
+        {
+            BeginTransaction( pDev );
+
+            result = restoreCGRAM( pDev, pSaved );
+
+            for ( i = 0; ( i < LCD_DDRAM_ROWS ) && ( pSaved->ddramValid ); i++ )
+            {
+                rc = DisplayText( pDev,
+                                  ( i == 0 ) ? 0x00 : 0x40,
+                                  (char *)pSaved->ddram[i],
+                                  LCD_DDRAM_COLS );
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+            }
+
+            if ( ( pSaved->ddramValid == true ) && ( result == EOK ) )
+            {
+                /* every row has been written (or was already shown) */
+                ValidateShadowDDRAM( pDev );
+            }
+
+            if ( ( pSaved->entryMode != 0 ) &&
+                 ( pSaved->entryMode != pShadow->entryMode ) )
+            {
+                rc = writeByte( pDev, 0, pSaved->entryMode );
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+            }
+
+            if ( ( pSaved->control != 0 ) &&
+                 ( pSaved->control != pShadow->control ) )
+            {
+                rc = writeByte( pDev, 0, pSaved->control );
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+            }
+
+            rc = SetDisplayOrigin( pDev, pSaved->shift );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+
+            RequestBacklight( pDev, pSaved->backlight );
+            rc = SyncBacklight( pDev );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+
+            rc = EndTransaction( pDev );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+
+            LCDClose( pDev );
+        }
+    }
+
+    EndTrace( pDev, origin );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LCDResync                                                                 */
+/*!
+    Recover the display after an I/O error without reinitializing it
+
+    The LCDResync function brings a display whose 4-bit interface may
+    have lost nibble sync (see GetSyncLost()) back into step, and then
+    replays its shadow state.  It is much quicker than a restart of the
+    service, and does not clear the display.
+
+    The interface is resynchronized using the same 8-bit/4-bit sequence
+    used at initialization (see Set4BitMode()), with timed writes since
+    the busy flag cannot be trusted until the interface is in sync.
+    The controller is then checked using the probe() address read back.
+    A stray instruction may have been executed while the interface was
+    out of sync, so the display is returned home to undo any display
+    shift, and the shadow state is reset and restored from a copy (see
+    LCDRestore()).  The shadow state is updated as the display is
+    written even if the writes fail, so it holds the intended contents
+    of the display, including those of the write which failed.
+
+    @param[in]
+        pDev
+            pointer to the LCD device object
+
+    @retval EOK the display was resynchronized and restored
+    @retval EIO the controller did not respond after resynchronizing
+    @retval EINVAL invalid arguments
+    @retval other error from LCDOpen(), Set4BitMode(), or LCDRestore()
+
+==============================================================================*/
+int LCDResync( LCDDev *pDev )
+{
+    int result = EINVAL;
+    const LCDShadow *pShadow;
+    LCDShadow saved;
+    LCDWriteMode mode;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_RESTORE );
+
+    if ( ( pDev != NULL ) &&
+         ( GetShadow( pDev, &pShadow ) == EOK ) )
+    {
+        saved = *pShadow;
+
+        result = LCDOpen( pDev );
+        if ( result == EOK )
+        {
+            ClearSyncLost( pDev );
+
+            GetWriteMode( pDev, &mode );
+            SetWriteMode( pDev, LCD_WRITE_TIMED );
+
             result = Set4BitMode( pDev );
             if ( result == EOK )
             {
-                ClearDisplay( pDev );
-                CursorHome( pDev );
-                Cursor( pDev );
+                result = probe( pDev );
+            }
+
+            if ( result == EOK )
+            {
+                result = CursorHome( pDev );
+            }
+
+            SetWriteMode( pDev, mode );
+
+            if ( result == EOK )
+            {
+                ResetShadow( pDev );
+                result = LCDRestore( pDev, &saved );
             }
 
             LCDClose( pDev );
         }
     }
 
+    EndTrace( pDev, origin );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  restoreCGRAM                                                              */
+/*!
+    Restore the custom characters from a saved shadow state
+
+    The restoreCGRAM function writes each fully known custom character
+    slot of the saved state which differs from the current contents of
+    the character generator RAM, and restores the glyph cache slot table
+    so the glyphs are not loaded again.  The glyph use stamps are reset,
+    since they belong to the previous instance of the glyph cache.
+
+    @param[in]
+        pDev
+            pointer to the open LCD device object
+
+    @param[in]
+        pSaved
+            pointer to a copy of the saved shadow state
+
+    @retval EOK the custom characters were restored
+    @retval other error from writeByte()
+
+==============================================================================*/
+static int restoreCGRAM( LCDDev *pDev, const LCDShadow *pSaved )
+{
+    int result = EOK;
+    const uint8_t *shadow;
+    LCDGlyphSlot *pSlots;
+    bool written = false;
+    int slot;
+    int row;
+    int rc;
+
+    GetGlyphSlots( pDev, &pSlots );
+
+    for ( slot = 0; slot < LCD_CGRAM_SLOTS; slot++ )
+    {
+        if ( pSaved->cgramKnown[slot] != 0xFF )
+        {
+            continue;
+        }
+
+        if ( ( GetShadowCGRAM( pDev, slot, &shadow ) != EOK ) ||
+             ( memcmp( shadow,
+                       pSaved->cgram[slot],
+                       LCD_GLYPH_ROWS ) != 0 ) )
+        {
+            /* set the CGRAM address and write the bitmap rows */
+            result = writeByte( pDev, 0, 0x40 | ( slot << 3 ) );
+            for ( row = 0; row < LCD_GLYPH_ROWS; row++ )
+            {
+                rc = writeByte( pDev, 1, pSaved->cgram[slot][row] );
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+            }
+
+            written = true;
+        }
+
+        pSlots[slot] = pSaved->glyphs[slot];
+        pSlots[slot].lastUse = 0;
+    }
+
+    if ( written == true )
+    {
+        /* leave the address counter in the display data RAM */
+        rc = SetADD( pDev, 0x00 );
+        if ( rc != EOK )
+        {
+            result = rc;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  coldInit                                                                  */
+/*!
+    Fully initialize an open LCD device
+
+    The coldInit function discards the shadow state of the display,
+    sets up 4-bit mode, and clears the display.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @retval EOK the initialization was successful
+    @retval other error from Set4BitMode()
+
+==============================================================================*/
+static int coldInit( LCDDev *pDev )
+{
+    int result;
+
+    ResetShadow( pDev );
+
+    result = Set4BitMode( pDev );
+    if ( result == EOK )
+    {
+        ClearDisplay( pDev );
+        CursorHome( pDev );
+        Cursor( pDev );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  probe                                                                     */
+/*!
+    Check that the LCD is in 4-bit mode and in nibble sync
+
+    The probe function sets the display data address to the first and
+    last addresses of the display data RAM in turn, and reads each one
+    back from the address counter using the status read.  The address
+    only reads back correctly if the controller is already in 4-bit mode
+    and is latching the nibbles in step with us.  The display contents
+    are not changed.
+
+    The instructions are written with timed writes, and the busy flag
+    is only read a few times, so a controller which is not in sync
+    cannot stall the probe.  A busy status does not match either
+    address.
+
+    @param[in]
+        pDev
+            pointer to the open LCDDev controller state object
+
+    @retval EOK the controller is set up and in sync
+    @retval EIO the address read back does not match
+    @retval other error from SetADD() or readByte()
+
+==============================================================================*/
+static int probe( LCDDev *pDev )
+{
+    static const uint8_t addrs[] = { 0x00, 0x67 };
+    LCDWriteMode mode;
+    uint8_t status = 0;
+    int result = EOK;
+    size_t i;
+    int n;
+
+    GetWriteMode( pDev, &mode );
+    SetWriteMode( pDev, LCD_WRITE_TIMED );
+
+    for ( i = 0; ( i < sizeof( addrs ) ) && ( result == EOK ); i++ )
+    {
+        result = SetADD( pDev, addrs[i] );
+
+        /* read the status until the instruction has completed */
+        for ( n = 0; ( n < LCD_PROBE_READS ) && ( result == EOK ); n++ )
+        {
+            result = readByte( pDev, &status );
+            if ( ( status & 0x80 ) == 0 )
+            {
+                break;
+            }
+
+            usleep( LCD_PROBE_WAIT_US );
+        }
+
+        if ( ( result == EOK ) && ( status != addrs[i] ) )
+        {
+            result = EIO;
+        }
+    }
+
+    SetWriteMode( pDev, mode );
+
     return result;
 }
 
@@ -135,6 +638,9 @@ int LCDInit( LCDDev *pDev )
 int ClearDisplay( LCDDev *pDev )
 {
     int result = EINVAL;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_CLEAR );
 
     if ( pDev != NULL )
     {
@@ -142,6 +648,8 @@ int ClearDisplay( LCDDev *pDev )
         result = writeByte( pDev, 0, 0x01 );
     }
 
+    EndTrace( pDev, origin );
+
     return result;
 }
 
@@ -169,6 +677,9 @@ int ClearDisplay( LCDDev *pDev )
 int CursorHome( LCDDev *pDev )
 {
     int result = EINVAL;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_HOME );
 
     if ( pDev != NULL )
     {
@@ -176,6 +687,8 @@ int CursorHome( LCDDev *pDev )
         result = writeByte( pDev, 0, 0x02 );
     }
 
+    EndTrace( pDev, origin );
+
     return result;
 }
 
@@ -204,6 +717,9 @@ int CursorHome( LCDDev *pDev )
 int SetADD( LCDDev *pDev, uint8_t loc )
 {
     int result = EINVAL;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_SETADD );
 
     if ( pDev != NULL )
     {
@@ -211,6 +727,8 @@ int SetADD( LCDDev *pDev, uint8_t loc )
         result = writeByte( pDev, 0, 0x80 | loc );
     }
 
+    EndTrace( pDev, origin );
+
     return result;
 }
 
@@ -239,6 +757,9 @@ int SetADD( LCDDev *pDev, uint8_t loc )
 int Cursor( LCDDev *pDev )
 {
     int result = EINVAL;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_CURSOR );
 
     if ( pDev != NULL )
     {
@@ -246,6 +767,138 @@ int Cursor( LCDDev *pDev )
         result = writeByte( pDev, 0, 0x0F );
     }
 
+    EndTrace( pDev, origin );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ShiftDisplay                                                              */
+/*!
+    Shift the display window by one character
+
+    The ShiftDisplay function writes the cursor or display shift command
+    (code 0x18 for left, 0x1C for right) to the hardware.  This moves
+    the visible window over the 40 character display data RAM rows
+    without rewriting any of the display data.  Note that the HD44780
+    shifts both rows together.  The shift is undone by CursorHome().
+
+    The command is written to the hardware using the writeByte()
+    function.
+
+    @param[in]
+        pDev
+            pointer to the LCD device object
+
+    @param[in]
+        left
+            true to shift the display contents to the left, false
+            to shift them to the right
+
+    @retval EOK the command was successful
+    @retval EINVAL invalid arguments
+    @retval other error from writeByte()
+
+==============================================================================*/
+int ShiftDisplay( LCDDev *pDev, bool left )
+{
+    int result = EINVAL;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_SHIFT );
+
+    if ( pDev != NULL )
+    {
+        /* shift the display, leaving the address counter alone */
+        result = writeByte( pDev, 0, left ? 0x18 : 0x1C );
+    }
+
+    EndTrace( pDev, origin );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetDisplayOrigin                                                          */
+/*!
+    Shift the display to show the display data RAM from a column
+
+    The SetDisplayOrigin function shifts the display so that the
+    specified display data RAM column is shown at the left of each
+    row, for example to show text which was written off screen (see
+    DisplayText()).  The display window wraps around the 40 column
+    display data RAM rows, so the display is shifted left or right,
+    whichever needs the fewest shift instructions, and the instructions
+    are sent as one I2C transaction.  Nothing is written if the column
+    is already shown at the left of the display.
+
+    The display shift is tracked in the shadow state of the display
+    (see GetShadow()), and is reset by ClearDisplay() and CursorHome().
+
+    @param[in]
+        pDev
+            pointer to the LCD device object
+
+    @param[in]
+        col
+            display data RAM column to show at the left of the display
+            (0 to 39)
+
+    @retval EOK the command was successful
+    @retval EINVAL invalid arguments
+    @retval other error from LCDOpen() or ShiftDisplay()
+
+==============================================================================*/
+int SetDisplayOrigin( LCDDev *pDev, int col )
+{
+    int result = EINVAL;
+    const LCDShadow *pShadow;
+    int n;
+    int rc;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_SHIFT );
+
+    if ( ( col >= 0 ) &&
+         ( col < LCD_DDRAM_COLS ) &&
+         ( GetShadow( pDev, &pShadow ) == EOK ) )
+    {
+        /* number of left shifts needed to reach the column */
+        n = ( col - pShadow->shift + LCD_DDRAM_COLS ) % LCD_DDRAM_COLS;
+
+        result = ( n == 0 ) ? EOK : LCDOpen( pDev );
+        if ( ( result == EOK ) && ( n != 0 ) )
+        {
+            BeginTransaction( pDev );
+
+            if ( n <= LCD_DDRAM_COLS / 2 )
+            {
+                while ( ( n-- > 0 ) && ( result == EOK ) )
+                {
+                    result = ShiftDisplay( pDev, true );
+                }
+            }
+            else
+            {
+                n = LCD_DDRAM_COLS - n;
+                while ( ( n-- > 0 ) && ( result == EOK ) )
+                {
+                    result = ShiftDisplay( pDev, false );
+                }
+            }
+
+            rc = EndTransaction( pDev );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+
+            LCDClose( pDev );
+        }
+    }
+
+    EndTrace( pDev, origin );
+
     return result;
 }
 
@@ -257,13 +910,24 @@ int Cursor( LCDDev *pDev )
     The DisplayLine function writes the specified text to the
     display data RAM at the specified offset.  For example, on the
     2x16 LCD hardware, offset 0 is the start of the first line,
-    and offset 0x40 is the start of the second line.
+    and offset 0x40 is the start of the second line.  The row addresses
+    of the display are given by its geometry (see GetGeometry()).
 
-    The character write start location is specified using the SetADD()
-    function.
+    Exactly one visible line width of characters is written, with the
+    line filled with blanks after the end of the text.
+
+    The new line is compared with the shadow copy of the display
+    data RAM (see GetShadowDDRAM()) and only the runs of characters
+    which have changed are written.  Runs separated by a gap which is
+    cheaper to rewrite than to re-address (LCD_READDRESS_COST) are
+    merged.  If the display contents are not known, the whole line
+    is written.
+
+    The character write start location of each run is specified using
+    the SetADD() function.
 
     The command is written to the hardware using the writeByte()
-    function.
+    function.  All of the runs are queued as a single I2C transaction.
 
     If the interface to the hardware is not open, this function will
     open it and closed it upon completion of the write.
@@ -272,6 +936,14 @@ int Cursor( LCDDev *pDev )
         pDev
             pointer to the LCD device object
 
+    @param[in]
+        offset
+            display data address of the start of the line
+
+    @param[in]
+        line
+            pointer to the NUL terminated line text
+
     @retval EOK the command was successful
     @retval EINVAL invalid arguments
     @retval other error from SetADD() or writeByte()
@@ -280,37 +952,640 @@ int Cursor( LCDDev *pDev )
 int DisplayLine( LCDDev *pDev, int offset, char *line )
 {
     int result = EINVAL;
-    char ch;
+    const LCDGeometry *pGeometry;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_LINE );
+
+    if ( GetGeometry( pDev, &pGeometry ) == EOK )
+    {
+        result = DisplayText( pDev, offset, line, pGeometry->cols );
+    }
+
+    EndTrace( pDev, origin );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  DisplayText                                                               */
+/*!
+    Display text of a specified width on the display
+
+    The DisplayText function writes the specified text to the display
+    data RAM at the specified offset, in the same way as DisplayLine(),
+    but for a field of up to the full 40 column width of a display data
+    RAM row.  The field is filled with blanks after the end of the text.
+    Characters written past the visible width of the display can be
+    brought into view with ShiftDisplay().
+
+    The field is padded and compared with the display contents in a
+    single pass, and the device is not opened at all if none of the
+    characters have changed.
+
+    @param[in]
+        pDev
+            pointer to the LCD device object
+
+    @param[in]
+        offset
+            display data address of the start of the field
+
+    @param[in]
+        text
+            pointer to the NUL terminated text
+
+    @param[in]
+        width
+            width of the field.  It is limited to the end of the
+            display data RAM row.
+
+    @retval EOK the command was successful
+    @retval EINVAL invalid arguments
+    @retval other error from SetADD() or writeByte()
+
+==============================================================================*/
+int DisplayText( LCDDev *pDev, int offset, char *text, int width )
+{
+    int result = EINVAL;
+    char buf[LCD_DDRAM_COLS];
+    const uint8_t *shadow = NULL;
+    bool end = false;
+    int first = -1;
+    int last = -1;
+    int start;
     int i;
     int rc;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_TEXT );
 
     if ( ( pDev != NULL ) &&
-         ( line != NULL ) )
+         ( text != NULL ) &&
+         ( width > 0 ) )
     {
-        /* open the LCD device if it isn't open already */
-        result = LCDOpen( pDev );
-        if ( result == EOK )
+        /* the field cannot extend past the end of the row */
+        if ( width > LCD_DDRAM_COLS - ( offset & 0x3F ) )
         {
-            /* Set the Display Data Address */
-            result = SetADD( pDev, offset );
-            if ( result == EOK )
+            width = LCD_DDRAM_COLS - ( offset & 0x3F );
+        }
+
+        /* get the current display contents (if known) */
+        if ( GetShadowDDRAM( pDev, offset, &shadow ) != EOK )
+        {
+            shadow = NULL;
+        }
+
+        /* build the new field contents, blank after the end of the text,
+           and find the changed region */
+        for( i = 0; i < width; i++ )
+        {
+            end = ( end || ( text[i] == 0 ) );
+            buf[i] = end ? 0x20 : text[i];
+
+            if ( ( shadow == NULL ) || ( (uint8_t)buf[i] != shadow[i] ) )
             {
-                /* iterate through the input data */
-                for( i = 0; i < 17; i++ )
+                first = ( first < 0 ) ? i : first;
+                last = i;
+            }
+        }
+
+        /* open the LCD device if it isn't open already, unless the
+           field is already displayed */
+        result = ( first < 0 ) ? EOK : LCDOpen( pDev );
+        if ( ( result == EOK ) && ( first >= 0 ) )
+        {
+            /* send all of the changed runs as one transaction */
+            BeginTransaction( pDev );
+
+            width = last + 1;
+            i = first;
+            while ( i < width )
+            {
+                if ( ( shadow != NULL ) && ( (uint8_t)buf[i] == shadow[i] ) )
+                {
+                    /* this character is already displayed */
+                    i++;
+                    continue;
+                }
+
+                /* find the end of the run, absorbing short unchanged gaps */
+                start = i;
+                last = i;
+                for ( i = start + 1; i < width; i++ )
                 {
-                    ch = line[i];
-                    if ( ch == 0 )
+                    if ( ( shadow == NULL ) ||
+                         ( (uint8_t)buf[i] != shadow[i] ) )
+                    {
+                        last = i;
+                    }
+                    else if ( ( i - last ) > LCD_READDRESS_COST )
                     {
-                        ch = 0x20;
+                        break;
                     }
+                }
+
+                rc = writeRun( pDev,
+                               offset + start,
+                               &buf[start],
+                               last - start + 1 );
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+
+                i = last + 1;
+            }
+
+            rc = EndTransaction( pDev );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+
+            LCDClose( pDev );
+        }
+    }
+
+    EndTrace( pDev, origin );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  DisplayFrame                                                              */
+/*!
+    Display several rows of text as one update
+
+    The DisplayFrame function writes the first rows of the specified
+    frame to the display, starting at the specified column of the rows
+    given by the display geometry (see GetGeometry()).  Each row is
+    written in the same way as DisplayText(), so only the characters
+    which have changed are written, but the changes to all of the rows
+    are sent as a single I2C transaction, so the display never shows a
+    mixture of old and new rows.
+
+    @param[in]
+        pDev
+            pointer to the LCD device object
+
+    @param[in]
+        col
+            display data RAM column of the start of each row.  A frame
+            written past the visible columns can be brought into view
+            with SetDisplayOrigin().
+
+    @param[in]
+        frame
+            the NUL terminated text of each row
+
+    @param[in]
+        rows
+            number of rows to write.  It is limited to the number of
+            rows of the display.
+
+    @param[in]
+        width
+            width of each row
+
+    @retval EOK the command was successful
+    @retval EINVAL invalid arguments
+    @retval other error from LCDOpen() or DisplayText()
+
+==============================================================================*/
+int DisplayFrame( LCDDev *pDev,
+                  int col,
+                  char frame[][LCD_DDRAM_COLS + 1],
+                  int rows,
+                  int width )
+{
+    int result = EINVAL;
+    const LCDGeometry *pGeometry;
+    int rc;
+    int row;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_FRAME );
+
+    if ( ( frame != NULL ) &&
+         ( GetGeometry( pDev, &pGeometry ) == EOK ) )
+    {
+        result = LCDOpen( pDev );
+        if ( result == EOK )
+        {
+            BeginTransaction( pDev );
+
+            for ( row = 0; ( row < rows ) && ( row < pGeometry->rows ); row++ )
+            {
+                rc = DisplayText( pDev,
+                                  pGeometry->rowAddr[row] + col,
+                                  frame[row],
+                                  width );
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+            }
+
+            rc = EndTransaction( pDev );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+
+            LCDClose( pDev );
+        }
+    }
+
+    EndTrace( pDev, origin );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RegisterGlyph                                                             */
+/*!
+    Register a custom character
+
+    The RegisterGlyph function registers a 5x8 custom character bitmap
+    under the specified identifier, so that it can be loaded onto a
+    display with LoadGlyph().  Registering an identifier again replaces
+    its bitmap, and displays which hold the old bitmap are updated the
+    next time the glyph is loaded.
+
+    Glyphs should be registered before the displays are handed over to
+    the render thread, since the glyph table is not locked.
+
+    @param[in]
+        id
+            glyph identifier chosen by the caller
+
+    @param[in]
+        bitmap
+            pointer to the LCD_GLYPH_ROWS byte bitmap, top row first,
+            using the low 5 bits of each row
+
+    @retval EOK the glyph was registered
+    @retval ENOSPC the glyph table is full
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int RegisterGlyph( uint16_t id, const uint8_t *bitmap )
+{
+    int result = EINVAL;
+    LCDGlyph *pGlyph;
+    int i;
+
+    if ( bitmap != NULL )
+    {
+        pGlyph = findGlyph( id );
+        for ( i = 0; ( pGlyph == NULL ) && ( i < LCD_MAX_GLYPHS ); i++ )
+        {
+            if ( glyphs[i].used == false )
+            {
+                pGlyph = &glyphs[i];
+            }
+        }
+
+        if ( pGlyph != NULL )
+        {
+            pGlyph->id = id;
+            pGlyph->used = true;
+            for ( i = 0; i < LCD_GLYPH_ROWS; i++ )
+            {
+                pGlyph->bitmap[i] = bitmap[i] & 0x1F;
+            }
+
+            result = EOK;
+        }
+        else
+        {
+            result = ENOSPC;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LoadGlyph                                                                 */
+/*!
+    Make a custom character available on a display
+
+    The LoadGlyph function ensures that the specified registered glyph
+    is held in one of the character generator RAM slots of the display,
+    and gets the character code used to display it.
+
+    The character generator RAM is only written if the glyph is not
+    already loaded, in which case the least recently used slot is
+    reprogrammed with one instruction and 8 data writes, sent as a
+    single I2C transaction.  A slot whose character code is on the
+    display is never reprogrammed, since that would change the
+    characters already shown.  Up to LCD_CGRAM_SLOTS glyphs which are
+    loaded one after the other stay loaded together, so all of the
+    glyphs needed for one screen should be loaded before it is drawn.
+
+    The returned character codes are 0x08 to 0x0F, which address the
+    same slots as codes 0x00 to 0x07 but can be used in NUL terminated
+    strings passed to DisplayLine() and DisplayText().
+
+    @param[in]
+        pDev
+            pointer to the LCD device object
+
+    @param[in]
+        id
+            identifier of the registered glyph
+
+    @param[out]
+        code
+            pointer to the location to store the character code
+
+    @retval EOK the glyph is loaded
+    @retval ENOENT the glyph is not registered
+    @retval ENOSPC every slot holds a glyph which is on the display
+    @retval EINVAL invalid arguments
+    @retval other error from uploadGlyph()
 
-                    /* write a character to the display memory */
-                    rc = writeByte(pDev, 1, ch);
-                    if ( rc != EOK )
+==============================================================================*/
+int LoadGlyph( LCDDev *pDev, uint16_t id, uint8_t *code )
+{
+    int result = EINVAL;
+    LCDGlyphSlot *pSlots = NULL;
+    LCDGlyph *pGlyph;
+    int slot = -1;
+    int i;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_GLYPH );
+
+    if ( ( pDev != NULL ) &&
+         ( code != NULL ) &&
+         ( GetGlyphSlots( pDev, &pSlots ) == EOK ) )
+    {
+        pGlyph = findGlyph( id );
+        if ( pGlyph == NULL )
+        {
+            result = ENOENT;
+        }
+        else
+        {
+            /* look for the glyph in the character generator RAM */
+            for ( i = 0; i < LCD_CGRAM_SLOTS; i++ )
+            {
+                if ( isLoaded( pDev, &pSlots[i], i, pGlyph ) )
+                {
+                    slot = i;
+                    result = EOK;
+                    break;
+                }
+            }
+
+            if ( slot == -1 )
+            {
+                /* replace an unused slot or the least recently used one,
+                   but never one which is on the display */
+                for ( i = 0; i < LCD_CGRAM_SLOTS; i++ )
+                {
+                    if ( ( isShown( pDev, i ) == false ) &&
+                         ( ( slot == -1 ) ||
+                           ( ( pSlots[slot].loaded == true ) &&
+                             ( ( pSlots[i].loaded == false ) ||
+                               ( pSlots[i].lastUse <
+                                 pSlots[slot].lastUse ) ) ) ) )
                     {
-                        result = rc;
+                        slot = i;
                     }
                 }
+
+                if ( slot == -1 )
+                {
+                    result = ENOSPC;
+                }
+                else
+                {
+                    result = uploadGlyph( pDev, slot, pGlyph );
+                    pSlots[slot].id = id;
+                    pSlots[slot].loaded = ( result == EOK ) ? true : false;
+                }
+            }
+
+            if ( result == EOK )
+            {
+                pSlots[slot].lastUse = atomic_fetch_add( &glyphUse, 1 ) + 1;
+                *code = 0x08 | slot;
+            }
+        }
+    }
+
+    EndTrace( pDev, origin );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  findGlyph                                                                 */
+/*!
+    Find a registered glyph
+
+    @param[in]
+        id
+            glyph identifier
+
+    @retval pointer to the registered glyph
+    @retval NULL the glyph is not registered
+
+==============================================================================*/
+static LCDGlyph *findGlyph( uint16_t id )
+{
+    LCDGlyph *pGlyph = NULL;
+    int i;
+
+    for ( i = 0; i < LCD_MAX_GLYPHS; i++ )
+    {
+        if ( ( glyphs[i].used == true ) &&
+             ( glyphs[i].id == id ) )
+        {
+            pGlyph = &glyphs[i];
+            break;
+        }
+    }
+
+    return pGlyph;
+}
+
+/*============================================================================*/
+/*  isLoaded                                                                  */
+/*!
+    Check if a character generator RAM slot holds a glyph
+
+    The slot holds the glyph if it was loaded with the glyph identifier
+    and the shadow copy of the slot still matches the glyph bitmap.
+
+    @param[in]
+        pDev
+            pointer to the LCD device object
+
+    @param[in]
+        pSlot
+            pointer to the slot table entry
+
+    @param[in]
+        slot
+            character generator RAM slot
+
+    @param[in]
+        pGlyph
+            pointer to the registered glyph
+
+    @retval true the glyph is loaded in the slot
+    @retval false the slot must be reprogrammed to display the glyph
+
+==============================================================================*/
+static bool isLoaded( LCDDev *pDev,
+                      LCDGlyphSlot *pSlot,
+                      int slot,
+                      LCDGlyph *pGlyph )
+{
+    const uint8_t *shadow = NULL;
+    bool result = false;
+    int i;
+
+    if ( ( pSlot->loaded == true ) &&
+         ( pSlot->id == pGlyph->id ) &&
+         ( GetShadowCGRAM( pDev, slot, &shadow ) == EOK ) )
+    {
+        result = true;
+        for ( i = 0; i < LCD_GLYPH_ROWS; i++ )
+        {
+            if ( shadow[i] != pGlyph->bitmap[i] )
+            {
+                result = false;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  isShown                                                                   */
+/*!
+    Check if a character generator RAM slot is on the display
+
+    The isShown function searches the shadow display data RAM for
+    either of the character codes which address the slot.
+
+    @param[in]
+        pDev
+            pointer to the LCD device object
+
+    @param[in]
+        slot
+            character generator RAM slot (0 - 7)
+
+    @retval true the slot is displayed
+    @retval false the slot is not displayed, or the display contents
+            are not known
+
+==============================================================================*/
+static bool isShown( LCDDev *pDev, int slot )
+{
+    const uint8_t *ddram = NULL;
+    bool result = false;
+    uint8_t addr;
+    int i;
+
+    for ( addr = 0x00; addr <= 0x40; addr += 0x40 )
+    {
+        if ( GetShadowDDRAM( pDev, addr, &ddram ) == EOK )
+        {
+            for ( i = 0; i < LCD_DDRAM_COLS; i++ )
+            {
+                if ( ( ddram[i] < 0x10 ) &&
+                     ( ( ddram[i] & 0x07 ) == slot ) )
+                {
+                    result = true;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  uploadGlyph                                                               */
+/*!
+    Write a glyph into a character generator RAM slot
+
+    The uploadGlyph function writes the glyph bitmap into the specified
+    character generator RAM slot, and then restores the display data
+    address so the cursor does not move.  All of the writes are sent
+    as a single I2C transaction.
+
+    @param[in]
+        pDev
+            pointer to the LCD device object
+
+    @param[in]
+        slot
+            character generator RAM slot (0 - 7)
+
+    @param[in]
+        pGlyph
+            pointer to the glyph to write
+
+    @retval EOK the glyph was written
+    @retval EINVAL invalid arguments
+    @retval other error from LCDOpen(), writeByte() or SetADD()
+
+==============================================================================*/
+static int uploadGlyph( LCDDev *pDev, int slot, LCDGlyph *pGlyph )
+{
+    int result = EINVAL;
+    const LCDGeometry *pGeometry = NULL;
+    int x = 1;
+    int y = 1;
+    int rc;
+    int i;
+
+    if ( ( pGlyph != NULL ) &&
+         ( GetGeometry( pDev, &pGeometry ) == EOK ) )
+    {
+        GetCursorX( pDev, &x );
+        GetCursorY( pDev, &y );
+        if ( ( x < 1 ) || ( y < 1 ) )
+        {
+            /* the cursor position is not known yet */
+            x = 1;
+            y = 1;
+        }
+
+        /* open the LCD device if it isn't open already */
+        result = LCDOpen( pDev );
+        if ( result == EOK )
+        {
+            BeginTransaction( pDev );
+
+            /* Set the Character Generator RAM Address */
+            result = writeByte( pDev, 0, 0x40 | ( slot << 3 ) );
+            for ( i = 0; ( i < LCD_GLYPH_ROWS ) && ( result == EOK ); i++ )
+            {
+                result = writeByte( pDev, 1, pGlyph->bitmap[i] );
+            }
+
+            /* return to the display data RAM */
+            rc = SetADD( pDev, pGeometry->rowAddr[y - 1] + ( x - 1 ) );
+            if ( result == EOK )
+            {
+                result = rc;
+            }
+
+            rc = EndTransaction( pDev );
+            if ( result == EOK )
+            {
+                result = rc;
             }
 
             LCDClose( pDev );
@@ -320,5 +1595,63 @@ int DisplayLine( LCDDev *pDev, int offset, char *line )
     return result;
 }
 
+/*============================================================================*/
+/*  writeRun                                                                  */
+/*!
+    Write a run of characters to the display
+
+    The writeRun function sets the display data address and writes
+    a contiguous run of characters to the display data RAM.
+
+    @param[in]
+        pDev
+            pointer to the LCD device object
+
+    @param[in]
+        addr
+            display data address of the first character
+
+    @param[in]
+        data
+            pointer to the characters to write
+
+    @param[in]
+        len
+            number of characters to write
+
+    @retval EOK the command was successful
+    @retval EINVAL invalid arguments
+    @retval other error from SetADD() or writeByte()
+
+==============================================================================*/
+static int writeRun( LCDDev *pDev, uint8_t addr, char *data, int len )
+{
+    int result = EINVAL;
+    int rc;
+    int i;
+
+    if ( ( pDev != NULL ) &&
+         ( data != NULL ) )
+    {
+        /* Set the Display Data Address.  The data is written even if
+           this fails, so the shadow state holds the intended contents
+           of the display (see LCDResync()) */
+        result = SetADD( pDev, addr );
+
+        /* iterate through the input data */
+        for( i = 0; i < len; i++ )
+        {
+            /* write a character to the display memory */
+            rc = writeByte( pDev, 1, data[i] );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+        }
+    }
+
+    return result;
+}
+
 /*! @}
  * end of lcdctrl group */
@@ -0,0 +1,1437 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup lcdemu lcdemu
+ * @brief In-process PCF8574/HD44780 display emulator
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file lcd_emu.c
+
+    In-process PCF8574/HD44780 display emulator
+
+    The lcd_emu module implements the bus transport operations
+    (see lcd_transport.h) using an in-process model of PCF8574 I/O
+    expanders driving HD44780 compatible character displays, so the
+    service and the driver benchmark can be run without any hardware.
+    It is selected by using a bus device name starting with "emu:".
+
+    A display is emulated at every slave address which is accessed.
+    Each emulated bus has its own set of displays.  "emu:" selects bus 0,
+    and "emu:1", "emu:2" etc select further buses.
+    The emulator decodes the 4-bit (and power-on 8-bit) nibble protocol
+    on the falling edge of EN, executes the HD44780 instructions on its
+    display and character generator RAM, and models the instruction
+    execution times by reporting the busy flag until they have elapsed.
+
+    The time taken to clock each byte over a 100 kHz I2C bus is also
+    modelled.  Each byte reaches the PCF8574 one byte time after the
+    previous one, and the instruction execution times are measured on
+    this bus clock, so a write which would be too early on a real bus is
+    seen as such by the emulator (see LCDEmuStats busyWrites).  Like the
+    i2c-dev driver, each transfer returns once all of its bytes have
+    been clocked out.
+
+    Each display is wired to its PCF8574 like the standard backpack,
+    unless a different wiring is selected with EmuSetPinMap().
+
+    The display state is held for the life of the process, like the
+    real display, so it survives the bus connection being closed.
+
+    Each emulator call is serialized by a lock, so different buses may
+    be driven from different threads.  As with a real bus, the displays
+    on one bus should only be accessed by one thread at a time.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <linux/i2c.h>
+#include "lcd_transport.h"
+#include "lcd_io.h"
+#include "lcd_emu.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+#define EOK 0
+#endif
+
+/*! maximum number of emulated displays */
+#define LCD_EMU_MAX_DEVICES     ( 8 )
+
+/*! size of the emulated display data RAM */
+#define LCD_EMU_DDRAM_SIZE      ( 80 )
+
+/*! number of display data RAM columns per row */
+#define LCD_EMU_DDRAM_COLS      ( 40 )
+
+/*! size of the emulated character generator RAM */
+#define LCD_EMU_CGRAM_SIZE      ( 64 )
+
+/*! execution time (us) of the clear and home instructions */
+#define LCD_EMU_EXEC_LONG_US    ( 1520 )
+
+/*! execution time (us) of the other instructions */
+#define LCD_EMU_EXEC_US         ( 37 )
+
+/*! execution time (us) of a data write */
+#define LCD_EMU_EXEC_DATA_US    ( 41 )
+
+/*! time (us) to clock one byte over a 100 kHz I2C bus
+    (8 data bits plus the acknowledge) */
+#define LCD_EMU_BYTE_US         ( 90 )
+
+/*! PCF8574 output bits of the standard backpack wiring */
+#define LCD_EMU_RS              ( 1 << 0 )
+#define LCD_EMU_RW              ( 1 << 1 )
+#define LCD_EMU_EN              ( 1 << 2 )
+
+/*! PCF8574 port bit of D4 in the standard backpack wiring */
+#define LCD_EMU_D4              ( 4 )
+
+/*==============================================================================
+        Data Types
+==============================================================================*/
+
+/*! The LCDEmuDev type models one PCF8574 and HD44780 display */
+typedef struct _LCDEmuDev
+{
+    /*! the display has been accessed */
+    bool used;
+
+    /*! emulated bus the display is attached to */
+    int bus;
+
+    /*! slave address of the PCF8574 */
+    uint8_t address;
+
+    /*! PCF8574 output latch */
+    uint8_t outputs;
+
+    /*! PCF8574 port bit of the register select signal */
+    uint8_t rs;
+
+    /*! PCF8574 port bit of the read/write signal */
+    uint8_t rw;
+
+    /*! PCF8574 port bit of the enable strobe */
+    uint8_t en;
+
+    /*! PCF8574 port bit numbers of D4-D7 */
+    uint8_t data[4];
+
+    /*! HD44780 is using the 4-bit interface */
+    bool fourBit;
+
+    /*! the next 4-bit write is the low nibble */
+    bool lowNibble;
+
+    /*! the next 4-bit read is the low nibble */
+    bool readLow;
+
+    /*! high nibble of the byte being written */
+    uint8_t high;
+
+    /*! address counter */
+    uint8_t ac;
+
+    /*! address counter selects the character generator RAM */
+    bool cgram;
+
+    /*! address counter increments (true) or decrements (false) */
+    bool increment;
+
+    /*! display data RAM */
+    uint8_t ddram[LCD_EMU_DDRAM_SIZE];
+
+    /*! character generator RAM */
+    uint8_t cgram_data[LCD_EMU_CGRAM_SIZE];
+
+    /*! display shift (columns) */
+    int shift;
+
+    /*! time at which the current instruction completes */
+    struct timespec readyAt;
+
+    /*! bus time at which the current PCF8574 byte was transferred */
+    struct timespec byteTime;
+
+    /*! activity counters */
+    LCDEmuStats stats;
+
+} LCDEmuDev;
+
+/*! The LCDEmuConn type is an open connection to the emulator */
+typedef struct _LCDEmuConn
+{
+    /*! emulated bus selected by the device name */
+    int bus;
+
+    /*! the selected display */
+    LCDEmuDev *pDev;
+
+    /*! time at which the bus finishes clocking out the bytes sent */
+    struct timespec busTime;
+
+} LCDEmuConn;
+
+/*==============================================================================
+        Private Function Declarations
+==============================================================================*/
+
+static int emuOpen( char *device, void **handle );
+static int emuClose( void *handle );
+static bool emuCombined( void *handle );
+static int emuSelect( void *handle, uint8_t address );
+static int emuWrite( void *handle, uint8_t *buf, size_t len );
+static int emuRead( void *handle, uint8_t *buf, size_t len );
+static int emuTransfer( void *handle, struct i2c_msg *msgs, int n );
+
+static int transfer( LCDEmuConn *pConn, uint8_t *buf, size_t len, bool rd );
+static void clockByte( LCDEmuConn *pConn );
+static void waitBus( LCDEmuConn *pConn );
+static LCDEmuDev *findDevice( int bus, uint8_t address, bool create );
+static void output( LCDEmuDev *pDev, uint8_t val );
+static uint8_t input( LCDEmuDev *pDev );
+static void receive( LCDEmuDev *pDev, bool rs, uint8_t val );
+static void instruction( LCDEmuDev *pDev, uint8_t val );
+static void writeData( LCDEmuDev *pDev, uint8_t val );
+static uint8_t readData( LCDEmuDev *pDev );
+static void step( LCDEmuDev *pDev, bool increment );
+static int ddramIndex( uint8_t ac );
+static uint8_t getNibble( LCDEmuDev *pDev, uint8_t port );
+static uint8_t nibblePins( LCDEmuDev *pDev, uint8_t nibble );
+static int busNumber( const char *device, int *bus );
+static bool isBusy( LCDEmuDev *pDev );
+static void setBusy( LCDEmuDev *pDev, int us );
+
+/*==============================================================================
+        File Scoped Variables
+==============================================================================*/
+
+/*! emulator transport operations */
+static const LCDTransport emu =
+{
+    "emulator",
+    emuOpen,
+    emuClose,
+    emuCombined,
+    emuSelect,
+    emuWrite,
+    emuRead,
+    emuTransfer
+};
+
+/*! emulated displays */
+static LCDEmuDev devices[LCD_EMU_MAX_DEVICES];
+
+/*! serializes access to the emulated displays */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*==============================================================================
+        Function Definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  GetEmuTransport                                                           */
+/*!
+    Get the emulator transport
+
+    @retval pointer to the emulator transport operations
+
+==============================================================================*/
+const LCDTransport *GetEmuTransport( void )
+{
+    return &emu;
+}
+
+/*============================================================================*/
+/*  EmuGetStats                                                               */
+/*!
+    Get the activity counters of an emulated display
+
+    @param[in]
+        device
+            bus device name of the emulated bus, eg "emu:" or "emu:1"
+
+    @param[in]
+        address
+            slave address of the display
+
+    @param[out]
+        pStats
+            pointer to the location to store the counters
+
+    @retval EOK the counters were retrieved
+    @retval ENOENT the display has not been accessed
+    @retval ENODEV the device is not an emulated bus
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int EmuGetStats( const char *device, uint8_t address, LCDEmuStats *pStats )
+{
+    int result = EINVAL;
+    LCDEmuDev *pDev;
+    int bus;
+
+    if ( ( device != NULL ) &&
+         ( pStats != NULL ) )
+    {
+        if ( busNumber( device, &bus ) != EOK )
+        {
+            result = ENODEV;
+        }
+        else
+        {
+            pthread_mutex_lock( &lock );
+
+            pDev = findDevice( bus, address, false );
+            if ( pDev != NULL )
+            {
+                *pStats = pDev->stats;
+                result = EOK;
+            }
+            else
+            {
+                result = ENOENT;
+            }
+
+            pthread_mutex_unlock( &lock );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  EmuGetText                                                                */
+/*!
+    Get the content of a row of an emulated display
+
+    The EmuGetText function gets the characters stored in one row of the
+    display data RAM of an emulated display, starting from the first
+    visible column.
+
+    @param[in]
+        device
+            bus device name of the emulated bus, eg "emu:" or "emu:1"
+
+    @param[in]
+        address
+            slave address of the display
+
+    @param[in]
+        row
+            display row (0 or 1)
+
+    @param[out]
+        buf
+            pointer to the location to store the NUL terminated text
+
+    @param[in]
+        len
+            size of the output buffer
+
+    @retval EOK the text was retrieved
+    @retval ENOENT the display has not been accessed
+    @retval ENODEV the device is not an emulated bus
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int EmuGetText( const char *device,
+                uint8_t address,
+                int row,
+                char *buf,
+                size_t len )
+{
+    int result = EINVAL;
+    LCDEmuDev *pDev;
+    size_t i;
+    int col;
+    int bus;
+
+    if ( ( device != NULL ) &&
+         ( buf != NULL ) &&
+         ( len > 0 ) &&
+         ( row >= 0 ) &&
+         ( row < 2 ) )
+    {
+        if ( busNumber( device, &bus ) != EOK )
+        {
+            result = ENODEV;
+        }
+        else
+        {
+            pthread_mutex_lock( &lock );
+
+            pDev = findDevice( bus, address, false );
+            if ( pDev != NULL )
+            {
+                for ( i = 0;
+                      ( i < len - 1 ) && ( i < LCD_EMU_DDRAM_COLS );
+                      i++ )
+                {
+                    col = ( (int)i + pDev->shift ) % LCD_EMU_DDRAM_COLS;
+                    if ( col < 0 )
+                    {
+                        col += LCD_EMU_DDRAM_COLS;
+                    }
+
+                    buf[i] = pDev->ddram[row * LCD_EMU_DDRAM_COLS + col];
+                }
+
+                buf[i] = 0;
+                result = EOK;
+            }
+            else
+            {
+                result = ENOENT;
+            }
+
+            pthread_mutex_unlock( &lock );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  EmuSetPinMap                                                              */
+/*!
+    Set the PCF8574 wiring of an emulated display
+
+    The EmuSetPinMap function sets the wiring of the display interface
+    signals to the PCF8574 port of an emulated display, so that it
+    decodes the traffic of a driver using the same pin map (see
+    SetPinMap()).  The display is created if it has not been accessed.
+    It should be set before the display is accessed.
+
+    @param[in]
+        device
+            bus device name of the emulated bus, eg "emu:" or "emu:1"
+
+    @param[in]
+        address
+            slave address of the display
+
+    @param[in]
+        pPinMap
+            pointer to the pin map
+
+    @retval EOK the pin map was set
+    @retval ENODEV the device is not an emulated bus
+    @retval ENOSPC there are too many emulated displays
+    @retval EINVAL invalid arguments, or the pin map does not give each
+            signal a different port bit
+
+==============================================================================*/
+int EmuSetPinMap( const char *device,
+                  uint8_t address,
+                  const LCDPinMap *pPinMap )
+{
+    int result = EINVAL;
+    LCDEmuDev *pDev;
+    int bus;
+
+    if ( ( device != NULL ) &&
+         ( pPinMap != NULL ) )
+    {
+        if ( busNumber( device, &bus ) != EOK )
+        {
+            result = ENODEV;
+        }
+        else if ( CheckPinMap( pPinMap ) == EOK )
+        {
+            pthread_mutex_lock( &lock );
+
+            pDev = findDevice( bus, address, true );
+            if ( pDev != NULL )
+            {
+                pDev->rs = 1 << pPinMap->rs;
+                pDev->rw = 1 << pPinMap->rw;
+                pDev->en = 1 << pPinMap->en;
+                memcpy( pDev->data, pPinMap->data, sizeof( pDev->data ) );
+                result = EOK;
+            }
+            else
+            {
+                result = ENOSPC;
+            }
+
+            pthread_mutex_unlock( &lock );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  EmuReset                                                                  */
+/*!
+    Reset the emulator
+
+    The EmuReset function removes all of the emulated displays, as if
+    they had been powered off.
+
+    @retval EOK the emulator was reset
+
+==============================================================================*/
+int EmuReset( void )
+{
+    pthread_mutex_lock( &lock );
+    memset( devices, 0, sizeof( devices ) );
+    pthread_mutex_unlock( &lock );
+
+    return EOK;
+}
+
+/*============================================================================*/
+/*  emuOpen                                                                   */
+/*!
+    Open a connection to the emulator
+
+    @param[in]
+        device
+            emulator device name, "emu:" or "emu:<bus number>"
+
+    @param[out]
+        handle
+            pointer to the location to store the transport handle
+
+    @retval EOK the connection was opened
+    @retval ENOMEM memory allocation failed
+
+==============================================================================*/
+static int emuOpen( char *device, void **handle )
+{
+    int result = ENOMEM;
+    LCDEmuConn *pConn;
+
+    pConn = calloc( 1, sizeof( LCDEmuConn ) );
+    if ( pConn != NULL )
+    {
+        busNumber( device, &pConn->bus );
+
+        *handle = pConn;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  emuClose                                                                  */
+/*!
+    Close a connection to the emulator
+
+    @param[in]
+        handle
+            transport handle
+
+    @retval EOK the connection was closed
+
+==============================================================================*/
+static int emuClose( void *handle )
+{
+    free( handle );
+
+    return EOK;
+}
+
+/*============================================================================*/
+/*  emuCombined                                                               */
+/*!
+    Check if combined transfers are supported
+
+    The emulator behaves as an adapter which supports plain I2C
+    transfers.
+
+    @param[in]
+        handle
+            transport handle (unused)
+
+    @retval true
+
+==============================================================================*/
+static bool emuCombined( void *handle )
+{
+    (void)handle;
+
+    return true;
+}
+
+/*============================================================================*/
+/*  emuSelect                                                                 */
+/*!
+    Select the emulated display for subsequent reads and writes
+
+    @param[in]
+        handle
+            transport handle
+
+    @param[in]
+        address
+            slave address of the display
+
+    @retval EOK the display was selected
+    @retval ENXIO no more displays can be emulated
+
+==============================================================================*/
+static int emuSelect( void *handle, uint8_t address )
+{
+    LCDEmuConn *pConn = (LCDEmuConn *)handle;
+
+    pthread_mutex_lock( &lock );
+    pConn->pDev = findDevice( pConn->bus, address, true );
+    pthread_mutex_unlock( &lock );
+
+    return ( pConn->pDev != NULL ) ? EOK : ENXIO;
+}
+
+/*============================================================================*/
+/*  emuWrite                                                                  */
+/*!
+    Write PCF8574 output bytes to the selected display
+
+    The emuWrite function returns once the bytes have been clocked
+    out over the emulated bus.
+
+    @param[in]
+        handle
+            transport handle
+
+    @param[in]
+        buf
+            pointer to the bytes to write
+
+    @param[in]
+        len
+            number of bytes to write
+
+    @retval EOK the bytes were written
+    @retval EBADF no display is selected
+
+==============================================================================*/
+static int emuWrite( void *handle, uint8_t *buf, size_t len )
+{
+    int result;
+
+    result = transfer( (LCDEmuConn *)handle, buf, len, false );
+    waitBus( (LCDEmuConn *)handle );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  emuRead                                                                   */
+/*!
+    Read the PCF8574 pins of the selected display
+
+    The emuRead function returns once the bytes have been clocked
+    in over the emulated bus.
+
+    @param[in]
+        handle
+            transport handle
+
+    @param[out]
+        buf
+            pointer to the location to store the bytes read
+
+    @param[in]
+        len
+            number of bytes to read
+
+    @retval EOK the bytes were read
+    @retval EBADF no display is selected
+
+==============================================================================*/
+static int emuRead( void *handle, uint8_t *buf, size_t len )
+{
+    int result;
+
+    result = transfer( (LCDEmuConn *)handle, buf, len, true );
+    waitBus( (LCDEmuConn *)handle );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  emuTransfer                                                               */
+/*!
+    Perform a combined transfer
+
+    @param[in]
+        handle
+            transport handle
+
+    @param[in,out]
+        msgs
+            pointer to the array of messages
+
+    @param[in]
+        n
+            number of messages
+
+    @retval EOK the transfer was successful
+    @retval other error from emuSelect() or transfer()
+
+==============================================================================*/
+static int emuTransfer( void *handle, struct i2c_msg *msgs, int n )
+{
+    int result = EOK;
+    int i;
+
+    for ( i = 0; ( i < n ) && ( result == EOK ); i++ )
+    {
+        result = emuSelect( handle, msgs[i].addr );
+        if ( result == EOK )
+        {
+            result = transfer( (LCDEmuConn *)handle,
+                               msgs[i].buf,
+                               msgs[i].len,
+                               ( msgs[i].flags & I2C_M_RD ) ? true : false );
+        }
+    }
+
+    /* the messages are sent back to back, with repeated starts */
+    waitBus( (LCDEmuConn *)handle );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  transfer                                                                  */
+/*!
+    Transfer one I2C message with the selected display
+
+    The transfer function clocks the address byte and then each byte of
+    the message over the emulated bus, writing it to the PCF8574 output
+    latch, or reading the PCF8574 pins, at the bus time at which it is
+    transferred, holding the emulator lock.  It does not wait for the bus
+    (see waitBus()).
+
+    @param[in]
+        pConn
+            pointer to the emulator connection
+
+    @param[in,out]
+        buf
+            pointer to the bytes to write, or to store the bytes read
+
+    @param[in]
+        len
+            number of bytes to transfer
+
+    @param[in]
+        rd
+            true to read the bytes, false to write them
+
+    @retval EOK the bytes were transferred
+    @retval EBADF no display is selected
+
+==============================================================================*/
+static int transfer( LCDEmuConn *pConn, uint8_t *buf, size_t len, bool rd )
+{
+    int result = EBADF;
+    LCDEmuDev *pDev = pConn->pDev;
+    size_t i;
+
+    if ( pDev != NULL )
+    {
+        pthread_mutex_lock( &lock );
+
+        pDev->stats.transactions++;
+        pDev->stats.bytes += len;
+
+        /* the address byte */
+        clockByte( pConn );
+
+        for ( i = 0; i < len; i++ )
+        {
+            clockByte( pConn );
+            pDev->byteTime = pConn->busTime;
+
+            if ( rd == true )
+            {
+                buf[i] = input( pDev );
+            }
+            else
+            {
+                output( pDev, buf[i] );
+            }
+        }
+
+        pthread_mutex_unlock( &lock );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  clockByte                                                                 */
+/*!
+    Clock one byte over the emulated bus
+
+    The clockByte function advances the bus time of the connection by
+    one byte time.  A bus which has been idle starts again from the
+    current time.
+
+    @param[in]
+        pConn
+            pointer to the emulator connection
+
+==============================================================================*/
+static void clockByte( LCDEmuConn *pConn )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    if ( ( now.tv_sec > pConn->busTime.tv_sec ) ||
+         ( ( now.tv_sec == pConn->busTime.tv_sec ) &&
+           ( now.tv_nsec > pConn->busTime.tv_nsec ) ) )
+    {
+        pConn->busTime = now;
+    }
+
+    pConn->busTime.tv_nsec += LCD_EMU_BYTE_US * 1000L;
+    if ( pConn->busTime.tv_nsec >= 1000000000L )
+    {
+        pConn->busTime.tv_sec++;
+        pConn->busTime.tv_nsec -= 1000000000L;
+    }
+}
+
+/*============================================================================*/
+/*  waitBus                                                                   */
+/*!
+    Wait for the emulated bus to finish clocking out its bytes
+
+    The waitBus function blocks the caller until the bus time of the
+    connection, as a synchronous I2C transfer would.
+
+    @param[in]
+        pConn
+            pointer to the emulator connection
+
+==============================================================================*/
+static void waitBus( LCDEmuConn *pConn )
+{
+    while ( clock_nanosleep( CLOCK_MONOTONIC,
+                             TIMER_ABSTIME,
+                             &pConn->busTime,
+                             NULL ) == EINTR )
+    {
+        /* interrupted by a signal, keep waiting */
+    }
+}
+
+/*============================================================================*/
+/*  findDevice                                                                */
+/*!
+    Find an emulated display
+
+    The caller must hold the emulator lock.
+
+    @param[in]
+        bus
+            emulated bus number
+
+    @param[in]
+        address
+            slave address of the display
+
+    @param[in]
+        create
+            create the display if it does not exist
+
+    @retval pointer to the display
+    @retval NULL the display was not found
+
+==============================================================================*/
+static LCDEmuDev *findDevice( int bus, uint8_t address, bool create )
+{
+    LCDEmuDev *pFree = NULL;
+    int i;
+
+    for ( i = 0; i < LCD_EMU_MAX_DEVICES; i++ )
+    {
+        if ( devices[i].used == false )
+        {
+            pFree = ( pFree == NULL ) ? &devices[i] : pFree;
+        }
+        else if ( ( devices[i].bus == bus ) &&
+                  ( devices[i].address == address ) )
+        {
+            return &devices[i];
+        }
+    }
+
+    if ( ( create == true ) && ( pFree != NULL ) )
+    {
+        /* power on state: 8-bit interface, display RAM cleared */
+        memset( pFree, 0, sizeof( LCDEmuDev ) );
+        memset( pFree->ddram, ' ', sizeof( pFree->ddram ) );
+        pFree->used = true;
+        pFree->bus = bus;
+        pFree->address = address;
+        pFree->increment = true;
+
+        /* standard backpack wiring */
+        pFree->rs = LCD_EMU_RS;
+        pFree->rw = LCD_EMU_RW;
+        pFree->en = LCD_EMU_EN;
+        for ( i = 0; i < 4; i++ )
+        {
+            pFree->data[i] = LCD_EMU_D4 + i;
+        }
+
+        return pFree;
+    }
+
+    return NULL;
+}
+
+/*============================================================================*/
+/*  output                                                                    */
+/*!
+    Update the PCF8574 outputs
+
+    The output function updates the PCF8574 output latch.  The HD44780
+    reads its data lines on the falling edge of EN.  The signals are
+    decoded using the wiring of the display (see EmuSetPinMap()).
+
+    @param[in]
+        pDev
+            pointer to the emulated display
+
+    @param[in]
+        val
+            new output latch value
+
+==============================================================================*/
+static void output( LCDEmuDev *pDev, uint8_t val )
+{
+    bool falling;
+
+    falling = ( pDev->outputs & pDev->en ) && !( val & pDev->en );
+    pDev->outputs = val;
+
+    if ( falling == true )
+    {
+        if ( val & pDev->rw )
+        {
+            /* end of a read cycle */
+            if ( pDev->fourBit == true )
+            {
+                pDev->readLow = !pDev->readLow;
+                if ( ( pDev->readLow == false ) && ( val & pDev->rs ) )
+                {
+                    step( pDev, pDev->increment );
+                }
+            }
+            else if ( val & pDev->rs )
+            {
+                step( pDev, pDev->increment );
+            }
+        }
+        else if ( pDev->fourBit == false )
+        {
+            /* 8-bit interface, only D7-D4 are connected */
+            receive( pDev, val & pDev->rs, getNibble( pDev, val ) << 4 );
+        }
+        else if ( pDev->lowNibble == false )
+        {
+            pDev->high = getNibble( pDev, val ) << 4;
+            pDev->lowNibble = true;
+        }
+        else
+        {
+            pDev->lowNibble = false;
+            receive( pDev,
+                     val & pDev->rs,
+                     pDev->high | getNibble( pDev, val ) );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  input                                                                     */
+/*!
+    Read the PCF8574 pins
+
+    The input function returns the state of the PCF8574 pins.  While EN
+    and RW are high, the HD44780 drives D7-D4 with the next nibble of
+    the status register (RS=0) or display data (RS=1).  Otherwise the
+    pins reflect the output latch.
+
+    @param[in]
+        pDev
+            pointer to the emulated display
+
+    @retval PCF8574 pin states
+
+==============================================================================*/
+static uint8_t input( LCDEmuDev *pDev )
+{
+    uint8_t val = pDev->outputs;
+    uint8_t data;
+
+    if ( ( val & pDev->en ) && ( val & pDev->rw ) )
+    {
+        if ( val & pDev->rs )
+        {
+            data = readData( pDev );
+        }
+        else
+        {
+            data = pDev->ac & 0x7F;
+            if ( isBusy( pDev ) )
+            {
+                data |= 0x80;
+                if ( pDev->readLow == false )
+                {
+                    pDev->stats.busyReads++;
+                }
+            }
+        }
+
+        if ( ( pDev->fourBit == true ) && ( pDev->readLow == true ) )
+        {
+            data <<= 4;
+        }
+
+        /* the pins are pulled low by the driven data lines */
+        val &= ~nibblePins( pDev, ( ~data >> 4 ) & 0x0F );
+    }
+
+    return val;
+}
+
+/*============================================================================*/
+/*  receive                                                                   */
+/*!
+    Receive a byte on the HD44780 interface
+
+    @param[in]
+        pDev
+            pointer to the emulated display
+
+    @param[in]
+        rs
+            true for a data byte, false for an instruction
+
+    @param[in]
+        val
+            byte received
+
+==============================================================================*/
+static void receive( LCDEmuDev *pDev, bool rs, uint8_t val )
+{
+    if ( isBusy( pDev ) )
+    {
+        pDev->stats.busyWrites++;
+    }
+
+    if ( rs == true )
+    {
+        pDev->stats.data++;
+        writeData( pDev, val );
+        setBusy( pDev, LCD_EMU_EXEC_DATA_US );
+    }
+    else
+    {
+        pDev->stats.instructions++;
+        instruction( pDev, val );
+    }
+}
+
+/*============================================================================*/
+/*  instruction                                                               */
+/*!
+    Execute an HD44780 instruction
+
+    @param[in]
+        pDev
+            pointer to the emulated display
+
+    @param[in]
+        val
+            instruction code
+
+==============================================================================*/
+static void instruction( LCDEmuDev *pDev, uint8_t val )
+{
+    int t = LCD_EMU_EXEC_US;
+
+    if ( val & 0x80 )
+    {
+        /* set DDRAM address */
+        pDev->ac = val & 0x7F;
+        pDev->cgram = false;
+    }
+    else if ( val & 0x40 )
+    {
+        /* set CGRAM address */
+        pDev->ac = val & 0x3F;
+        pDev->cgram = true;
+    }
+    else if ( val & 0x20 )
+    {
+        /* function set: DL selects the interface width */
+        pDev->fourBit = ( val & 0x10 ) ? false : true;
+        pDev->lowNibble = false;
+        pDev->readLow = false;
+    }
+    else if ( val & 0x10 )
+    {
+        /* cursor or display shift */
+        if ( val & 0x08 )
+        {
+            pDev->shift += ( val & 0x04 ) ? -1 : 1;
+        }
+        else
+        {
+            step( pDev, ( val & 0x04 ) ? true : false );
+        }
+    }
+    else if ( val & 0x08 )
+    {
+        /* display on/off control: no effect on the memory model */
+    }
+    else if ( val & 0x04 )
+    {
+        /* entry mode set */
+        pDev->increment = ( val & 0x02 ) ? true : false;
+    }
+    else if ( val & 0x02 )
+    {
+        /* return home */
+        pDev->ac = 0;
+        pDev->cgram = false;
+        pDev->shift = 0;
+        t = LCD_EMU_EXEC_LONG_US;
+    }
+    else if ( val & 0x01 )
+    {
+        /* clear display */
+        memset( pDev->ddram, ' ', sizeof( pDev->ddram ) );
+        pDev->ac = 0;
+        pDev->cgram = false;
+        pDev->shift = 0;
+        pDev->increment = true;
+        t = LCD_EMU_EXEC_LONG_US;
+    }
+
+    setBusy( pDev, t );
+}
+
+/*============================================================================*/
+/*  writeData                                                                 */
+/*!
+    Write a data byte at the address counter
+
+    @param[in]
+        pDev
+            pointer to the emulated display
+
+    @param[in]
+        val
+            data byte
+
+==============================================================================*/
+static void writeData( LCDEmuDev *pDev, uint8_t val )
+{
+    int idx;
+
+    if ( pDev->cgram == true )
+    {
+        pDev->cgram_data[pDev->ac & 0x3F] = val;
+    }
+    else
+    {
+        idx = ddramIndex( pDev->ac );
+        if ( idx >= 0 )
+        {
+            pDev->ddram[idx] = val;
+        }
+    }
+
+    step( pDev, pDev->increment );
+}
+
+/*============================================================================*/
+/*  readData                                                                  */
+/*!
+    Read the data byte at the address counter
+
+    @param[in]
+        pDev
+            pointer to the emulated display
+
+    @retval data byte
+
+==============================================================================*/
+static uint8_t readData( LCDEmuDev *pDev )
+{
+    int idx;
+
+    if ( pDev->cgram == true )
+    {
+        return pDev->cgram_data[pDev->ac & 0x3F];
+    }
+
+    idx = ddramIndex( pDev->ac );
+
+    return ( idx >= 0 ) ? pDev->ddram[idx] : 0;
+}
+
+/*============================================================================*/
+/*  step                                                                      */
+/*!
+    Step the address counter
+
+    The step function increments or decrements the address counter,
+    wrapping between the two rows of the display data RAM in the same
+    way as the HD44780 in 2-line mode.
+
+    @param[in]
+        pDev
+            pointer to the emulated display
+
+    @param[in]
+        increment
+            true to increment, false to decrement
+
+==============================================================================*/
+static void step( LCDEmuDev *pDev, bool increment )
+{
+    if ( pDev->cgram == true )
+    {
+        pDev->ac = ( pDev->ac + ( increment ? 1 : -1 ) ) & 0x3F;
+    }
+    else if ( increment == true )
+    {
+        pDev->ac = ( pDev->ac == 0x27 ) ? 0x40
+                 : ( pDev->ac >= 0x67 ) ? 0x00
+                 : pDev->ac + 1;
+    }
+    else
+    {
+        pDev->ac = ( pDev->ac == 0x40 ) ? 0x27
+                 : ( pDev->ac == 0x00 ) ? 0x67
+                 : pDev->ac - 1;
+    }
+}
+
+/*============================================================================*/
+/*  ddramIndex                                                                */
+/*!
+    Convert a display data address to a display data RAM index
+
+    @param[in]
+        ac
+            display data address
+
+    @retval index into the display data RAM
+    @retval -1 the address is not mapped
+
+==============================================================================*/
+static int ddramIndex( uint8_t ac )
+{
+    if ( ac < LCD_EMU_DDRAM_COLS )
+    {
+        return ac;
+    }
+
+    if ( ( ac >= 0x40 ) && ( ac < 0x40 + LCD_EMU_DDRAM_COLS ) )
+    {
+        return LCD_EMU_DDRAM_COLS + ( ac - 0x40 );
+    }
+
+    return -1;
+}
+
+/*============================================================================*/
+/*  getNibble                                                                 */
+/*!
+    Get the D4-D7 data signals from the PCF8574 port
+
+    @param[in]
+        pDev
+            pointer to the emulated display
+
+    @param[in]
+        port
+            PCF8574 port value
+
+    @retval 4-bit value on D4-D7
+
+==============================================================================*/
+static uint8_t getNibble( LCDEmuDev *pDev, uint8_t port )
+{
+    uint8_t nibble = 0;
+    int i;
+
+    for ( i = 0; i < 4; i++ )
+    {
+        nibble |= ( ( port >> pDev->data[i] ) & 1 ) << i;
+    }
+
+    return nibble;
+}
+
+/*============================================================================*/
+/*  nibblePins                                                                */
+/*!
+    Get the PCF8574 port bits which carry a 4-bit value on D4-D7
+
+    @param[in]
+        pDev
+            pointer to the emulated display
+
+    @param[in]
+        nibble
+            4-bit value on D4-D7
+
+    @retval PCF8574 port bits which are high for the value
+
+==============================================================================*/
+static uint8_t nibblePins( LCDEmuDev *pDev, uint8_t nibble )
+{
+    uint8_t pins = 0;
+    int i;
+
+    for ( i = 0; i < 4; i++ )
+    {
+        pins |= ( ( nibble >> i ) & 1 ) << pDev->data[i];
+    }
+
+    return pins;
+}
+
+/*============================================================================*/
+/*  busNumber                                                                 */
+/*!
+    Get the emulated bus number selected by a bus device name
+
+    @param[in]
+        device
+            bus device name, "emu:" or "emu:<bus number>"
+
+    @param[out]
+        bus
+            pointer to the location to store the bus number
+
+    @retval EOK the device is an emulated bus
+    @retval ENODEV the device is not an emulated bus
+
+==============================================================================*/
+static int busNumber( const char *device, int *bus )
+{
+    int result = ENODEV;
+
+    if ( ( device != NULL ) &&
+         ( strncmp( device, "emu:", 4 ) == 0 ) )
+    {
+        *bus = atoi( &device[4] );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  isBusy                                                                    */
+/*!
+    Check if the emulated display is executing an instruction
+
+    The display is checked at the bus time of the PCF8574 byte which
+    is being transferred.
+
+    @param[in]
+        pDev
+            pointer to the emulated display
+
+    @retval true the display is busy
+    @retval false the display is ready
+
+==============================================================================*/
+static bool isBusy( LCDEmuDev *pDev )
+{
+    struct timespec *now = &pDev->byteTime;
+
+    return ( ( now->tv_sec < pDev->readyAt.tv_sec ) ||
+             ( ( now->tv_sec == pDev->readyAt.tv_sec ) &&
+               ( now->tv_nsec < pDev->readyAt.tv_nsec ) ) ) ? true : false;
+}
+
+/*============================================================================*/
+/*  setBusy                                                                   */
+/*!
+    Start the execution time of an instruction
+
+    The instruction starts executing at the bus time of the PCF8574
+    byte which latched it.
+
+    @param[in]
+        pDev
+            pointer to the emulated display
+
+    @param[in]
+        us
+            execution time (us)
+
+==============================================================================*/
+static void setBusy( LCDEmuDev *pDev, int us )
+{
+    pDev->readyAt = pDev->byteTime;
+    pDev->readyAt.tv_nsec += us * 1000L;
+    while ( pDev->readyAt.tv_nsec >= 1000000000L )
+    {
+        pDev->readyAt.tv_sec++;
+        pDev->readyAt.tv_nsec -= 1000000000L;
+    }
+}
+
+/*! @}
+ * end of lcdemu group */
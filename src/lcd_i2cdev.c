@@ -0,0 +1,350 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup lcdi2cdev lcdi2cdev
+ * @brief Linux i2c-dev bus transport
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file lcd_i2cdev.c
+
+    Linux i2c-dev bus transport
+
+    The lcd_i2cdev module implements the bus transport operations
+    (see lcd_transport.h) using a Linux /dev/i2c-* character device.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <sys/ioctl.h>
+#include "lcd_transport.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+#define EOK 0
+#endif
+
+/*==============================================================================
+        Data Types
+==============================================================================*/
+
+/*! The I2CDev type holds an open i2c-dev connection */
+typedef struct _I2CDev
+{
+    /*! handle to the I2C device */
+    int fd;
+
+} I2CDev;
+
+/*==============================================================================
+        Private Function Declarations
+==============================================================================*/
+
+static int i2cOpen( char *device, void **handle );
+static int i2cClose( void *handle );
+static bool i2cCombined( void *handle );
+static int i2cSelect( void *handle, uint8_t address );
+static int i2cWrite( void *handle, uint8_t *buf, size_t len );
+static int i2cRead( void *handle, uint8_t *buf, size_t len );
+static int i2cTransfer( void *handle, struct i2c_msg *msgs, int n );
+
+/*==============================================================================
+        File Scoped Variables
+==============================================================================*/
+
+/*! i2c-dev transport operations */
+static const LCDTransport i2cdev =
+{
+    "i2c-dev",
+    i2cOpen,
+    i2cClose,
+    i2cCombined,
+    i2cSelect,
+    i2cWrite,
+    i2cRead,
+    i2cTransfer
+};
+
+/*==============================================================================
+        Function Definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  GetI2CDevTransport                                                        */
+/*!
+    Get the i2c-dev transport
+
+    @retval pointer to the i2c-dev transport operations
+
+==============================================================================*/
+const LCDTransport *GetI2CDevTransport( void )
+{
+    return &i2cdev;
+}
+
+/*============================================================================*/
+/*  i2cOpen                                                                   */
+/*!
+    Open an i2c-dev device
+
+    @param[in]
+        device
+            name of the I2C device, eg /dev/i2c-1
+
+    @param[out]
+        handle
+            pointer to the location to store the transport handle
+
+    @retval EOK the device was opened
+    @retval ENOMEM memory allocation failed
+    @retval other error from open()
+
+==============================================================================*/
+static int i2cOpen( char *device, void **handle )
+{
+    int result = ENOMEM;
+    I2CDev *pI2C;
+
+    pI2C = calloc( 1, sizeof( I2CDev ) );
+    if ( pI2C != NULL )
+    {
+        pI2C->fd = open( device, O_RDWR );
+        if ( pI2C->fd != -1 )
+        {
+            *handle = pI2C;
+            result = EOK;
+        }
+        else
+        {
+            result = errno;
+            free( pI2C );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  i2cClose                                                                  */
+/*!
+    Close an i2c-dev device
+
+    @param[in]
+        handle
+            transport handle
+
+    @retval EOK the device was closed
+
+==============================================================================*/
+static int i2cClose( void *handle )
+{
+    I2CDev *pI2C = (I2CDev *)handle;
+
+    close( pI2C->fd );
+    free( pI2C );
+
+    return EOK;
+}
+
+/*============================================================================*/
+/*  i2cCombined                                                               */
+/*!
+    Check if the adapter supports plain I2C transfers
+
+    @param[in]
+        handle
+            transport handle
+
+    @retval true the adapter supports I2C_RDWR transfers
+    @retval false the adapter only supports SMBus style transfers
+
+==============================================================================*/
+static bool i2cCombined( void *handle )
+{
+    I2CDev *pI2C = (I2CDev *)handle;
+    unsigned long funcs = 0;
+
+    return ( ( ioctl( pI2C->fd, I2C_FUNCS, &funcs ) >= 0 ) &&
+             ( funcs & I2C_FUNC_I2C ) ) ? true : false;
+}
+
+/*============================================================================*/
+/*  i2cSelect                                                                 */
+/*!
+    Select the slave address
+
+    @param[in]
+        handle
+            transport handle
+
+    @param[in]
+        address
+            slave address to select
+
+    @retval EOK the slave was selected
+    @retval ENXIO cannot use ioctl to set the device as a slave device
+
+==============================================================================*/
+static int i2cSelect( void *handle, uint8_t address )
+{
+    I2CDev *pI2C = (I2CDev *)handle;
+
+    return ( ioctl( pI2C->fd, I2C_SLAVE, address ) >= 0 ) ? EOK : ENXIO;
+}
+
+/*============================================================================*/
+/*  i2cWrite                                                                  */
+/*!
+    Write data to the selected slave
+
+    @param[in]
+        handle
+            transport handle
+
+    @param[in]
+        buf
+            pointer to the data to write
+
+    @param[in]
+        len
+            number of bytes to write
+
+    @retval EOK the write was successful
+    @retval EIO short write
+    @retval other error from write()
+
+==============================================================================*/
+static int i2cWrite( void *handle, uint8_t *buf, size_t len )
+{
+    I2CDev *pI2C = (I2CDev *)handle;
+    int result = EOK;
+    ssize_t n;
+
+    n = write( pI2C->fd, buf, len );
+    if ( n < 0 )
+    {
+        result = errno;
+    }
+    else if ( (size_t)n != len )
+    {
+        result = EIO;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  i2cRead                                                                   */
+/*!
+    Read data from the selected slave
+
+    @param[in]
+        handle
+            transport handle
+
+    @param[in]
+        buf
+            pointer to the location to store the data
+
+    @param[in]
+        len
+            number of bytes to read
+
+    @retval EOK the read was successful
+    @retval EIO short read
+    @retval other error from read()
+
+==============================================================================*/
+static int i2cRead( void *handle, uint8_t *buf, size_t len )
+{
+    I2CDev *pI2C = (I2CDev *)handle;
+    int result = EOK;
+    ssize_t n;
+
+    n = read( pI2C->fd, buf, len );
+    if ( n < 0 )
+    {
+        result = errno;
+    }
+    else if ( (size_t)n != len )
+    {
+        result = EIO;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  i2cTransfer                                                               */
+/*!
+    Perform a combined transfer
+
+    @param[in]
+        handle
+            transport handle
+
+    @param[in,out]
+        msgs
+            pointer to the array of messages
+
+    @param[in]
+        n
+            number of messages
+
+    @retval EOK the transfer was successful
+    @retval other error from ioctl()
+
+==============================================================================*/
+static int i2cTransfer( void *handle, struct i2c_msg *msgs, int n )
+{
+    I2CDev *pI2C = (I2CDev *)handle;
+    struct i2c_rdwr_ioctl_data data;
+
+    data.msgs = msgs;
+    data.nmsgs = n;
+
+    return ( ioctl( pI2C->fd, I2C_RDWR, &data ) < 0 ) ? errno : EOK;
+}
+
+/*! @}
+ * end of lcdi2cdev group */
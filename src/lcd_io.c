@@ -54,14 +54,19 @@ SOFTWARE.
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <time.h>
+#include <stdatomic.h>
 #include <linux/i2c.h>
 #include <linux/i2c-dev.h>
 #include <sys/ioctl.h>
 #include "lcd_ctrl.h"
+#include "lcd_bus.h"
 #include "lcd_io.h"
+#include "lcd_trace.h"
 
 /*==============================================================================
         Definitions
@@ -71,38 +76,136 @@ SOFTWARE.
 #define EOK 0
 #endif
 
+/*! size of the I2C transaction buffer.  This is large enough to hold
+    a full 40 character DDRAM row (6 bus bytes per character) plus the
+    address command which precedes it */
+#define LCD_TX_BUFSIZE  ( 256 )
+
+/*! HD44780 execution time (us) for clear display and return home */
+#define LCD_EXEC_TIME_LONG_US   ( 1520 )
+
+/*! HD44780 execution time (us) for all other instructions */
+#define LCD_EXEC_TIME_US        ( 37 )
+
+/*! HD44780 extra time (us) to update the address counter after a
+    data RAM write */
+#define LCD_EXEC_TIME_DATA_US   ( 4 )
+
+/*! time (us) to clock one byte out to the PCF8574 at 100 kHz
+    (8 data bits plus the acknowledge) */
+#define LCD_BUS_BYTE_US         ( 90 )
+
+/*! number of bus bytes which precede the first EN falling edge of
+    the next instruction (data, EN high, EN low) */
+#define LCD_LATCH_BYTES         ( 3 )
+
+/*! shortest delay (us) between busy flag polls of an instruction which
+    is still executing.  The delay doubles after each busy poll. */
+#define LCD_POLL_BACKOFF_MIN_US ( 50 )
+
+/*! longest delay (us) between busy flag polls */
+#define LCD_POLL_BACKOFF_MAX_US ( 800 )
+
+/*! time (us) after which a display which still reports busy is assumed
+    to be disconnected or hung.  It may be overridden at build time,
+    eg -DLCD_POLL_TIMEOUT_US=20000 */
+#ifndef LCD_POLL_TIMEOUT_US
+#define LCD_POLL_TIMEOUT_US     ( 100000 )
+#endif
+
+/*! number of bus bytes of a status read which precede the sample of
+    the busy flag (register set up, EN high, read address) */
+#define LCD_POLL_LEAD_BYTES     ( 3 )
+
+/*! one in this many writes of an instruction class polls early to
+    measure the actual execution time of the display */
+#define LCD_POLL_SAMPLE_RATE    ( 16 )
+
 /*==============================================================================
         Data Types
 ==============================================================================*/
 
-/*! The Ctrl Register defines the bit-mapping for the LCD controller */
-typedef struct _ctrlReg
+/*! HD44780 instruction classes with different execution times */
+typedef enum _LCDExecClass
+{
+    /*! data RAM write */
+    LCD_EXEC_DATA = 0,
+
+    /*! any instruction other than clear display and return home */
+    LCD_EXEC_SHORT,
+
+    /*! clear display or return home */
+    LCD_EXEC_LONG,
+
+    /*! number of instruction classes */
+    LCD_EXEC_CLASSES
+
+} LCDExecClass;
+
+/*! datasheet execution time (us) of each instruction class */
+static const int execTimes[LCD_EXEC_CLASSES] =
+{
+    LCD_EXEC_TIME_US + LCD_EXEC_TIME_DATA_US,
+    LCD_EXEC_TIME_US,
+    LCD_EXEC_TIME_LONG_US
+};
+
+/*! The LCDPins type holds the PCF8574 port bits of the HD44780 interface
+    signals, compiled from a pin map (see SetPinMap()) */
+typedef struct _LCDPins
 {
     /*! Register Select: 0=Instruction Register, 1=Data Register */
-    uint8_t RS:1;
+    uint8_t rs;
 
     /*! Read/Write: 0=Write, 1=Read */
-    uint8_t RW:1;
+    uint8_t rw;
 
     /*! Enable: starts data read/write */
-    uint8_t EN:1;
+    uint8_t en;
 
     /*! LED control */
-    uint8_t LED:1;
+    uint8_t led;
+
+    /*! value of the LED control bit when the backlight is on */
+    uint8_t ledOn;
+
+    /*! D4-D7 data bits */
+    uint8_t data;
+
+    /*! port data bits of each 4-bit value */
+    uint8_t nibble[16];
 
-    /*! 4-bit data register */
-    uint8_t D4:4;
-} CtrlReg;
+} LCDPins;
+
+/*! supported display geometries.  On a 4 row display, rows 3 and 4
+    continue rows 1 and 2 in the display data RAM */
+static const LCDGeometry geometries[] =
+{
+    { "16x2", 16, 2, { 0x00, 0x40, 0x00, 0x00 } },
+    { "20x4", 20, 4, { 0x00, 0x40, 0x14, 0x54 } },
+    { "40x2", 40, 2, { 0x00, 0x40, 0x00, 0x00 } }
+};
+
+/*! supported PCF8574 backpack wirings.  The standard wiring has RS, RW,
+    EN and the backlight on port bits 0-3 and D4-D7 on bits 4-7 */
+static const LCDPinMap pinMaps[] =
+{
+    { "standard", 0, 1, 2, 3, { 4, 5, 6, 7 }, false },
+    { "mjkdz", 6, 5, 4, 7, { 0, 1, 2, 3 }, true }
+};
 
 /*! The LCDDev type provides the context used when reading/writing the
  *  LCD character display */
 struct _LCDDev
 {
-    /*! the I2C device */
-    char *device;
+    /*! the I2C bus connection */
+    LCDBus *pBus;
 
-    /*! handle to the I2C device */
-    int fd;
+    /*! the bus connection was created by InitDev() */
+    bool ownBus;
+
+    /*! the bus connection is held open by LCDOpen() */
+    bool open;
 
     /*! busy flag */
     bool busy;
@@ -110,30 +213,107 @@ struct _LCDDev
     /*! exclusive mode flag */
     bool exclusive;
 
+    /*! an I/O error may have left the 4-bit interface out of nibble
+        sync (see GetSyncLost()) */
+    bool syncLost;
+
+    /*! write completion mode */
+    LCDWriteMode writeMode;
+
+    /*! time at which the last timed instruction will have completed */
+    struct timespec readyAt;
+
+    /*! learned execution time (us) of each instruction class, used
+        in LCD_WRITE_BUSY_POLL mode to wait before the first poll */
+    int execEstimate[LCD_EXEC_CLASSES];
+
+    /*! number of busy polled writes of each instruction class, used
+        to select the writes which measure the execution time */
+    uint32_t execCount[LCD_EXEC_CLASSES];
+
     /*! PCF8574 device address */
     uint8_t address;
 
+    /*! display panel geometry */
+    const LCDGeometry *pGeometry;
+
     /*! address counter */
     uint8_t AddressCounter;
 
+    /*! address counter selects CGRAM (true) or DDRAM (false) */
+    bool acCGRAM;
+
+    /*! shadow state of the display (see AttachShadow()) */
+    LCDShadow *pShadow;
+
+    /*! shadow state held in the device object */
+    LCDShadow shadow;
+
     /*! cursor X position */
     int cx;
 
     /*! cursor Y position */
     int cy;
 
-    /*! register */
-    union
-    {
-        /*! register bitmap */
-        CtrlReg reg;
+    /*! wiring of the display interface to the PCF8574 port */
+    LCDPinMap pinMap;
+
+    /*! port bits of the display interface signals */
+    LCDPins pins;
+
+    /*! register shadow: the last value written to the PCF8574.  It is
+        only accessed by the thread which owns the bus */
+    uint8_t regval;
+
+    /*! requested backlight state.  It may be set from any thread (see
+        RequestBacklight()), and is merged into the LED bit of the
+        register shadow by the bus owner each time the register is
+        written */
+    atomic_bool led;
+
+    /*! transaction nesting depth */
+    int txDepth;
+
+    /*! number of bytes queued in the transaction buffer */
+    size_t txLen;
+
+    /*! transaction buffer of PCF8574 output bytes waiting to be sent */
+    uint8_t txBuf[LCD_TX_BUFSIZE];
+
+    /*! activity counters */
+    LCDDevStats stats;
 
-        /*! register value */
-        uint8_t regval;
-    };
+    /*! bus trace to record the bus bytes in, or NULL (see SetTrace()) */
+    LCDTrace *pTrace;
+
+    /*! operation which the bus bytes are recorded against (see
+        BeginTrace()) */
+    uint8_t traceOrigin;
 
 };
 
+/*==============================================================================
+        Private Function Declarations
+==============================================================================*/
+
+static int submit( LCDDev *pDev, uint8_t *buf, size_t len );
+static int waitExecution( LCDDev *pDev, uint8_t rs, uint8_t val );
+static int waitReady( LCDDev *pDev );
+static int pollReady( LCDDev *pDev, uint8_t rs, uint8_t val );
+static LCDExecClass execClass( uint8_t rs, uint8_t val );
+static long elapsedUs( struct timespec *since );
+static int ioError( LCDDev *pDev, int result );
+static void trace( LCDDev *pDev, bool read, const uint8_t *buf, size_t len );
+static void traceWiring( LCDDev *pDev );
+static void trackAddress( LCDDev *pDev, uint8_t rs, uint8_t val );
+static void updateCursor( LCDDev *pDev );
+static int readCombined( LCDDev *pDev, uint8_t *val );
+static void mergeBacklight( LCDDev *pDev );
+static bool getLED( LCDDev *pDev );
+static void setSignal( LCDDev *pDev, uint8_t pin, bool on );
+static void setNibble( LCDDev *pDev, uint8_t val );
+static uint8_t getNibble( LCDDev *pDev, uint8_t port );
+
 /*==============================================================================
         Function Definitions
 ==============================================================================*/
@@ -147,7 +327,8 @@ struct _LCDDev
     It sets the following defaults:
 
     - device address: 0x27
-    - device bus: /dev/i2c-1
+    - device bus: LCD_BUS_DEFAULT_DEVICE
+    - pin map: standard
     - backlight: ON
     - device state: closed
 
@@ -160,17 +341,41 @@ LCDDev *InitDev( void )
     LCDDev *pDev = calloc( 1, sizeof( LCDDev ) );
     if ( pDev != NULL )
     {
-        /* initialize default file descriptor */
-        pDev->fd = -1;
+        /* initialize the default I2C bus connection */
+        pDev->pBus = BusInit( LCD_BUS_DEFAULT_DEVICE );
+        if ( pDev->pBus != NULL )
+        {
+            pDev->ownBus = true;
+
+            /* initialize default address */
+            pDev->address = 0x27;
+
+            /* initialize default geometry */
+            pDev->pGeometry = FindGeometry( LCD_GEOMETRY );
+            if ( pDev->pGeometry == NULL )
+            {
+                pDev->pGeometry = &geometries[0];
+            }
 
-        /* initialize default address */
-        pDev->address = 0x27;
+            /* the shadow state is held in the device */
+            pDev->pShadow = &pDev->shadow;
 
-        /* initialize default I2C device name */
-        pDev->device = "/dev/i2c-1";
+            /* start from the datasheet execution times */
+            memcpy( pDev->execEstimate,
+                    execTimes,
+                    sizeof( pDev->execEstimate ) );
 
-        /* backlight is on */
-        pDev->reg.LED = 1;
+            /* backlight is on */
+            atomic_init( &pDev->led, true );
+
+            /* standard PCF8574 backpack wiring */
+            SetPinMap( pDev, &pinMaps[0] );
+        }
+        else
+        {
+            free( pDev );
+            pDev = NULL;
+        }
     }
 
     return pDev;
@@ -181,10 +386,10 @@ LCDDev *InitDev( void )
 /*!
     Open a connection to the LCD device
 
-    The LCDOpen function opens a file descriptor to communicate with the
-    LCD device via the i2c device driver.  The file descriptor is opened
-    in R/W mode as a bus master.  The file descriptor is cached for
-    subsequent input/output operations.
+    The LCDOpen function acquires the I2C bus connection used to
+    communicate with the LCD device (see BusOpen()).  The bus connection
+    is cached by the lcd_bus module, so re-opening the LCD device shortly
+    after it was closed does not re-open the i2c device driver.
 
     If a connection to the LCD device is already available (previously opened)
     then this function has no effect.
@@ -193,7 +398,7 @@ LCDDev *InitDev( void )
         pDev
             pointer to the LCDDev controller state object
 
-    @retval EOK a file descriptor to the device is available and cached
+    @retval EOK a connection to the device is available
     @retval EINVAL invalid arguments
     @retval ENXIO cannot use ioctl to set the device as a slave device
     @retval ENODEV no i2c device has been specified
@@ -202,46 +407,32 @@ LCDDev *InitDev( void )
 ==============================================================================*/
 int LCDOpen( LCDDev *pDev )
 {
-    int fd;
     int result = EINVAL;
 
     if ( pDev != NULL )
     {
-        if ( pDev->fd == -1 )
+        if ( pDev->open == false )
         {
-            if ( pDev->device != NULL )
+            result = BusOpen( pDev->pBus );
+            if ( result == EOK )
             {
-                /* open the i2c device for reading */
-                fd = open( pDev->device, O_RDWR );
-                if( fd != -1 )
+                /* set up the channel to read */
+                mergeBacklight( pDev );
+                trace( pDev, false, &(pDev->regval), 1 );
+                result = ioError( pDev,
+                                  BusWrite( pDev->pBus,
+                                            pDev->address,
+                                            &(pDev->regval),
+                                            1 ) );
+                if ( result == EOK )
                 {
-                    /* set up the device slave address */
-                    if (ioctl( fd, I2C_SLAVE, pDev->address ) >= 0 )
-                    {
-                        /* set up the channel to read */
-                        write( fd, &(pDev->regval), 1 );
-
-                        /* save the file descriptor */
-                        pDev->fd = fd;
-
-                        /* success */
-                        result = EOK;
-                    }
-                    else
-                    {
-                        close( fd );
-                        result = ENXIO;
-                    }
+                    pDev->open = true;
                 }
                 else
                 {
-                    result = errno;
+                    BusRelease( pDev->pBus );
                 }
             }
-            else
-            {
-                result = ENODEV;
-            }
         }
         else
         {
@@ -258,9 +449,10 @@ int LCDOpen( LCDDev *pDev )
 /*!
     Close the connection to the LCD device
 
-    The LCDClose function closes the connection to the LCD device via
-    the i2c device driver if the connecion is open and not opened for
-    exclusive access.
+    The LCDClose function releases the connection to the LCD device
+    if the connecion is open and not opened for exclusive access.
+    The underlying i2c device is closed by the lcd_bus module once it
+    has been idle for the bus idle timeout (see SetIdleTimeout()).
 
     To close a connection which was opened with exclusive access, you
     must first clear the "exclusive" flag using the SetExclusive()
@@ -284,13 +476,11 @@ int LCDClose( LCDDev *pDev )
     if ( pDev != NULL )
     {
         /* don't close if we are in exclusive-open mode */
-        if ( ( pDev->fd != -1 ) &&
+        if ( ( pDev->open == true ) &&
              ( pDev->exclusive == false ) )
         {
-            close( pDev->fd );
-            pDev->fd = -1;
-
-            result = EOK;
+            pDev->open = false;
+            result = BusRelease( pDev->pBus );
         }
         else
         {
@@ -342,16 +532,22 @@ int Set4BitMode( LCDDev *pDev )
         rc1 = writeByte( pDev, 0, 0x38 );
 
         /* now set up 4-bit mode with a single write */
-        pDev->reg.RS = 0;
-        pDev->reg.RW = 0;
-        pDev->reg.D4 =  0x02;
-        writeReg( pDev );
+        setSignal( pDev, pDev->pins.rs, false );
+        setSignal( pDev, pDev->pins.rw, false );
+        setNibble( pDev, 0x02 );
+        rc2 = writeReg( pDev );
 
         /* latch the output */
-        latch( pDev );
+        if ( rc2 == EOK )
+        {
+            rc2 = latch( pDev );
+        }
 
         /* set up Function status 4-bit mode, 2 line display, 5x8 char */
-        rc2 = writeByte( pDev, 0, 0x28 );
+        if ( rc2 == EOK )
+        {
+            rc2 = writeByte( pDev, 0, 0x28 );
+        }
 
         if ( ( rc1 == EOK ) && ( rc2 == EOK ) )
         {
@@ -367,7 +563,8 @@ int Set4BitMode( LCDDev *pDev )
 /*!
     Latch the PCF8574 outputs into the LCD display interface
 
-    The latch function toggles the EN pin (PCF8574 bit 2) to latch the
+    The latch function toggles the EN pin (PCF8574 bit 2 in the standard
+    wiring, see SetPinMap()) to latch the
     RS, RW, and D7-D4 bits into the LCD display interface.
     The EN pin is written high and then low to latch the data.
 
@@ -382,16 +579,16 @@ int Set4BitMode( LCDDev *pDev )
 int latch( LCDDev *pDev )
 {
     int result = EINVAL;
+    int rc;
 
     if ( pDev != NULL )
     {
-        pDev->reg.EN = 1;
-        writeReg( pDev );
-
-        pDev->reg.EN = 0;
-        writeReg( pDev );
+        setSignal( pDev, pDev->pins.en, true );
+        result = writeReg( pDev );
 
-        result = EOK;
+        setSignal( pDev, pDev->pins.en, false );
+        rc = writeReg( pDev );
+        result = ( result == EOK ) ? rc : result;
     }
 
     return result;
@@ -418,12 +615,20 @@ int latch( LCDDev *pDev )
     Between each nibble, the data is latched using the latch() function which
     toggles the EN bit.
 
-    After the write the BUSY status is polled, making the writeByte function
-    synchronous, that is, it does not return until the write is completed.
+    The six PCF8574 output bytes making up the two nibbles are queued
+    in a transaction and sent to the bus using a single write.  If the
+    caller already has a transaction open, the bytes are appended to it.
+
+    In LCD_WRITE_BUSY_POLL mode, after the write the BUSY status is polled,
+    making the writeByte function synchronous, that is, it does not return
+    until the write is completed (see pollReady()).
 
-    As a side effect of the busy polling, this function updates the cursor
-    cx,cy coordinates in the device object.  These can be retrieved using
-    the GetCursorX() and GetCursorY() functions.
+    In LCD_WRITE_TIMED mode, the BUSY status is not read back.  Instead,
+    the datasheet execution time of the instruction is allowed to elapse
+    before the next instruction is latched (see waitExecution()).
+
+    This function updates the cursor cx,cy coordinates in the device object.
+    These can be retrieved using the GetCursorX() and GetCursorY() functions.
 
     @param[in]
         pDev
@@ -439,363 +644,2141 @@ int latch( LCDDev *pDev )
 
     @retval EOK no error occurred
     @retval EINVAL invalid arguments
+    @retval ETIMEDOUT the display did not become ready
+    @retval other error from GetStatus()
 
 ==============================================================================*/
 int writeByte( LCDDev *pDev, uint8_t rs, uint8_t val )
 {
     int result = EINVAL;
+    int rc;
 
     if ( pDev != NULL )
     {
+        pDev->stats.writes++;
+
+        /* wait for a previous long instruction to complete */
+        waitReady( pDev );
+
+        /* queue up both nibbles */
+        BeginTransaction( pDev );
+
         /* set up to write to control (rs = 0) or data (rs = 1) registers */
-        pDev->reg.RS = rs ? 1 : 0;
+        setSignal( pDev, pDev->pins.rs, rs != 0 );
 
         /* set up to write (rw = 0) */
-        pDev->reg.RW = 0;
+        setSignal( pDev, pDev->pins.rw, false );
 
         /* write most significant nibble */
-        pDev->reg.D4 = (val & 0xF0) >> 4;
-        writeReg( pDev );
+        setNibble( pDev, val >> 4 );
+        result = writeReg( pDev );
 
         /* latch the output */
-        latch( pDev );
+        rc = latch( pDev );
+        result = ( result == EOK ) ? rc : result;
 
         /* write least significant nibble */
-        pDev->reg.D4 = (val & 0x0F);
-        writeReg( pDev );
+        setNibble( pDev, val & 0x0F );
+        rc = writeReg( pDev );
+        result = ( result == EOK ) ? rc : result;
 
         /* latch the output */
-        latch( pDev );
+        rc = latch( pDev );
+        result = ( result == EOK ) ? rc : result;
 
-        /* poll hardware for write completion */
-        do
+        /* keep track of the expected address counter.  The shadow state
+           is updated even if the write failed, so it holds the intended
+           contents of the display for a resync (see GetSyncLost()) */
+        trackAddress( pDev, rs, val );
+
+        if ( pDev->writeMode == LCD_WRITE_TIMED )
         {
-            result = GetStatus( pDev );
-        } while( pDev->busy );
+            /* allow the instruction time to execute */
+            rc = waitExecution( pDev, rs, val );
+            result = ( result == EOK ) ? rc : result;
+
+            rc = EndTransaction( pDev );
+            result = ( result == EOK ) ? rc : result;
+        }
+        else
+        {
+            /* the queued nibbles must go out before polling the busy flag */
+            rc = FlushTransaction( pDev );
+            result = ( result == EOK ) ? rc : result;
+            EndTransaction( pDev );
+
+            if ( pDev->syncLost == true )
+            {
+                /* the busy flag cannot be read until the interface is
+                   resynchronized, so just wait for the instruction */
+                usleep( execTimes[execClass( rs, val )] );
+            }
+            else if ( result == EOK )
+            {
+                /* poll hardware for write completion */
+                result = pollReady( pDev, rs, val );
+            }
+        }
     }
 
     return result;
 }
 
 /*============================================================================*/
-/*  readByte                                                                  */
+/*  pollReady                                                                 */
 /*!
-    Reads an 8-bit data value from the LCD controller
-
-    The readByte function reads a byte of data from the LCD controller IC.
-    The read status byte contains the busy flag, and the current data
-    address (the address in the LCD RAM of the next write).
-
-    The LCD controller must be operating in 4-bit data transfer mode
-
-    Since the PCF8574 is a pseudo I/O chip, the data outputs have to be
-    driven high during a read operation.
+    Poll the busy flag until an instruction has completed
 
-    RS is set to 0 to select the status register
-    RW is set to 1 to read the data
-    D7-D4 are set HIGH
+    The pollReady function is used in LCD_WRITE_BUSY_POLL mode to wait
+    for an instruction which has just been written to complete.
 
-    The EN is set high to enable the LCD outputs, the data is read back
-    from the PCF8574, and then the EN is set low to disable the LCD outputs.
+    Rather than polling back to back, which occupies the bus for the
+    whole execution time of a clear display or return home, it sleeps
+    for the expected execution time of the instruction class before
+    the first poll, and backs off exponentially between any further
+    polls.
 
-    This process is repeated twice, the first time to get the Most Significant
-    Bits of the status register, and the second time to get the Least
-    Significant bits of the status register.
+    The expected execution time is learned from the display.  One in
+    LCD_POLL_SAMPLE_RATE writes of each class polls after half of the
+    expected time to measure how long the instruction actually took,
+    and any write which is still busy at the first poll also updates
+    the estimate.  The instruction completed between the last busy
+    sample and the first ready sample of the busy flag, and the
+    estimate is a moving average of these completion times.
 
-    The two halves of the status register are ORed together to get the final
-    result
+    If the display still reports busy after LCD_POLL_TIMEOUT_US, or the
+    status cannot be read, polling is abandoned so a disconnected panel
+    cannot stall its caller.
 
     @param[in]
         pDev
             pointer to the LCDDev controller state object
 
+    @param[in]
+        rs
+            register select of the instruction: 1 = Data RAM,
+            0 = Instruction Register
+
     @param[in]
         val
-            pointer to the location to store the 8-bit status value
+            8-bit instruction or data value which was written
 
-    @retval EOK no error occurred
+    @retval EOK the instruction has completed
+    @retval ETIMEDOUT the display did not become ready
     @retval EINVAL invalid arguments
-    @retval EBADF invalid device file descriptor
+    @retval other error from GetStatus()
 
 ==============================================================================*/
-int readByte( LCDDev *pDev, uint8_t *val )
+static int pollReady( LCDDev *pDev, uint8_t rs, uint8_t val )
 {
     int result = EINVAL;
-    uint8_t data_high = 0;
-    uint8_t data_low = 0;
-    uint8_t data = 0;
+    LCDExecClass class;
+    struct timespec start;
+    uint32_t polls = 0;
+    bool sample;
+    long elapsed = 0;
+    long sampled = 0;
+    long busyAt = 0;
+    int delay;
+    int backoff = LCD_POLL_BACKOFF_MIN_US;
 
     if ( pDev != NULL )
     {
-        if ( pDev->fd != -1 )
+        class = execClass( rs, val );
+        sample = ( ( pDev->execCount[class]++ % LCD_POLL_SAMPLE_RATE ) == 0 )
+                 ? true : false;
+
+        /* the instruction must be on the bus before we start timing it */
+        BusFlush( pDev->pBus );
+        clock_gettime( CLOCK_MONOTONIC, &start );
+
+        /* the busy flag is not sampled until part way through the
+           status read, so most instructions have completed by then */
+        delay = pDev->execEstimate[class];
+        if ( sample == true )
         {
-            /* set up register for reading status */
-            pDev->reg.RS = 0;
-            pDev->reg.RW = 1;
-
-            /* set data registers high for PCF8574 so we can read them back */
-            pDev->reg.D4 = 0x0F;
-
-            /* Update PCF8574 outputs */
-            write( pDev->fd, &(pDev->regval), 1 );
-
-            pDev->reg.EN = 1;
-            write( pDev->fd, &(pDev->regval), 1 );
+            delay /= 2;
+        }
 
-            /* read back upper nibble of status byte */
-            read( pDev->fd, &data, 1 );
-            data_high = ( data & 0xF0 );
+        delay -= LCD_POLL_LEAD_BYTES * LCD_BUS_BYTE_US;
+        if ( delay > 0 )
+        {
+            usleep( delay );
+            pDev->stats.pollWaitUs += delay;
+        }
 
-            pDev->reg.EN = 0;
-            write( pDev->fd, &(pDev->regval), 1 );
+        do
+        {
+            if ( polls > 0 )
+            {
+                /* wait longer each time the display is still busy */
+                usleep( backoff );
+                pDev->stats.pollWaitUs += backoff;
+                backoff = ( backoff * 2 < LCD_POLL_BACKOFF_MAX_US )
+                          ? backoff * 2
+                          : LCD_POLL_BACKOFF_MAX_US;
+            }
 
-            /* Update PCF8574 outputs */
-            pDev->reg.EN = 1;
-            write( pDev->fd, &(pDev->regval), 1 );
+            /* the time at which this poll samples the busy flag */
+            busyAt = sampled;
+            sampled = elapsedUs( &start ) +
+                      LCD_POLL_LEAD_BYTES * LCD_BUS_BYTE_US;
+            result = GetStatus( pDev );
+            polls++;
 
-            /* read back lower nibble of status byte */
-            read( pDev->fd, &data, 1 );
-            data_low = ( data & 0xF0 ) >> 4;
+            elapsed = elapsedUs( &start );
+            if ( ( result == EOK ) &&
+                 ( pDev->busy ) &&
+                 ( elapsed > LCD_POLL_TIMEOUT_US ) )
+            {
+                /* the status reads may be out of nibble sync */
+                pDev->stats.pollTimeouts++;
+                pDev->syncLost = true;
+                result = ETIMEDOUT;
+            }
+        } while( ( result == EOK ) && ( pDev->busy ) );
 
-            /* Update PCF8574 outputs */
-            pDev->reg.EN = 0;
-            write( pDev->fd, &(pDev->regval), 1 );
+        /* a busy poll brackets the execution time, but a first poll
+           which is ready only shows that it was shorter than that */
+        if ( polls > 1 )
+        {
+            sampled = ( busyAt + sampled ) / 2;
+        }
 
-            *val = data_high | data_low;
+        if ( ( result == EOK ) &&
+             ( ( polls > 1 ) ||
+               ( ( sample == true ) &&
+                 ( sampled < pDev->execEstimate[class] ) ) ) )
+        {
+            /* learn the execution time from the completed poll */
+            pDev->execEstimate[class] += ( sampled -
+                                           pDev->execEstimate[class] ) / 8;
+            if ( pDev->execEstimate[class] < execTimes[class] / 2 )
+            {
+                pDev->execEstimate[class] = execTimes[class] / 2;
+            }
+        }
 
-            result = EOK;
+        pDev->stats.polls += polls;
+        if ( polls > pDev->stats.maxPolls )
+        {
+            pDev->stats.maxPolls = polls;
         }
-        else
+
+        if ( polls == 1 )
         {
-            result = EBADF;
+            pDev->stats.firstPollReady++;
         }
     }
 
     return result;
 }
 
+/*============================================================================*/
+/*  execClass                                                                 */
+/*!
+    Get the execution time class of an instruction
+
+    @param[in]
+        rs
+            register select of the instruction: 1 = Data RAM,
+            0 = Instruction Register
+
+    @param[in]
+        val
+            8-bit instruction or data value
+
+    @retval the instruction class
+
+==============================================================================*/
+static LCDExecClass execClass( uint8_t rs, uint8_t val )
+{
+    LCDExecClass class = LCD_EXEC_SHORT;
+
+    if ( rs != 0 )
+    {
+        class = LCD_EXEC_DATA;
+    }
+    else if ( ( val != 0 ) && ( val < 0x04 ) )
+    {
+        /* clear display (0x01) or return home (0x02/0x03) */
+        class = LCD_EXEC_LONG;
+    }
+
+    return class;
+}
 
 /*============================================================================*/
-/*  writeReg                                                                  */
+/*  elapsedUs                                                                 */
 /*!
-    Write the register to the I2C device
+    Get the time elapsed since a monotonic clock time
 
-    The writeReg function writes an 8-bit value to the PCF8574 serial to
-    parallel I/O expander.
+    @param[in]
+        since
+            pointer to the start time
 
-    If the I2C interface is not opened (for exclusive access), this function
-    will open/close the I2C interface for each write.
+    @retval number of microseconds since the start time
+
+==============================================================================*/
+static long elapsedUs( struct timespec *since )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( now.tv_sec - since->tv_sec ) * 1000000L +
+           ( now.tv_nsec - since->tv_nsec ) / 1000L;
+}
+
+/*============================================================================*/
+/*  waitExecution                                                             */
+/*!
+    Wait for an instruction to complete without polling the busy flag
+
+    The waitExecution function is used in LCD_WRITE_TIMED mode to allow
+    an instruction which has just been latched into the HD44780 to
+    complete.
+
+    The next instruction is not latched until its first nibble has been
+    clocked out to the PCF8574 (LCD_LATCH_BYTES bus bytes), so only the
+    part of the execution time which is not already covered by that bus
+    time needs to be waited for.  For most instructions the bus time is
+    longer than the execution time, so they can remain queued in the
+    current transaction.  Clear display and return home take 1.52 ms,
+    so the transaction is flushed and the time at which the device
+    will be ready again is recorded.
+
+    The remaining time is not waited for here.  Instead, the next
+    writeByte() to this device waits until the device is ready (see
+    waitReady()).  This allows other devices on the bus to be serviced
+    in the meantime (see GetReadyDelay()).
 
     @param[in]
         pDev
             pointer to the LCDDev controller state object
 
-    @retval EOK the write was successful
-    @retval ENODEV no I2C device was specified
-    @retval ENXIO ioctl failed
-    @retval other error from open()
+    @param[in]
+        rs
+            register select of the instruction: 1 = Data RAM,
+            0 = Instruction Register
+
+    @param[in]
+        val
+            8-bit instruction or data value which was written
+
+    @retval EOK no error occurred
     @retval EINVAL invalid arguments
+    @retval other error from FlushTransaction()
 
 ==============================================================================*/
-int writeReg( LCDDev *pDev )
+static int waitExecution( LCDDev *pDev, uint8_t rs, uint8_t val )
 {
     int result = EINVAL;
-    int fd = -1;
+    int t;
 
     if ( pDev != NULL )
     {
-        fd = pDev->fd;
+        result = EOK;
 
-        if( fd != -1 )
-        {
-            write( fd, &(pDev->regval), 1 );
-            result = EOK;
-        }
-        else if ( pDev->device != NULL )
+        t = execTimes[execClass( rs, val )];
+
+        /* subtract the time taken to latch the next instruction */
+        t -= LCD_LATCH_BYTES * LCD_BUS_BYTE_US;
+        if ( t > 0 )
         {
-            /* open the i2c device for reading */
-            fd = open( pDev->device, O_RDWR );
-            if( fd != -1 )
+            /* the instruction must be on the bus before we start waiting */
+            result = FlushTransaction( pDev );
+            if ( result == EOK )
             {
-                /* set up the device slave address */
-                if (ioctl( fd, I2C_SLAVE, pDev->address ) >= 0 )
-                {
-                    /* set up the channel to read */
-                    write( fd, &(pDev->regval), 1 );
-
-                    /* success */
-                    result = EOK;
-                }
-                else
-                {
-                    result = ENXIO;
-                }
-
-                close( fd );
+                result = BusFlush( pDev->pBus );
             }
-            else
+
+            clock_gettime( CLOCK_MONOTONIC, &pDev->readyAt );
+            pDev->readyAt.tv_nsec += t * 1000L;
+            if ( pDev->readyAt.tv_nsec >= 1000000000L )
             {
-                result = errno;
+                pDev->readyAt.tv_sec++;
+                pDev->readyAt.tv_nsec -= 1000000000L;
             }
         }
-        else
-        {
-            result = ENODEV;
-        }
     }
 
     return result;
 }
 
 /*============================================================================*/
-/*  GetStatus                                                                 */
+/*  waitReady                                                                 */
 /*!
-    Get the status of the LCD
-
-    The GetStatus function gets the busy status and address counter
-    from the LCD display via the PCF8574 4-bit interface
+    Wait for the LCD device to complete a timed instruction
 
-    If the I2C interface is not opened (for exclusive access), this function
-    will open/close the I2C interface for each status read.
+    The waitReady function waits until the time recorded by
+    waitExecution() for the last long instruction has elapsed.
+    Bus writes for other devices which are waiting in a batch are
+    sent before sleeping so they are not held up.
 
     @param[in]
         pDev
             pointer to the LCDDev controller state object
 
     @retval EOK the device is ready
-    @retval EBUSY the device is busy
-    @retval ENODEV no I2C device was specified
-    @retval ENXIO ioctl failed
-    @retval other error from open()
     @retval EINVAL invalid arguments
 
 ==============================================================================*/
-int GetStatus( LCDDev *pDev )
+static int waitReady( LCDDev *pDev )
 {
     int result = EINVAL;
-    int fd = -1;
-    uint8_t val;
-    uint8_t ac;
+    int us = 0;
 
     if ( pDev != NULL )
     {
-        fd = pDev->fd;
-
-        if( fd != -1 )
+        GetReadyDelay( pDev, &us );
+        if ( us > 0 )
         {
-            /* get the LCD status */
-            result = readStatus( pDev );
+            BusFlush( pDev->pBus );
+            usleep( us );
         }
-        else if ( pDev->device != NULL )
-        {
-            /* open the i2c device for reading */
-            fd = open( pDev->device, O_RDWR );
-            if( fd != -1 )
-            {
-                /* set up the device slave address */
-                if (ioctl( fd, I2C_SLAVE, pDev->address ) >= 0 )
-                {
-                    /* get the LCD status */
-                    pDev->fd = fd;
-                    result = readStatus( pDev );
-                }
-                else
-                {
-                    result = ENXIO;
-                }
 
-                pDev->fd = -1;
-                close( fd );
-            }
-            else
-            {
-                result = errno;
-            }
-        }
-        else
-        {
-            result = ENODEV;
-        }
+        result = EOK;
     }
 
     return result;
 }
 
 /*============================================================================*/
-/*  readStatus                                                                */
+/*  trackAddress                                                              */
 /*!
-    Read the status register of the LCD
+    Track the HD44780 address counter
 
-    The readStatus function reads the busy status and address counter
-    from the LCD display via the PCF8574 4-bit interface
+    The trackAddress function maintains a software copy of the HD44780
+    address counter based on the instructions and data which have been
+    written.  This allows the cursor position to be known without
+    reading back the status register.  In LCD_WRITE_BUSY_POLL mode
+    the tracked value is overwritten by each status read.
+
+    The display is assumed to be in 2-line mode with the
+    cursor incrementing after each data write.
 
     @param[in]
         pDev
             pointer to the LCDDev controller state object
 
-    @retval EOK the device is ready
-    @retval EBUSY the device is busy
-    @retval EBADF invalid file descriptor
-    @retval EINVAL invalid arguments
+    @param[in]
+        rs
+            register select: 1 = Data RAM, 0 = Instruction Register
+
+    @param[in]
+        val
+            8-bit instruction or data value which was written
+
+==============================================================================*/
+static void trackAddress( LCDDev *pDev, uint8_t rs, uint8_t val )
+{
+    uint8_t ac;
+
+    if ( pDev != NULL )
+    {
+        ac = pDev->AddressCounter;
+
+        if ( ( rs != 0 ) && ( pDev->acCGRAM == true ) )
+        {
+            /* keep the shadow character generator RAM up to date */
+            pDev->pShadow->cgram[ ac >> 3 ][ ac & 0x07 ] = val & 0x1F;
+            pDev->pShadow->cgramKnown[ ac >> 3 ] |= ( 1 << ( ac & 0x07 ) );
+
+            /* character generator RAM write */
+            ac = ( ac + 1 ) & 0x3F;
+        }
+        else if ( rs != 0 )
+        {
+            /* keep the shadow display data RAM up to date */
+            if ( ( ac & 0x3F ) < LCD_DDRAM_COLS )
+            {
+                pDev->pShadow->ddram[ ac >= 0x40 ? 1 : 0 ][ ac & 0x3F ] = val;
+            }
+
+            /* data write increments the address counter, wrapping
+               from the end of one row to the start of the other */
+            ac++;
+            if ( ac == 0x28 )
+            {
+                ac = 0x40;
+            }
+            else if ( ac >= 0x68 )
+            {
+                ac = 0x00;
+            }
+        }
+        else if ( val & 0x80 )
+        {
+            /* set DDRAM address */
+            ac = val & 0x7F;
+            pDev->acCGRAM = false;
+        }
+        else if ( val & 0x40 )
+        {
+            /* set CGRAM address */
+            ac = val & 0x3F;
+            pDev->acCGRAM = true;
+        }
+        else if ( ( val & 0xF8 ) == 0x10 )
+        {
+            /* cursor shift (display shift leaves the counter alone) */
+            if ( pDev->acCGRAM == true )
+            {
+                ac = ( ( val & 0x04 ) ? ac + 1 : ac - 1 ) & 0x3F;
+            }
+            else if ( val & 0x04 )
+            {
+                /* wrapping from the end of one row to the start of
+                   the other, like a data write */
+                ac = ( ac == 0x27 ) ? 0x40
+                   : ( ac >= 0x67 ) ? 0x00
+                   : ac + 1;
+            }
+            else
+            {
+                ac = ( ac == 0x40 ) ? 0x27
+                   : ( ac == 0x00 ) ? 0x67
+                   : ac - 1;
+            }
+        }
+        else if ( ( val & 0xF8 ) == 0x18 )
+        {
+            /* display shift, wrapping around the display data RAM row */
+            pDev->pShadow->shift = ( val & 0x04 )
+                ? ( pDev->pShadow->shift + LCD_DDRAM_COLS - 1 ) % LCD_DDRAM_COLS
+                : ( pDev->pShadow->shift + 1 ) % LCD_DDRAM_COLS;
+        }
+        else if ( val == 0x01 )
+        {
+            /* clear display fills the display data RAM with spaces */
+            memset( pDev->pShadow->ddram,
+                    0x20,
+                    sizeof( pDev->pShadow->ddram ) );
+            pDev->pShadow->ddramValid = true;
+            pDev->pShadow->shift = 0;
+            pDev->acCGRAM = false;
+            ac = 0;
+        }
+        else if ( ( val & 0xFE ) == 0x02 )
+        {
+            /* return home also undoes any display shift */
+            pDev->pShadow->shift = 0;
+            pDev->acCGRAM = false;
+            ac = 0;
+        }
+        else if ( ( val & 0xF8 ) == 0x08 )
+        {
+            /* display on/off control */
+            pDev->pShadow->control = val;
+        }
+        else if ( ( val & 0xFC ) == 0x04 )
+        {
+            /* entry mode set */
+            pDev->pShadow->entryMode = val;
+        }
+
+        pDev->AddressCounter = ac;
+        updateCursor( pDev );
+    }
+}
+
+/*============================================================================*/
+/*  updateCursor                                                              */
+/*!
+    Update the cursor coordinates from the address counter
+
+    The updateCursor function calculates the cx, cy cursor coordinates
+    from the current value of the address counter, using the row
+    addresses of the display geometry.  Addresses past the end of a row
+    give an x coordinate past the right of the screen.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+==============================================================================*/
+static void updateCursor( LCDDev *pDev )
+{
+    const LCDGeometry *pGeometry;
+    uint8_t ac;
+    int row;
+    int i;
+
+    if ( pDev != NULL )
+    {
+        pGeometry = pDev->pGeometry;
+        ac = pDev->AddressCounter;
+
+        /* rows 1 and 2 start each half of the display data RAM, and any
+           further rows continue them */
+        row = ( ac & 0x40 ) ? 1 : 0;
+        for ( i = 2; i < pGeometry->rows; i++ )
+        {
+            if ( ( ( pGeometry->rowAddr[i] & 0x40 ) == ( ac & 0x40 ) ) &&
+                 ( pGeometry->rowAddr[i] <= ac ) )
+            {
+                row = i;
+            }
+        }
+
+        pDev->cx = ac - pGeometry->rowAddr[row] + 1;
+        pDev->cy = row + 1;
+    }
+}
+
+/*============================================================================*/
+/*  readByte                                                                  */
+/*!
+    Reads an 8-bit data value from the LCD controller
+
+    The readByte function reads a byte of data from the LCD controller IC.
+    The read status byte contains the busy flag, and the current data
+    address (the address in the LCD RAM of the next write).
+
+    The LCD controller must be operating in 4-bit data transfer mode
+
+    Since the PCF8574 is a pseudo I/O chip, the data outputs have to be
+    driven high during a read operation.
+
+    RS is set to 0 to select the status register
+    RW is set to 1 to read the data
+    D7-D4 are set HIGH
+
+    The EN is set high to enable the LCD outputs, the data is read back
+    from the PCF8574, and then the EN is set low to disable the LCD outputs.
+
+    This process is repeated twice, the first time to get the Most Significant
+    Bits of the status register, and the second time to get the Least
+    Significant bits of the status register.
+
+    The two halves of the status register are ORed together to get the final
+    result
+
+    If the I2C adapter supports plain I2C transfers, the whole sequence
+    is performed as one combined I2C_RDWR transaction.  SMBus only
+    adapters use separate writes and reads.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        val
+            pointer to the location to store the 8-bit status value
+
+    @retval EOK no error occurred
+    @retval EINVAL invalid arguments
+    @retval EBADF invalid device file descriptor
+    @retval other error from BusTransfer(), BusWrite() or BusRead()
+
+==============================================================================*/
+int readByte( LCDDev *pDev, uint8_t *val )
+{
+    int result = EINVAL;
+    int rc;
+    uint8_t data_high = 0;
+    uint8_t data_low = 0;
+    uint8_t data = 0;
+
+    if ( pDev != NULL )
+    {
+        /* queued writes must reach the bus before we read it back */
+        FlushTransaction( pDev );
+
+        if ( BusIsOpen( pDev->pBus ) )
+        {
+            /* set up register for reading status */
+            mergeBacklight( pDev );
+            setSignal( pDev, pDev->pins.rs, false );
+            setSignal( pDev, pDev->pins.rw, true );
+
+            /* set data registers high for PCF8574 so we can read them back */
+            setNibble( pDev, 0x0F );
+
+            result = readCombined( pDev, val );
+            if ( result == ENOTSUP )
+            {
+                /* Update PCF8574 outputs */
+                trace( pDev, false, &(pDev->regval), 1 );
+                result = BusWrite( pDev->pBus,
+                                   pDev->address,
+                                   &(pDev->regval),
+                                   1 );
+
+                setSignal( pDev, pDev->pins.en, true );
+                trace( pDev, false, &(pDev->regval), 1 );
+                rc = BusWrite( pDev->pBus, pDev->address, &(pDev->regval), 1 );
+                result = ( result == EOK ) ? rc : result;
+
+                /* read back upper nibble of status byte */
+                rc = BusRead( pDev->pBus, pDev->address, &data, 1 );
+                result = ( result == EOK ) ? rc : result;
+                trace( pDev, true, &data, 1 );
+                data_high = getNibble( pDev, data );
+
+                setSignal( pDev, pDev->pins.en, false );
+                trace( pDev, false, &(pDev->regval), 1 );
+                rc = BusWrite( pDev->pBus, pDev->address, &(pDev->regval), 1 );
+                result = ( result == EOK ) ? rc : result;
+
+                /* Update PCF8574 outputs */
+                setSignal( pDev, pDev->pins.en, true );
+                trace( pDev, false, &(pDev->regval), 1 );
+                rc = BusWrite( pDev->pBus, pDev->address, &(pDev->regval), 1 );
+                result = ( result == EOK ) ? rc : result;
+
+                /* read back lower nibble of status byte */
+                rc = BusRead( pDev->pBus, pDev->address, &data, 1 );
+                result = ( result == EOK ) ? rc : result;
+                trace( pDev, true, &data, 1 );
+                data_low = getNibble( pDev, data );
+
+                /* Update PCF8574 outputs */
+                setSignal( pDev, pDev->pins.en, false );
+                trace( pDev, false, &(pDev->regval), 1 );
+                rc = BusWrite( pDev->pBus, pDev->address, &(pDev->regval), 1 );
+                result = ( result == EOK ) ? rc : result;
+
+                *val = ( data_high << 4 ) | data_low;
+            }
+
+            result = ioError( pDev, result );
+        }
+        else
+        {
+            result = EBADF;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  readCombined                                                              */
+/*!
+    Read a byte from the LCD using one combined I2C transfer
+
+    The readCombined function performs the same sequence of PCF8574
+    output updates and reads as readByte(), but submits them as a single
+    combined I2C transaction (see BusTransfer()), so the whole status
+    read takes one system call.  The RS and RW bits must already be
+    set up for the read.
+
+    @param[in]
+        pDev
+            pointer to the LCD device
+
+    @param[out]
+        val
+            pointer to the location to store the byte read from the LCD
+
+    @retval EOK the byte was read
+    @retval ENOTSUP the adapter does not support combined transfers
+    @retval other error from BusTransfer()
+
+==============================================================================*/
+static int readCombined( LCDDev *pDev, uint8_t *val )
+{
+    int result;
+    uint8_t high[2];
+    uint8_t low[2];
+    uint8_t last;
+    uint8_t data_high = 0;
+    uint8_t data_low = 0;
+    LCDBusXfer xfers[5];
+    int i;
+
+    /* outputs set up, then EN high to read the upper nibble */
+    high[0] = pDev->regval;
+    setSignal( pDev, pDev->pins.en, true );
+    high[1] = pDev->regval;
+
+    /* EN low, then EN high to read the lower nibble */
+    setSignal( pDev, pDev->pins.en, false );
+    low[0] = pDev->regval;
+    setSignal( pDev, pDev->pins.en, true );
+    low[1] = pDev->regval;
+
+    /* EN low to end the read */
+    setSignal( pDev, pDev->pins.en, false );
+    last = pDev->regval;
+
+    xfers[0] = (LCDBusXfer){ false, high, sizeof( high ) };
+    xfers[1] = (LCDBusXfer){ true, &data_high, 1 };
+    xfers[2] = (LCDBusXfer){ false, low, sizeof( low ) };
+    xfers[3] = (LCDBusXfer){ true, &data_low, 1 };
+    xfers[4] = (LCDBusXfer){ false, &last, 1 };
+
+    result = BusTransfer( pDev->pBus, pDev->address, xfers, 5 );
+    if ( result == EOK )
+    {
+        *val = ( getNibble( pDev, data_high ) << 4 ) |
+               getNibble( pDev, data_low );
+    }
+
+    if ( result != ENOTSUP )
+    {
+        for ( i = 0; i < 5; i++ )
+        {
+            trace( pDev, xfers[i].read, xfers[i].buf, xfers[i].len );
+        }
+    }
+
+    return result;
+}
+
+
+/*============================================================================*/
+/*  writeReg                                                                  */
+/*!
+    Write the register to the I2C device
+
+    The writeReg function writes an 8-bit value to the PCF8574 serial to
+    parallel I/O expander.
+
+    If a transaction is open (see BeginTransaction()) the value is
+    appended to the transaction buffer and is sent to the bus when
+    the transaction is flushed.
+
+    If the I2C interface is not opened (for exclusive access), this function
+    will open/close the I2C interface for each write.
+
+    Any pending backlight change (see RequestBacklight()) is merged into
+    the value written, so it does not need a bus write of its own.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @retval EOK the write was successful
+    @retval ENODEV no I2C device was specified
+    @retval ENXIO ioctl failed
+    @retval other error from open()
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int writeReg( LCDDev *pDev )
+{
+    int result = EINVAL;
+
+    if ( pDev != NULL )
+    {
+        mergeBacklight( pDev );
+
+        if ( pDev->txDepth > 0 )
+        {
+            result = EOK;
+
+            if ( pDev->txLen >= LCD_TX_BUFSIZE )
+            {
+                /* transaction buffer is full, send what we have so far */
+                result = FlushTransaction( pDev );
+            }
+
+            /* queue the register value */
+            pDev->txBuf[pDev->txLen++] = pDev->regval;
+        }
+        else
+        {
+            result = submit( pDev, &(pDev->regval), 1 );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BeginTransaction                                                          */
+/*!
+    Begin an I2C transaction
+
+    The BeginTransaction function starts queueing PCF8574 register
+    writes into the device transaction buffer instead of sending
+    them to the bus one byte at a time.  The PCF8574 latches each
+    byte it receives in order, so the queued bytes can be sent
+    using a single multi-byte write.
+
+    Transactions may be nested.  The queued data is sent when the
+    outermost transaction is ended using EndTransaction(), or earlier
+    if FlushTransaction() is called or the transaction buffer fills up.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @retval EOK the transaction was started
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int BeginTransaction( LCDDev *pDev )
+{
+    int result = EINVAL;
+
+    if ( pDev != NULL )
+    {
+        if ( pDev->txDepth++ == 0 )
+        {
+            /* the shadow state is updated before the bus is written */
+            pDev->pShadow->pending = true;
+        }
+
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  EndTransaction                                                            */
+/*!
+    End an I2C transaction
+
+    The EndTransaction function closes a transaction previously opened
+    with BeginTransaction().  When the outermost transaction is closed,
+    all of the queued register writes are sent to the bus.  The shadow
+    state remains marked as pending if they could not be sent.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @retval EOK the transaction was completed
+    @retval EINVAL invalid arguments
+    @retval other error from FlushTransaction()
+
+==============================================================================*/
+int EndTransaction( LCDDev *pDev )
+{
+    int result = EINVAL;
+
+    if ( ( pDev != NULL ) &&
+         ( pDev->txDepth > 0 ) )
+    {
+        result = EOK;
+
+        pDev->txDepth--;
+        if ( pDev->txDepth == 0 )
+        {
+            result = FlushTransaction( pDev );
+            if ( result == EOK )
+            {
+                pDev->pShadow->pending = false;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  FlushTransaction                                                          */
+/*!
+    Send the queued register writes to the bus
+
+    The FlushTransaction function sends all of the register writes
+    queued in the transaction buffer to the PCF8574 using a single
+    multi-byte write.  The transaction (if any) remains open.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @retval EOK the queued data was sent (or there was nothing to send)
+    @retval EINVAL invalid arguments
+    @retval other error from submit()
+
+==============================================================================*/
+int FlushTransaction( LCDDev *pDev )
+{
+    int result = EINVAL;
+
+    if ( pDev != NULL )
+    {
+        result = EOK;
+
+        if ( pDev->txLen > 0 )
+        {
+            result = submit( pDev, pDev->txBuf, pDev->txLen );
+            pDev->txLen = 0;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  submit                                                                    */
+/*!
+    Send a buffer of register values to the I2C device
+
+    The submit function writes one or more 8-bit values to the PCF8574
+    serial to parallel I/O expander using a single write.
+
+    If the LCD device is not open, the I2C bus connection is acquired
+    and released around the write.  The bus connection manager keeps
+    the connection cached, so this does not re-open the i2c device for
+    each write.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        buf
+            pointer to the register values to write
+
+    @param[in]
+        len
+            number of register values to write
+
+    @retval EOK the write was successful
+    @retval ENODEV no I2C device was specified
+    @retval ENXIO ioctl failed
+    @retval EIO short write
+    @retval other error from open() or write()
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int submit( LCDDev *pDev, uint8_t *buf, size_t len )
+{
+    int result = EINVAL;
+
+    if ( ( pDev != NULL ) &&
+         ( buf != NULL ) )
+    {
+        result = BusOpen( pDev->pBus );
+        if ( result == EOK )
+        {
+            trace( pDev, false, buf, len );
+            result = BusWrite( pDev->pBus, pDev->address, buf, len );
+            BusRelease( pDev->pBus );
+        }
+
+        result = ioError( pDev, result );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ioError                                                                   */
+/*!
+    Check the result of a bus operation
+
+    The ioError function counts failed bus operations.  A failed write
+    or read may have been partly performed, so the HD44780 may have
+    latched one nibble of a byte without the other, and the interface
+    is marked as being out of nibble sync.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        result
+            result of the bus operation
+
+    @retval the result of the bus operation
+
+==============================================================================*/
+static int ioError( LCDDev *pDev, int result )
+{
+    if ( result != EOK )
+    {
+        pDev->stats.ioErrors++;
+        pDev->syncLost = true;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  trace                                                                     */
+/*!
+    Record bus bytes in the device trace
+
+    The trace function records a bus message in the bus trace of the
+    device (see SetTrace()), if it has one, against the operation which
+    is in progress (see BeginTrace()).
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        read
+            true if the bytes were read from the bus
+
+    @param[in]
+        buf
+            pointer to the bytes written or read
+
+    @param[in]
+        len
+            number of bytes
+
+==============================================================================*/
+static void trace( LCDDev *pDev, bool read, const uint8_t *buf, size_t len )
+{
+    if ( pDev->pTrace != NULL )
+    {
+        TraceRecord( pDev->pTrace,
+                     pDev->address,
+                     read ? LCD_TRACE_READ : 0,
+                     pDev->traceOrigin,
+                     buf,
+                     len );
+    }
+}
+
+/*============================================================================*/
+/*  SetTrace                                                                  */
+/*!
+    Record the bus bytes of the LCD device in a bus trace
+
+    The SetTrace function selects a bus trace (see TraceInit()) which
+    records every byte written to or read from the PCF8574 of the device.
+    Several devices on the same bus may share a trace, as long as they
+    are driven by the same thread.  The wiring of the device (see
+    SetPinMap()) is recorded in the trace against the device address,
+    so the address should be set first (see SetAddress()).
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        pTrace
+            pointer to the bus trace, or NULL to stop tracing
+
+    @retval EOK the trace was selected
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int SetTrace( LCDDev *pDev, LCDTrace *pTrace )
+{
+    int result = EINVAL;
+
+    if ( pDev != NULL )
+    {
+        pDev->pTrace = pTrace;
+        traceWiring( pDev );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  traceWiring                                                               */
+/*!
+    Record the wiring of the LCD device in its bus trace
+
+    The traceWiring function records the pin map of the device in the
+    bus trace of the device (see SetTrace()), if it has one, so the
+    recorded port values can be decoded.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+==============================================================================*/
+static void traceWiring( LCDDev *pDev )
+{
+    LCDTraceWiring wiring;
+
+    if ( pDev->pTrace != NULL )
+    {
+        wiring.address = pDev->address;
+        wiring.rs = pDev->pinMap.rs;
+        wiring.rw = pDev->pinMap.rw;
+        wiring.en = pDev->pinMap.en;
+        wiring.led = pDev->pinMap.led;
+        memcpy( wiring.data, pDev->pinMap.data, sizeof( wiring.data ) );
+        wiring.ledActiveLow = pDev->pinMap.ledActiveLow ? 1 : 0;
+
+        /* if the wiring table is full, the port values of the device
+           are decoded with the standard wiring */
+        TraceSetWiring( pDev->pTrace, &wiring );
+    }
+}
+
+/*============================================================================*/
+/*  BeginTrace                                                                */
+/*!
+    Begin an operation which bus bytes are recorded against
+
+    The BeginTrace function sets the operation which the bus trace
+    records the following bus bytes against.  Operations may be nested,
+    for example DisplayLine() uses SetADD(), and the bytes are recorded
+    against the outermost operation.  Each BeginTrace() must be matched
+    by an EndTrace() with the returned previous operation.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        origin
+            the operation which is starting (see LCDTraceOrigin)
+
+    @retval the previous operation, to pass to EndTrace()
+
+==============================================================================*/
+uint8_t BeginTrace( LCDDev *pDev, uint8_t origin )
+{
+    uint8_t prev = LCD_TRACE_NONE;
+
+    if ( pDev != NULL )
+    {
+        prev = pDev->traceOrigin;
+        if ( prev == LCD_TRACE_NONE )
+        {
+            pDev->traceOrigin = origin;
+        }
+    }
+
+    return prev;
+}
+
+/*============================================================================*/
+/*  EndTrace                                                                  */
+/*!
+    End an operation which bus bytes are recorded against
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        prev
+            the previous operation returned by BeginTrace()
+
+==============================================================================*/
+void EndTrace( LCDDev *pDev, uint8_t prev )
+{
+    if ( pDev != NULL )
+    {
+        pDev->traceOrigin = prev;
+    }
+}
+
+/*============================================================================*/
+/*  GetStatus                                                                 */
+/*!
+    Get the status of the LCD
+
+    The GetStatus function gets the busy status and address counter
+    from the LCD display via the PCF8574 4-bit interface
+
+    If the LCD device is not open, the I2C bus connection is acquired
+    and released around the status read.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @retval EOK the device is ready
+    @retval EBUSY the device is busy
+    @retval ENODEV no I2C device was specified
+    @retval ENXIO ioctl failed
+    @retval other error from open()
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GetStatus( LCDDev *pDev )
+{
+    int result = EINVAL;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_STATUS );
+
+    if ( pDev != NULL )
+    {
+        result = BusOpen( pDev->pBus );
+        if ( result == EOK )
+        {
+            /* get the LCD status */
+            result = readStatus( pDev );
+            BusRelease( pDev->pBus );
+        }
+    }
+
+    EndTrace( pDev, origin );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  readStatus                                                                */
+/*!
+    Read the status register of the LCD
+
+    The readStatus function reads the busy status and address counter
+    from the LCD display via the PCF8574 4-bit interface
+
+    While the interface may be out of nibble sync (see GetSyncLost()),
+    the status read back is not used, and the tracked address counter
+    is kept.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @retval EOK the device is ready
+    @retval EBUSY the device is busy
+    @retval EBADF invalid file descriptor
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int readStatus( LCDDev *pDev )
+{
+    int result = EINVAL;
+    uint8_t val;
+
+    if ( pDev != NULL )
+    {
+        if ( BusIsOpen( pDev->pBus ) )
+        {
+            /* read a byte by 4-bit read */
+            result = readByte( pDev, &val );
+            pDev->stats.statusReads++;
+            if ( ( result == EOK ) && ( pDev->syncLost == false ) )
+            {
+                pDev->busy = val & 0x80 ? true : false;
+                pDev->AddressCounter = val & 0x7F;
+                updateCursor( pDev );
+            }
+        }
+        else
+        {
+            result = EBADF;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GetExclusive                                                              */
+/*!
+    Check if the module has exclusive access to the I2C bus
+
+    The GetExclusive function checks to see if the module has exclusive
+    access to the I2C bus, and has an open persistent connection to the
+    driver.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        exclusive
+            pointer to a boolean to hold the results of the query
+
+    @retval EOK the query was successful
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GetExclusive( LCDDev *pDev, bool *exclusive )
+{
+    int result = EINVAL;
+
+    if ( ( pDev != NULL ) &&
+         ( exclusive != NULL ) )
+    {
+        *exclusive = pDev->exclusive;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetExclusive                                                              */
+/*!
+    Set flag to request exclusive access to the I2C bus
+
+    The SetExclusive function sets a flag to request exclusive access
+    to the bus.  Note that this function has no effect after the application
+    has started its main loop.  It must be set as part of command line
+    argument processing before the main loop begins.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        exclusive
+            boolean request for exclusive (true) or non-exclusive (false) access
+
+    @retval EOK the set was successful
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int SetExclusive( LCDDev *pDev, bool exclusive )
+{
+    int result = EINVAL;
+
+    if ( pDev != NULL )
+    {
+        pDev->exclusive = exclusive;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GetReadyDelay                                                             */
+/*!
+    Get the time until the LCD device is ready for the next instruction
+
+    The GetReadyDelay function gets the time remaining until a long
+    instruction (eg clear display) written in LCD_WRITE_TIMED mode
+    has completed.  Writing to the device before then will block
+    until the device is ready, so a scheduler can use this to service
+    other devices on the bus in the meantime.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[out]
+        us
+            pointer to the location to store the delay (microseconds).
+            Zero indicates the device is ready now.
+
+    @retval EOK the query was successful
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GetReadyDelay( LCDDev *pDev, int *us )
+{
+    int result = EINVAL;
+    struct timespec now;
+    long delay;
+
+    if ( ( pDev != NULL ) &&
+         ( us != NULL ) )
+    {
+        clock_gettime( CLOCK_MONOTONIC, &now );
+        delay = ( pDev->readyAt.tv_sec - now.tv_sec ) * 1000000L +
+                ( pDev->readyAt.tv_nsec - now.tv_nsec ) / 1000L;
+
+        *us = ( delay > 0 ) ? (int)delay : 0;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GetShadowDDRAM                                                            */
+/*!
+    Get the shadow copy of the display data RAM
+
+    The GetShadowDDRAM function gets a pointer into the shadow copy of
+    the display data RAM at the specified DDRAM address.  The pointer
+    may be used to read up to the end of the DDRAM row containing
+    the address (LCD_DDRAM_COLS - (address & 0x3F) bytes).
+
+    The shadow is maintained by writeByte() and is only available
+    once the display has been cleared, since the contents of the display
+    data RAM are not known before then.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        addr
+            DDRAM address, eg 0x00 for line 1, 0x40 for line 2
+
+    @param[out]
+        data
+            pointer to the location to store the shadow DDRAM pointer
+
+    @retval EOK the shadow DDRAM is available
+    @retval ENODATA the display contents are not known
+    @retval ERANGE the address is outside of the display data RAM
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GetShadowDDRAM( LCDDev *pDev, uint8_t addr, const uint8_t **data )
+{
+    int result = EINVAL;
+
+    if ( ( pDev != NULL ) &&
+         ( data != NULL ) )
+    {
+        if ( ( addr & 0x3F ) >= LCD_DDRAM_COLS )
+        {
+            result = ERANGE;
+        }
+        else if ( pDev->pShadow->ddramValid == false )
+        {
+            result = ENODATA;
+        }
+        else
+        {
+            *data = &( pDev->pShadow->ddram[ addr & 0x40 ? 1 : 0 ]
+                                           [ addr & 0x3F ] );
+            result = EOK;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  InvalidateShadowDDRAM                                                     */
+/*!
+    Mark the shadow display data RAM as unknown
+
+    The InvalidateShadowDDRAM function discards the shadow copy of
+    the display data RAM, so the next update of each line is written
+    in full.  This can be used when the display contents may have
+    been changed without our knowledge.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @retval EOK the shadow was invalidated
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int InvalidateShadowDDRAM( LCDDev *pDev )
+{
+    int result = EINVAL;
+
+    if ( pDev != NULL )
+    {
+        pDev->pShadow->ddramValid = false;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ValidateShadowDDRAM                                                       */
+/*!
+    Mark the shadow display data RAM as known
+
+    The ValidateShadowDDRAM function records that the whole of the
+    display data RAM has been written since the shadow copy was
+    discarded, so the shadow copy matches the display again and only
+    the changed characters of later updates need to be written.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @retval EOK the shadow was validated
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int ValidateShadowDDRAM( LCDDev *pDev )
+{
+    int result = EINVAL;
+
+    if ( pDev != NULL )
+    {
+        pDev->pShadow->ddramValid = true;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  FindGeometry                                                              */
+/*!
+    Look up a display geometry by name
+
+    The FindGeometry function gets the descriptor of one of the
+    supported display panel geometries: "16x2", "20x4" or "40x2".
+
+    @param[in]
+        name
+            geometry name (columns x rows)
+
+    @retval pointer to the geometry descriptor
+    @retval NULL the geometry is not supported
+
+==============================================================================*/
+const LCDGeometry *FindGeometry( char *name )
+{
+    const LCDGeometry *pGeometry = NULL;
+    size_t i;
+
+    if ( name != NULL )
+    {
+        for ( i = 0; i < sizeof( geometries ) / sizeof( geometries[0] ); i++ )
+        {
+            if ( strcmp( geometries[i].name, name ) == 0 )
+            {
+                pGeometry = &geometries[i];
+                break;
+            }
+        }
+    }
+
+    return pGeometry;
+}
+
+/*============================================================================*/
+/*  GetGeometry                                                               */
+/*!
+    Get the display panel geometry
+
+    The GetGeometry function gets the geometry descriptor of the display
+    panel driven by the LCD device.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[out]
+        ppGeometry
+            pointer to the location to store the geometry descriptor
+
+    @retval EOK the geometry was retrieved
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GetGeometry( LCDDev *pDev, const LCDGeometry **ppGeometry )
+{
+    int result = EINVAL;
+
+    if ( ( pDev != NULL ) &&
+         ( ppGeometry != NULL ) )
+    {
+        *ppGeometry = pDev->pGeometry;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetGeometry                                                               */
+/*!
+    Set the display panel geometry
+
+    The SetGeometry function sets the geometry of the display panel
+    driven by the LCD device.  The geometry determines the visible line
+    length and row addresses used by DisplayLine(), and the cursor
+    coordinates.  It should be set before the device is initialized.
+    The default is LCD_GEOMETRY.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        pGeometry
+            pointer to the geometry descriptor (see FindGeometry())
+
+    @retval EOK the geometry was set
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int SetGeometry( LCDDev *pDev, const LCDGeometry *pGeometry )
+{
+    int result = EINVAL;
+
+    if ( ( pDev != NULL ) &&
+         ( pGeometry != NULL ) )
+    {
+        pDev->pGeometry = pGeometry;
+        updateCursor( pDev );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  FindPinMap                                                                */
+/*!
+    Look up a PCF8574 backpack wiring by name
+
+    The FindPinMap function gets the pin map of one of the supported
+    PCF8574 backpack wirings: "standard", or "mjkdz", which has D4-D7 on
+    port bits 0-3, EN, RW and RS on bits 4-6, and an active low backlight
+    on bit 7.
+
+    @param[in]
+        name
+            pin map name
+
+    @retval pointer to the pin map
+    @retval NULL the pin map is not supported
+
+==============================================================================*/
+const LCDPinMap *FindPinMap( char *name )
+{
+    const LCDPinMap *pPinMap = NULL;
+    size_t i;
+
+    if ( name != NULL )
+    {
+        for ( i = 0; i < sizeof( pinMaps ) / sizeof( pinMaps[0] ); i++ )
+        {
+            if ( strcmp( pinMaps[i].name, name ) == 0 )
+            {
+                pPinMap = &pinMaps[i];
+                break;
+            }
+        }
+    }
+
+    return pPinMap;
+}
+
+/*============================================================================*/
+/*  GetPinMap                                                                 */
+/*!
+    Get the PCF8574 backpack wiring
+
+    The GetPinMap function gets the wiring of the display interface
+    signals to the PCF8574 port of the LCD device.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[out]
+        ppPinMap
+            pointer to the location to store the pin map pointer
+
+    @retval EOK the pin map was retrieved
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GetPinMap( LCDDev *pDev, const LCDPinMap **ppPinMap )
+{
+    int result = EINVAL;
+
+    if ( ( pDev != NULL ) &&
+         ( ppPinMap != NULL ) )
+    {
+        *ppPinMap = &pDev->pinMap;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CheckPinMap                                                               */
+/*!
+    Check a PCF8574 backpack wiring
+
+    The CheckPinMap function checks that a pin map gives each of the
+    display interface signals and the backlight its own PCF8574 port
+    bit, so that every port bit is used exactly once.
+
+    @param[in]
+        pPinMap
+            pointer to the pin map
+
+    @retval EOK the pin map is valid
+    @retval EINVAL invalid arguments, a port bit number above 7, or a
+            port bit used by more than one signal
+
+==============================================================================*/
+int CheckPinMap( const LCDPinMap *pPinMap )
+{
+    int result = EINVAL;
+    uint8_t bits[8];
+    uint8_t used = 0;
+    int i;
+
+    if ( pPinMap != NULL )
+    {
+        bits[0] = pPinMap->rs;
+        bits[1] = pPinMap->rw;
+        bits[2] = pPinMap->en;
+        bits[3] = pPinMap->led;
+        memcpy( &bits[4], pPinMap->data, sizeof( pPinMap->data ) );
+
+        for ( i = 0; i < 8; i++ )
+        {
+            used |= ( bits[i] < 8 ) ? 1 << bits[i] : 0;
+        }
+
+        /* eight signals on eight different port bits */
+        result = ( used == 0xFF ) ? EOK : EINVAL;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetPinMap                                                                 */
+/*!
+    Set the PCF8574 backpack wiring
+
+    The SetPinMap function sets the wiring of the display interface
+    signals to the PCF8574 port of the LCD device.  The pin map is
+    copied and compiled into the port bits of each signal, and a table
+    of the port data bits of each 4-bit value, which are used to build
+    every byte written to the PCF8574.  It should be set before the
+    device is opened.  The default is the "standard" pin map.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        pPinMap
+            pointer to the pin map (see FindPinMap())
+
+    @retval EOK the pin map was set
+    @retval EINVAL invalid arguments, or the pin map does not give each
+            signal a different port bit
+
+==============================================================================*/
+int SetPinMap( LCDDev *pDev, const LCDPinMap *pPinMap )
+{
+    int result = EINVAL;
+    LCDPins pins;
+    int i;
+    int j;
+
+    if ( ( pDev != NULL ) &&
+         ( CheckPinMap( pPinMap ) == EOK ) )
+    {
+        memset( &pins, 0, sizeof( pins ) );
+        pins.rs = 1 << pPinMap->rs;
+        pins.rw = 1 << pPinMap->rw;
+        pins.en = 1 << pPinMap->en;
+        pins.led = 1 << pPinMap->led;
+        pins.ledOn = pPinMap->ledActiveLow ? 0 : pins.led;
+
+        for ( i = 0; i < 16; i++ )
+        {
+            for ( j = 0; j < 4; j++ )
+            {
+                if ( i & ( 1 << j ) )
+                {
+                    pins.nibble[i] |= 1 << pPinMap->data[j];
+                }
+            }
+        }
+
+        pins.data = pins.nibble[0x0F];
+
+        pDev->pinMap = *pPinMap;
+        pDev->pins = pins;
+
+        /* rebuild the register shadow for the new wiring */
+        pDev->regval = 0;
+        mergeBacklight( pDev );
+
+        /* decode the traced port values with the new wiring */
+        traceWiring( pDev );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GetShadowCGRAM                                                            */
+/*!
+    Get the shadow copy of a custom character
+
+    The GetShadowCGRAM function gets a pointer to the shadow copy of
+    the 8 row bitmap held in one character generator RAM slot.  Only
+    the low 5 bits of each row are significant.
+
+    The shadow is maintained by writeByte() and a slot is only available
+    once all of its rows have been written, since the contents of the
+    character generator RAM are not known at power on.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        slot
+            character generator RAM slot (0 - 7)
+
+    @param[out]
+        data
+            pointer to the location to store the shadow bitmap pointer
+
+    @retval EOK the shadow bitmap is available
+    @retval ENODATA the slot contents are not known
+    @retval ERANGE the slot does not exist
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GetShadowCGRAM( LCDDev *pDev, int slot, const uint8_t **data )
+{
+    int result = EINVAL;
+
+    if ( ( pDev != NULL ) &&
+         ( data != NULL ) )
+    {
+        if ( ( slot < 0 ) || ( slot >= LCD_CGRAM_SLOTS ) )
+        {
+            result = ERANGE;
+        }
+        else if ( pDev->pShadow->cgramKnown[slot] != 0xFF )
+        {
+            result = ENODATA;
+        }
+        else
+        {
+            *data = pDev->pShadow->cgram[slot];
+            result = EOK;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GetGlyphSlots                                                             */
+/*!
+    Get the custom character slot table
+
+    The GetGlyphSlots function gets a pointer to the table of
+    LCD_CGRAM_SLOTS entries which records the custom character held
+    in each character generator RAM slot of the device.  The table is
+    maintained by the lcd_ctrl glyph cache.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[out]
+        ppSlots
+            pointer to the location to store the slot table pointer
+
+    @retval EOK the slot table was returned
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GetGlyphSlots( LCDDev *pDev, LCDGlyphSlot **ppSlots )
+{
+    int result = EINVAL;
+
+    if ( ( pDev != NULL ) &&
+         ( ppSlots != NULL ) )
+    {
+        *ppSlots = pDev->pShadow->glyphs;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  AttachShadow                                                              */
+/*!
+    Select where the shadow state of the display is kept
+
+    The AttachShadow function makes the device track the state of the
+    display in the specified shadow state object, for example one held
+    in a memory mapped file, instead of the one held in the device.  The
+    contents of the shadow state object are taken as the current state
+    of the display, so it should be reset with ResetShadow() if they
+    are not known to be correct.  The shadow state object must remain
+    valid until another one is attached.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        pShadow
+            pointer to the shadow state object, or NULL to use the one
+            held in the device
+
+    @retval EOK the shadow state object was attached
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int AttachShadow( LCDDev *pDev, LCDShadow *pShadow )
+{
+    int result = EINVAL;
+
+    if ( pDev != NULL )
+    {
+        pDev->pShadow = ( pShadow != NULL ) ? pShadow : &pDev->shadow;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GetShadow                                                                 */
+/*!
+    Get the shadow state of the display
+
+    The GetShadow function gets a pointer to the shadow state object
+    which tracks the state of the display.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[out]
+        ppShadow
+            pointer to the location to store the shadow state pointer
+
+    @retval EOK the shadow state pointer was returned
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GetShadow( LCDDev *pDev, const LCDShadow **ppShadow )
+{
+    int result = EINVAL;
+
+    if ( ( pDev != NULL ) &&
+         ( ppShadow != NULL ) )
+    {
+        *ppShadow = pDev->pShadow;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ResetShadow                                                               */
+/*!
+    Discard the shadow state of the display
+
+    The ResetShadow function marks all of the shadow state of the
+    display as unknown, for example before the display is initialized
+    from power on.  The magic number of the shadow state object is kept.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @retval EOK the shadow state was reset
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int ResetShadow( LCDDev *pDev )
+{
+    int result = EINVAL;
+    uint32_t magic;
+
+    if ( pDev != NULL )
+    {
+        magic = pDev->pShadow->magic;
+        memset( pDev->pShadow, 0, sizeof( LCDShadow ) );
+        pDev->pShadow->magic = magic;
+        pDev->pShadow->backlight = getLED( pDev );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GetSyncLost                                                               */
+/*!
+    Check if the LCD interface may be out of nibble sync
+
+    The GetSyncLost function checks if a bus error or a busy flag
+    timeout has occurred since the interface was last synchronized.
+    Once the HD44780 has latched half of a byte, every following byte
+    is received with its nibbles swapped, so the interface must be
+    resynchronized (see lcd_ctrl LCDResync()) before the display can
+    be written again.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[out]
+        lost
+            pointer to the location to store the sync lost state
+
+    @retval EOK the sync lost state was retrieved
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GetSyncLost( LCDDev *pDev, bool *lost )
+{
+    int result = EINVAL;
+
+    if ( ( pDev != NULL ) &&
+         ( lost != NULL ) )
+    {
+        *lost = pDev->syncLost;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ClearSyncLost                                                             */
+/*!
+    Record that the LCD interface has been resynchronized
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @retval EOK the sync lost state was cleared
+    @retval EINVAL invalid arguments
 
 ==============================================================================*/
-int readStatus( LCDDev *pDev )
+int ClearSyncLost( LCDDev *pDev )
 {
     int result = EINVAL;
-    uint8_t val;
 
     if ( pDev != NULL )
     {
-        if ( pDev->fd != -1 )
-        {
-            /* read a byte by 4-bit read */
-            result = readByte( pDev, &val );
-            if ( result == EOK )
-            {
-                pDev->busy = val & 0x80 ? true : false;
-                pDev->AddressCounter = val & 0x7F;
-                pDev->cx = ( pDev->AddressCounter & 0x3F ) + 1;
-                pDev->cy = pDev->AddressCounter >= 0x40 ? 2 : 1;
-            }
-        }
-        else
-        {
-            result = EBADF;
-        }
+        pDev->syncLost = false;
+        result = EOK;
     }
 
     return result;
 }
 
 /*============================================================================*/
-/*  GetExclusive                                                              */
+/*  GetWriteMode                                                              */
 /*!
-    Check if the module has exclusive access to the I2C bus
+    Get the write completion mode
 
-    The GetExclusive function checks to see if the module has exclusive
-    access to the I2C bus, and has an open persistent connection to the
-    driver.
+    The GetWriteMode function gets the mode used by writeByte() to
+    determine when an instruction has completed.
 
     @param[in]
         pDev
             pointer to the LCDDev controller state object
 
     @param[in]
-        exclusive
-            pointer to a boolean to hold the results of the query
+        mode
+            pointer to the location to store the write mode
 
     @retval EOK the query was successful
     @retval EINVAL invalid arguments
 
 ==============================================================================*/
-int GetExclusive( LCDDev *pDev, bool *exclusive )
+int GetWriteMode( LCDDev *pDev, LCDWriteMode *mode )
 {
     int result = EINVAL;
 
     if ( ( pDev != NULL ) &&
-         ( exclusive != NULL ) )
+         ( mode != NULL ) )
     {
-        *exclusive = pDev->exclusive;
+        *mode = pDev->writeMode;
         result = EOK;
     }
 
@@ -803,34 +2786,42 @@ int GetExclusive( LCDDev *pDev, bool *exclusive )
 }
 
 /*============================================================================*/
-/*  SetExclusive                                                              */
+/*  SetWriteMode                                                              */
 /*!
-    Set flag to request exclusive access to the I2C bus
+    Set the write completion mode
 
-    The SetExclusive function sets a flag to request exclusive access
-    to the bus.  Note that this function has no effect after the application
-    has started its main loop.  It must be set as part of command line
-    argument processing before the main loop begins.
+    The SetWriteMode function selects how writeByte() determines when
+    an instruction has completed:
+
+    LCD_WRITE_BUSY_POLL - the busy flag is read back after every write
+    LCD_WRITE_TIMED - the datasheet execution time is waited instead
+
+    Timed mode avoids the status read-back over the I2C bus, which allows
+    complete lines to be sent in a single transaction.  Busy polling
+    should be used for modules which are slower than the datasheet.
 
     @param[in]
         pDev
             pointer to the LCDDev controller state object
 
     @param[in]
-        exclusive
-            boolean request for exclusive (true) or non-exclusive (false) access
+        mode
+            write completion mode
 
     @retval EOK the set was successful
     @retval EINVAL invalid arguments
 
 ==============================================================================*/
-int SetExclusive( LCDDev *pDev, bool exclusive )
+int SetWriteMode( LCDDev *pDev, LCDWriteMode mode )
 {
     int result = EINVAL;
 
-    if ( pDev != NULL )
+    if ( ( pDev != NULL ) &&
+         ( ( mode == LCD_WRITE_BUSY_POLL ) ||
+           ( mode == LCD_WRITE_TIMED ) ) )
     {
-        pDev->exclusive = exclusive;
+        pDev->writeMode = mode;
+        result = EOK;
     }
 
     return result;
@@ -839,9 +2830,10 @@ int SetExclusive( LCDDev *pDev, bool exclusive )
 /*============================================================================*/
 /*  GetBacklight                                                              */
 /*!
-    Check if the LCD backlight is enabled
+    Get the state of the LCD backlight
 
-    The GetBacklight function checks to see if the LCD backlight is enabled
+    The GetBacklight function gets the requested state (on or off) of
+    the LCD backlight.  It may be called from any thread.
 
     @param[in]
         pDev
@@ -862,7 +2854,7 @@ int GetBacklight( LCDDev *pDev, bool *backlight )
     if ( ( pDev != NULL ) &&
          ( backlight != NULL ) )
     {
-        *backlight = ( pDev->reg.LED );
+        *backlight = atomic_load_explicit( &pDev->led, memory_order_relaxed );
         result = EOK;
     }
 
@@ -874,7 +2866,9 @@ int GetBacklight( LCDDev *pDev, bool *backlight )
 /*!
     Set the state of the LCD backlight
 
-    The SetBacklight function sets the state (on or off) of the LCD backlight
+    The SetBacklight function sets the state (on or off) of the LCD
+    backlight, and writes it to the PCF8574 (see SyncBacklight()).  It
+    must only be called by the thread which owns the bus.
 
     @param[in]
         pDev
@@ -890,18 +2884,214 @@ int GetBacklight( LCDDev *pDev, bool *backlight )
 
 ==============================================================================*/
 int SetBacklight( LCDDev *pDev, bool backlight )
+{
+    int result = RequestBacklight( pDev, backlight );
+
+    if ( result == EOK )
+    {
+        result = SyncBacklight( pDev );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RequestBacklight                                                          */
+/*!
+    Request a change to the state of the LCD backlight
+
+    The RequestBacklight function records the requested state (on or off)
+    of the LCD backlight without touching the register shadow or the bus,
+    so it may be called from any thread, even while the bus owner is in
+    the middle of writing a byte to the display.  The change is merged
+    into the next value written to the PCF8574, or is written on its own
+    by SyncBacklight().
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        backlight
+            true - turn on the backlight
+            false - turn off the backlight
+
+    @retval EOK the change was requested
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int RequestBacklight( LCDDev *pDev, bool backlight )
+{
+    int result = EINVAL;
+
+    if ( pDev != NULL )
+    {
+        atomic_store_explicit( &pDev->led, backlight, memory_order_relaxed );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SyncBacklight                                                             */
+/*!
+    Write a pending backlight change to the PCF8574
+
+    The SyncBacklight function writes the requested backlight state to
+    the PCF8574 if it has not already been merged into a write.  The LED
+    bit is written together with the current RS, RW, EN and data lines,
+    so a change in the middle of an instruction does not disturb it.  It
+    must only be called by the thread which owns the bus.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @retval EOK the backlight state has been written
+    @retval EINVAL invalid arguments
+    @retval other error from writeReg()
+
+==============================================================================*/
+int SyncBacklight( LCDDev *pDev )
 {
     int result = EINVAL;
+    bool led;
+    uint8_t origin;
+
+    origin = BeginTrace( pDev, LCD_TRACE_BACKLIGHT );
 
     if ( pDev != NULL )
     {
-        pDev->reg.LED = backlight == true ? 1 : 0;
-        writeReg( pDev );
+        led = atomic_load_explicit( &pDev->led, memory_order_relaxed );
+        result = ( getLED( pDev ) != led ) ? writeReg( pDev ) : EOK;
     }
 
+    EndTrace( pDev, origin );
+
     return result;
 }
 
+/*============================================================================*/
+/*  mergeBacklight                                                            */
+/*!
+    Merge the requested backlight state into the register shadow
+
+    The mergeBacklight function is called by the bus owner before the
+    register shadow is written to the PCF8574.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+==============================================================================*/
+static void mergeBacklight( LCDDev *pDev )
+{
+    bool led = atomic_load_explicit( &pDev->led, memory_order_relaxed );
+
+    pDev->regval = ( pDev->regval & ~pDev->pins.led ) |
+                   ( led ? pDev->pins.ledOn
+                         : pDev->pins.ledOn ^ pDev->pins.led );
+    pDev->pShadow->backlight = led;
+}
+
+/*============================================================================*/
+/*  getLED                                                                    */
+/*!
+    Get the backlight state held in the register shadow
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @retval true the register shadow turns the backlight on
+    @retval false the register shadow turns the backlight off
+
+==============================================================================*/
+static bool getLED( LCDDev *pDev )
+{
+    return ( pDev->regval & pDev->pins.led ) == pDev->pins.ledOn;
+}
+
+/*============================================================================*/
+/*  setSignal                                                                 */
+/*!
+    Set an interface signal in the register shadow
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        pin
+            port bit of the signal (eg pDev->pins.en)
+
+    @param[in]
+        on
+            true to drive the signal high, false to drive it low
+
+==============================================================================*/
+static void setSignal( LCDDev *pDev, uint8_t pin, bool on )
+{
+    pDev->regval = on ? ( pDev->regval | pin ) : ( pDev->regval & ~pin );
+}
+
+/*============================================================================*/
+/*  setNibble                                                                 */
+/*!
+    Set the D4-D7 data signals in the register shadow
+
+    The setNibble function looks up the port bits of a 4-bit value in the
+    table compiled from the pin map (see SetPinMap()), rather than moving
+    the bits into place one at a time for each nibble written.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        val
+            4-bit value to drive onto D4-D7
+
+==============================================================================*/
+static void setNibble( LCDDev *pDev, uint8_t val )
+{
+    pDev->regval = ( pDev->regval & ~pDev->pins.data ) |
+                   pDev->pins.nibble[val & 0x0F];
+}
+
+/*============================================================================*/
+/*  getNibble                                                                 */
+/*!
+    Get the D4-D7 data signals from a value read from the PCF8574
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        port
+            value read from the PCF8574 port
+
+    @retval the 4-bit value read from D4-D7
+
+==============================================================================*/
+static uint8_t getNibble( LCDDev *pDev, uint8_t port )
+{
+    uint8_t val = 0;
+    int i;
+
+    for ( i = 0; i < 4; i++ )
+    {
+        if ( port & ( 1 << pDev->pinMap.data[i] ) )
+        {
+            val |= 1 << i;
+        }
+    }
+
+    return val;
+}
+
 /*============================================================================*/
 /*  GetCursorX                                                                */
 /*!
@@ -911,6 +3101,7 @@ int SetBacklight( LCDDev *pDev, bool backlight )
     The cursor indicates where the next character will be displayed.
     x = 1 is the far left of the screen
     x = 16 is the far right of the screen (on a 16x2 display)
+    x = 20 is the far right of the screen (on a 20x4 display)
 
     @param[in]
         pDev
@@ -947,14 +3138,15 @@ int GetCursorX( LCDDev *pDev, int *pX )
     The cursor indicates where the next character will be displayed.
     y = 1 is the top of the screen (line1)
     y = 2 is the bottom of the screen (line2) on a 16x2 display
+    y = 4 is the bottom of the screen (line4) on a 20x4 display
 
     @param[in]
         pDev
             pointer to the LCDDev controller state object
 
     @param[in]
-        pX
-            pointer to the location to store the X coordinate
+        pY
+            pointer to the location to store the Y coordinate
 
     @retval EOK the query was successful
     @retval EINVAL invalid arguments
@@ -974,6 +3166,44 @@ int GetCursorY( LCDDev *pDev, int *pY )
     return result;
 }
 
+/*============================================================================*/
+/*  GetDevStats                                                               */
+/*!
+    Get the activity counters of the LCD device
+
+    The GetDevStats function gets the number of bytes written to the
+    device, the number of status reads, and the busy flag polling
+    counts since the device was created.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[out]
+        pStats
+            pointer to the location to store the counters
+
+    @retval EOK the counters were retrieved
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GetDevStats( LCDDev *pDev, LCDDevStats *pStats )
+{
+    int result = EINVAL;
+
+    if ( ( pDev != NULL ) &&
+         ( pStats != NULL ) )
+    {
+        *pStats = pDev->stats;
+        pStats->dataExecUs = pDev->execEstimate[LCD_EXEC_DATA];
+        pStats->instrExecUs = pDev->execEstimate[LCD_EXEC_SHORT];
+        pStats->longExecUs = pDev->execEstimate[LCD_EXEC_LONG];
+        result = EOK;
+    }
+
+    return result;
+}
+
 /*============================================================================*/
 /*  GetAddress                                                                */
 /*!
@@ -1074,8 +3304,7 @@ int GetDeviceName( LCDDev *pDev, char **name )
     if ( ( pDev != NULL ) &&
          ( name != NULL ) )
     {
-        *name = pDev->device;
-        result = EOK;
+        result = GetBusDevice( pDev->pBus, name );
     }
 
     return result;
@@ -1089,6 +3318,9 @@ int GetDeviceName( LCDDev *pDev, char **name )
     The SetDeviceName function sets the name of the i2c device
     eg /dev/i2c-1.  The name is used on the next call to LCDOpen()
 
+    A name starting with "emu:" selects the in-process display emulator
+    instead of a real I2C bus device.
+
     @param[in]
         pDev
             pointer to the LCDDev controller state object
@@ -1107,12 +3339,99 @@ int SetDeviceName( LCDDev *pDev, char *name )
 
     if ( pDev != NULL )
     {
-        pDev->device = name;
+        result = SetBusDevice( pDev->pBus, name );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GetBus                                                                    */
+/*!
+    Get the I2C bus connection used by the LCD device
+
+    The GetBus function gets the I2C bus connection manager used to
+    communicate with the LCD device.  This can be used to configure the
+    connection idle timeout, or to call BusCheckIdle() periodically.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        ppBus
+            pointer to the location to store the bus connection pointer
+
+    @retval EOK the query was successful
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GetBus( LCDDev *pDev, LCDBus **ppBus )
+{
+    int result = EINVAL;
+
+    if ( ( pDev != NULL ) &&
+         ( ppBus != NULL ) )
+    {
+        *ppBus = pDev->pBus;
         result = EOK;
     }
 
     return result;
 }
 
+/*============================================================================*/
+/*  SetBus                                                                    */
+/*!
+    Set the I2C bus connection used by the LCD device
+
+    The SetBus function sets the I2C bus connection used to communicate
+    with the LCD device.  This allows several LCD devices at different
+    addresses to share a single bus connection.  The default bus
+    connection created by InitDev() is deleted.
+
+    The bus must not be changed while the LCD device is open.
+
+    @param[in]
+        pDev
+            pointer to the LCDDev controller state object
+
+    @param[in]
+        pBus
+            pointer to the bus connection to use
+
+    @retval EOK the set was successful
+    @retval EBUSY the LCD device is open
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int SetBus( LCDDev *pDev, LCDBus *pBus )
+{
+    int result = EINVAL;
+
+    if ( ( pDev != NULL ) &&
+         ( pBus != NULL ) )
+    {
+        if ( pDev->open == true )
+        {
+            result = EBUSY;
+        }
+        else
+        {
+            if ( ( pDev->ownBus == true ) &&
+                 ( pDev->pBus != pBus ) )
+            {
+                BusDelete( pDev->pBus );
+            }
+
+            pDev->pBus = pBus;
+            pDev->ownBus = false;
+            result = EOK;
+        }
+    }
+
+    return result;
+}
+
 /*! @}
  * end of lcdio group */
@@ -0,0 +1,1493 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup lcdrender lcdrender
+ * @brief Character LCD render thread
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file lcd_render.c
+
+    Render thread for the character based display
+
+    The lcd_render module performs all of the I2C bus input/output for
+    the LCD devices on an I2C bus on a dedicated render thread, so that
+    the thread which requests display updates never waits on the bus.
+
+    Display update commands are passed to the render thread through
+    a lock-free single-producer/single-consumer command ring.  Only one
+    thread may submit commands to a render object, and only the render
+    thread may access the bus and its LCD devices once it has been started.
+
+    Each operation may carry a completion function.  Completions are
+    passed back through a second lock-free queue and signalled on an
+    eventfd (see RenderGetEventFd()), and the completion functions are
+    called on the submitting thread by RenderDispatch().
+
+    The render thread moves the commands from the ring into the bus
+    scheduler (see lcd_sched), which decides the order in which they are
+    performed.  Backlight changes are given priority over text updates,
+    and panels which are still executing a long instruction do not hold
+    up the other panels on the bus.
+
+    All of the operations which can be performed when the render thread
+    wakes up are performed as one bus batch (see BusBeginBatch()), so
+    updates to several panels on the bus are submitted together.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+/* sem_clockwait() */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+#include "lcd_bus.h"
+#include "lcd_io.h"
+#include "lcd_sched.h"
+#include "lcd_render.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+#define EOK 0
+#endif
+
+/*! number of entries in the command ring (must be a power of 2) */
+#define LCD_RENDER_RING_SIZE    ( 32 )
+
+/*! mask to convert a ring sequence number into a ring index */
+#define LCD_RENDER_RING_MASK    ( LCD_RENDER_RING_SIZE - 1 )
+
+/*! number of entries in the completion queue (must be a power of 2) */
+#define LCD_RENDER_DONE_SIZE    ( 128 )
+
+/*! mask to convert a completion sequence number into a queue index */
+#define LCD_RENDER_DONE_MASK    ( LCD_RENDER_DONE_SIZE - 1 )
+
+/*==============================================================================
+        Data Types
+==============================================================================*/
+
+/*! render command types */
+typedef enum _LCDCommandType
+{
+    /*! submit an operation to the scheduler */
+    LCD_CMD_OP = 0,
+
+    /*! stop the render thread */
+    LCD_CMD_STOP
+
+} LCDCommandType;
+
+/*! The LCDCommand type describes one display update for the render thread */
+typedef struct _LCDCommand
+{
+    /*! command type */
+    LCDCommandType type;
+
+    /*! operation for LCD_CMD_OP */
+    LCDOp op;
+
+} LCDCommand;
+
+/*! The LCDCompletion type holds the result of an asynchronous operation */
+typedef struct _LCDCompletion
+{
+    /*! completion function */
+    LCDCompletionFn fn;
+
+    /*! argument passed to the completion function */
+    void *arg;
+
+    /*! result of the operation */
+    int result;
+
+} LCDCompletion;
+
+/*! The LCDRender type manages the render thread for an LCD device */
+struct _LCDRender
+{
+    /*! the I2C bus owned by the render thread */
+    LCDBus *pBus;
+
+    /*! scheduler for the operations on the bus */
+    LCDSched *pSched;
+
+    /*! render thread */
+    pthread_t thread;
+
+    /*! render thread has been started */
+    bool running;
+
+    /*! counts commands available to the render thread */
+    sem_t sem;
+
+    /*! next ring sequence number to be written (producer owned) */
+    atomic_uint head;
+
+    /*! next ring sequence number to be read (consumer owned) */
+    atomic_uint tail;
+
+    /*! command ring */
+    LCDCommand ring[LCD_RENDER_RING_SIZE];
+
+    /*! eventfd signalled when asynchronous operations complete */
+    int efd;
+
+    /*! number of submitted operations awaiting RenderDispatch()
+        (producer owned) */
+    int outstanding;
+
+    /*! next completion sequence number to be written (render thread) */
+    atomic_uint doneHead;
+
+    /*! next completion sequence number to be read (producer) */
+    atomic_uint doneTail;
+
+    /*! completion queue */
+    LCDCompletion done[LCD_RENDER_DONE_SIZE];
+};
+
+/*==============================================================================
+        Private Function Declarations
+==============================================================================*/
+
+static void *renderThread( void *arg );
+static int push( LCDRender *pRender, LCDCommand *pCmd );
+static bool pop( LCDRender *pRender, LCDCommand *pCmd );
+static int waitCommand( LCDRender *pRender, int timeout );
+static bool drain( LCDRender *pRender );
+static void finish( LCDRender *pRender );
+static void setDeadline( LCDOp *pOp, int ms );
+static int submit( LCDRender *pRender,
+                   LCDCommand *pCmd,
+                   LCDCompletionFn done,
+                   void *arg );
+static int queueControl( LCDRender *pRender,
+                         LCDDev *pDev,
+                         LCDOpType type,
+                         LCDCompletionFn done,
+                         void *arg );
+static void notify( void *ctx, LCDOp *pOp, int result );
+
+/*==============================================================================
+        Function Definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  RenderInit                                                                */
+/*!
+    Initialize a render object
+
+    The RenderInit function creates a render object for the LCD devices
+    on the specified I2C bus.  The render thread is not started until
+    RenderStart() is called.
+
+    @param[in]
+        pBus
+            pointer to the I2C bus to render to
+
+    @retval pointer to the new LCDRender object
+    @retval NULL if the render object could not be created
+
+==============================================================================*/
+LCDRender *RenderInit( LCDBus *pBus )
+{
+    LCDRender *pRender = NULL;
+
+    if ( pBus != NULL )
+    {
+        pRender = calloc( 1, sizeof( LCDRender ) );
+        if ( pRender != NULL )
+        {
+            pRender->pBus = pBus;
+            pRender->pSched = SchedInit( pBus, notify, pRender );
+            pRender->efd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+            atomic_init( &pRender->head, 0 );
+            atomic_init( &pRender->tail, 0 );
+            atomic_init( &pRender->doneHead, 0 );
+            atomic_init( &pRender->doneTail, 0 );
+
+            if ( ( pRender->pSched == NULL ) ||
+                 ( pRender->efd == -1 ) ||
+                 ( sem_init( &pRender->sem, 0, 0 ) != 0 ) )
+            {
+                if ( pRender->efd != -1 )
+                {
+                    close( pRender->efd );
+                }
+
+                free( pRender->pSched );
+                free( pRender );
+                pRender = NULL;
+            }
+        }
+    }
+
+    return pRender;
+}
+
+/*============================================================================*/
+/*  RenderStart                                                               */
+/*!
+    Start the render thread
+
+    The RenderStart function starts the render thread.  All signals are
+    blocked in the render thread so that signals from the variable
+    server continue to be delivered to the calling thread.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @retval EOK the render thread was started
+    @retval EALREADY the render thread is already running
+    @retval EINVAL invalid arguments
+    @retval other error from pthread_create()
+
+==============================================================================*/
+int RenderStart( LCDRender *pRender )
+{
+    int result = EINVAL;
+    sigset_t all;
+    sigset_t old;
+
+    if ( pRender != NULL )
+    {
+        if ( pRender->running == false )
+        {
+            /* the render thread inherits a fully blocked signal mask */
+            sigfillset( &all );
+            pthread_sigmask( SIG_BLOCK, &all, &old );
+
+            result = pthread_create( &pRender->thread,
+                                     NULL,
+                                     renderThread,
+                                     pRender );
+            if ( result == EOK )
+            {
+                pRender->running = true;
+            }
+
+            pthread_sigmask( SIG_SETMASK, &old, NULL );
+        }
+        else
+        {
+            result = EALREADY;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RenderStop                                                                */
+/*!
+    Stop the render thread
+
+    The RenderStop function waits for the render thread to process
+    all of the queued commands and then stops it.  The completion
+    functions of the final operations are called before it returns.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @retval EOK the render thread was stopped
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int RenderStop( LCDRender *pRender )
+{
+    int result = EINVAL;
+    LCDCommand cmd;
+
+    if ( pRender != NULL )
+    {
+        result = EOK;
+
+        if ( pRender->running == true )
+        {
+            memset( &cmd, 0, sizeof( cmd ) );
+            cmd.type = LCD_CMD_STOP;
+
+            /* wait for space in the ring for the stop command */
+            while ( push( pRender, &cmd ) == EAGAIN )
+            {
+                sched_yield();
+            }
+
+            pthread_join( pRender->thread, NULL );
+            pRender->running = false;
+
+            /* deliver the completions of the final operations */
+            RenderDispatch( pRender );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RenderLine                                                                */
+/*!
+    Queue a line of text to be displayed
+
+    The RenderLine function queues a line of text to be written to the
+    display by the render thread using DisplayLine().  It does not wait
+    for the text to be written.  If an earlier line for the same position
+    has not been written yet, it is replaced by this one.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[in]
+        pDev
+            pointer to the LCD device to display the line on
+
+    @param[in]
+        offset
+            display data address of the start of the line
+
+    @param[in]
+        line
+            pointer to the line text
+
+    @retval EOK the line was queued
+    @retval EAGAIN the command ring is full
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int RenderLine( LCDRender *pRender, LCDDev *pDev, uint8_t offset, char *line )
+{
+    return DisplayLineAsync( pRender, pDev, offset, line, NULL, NULL );
+}
+
+/*============================================================================*/
+/*  RenderBacklight                                                           */
+/*!
+    Queue a backlight change
+
+    The RenderBacklight function queues a change to the backlight state
+    to be written to the display by the render thread.  It does not wait
+    for the change to be written.  Backlight changes are performed ahead
+    of any pending text updates.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[in]
+        pDev
+            pointer to the LCD device to control
+
+    @param[in]
+        backlight
+            true - turn on the backlight
+            false - turn off the backlight
+
+    @retval EOK the change was queued
+    @retval EAGAIN the command ring is full
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int RenderBacklight( LCDRender *pRender, LCDDev *pDev, bool backlight )
+{
+    return SetBacklightAsync( pRender, pDev, backlight, NULL, NULL );
+}
+
+/*============================================================================*/
+/*  DisplayLineAsync                                                          */
+/*!
+    Display a line of text without waiting for the bus
+
+    The DisplayLineAsync function is the asynchronous form of
+    DisplayLine().  It queues the line to the render thread and returns
+    immediately.  If a completion function is specified, it is called
+    with the result of the operation from RenderDispatch() once the line
+    has been written, or with ECANCELED if the line was replaced by a
+    newer line for the same position before it was written.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[in]
+        pDev
+            pointer to the LCD device to display the line on
+
+    @param[in]
+        offset
+            display data address of the start of the line
+
+    @param[in]
+        line
+            pointer to the line text
+
+    @param[in]
+        done
+            completion function, or NULL
+
+    @param[in]
+        arg
+            argument passed to the completion function
+
+    @retval EOK the line was queued
+    @retval EAGAIN the command ring (or completion queue) is full
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int DisplayLineAsync( LCDRender *pRender,
+                      LCDDev *pDev,
+                      uint8_t offset,
+                      char *line,
+                      LCDCompletionFn done,
+                      void *arg )
+{
+    return DisplayTextAsync( pRender,
+                             pDev,
+                             offset,
+                             line,
+                             0,
+                             LCD_RENDER_LINE_DEADLINE_MS,
+                             done,
+                             arg );
+}
+
+/*============================================================================*/
+/*  DisplayTextAsync                                                          */
+/*!
+    Display a field of text without waiting for the bus
+
+    The DisplayTextAsync function is the asynchronous form of
+    DisplayText().  It is used for text wider than a display line,
+    for example text which is scrolled into view with ShiftDisplayAsync().
+    See DisplayLineAsync() for the completion notification.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[in]
+        pDev
+            pointer to the LCD device to display the text on
+
+    @param[in]
+        offset
+            display data address of the start of the field
+
+    @param[in]
+        text
+            pointer to the text
+
+    @param[in]
+        width
+            width of the field (up to LCD_DDRAM_COLS), or 0 to write
+            a standard display line using DisplayLine()
+
+    @param[in]
+        deadline
+            time (ms) allowed to write the text.  Text with an earlier
+            deadline is written ahead of other text.
+
+    @param[in]
+        done
+            completion function, or NULL
+
+    @param[in]
+        arg
+            argument passed to the completion function
+
+    @retval EOK the text was queued
+    @retval EAGAIN the command ring (or completion queue) is full
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int DisplayTextAsync( LCDRender *pRender,
+                      LCDDev *pDev,
+                      uint8_t offset,
+                      char *text,
+                      int width,
+                      int deadline,
+                      LCDCompletionFn done,
+                      void *arg )
+{
+    int result = EINVAL;
+    LCDCommand cmd;
+
+    if ( ( pRender != NULL ) &&
+         ( pDev != NULL ) &&
+         ( text != NULL ) &&
+         ( width >= 0 ) &&
+         ( width <= LCD_DDRAM_COLS ) )
+    {
+        memset( &cmd, 0, sizeof( cmd ) );
+        cmd.type = LCD_CMD_OP;
+        cmd.op.type = LCD_OP_LINE;
+        cmd.op.pDev = pDev;
+        cmd.op.priority = LCD_PRIO_NORMAL;
+        cmd.op.offset = offset;
+        cmd.op.width = width;
+        strncpy( cmd.op.text, text, sizeof( cmd.op.text ) - 1 );
+        setDeadline( &cmd.op, deadline );
+
+        result = submit( pRender, &cmd, done, arg );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  DisplayFrameAsync                                                         */
+/*!
+    Display several rows of text as one update without waiting for the bus
+
+    The DisplayFrameAsync function is the asynchronous form of
+    DisplayFrame().  The rows are copied when the frame is queued, and
+    are written to the display in one bus transaction.  A pending frame
+    for the same device is replaced by the newer one.  See
+    DisplayLineAsync() for the completion notification.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[in]
+        pDev
+            pointer to the LCD device to display the frame on
+
+    @param[in]
+        col
+            display data RAM column of the start of each row
+
+    @param[in]
+        frame
+            the NUL terminated text of each row
+
+    @param[in]
+        rows
+            number of rows (up to LCD_MAX_ROWS)
+
+    @param[in]
+        width
+            width of each row (up to LCD_DDRAM_COLS)
+
+    @param[in]
+        deadline
+            time (ms) allowed to write the frame
+
+    @param[in]
+        done
+            completion function, or NULL
+
+    @param[in]
+        arg
+            argument passed to the completion function
+
+    @retval EOK the frame was queued
+    @retval EAGAIN the command ring (or completion queue) is full
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int DisplayFrameAsync( LCDRender *pRender,
+                       LCDDev *pDev,
+                       uint8_t col,
+                       char frame[][LCD_DDRAM_COLS + 1],
+                       int rows,
+                       int width,
+                       int deadline,
+                       LCDCompletionFn done,
+                       void *arg )
+{
+    int result = EINVAL;
+    LCDCommand cmd;
+    int row;
+
+    if ( ( pRender != NULL ) &&
+         ( pDev != NULL ) &&
+         ( frame != NULL ) &&
+         ( col < LCD_DDRAM_COLS ) &&
+         ( rows > 0 ) &&
+         ( rows <= LCD_MAX_ROWS ) &&
+         ( width > 0 ) &&
+         ( width <= LCD_DDRAM_COLS ) )
+    {
+        memset( &cmd, 0, sizeof( cmd ) );
+        cmd.type = LCD_CMD_OP;
+        cmd.op.type = LCD_OP_FRAME;
+        cmd.op.pDev = pDev;
+        cmd.op.priority = LCD_PRIO_NORMAL;
+        cmd.op.offset = col;
+        cmd.op.rows = rows;
+        cmd.op.width = width;
+        for ( row = 0; row < rows; row++ )
+        {
+            strncpy( cmd.op.frame[row], frame[row], LCD_DDRAM_COLS );
+        }
+
+        setDeadline( &cmd.op, deadline );
+
+        result = submit( pRender, &cmd, done, arg );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetBacklightAsync                                                         */
+/*!
+    Set the backlight state without waiting for the bus
+
+    The SetBacklightAsync function is the asynchronous form of
+    SetBacklight().  The requested state is recorded in the device
+    immediately (see RequestBacklight()), so the render thread merges
+    it into the next byte it writes to the display, and the queued
+    operation only writes it on its own if no other write has carried
+    it.  Backlight changes are performed ahead of any pending text
+    updates.  See DisplayLineAsync() for the completion notification.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[in]
+        pDev
+            pointer to the LCD device to control
+
+    @param[in]
+        backlight
+            true - turn on the backlight
+            false - turn off the backlight
+
+    @param[in]
+        done
+            completion function, or NULL
+
+    @param[in]
+        arg
+            argument passed to the completion function
+
+    @retval EOK the change was queued
+    @retval EAGAIN the command ring (or completion queue) is full
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int SetBacklightAsync( LCDRender *pRender,
+                       LCDDev *pDev,
+                       bool backlight,
+                       LCDCompletionFn done,
+                       void *arg )
+{
+    int result = EINVAL;
+    LCDCommand cmd;
+
+    if ( ( pRender != NULL ) &&
+         ( pDev != NULL ) )
+    {
+        memset( &cmd, 0, sizeof( cmd ) );
+        cmd.type = LCD_CMD_OP;
+        cmd.op.type = LCD_OP_BACKLIGHT;
+        cmd.op.pDev = pDev;
+        cmd.op.priority = LCD_PRIO_HIGH;
+        cmd.op.backlight = backlight;
+        setDeadline( &cmd.op, 0 );
+
+        RequestBacklight( pDev, backlight );
+        result = submit( pRender, &cmd, done, arg );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ClearDisplayAsync                                                         */
+/*!
+    Clear the display without waiting for the bus
+
+    The ClearDisplayAsync function is the asynchronous form of
+    ClearDisplay().  Line updates queued after the clear are always
+    written after it.  See DisplayLineAsync() for the completion
+    notification.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[in]
+        pDev
+            pointer to the LCD device to clear
+
+    @param[in]
+        done
+            completion function, or NULL
+
+    @param[in]
+        arg
+            argument passed to the completion function
+
+    @retval EOK the clear was queued
+    @retval EAGAIN the command ring (or completion queue) is full
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int ClearDisplayAsync( LCDRender *pRender,
+                       LCDDev *pDev,
+                       LCDCompletionFn done,
+                       void *arg )
+{
+    return queueControl( pRender, pDev, LCD_OP_CLEAR, done, arg );
+}
+
+/*============================================================================*/
+/*  CursorHomeAsync                                                           */
+/*!
+    Move the cursor home without waiting for the bus
+
+    The CursorHomeAsync function is the asynchronous form of
+    CursorHome().  See DisplayLineAsync() for the completion
+    notification.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[in]
+        pDev
+            pointer to the LCD device
+
+    @param[in]
+        done
+            completion function, or NULL
+
+    @param[in]
+        arg
+            argument passed to the completion function
+
+    @retval EOK the operation was queued
+    @retval EAGAIN the command ring (or completion queue) is full
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int CursorHomeAsync( LCDRender *pRender,
+                     LCDDev *pDev,
+                     LCDCompletionFn done,
+                     void *arg )
+{
+    return queueControl( pRender, pDev, LCD_OP_HOME, done, arg );
+}
+
+/*============================================================================*/
+/*  ShiftDisplayAsync                                                         */
+/*!
+    Shift the display window without waiting for the bus
+
+    The ShiftDisplayAsync function is the asynchronous form of
+    ShiftDisplay().  Like a clear, a shift is never reordered with the
+    line updates queued around it.  See DisplayLineAsync() for the
+    completion notification.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[in]
+        pDev
+            pointer to the LCD device
+
+    @param[in]
+        left
+            true to shift the display contents to the left, false
+            to shift them to the right
+
+    @param[in]
+        done
+            completion function, or NULL
+
+    @param[in]
+        arg
+            argument passed to the completion function
+
+    @retval EOK the shift was queued
+    @retval EAGAIN the command ring (or completion queue) is full
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int ShiftDisplayAsync( LCDRender *pRender,
+                       LCDDev *pDev,
+                       bool left,
+                       LCDCompletionFn done,
+                       void *arg )
+{
+    int result = EINVAL;
+    LCDCommand cmd;
+
+    if ( ( pRender != NULL ) &&
+         ( pDev != NULL ) )
+    {
+        memset( &cmd, 0, sizeof( cmd ) );
+        cmd.type = LCD_CMD_OP;
+        cmd.op.type = LCD_OP_SHIFT;
+        cmd.op.pDev = pDev;
+        cmd.op.priority = LCD_PRIO_NORMAL;
+        cmd.op.left = left;
+        setDeadline( &cmd.op, LCD_RENDER_LINE_DEADLINE_MS );
+
+        result = submit( pRender, &cmd, done, arg );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetDisplayOriginAsync                                                     */
+/*!
+    Shift the display to show a column without waiting for the bus
+
+    The SetDisplayOriginAsync function is the asynchronous form of
+    SetDisplayOrigin().  Like a shift, it is never reordered with the
+    line updates queued around it, so text queued before it is written
+    before it comes into view.  See DisplayLineAsync() for the
+    completion notification.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[in]
+        pDev
+            pointer to the LCD device
+
+    @param[in]
+        col
+            display data RAM column to show at the left of the display
+
+    @param[in]
+        done
+            completion function, or NULL
+
+    @param[in]
+        arg
+            argument passed to the completion function
+
+    @retval EOK the operation was queued
+    @retval EAGAIN the command ring (or completion queue) is full
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int SetDisplayOriginAsync( LCDRender *pRender,
+                           LCDDev *pDev,
+                           uint8_t col,
+                           LCDCompletionFn done,
+                           void *arg )
+{
+    int result = EINVAL;
+    LCDCommand cmd;
+
+    if ( ( pRender != NULL ) &&
+         ( pDev != NULL ) &&
+         ( col < LCD_DDRAM_COLS ) )
+    {
+        memset( &cmd, 0, sizeof( cmd ) );
+        cmd.type = LCD_CMD_OP;
+        cmd.op.type = LCD_OP_ORIGIN;
+        cmd.op.pDev = pDev;
+        cmd.op.priority = LCD_PRIO_NORMAL;
+        cmd.op.offset = col;
+        setDeadline( &cmd.op, LCD_RENDER_LINE_DEADLINE_MS );
+
+        result = submit( pRender, &cmd, done, arg );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RenderGetEventFd                                                          */
+/*!
+    Get the completion event file descriptor
+
+    The RenderGetEventFd function gets an eventfd which becomes readable
+    when asynchronous operations have completed.  It can be added to the
+    caller's poll/epoll/select loop, and RenderDispatch() called when it
+    is readable.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @retval the completion eventfd
+    @retval -1 invalid arguments
+
+==============================================================================*/
+int RenderGetEventFd( LCDRender *pRender )
+{
+    return ( pRender != NULL ) ? pRender->efd : -1;
+}
+
+/*============================================================================*/
+/*  RenderDispatch                                                            */
+/*!
+    Deliver the completion notifications
+
+    The RenderDispatch function calls the completion function of each
+    asynchronous operation which has completed since the last call.
+    The completion functions are called on the calling thread, which
+    must be the thread which submits the operations.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @retval number of completion functions called
+    @retval -1 invalid arguments
+
+==============================================================================*/
+int RenderDispatch( LCDRender *pRender )
+{
+    int result = -1;
+    LCDCompletion done;
+    uint64_t count;
+    unsigned int head;
+    unsigned int tail;
+
+    if ( pRender != NULL )
+    {
+        result = 0;
+
+        /* reset the event counter before draining the queue */
+        if ( read( pRender->efd, &count, sizeof( count ) ) < 0 )
+        {
+            /* nothing signalled, but check the queue anyway */
+        }
+
+        tail = atomic_load_explicit( &pRender->doneTail, memory_order_relaxed );
+        head = atomic_load_explicit( &pRender->doneHead, memory_order_acquire );
+
+        while ( tail != head )
+        {
+            done = pRender->done[tail & LCD_RENDER_DONE_MASK];
+            tail++;
+            atomic_store_explicit( &pRender->doneTail,
+                                   tail,
+                                   memory_order_release );
+
+            pRender->outstanding--;
+            done.fn( done.arg, done.result );
+            result++;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RenderGetStats                                                            */
+/*!
+    Get the bus scheduler statistics
+
+    The RenderGetStats function gets a snapshot of the statistics of
+    the bus scheduler used by the render thread.  The statistics are
+    updated by the render thread, so the snapshot may be slightly stale.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[out]
+        pStats
+            pointer to the location to store the statistics
+
+    @retval EOK the statistics were retrieved
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int RenderGetStats( LCDRender *pRender, LCDSchedStats *pStats )
+{
+    int result = EINVAL;
+
+    if ( pRender != NULL )
+    {
+        result = SchedGetStats( pRender->pSched, pStats );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  renderThread                                                              */
+/*!
+    Render thread main loop
+
+    The renderThread function moves commands from the command ring into
+    the bus scheduler and performs the scheduled operations until it
+    receives a stop command.  While there is nothing to do, the I2C bus
+    connection is closed once it has been idle for longer than the bus
+    idle timeout.
+
+    @param[in]
+        arg
+            pointer to the render object
+
+    @retval NULL
+
+==============================================================================*/
+static void *renderThread( void *arg )
+{
+    LCDRender *pRender = (LCDRender *)arg;
+    bool running = true;
+    int next = -1;
+    int timeout;
+    int rc;
+
+    while ( running == true )
+    {
+        /* lazily close the bus connection if it has been idle */
+        BusCheckIdle( pRender->pBus, &timeout );
+
+        /* wake up when the next waiting panel becomes ready */
+        if ( ( next >= 0 ) && ( ( timeout < 0 ) || ( next < timeout ) ) )
+        {
+            timeout = next;
+        }
+
+        rc = waitCommand( pRender, timeout );
+        if ( ( rc != EOK ) && ( next < 0 ) )
+        {
+            continue;
+        }
+
+        /* perform everything which can be performed as one bus batch */
+        BusBeginBatch( pRender->pBus );
+
+        running = drain( pRender );
+        SchedRun( pRender->pSched, &next );
+
+        BusEndBatch( pRender->pBus );
+    }
+
+    finish( pRender );
+
+    return NULL;
+}
+
+/*============================================================================*/
+/*  drain                                                                     */
+/*!
+    Move commands from the command ring to the scheduler
+
+    The drain function moves commands from the command ring into the
+    bus scheduler while the scheduler has room for them.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @retval true the render thread should keep running
+    @retval false a stop command was received
+
+==============================================================================*/
+static bool drain( LCDRender *pRender )
+{
+    bool running = true;
+    LCDCommand cmd;
+
+    while ( ( running == true ) &&
+            ( SchedFull( pRender->pSched ) == false ) &&
+            ( pop( pRender, &cmd ) == true ) )
+    {
+        if ( cmd.type == LCD_CMD_STOP )
+        {
+            running = false;
+        }
+        else if ( cmd.type == LCD_CMD_OP )
+        {
+            SchedSubmit( pRender->pSched, &cmd.op );
+        }
+    }
+
+    return running;
+}
+
+/*============================================================================*/
+/*  finish                                                                    */
+/*!
+    Perform the remaining scheduled operations
+
+    The finish function is called when the render thread is stopping,
+    to perform all of the operations which are still scheduled.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+==============================================================================*/
+static void finish( LCDRender *pRender )
+{
+    int next = 0;
+
+    while ( next >= 0 )
+    {
+        BusBeginBatch( pRender->pBus );
+        SchedRun( pRender->pSched, &next );
+        BusEndBatch( pRender->pBus );
+
+        if ( next > 0 )
+        {
+            usleep( next * 1000 );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  setDeadline                                                               */
+/*!
+    Set the deadline of an operation
+
+    @param[in]
+        pOp
+            pointer to the operation
+
+    @param[in]
+        ms
+            number of milliseconds from now
+
+==============================================================================*/
+static void setDeadline( LCDOp *pOp, int ms )
+{
+    clock_gettime( CLOCK_MONOTONIC, &pOp->deadline );
+    pOp->deadline.tv_sec += ms / 1000;
+    pOp->deadline.tv_nsec += ( ms % 1000 ) * 1000000L;
+    if ( pOp->deadline.tv_nsec >= 1000000000L )
+    {
+        pOp->deadline.tv_sec++;
+        pOp->deadline.tv_nsec -= 1000000000L;
+    }
+}
+
+/*============================================================================*/
+/*  submit                                                                    */
+/*!
+    Submit an operation command to the render thread
+
+    The submit function attaches the completion function to an operation
+    command and pushes it into the command ring.  Operations with a
+    completion function are only accepted while there is room in the
+    completion queue for their notification.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[in]
+        pCmd
+            pointer to the command to submit
+
+    @param[in]
+        done
+            completion function, or NULL
+
+    @param[in]
+        arg
+            argument passed to the completion function
+
+    @retval EOK the command was submitted
+    @retval EAGAIN the command ring or completion queue is full
+
+==============================================================================*/
+static int submit( LCDRender *pRender,
+                   LCDCommand *pCmd,
+                   LCDCompletionFn done,
+                   void *arg )
+{
+    int result = EAGAIN;
+
+    pCmd->op.done = done;
+    pCmd->op.arg = arg;
+
+    if ( ( done == NULL ) ||
+         ( pRender->outstanding < LCD_RENDER_DONE_SIZE ) )
+    {
+        result = push( pRender, pCmd );
+        if ( ( result == EOK ) && ( done != NULL ) )
+        {
+            pRender->outstanding++;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  queueControl                                                              */
+/*!
+    Queue a whole display control operation
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[in]
+        pDev
+            pointer to the LCD device
+
+    @param[in]
+        type
+            LCD_OP_CLEAR or LCD_OP_HOME
+
+    @param[in]
+        done
+            completion function, or NULL
+
+    @param[in]
+        arg
+            argument passed to the completion function
+
+    @retval EOK the operation was queued
+    @retval EAGAIN the command ring or completion queue is full
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int queueControl( LCDRender *pRender,
+                         LCDDev *pDev,
+                         LCDOpType type,
+                         LCDCompletionFn done,
+                         void *arg )
+{
+    int result = EINVAL;
+    LCDCommand cmd;
+
+    if ( ( pRender != NULL ) &&
+         ( pDev != NULL ) )
+    {
+        memset( &cmd, 0, sizeof( cmd ) );
+        cmd.type = LCD_CMD_OP;
+        cmd.op.type = type;
+        cmd.op.pDev = pDev;
+        cmd.op.priority = LCD_PRIO_NORMAL;
+        setDeadline( &cmd.op, LCD_RENDER_LINE_DEADLINE_MS );
+
+        result = submit( pRender, &cmd, done, arg );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  notify                                                                    */
+/*!
+    Queue the completion of an asynchronous operation
+
+    The notify function is called by the scheduler on the render thread
+    when an operation with a completion function has completed.  It
+    queues the completion for RenderDispatch() and signals the eventfd.
+    The completion queue cannot overflow, since submit() limits the
+    number of outstanding operations to its size.
+
+    @param[in]
+        ctx
+            pointer to the render object
+
+    @param[in]
+        pOp
+            pointer to the completed operation
+
+    @param[in]
+        result
+            result of the operation
+
+==============================================================================*/
+static void notify( void *ctx, LCDOp *pOp, int result )
+{
+    LCDRender *pRender = (LCDRender *)ctx;
+    LCDCompletion *pDone;
+    uint64_t one = 1;
+    unsigned int head;
+
+    head = atomic_load_explicit( &pRender->doneHead, memory_order_relaxed );
+
+    pDone = &pRender->done[head & LCD_RENDER_DONE_MASK];
+    pDone->fn = pOp->done;
+    pDone->arg = pOp->arg;
+    pDone->result = result;
+
+    atomic_store_explicit( &pRender->doneHead, head + 1, memory_order_release );
+
+    if ( write( pRender->efd, &one, sizeof( one ) ) < 0 )
+    {
+        /* the counter is already signalled */
+    }
+}
+
+/*============================================================================*/
+/*  waitCommand                                                               */
+/*!
+    Wait for a command to be available in the command ring
+
+    The timeout is measured on CLOCK_MONOTONIC, like the scheduler ready
+    delays and the bus idle timeout it is derived from, so stepping the
+    wall clock does not stretch or shorten the wait.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[in]
+        timeout
+            maximum time to wait (ms), or -1 to wait forever
+
+    @retval EOK a command is available
+    @retval ETIMEDOUT the timeout expired
+    @retval EINTR the wait was interrupted
+
+==============================================================================*/
+static int waitCommand( LCDRender *pRender, int timeout )
+{
+    struct timespec ts;
+    int rc;
+
+    if ( timeout < 0 )
+    {
+        rc = sem_wait( &pRender->sem );
+    }
+    else
+    {
+        clock_gettime( CLOCK_MONOTONIC, &ts );
+        ts.tv_sec += timeout / 1000;
+        ts.tv_nsec += ( timeout % 1000 ) * 1000000L;
+        if ( ts.tv_nsec >= 1000000000L )
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+
+        rc = sem_clockwait( &pRender->sem, CLOCK_MONOTONIC, &ts );
+    }
+
+    return ( rc == 0 ) ? EOK : errno;
+}
+
+/*============================================================================*/
+/*  push                                                                      */
+/*!
+    Push a command into the command ring
+
+    The push function is called by the producer thread to add a command
+    to the command ring and wake up the render thread.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[in]
+        pCmd
+            pointer to the command to push
+
+    @retval EOK the command was pushed
+    @retval EAGAIN the command ring is full
+
+==============================================================================*/
+static int push( LCDRender *pRender, LCDCommand *pCmd )
+{
+    int result = EAGAIN;
+    unsigned int head;
+    unsigned int tail;
+
+    head = atomic_load_explicit( &pRender->head, memory_order_relaxed );
+    tail = atomic_load_explicit( &pRender->tail, memory_order_acquire );
+
+    if ( ( head - tail ) < LCD_RENDER_RING_SIZE )
+    {
+        pRender->ring[head & LCD_RENDER_RING_MASK] = *pCmd;
+        atomic_store_explicit( &pRender->head, head + 1, memory_order_release );
+        sem_post( &pRender->sem );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  pop                                                                       */
+/*!
+    Pop a command from the command ring
+
+    The pop function is called by the render thread to remove the
+    oldest command from the command ring.
+
+    @param[in]
+        pRender
+            pointer to the render object
+
+    @param[out]
+        pCmd
+            pointer to the location to store the command
+
+    @retval true a command was removed
+    @retval false the command ring is empty
+
+==============================================================================*/
+static bool pop( LCDRender *pRender, LCDCommand *pCmd )
+{
+    bool result = false;
+    unsigned int head;
+    unsigned int tail;
+
+    tail = atomic_load_explicit( &pRender->tail, memory_order_relaxed );
+    head = atomic_load_explicit( &pRender->head, memory_order_acquire );
+
+    if ( tail != head )
+    {
+        *pCmd = pRender->ring[tail & LCD_RENDER_RING_MASK];
+        atomic_store_explicit( &pRender->tail, tail + 1, memory_order_release );
+        result = true;
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of lcdrender group */
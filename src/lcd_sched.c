@@ -0,0 +1,958 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup lcdsched lcdsched
+ * @brief I2C bus operation scheduler
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file lcd_sched.c
+
+    I2C bus operation scheduler
+
+    The lcd_sched module sits between the high level display functions
+    in lcd_ctrl and the low level I/O in lcd_io.  It holds the pending
+    operations for all of the LCD devices on one I2C bus, and decides
+    which operation to perform next.
+
+    Operations are performed in priority order, and in deadline order
+    within a priority.  Operations for the same device at the same (or
+    a higher) priority are always performed in the order they were
+    submitted.
+
+    A device which is still executing a long instruction in timed mode
+    (see GetReadyDelay()) is skipped, so other devices can use the bus
+    while it completes.
+
+    A pending line, frame or backlight operation is replaced by a newer one
+    for the same target, so only the latest value is ever written.
+
+    Operations which have a completion function are reported to the
+    scheduler's notification function once they have been performed,
+    or with ECANCELED if they were replaced by a newer operation.
+
+    The scheduler also measures how much of the time it was busy
+    performing operations.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "lcd_bus.h"
+#include "lcd_io.h"
+#include "lcd_ctrl.h"
+#include "lcd_sched.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+#define EOK 0
+#endif
+
+/*! maximum number of pending operations */
+#define LCD_SCHED_MAX_OPS   ( 64 )
+
+/*! interval (ms) over which the bus utilisation is measured */
+#define LCD_SCHED_STATS_INTERVAL_MS ( 1000 )
+
+/*==============================================================================
+        Data Types
+==============================================================================*/
+
+/*! a pending operation slot */
+typedef struct _LCDSchedEntry
+{
+    /*! slot contains a pending operation */
+    bool inUse;
+
+    /*! submission sequence number */
+    uint32_t seq;
+
+    /*! the operation */
+    LCDOp op;
+
+} LCDSchedEntry;
+
+/*! The LCDSched type holds the pending operations for one I2C bus */
+struct _LCDSched
+{
+    /*! the bus the operations are performed on */
+    LCDBus *pBus;
+
+    /*! operation completion notification function */
+    LCDSchedNotifyFn notify;
+
+    /*! context passed to the notification function */
+    void *ctx;
+
+    /*! next submission sequence number */
+    uint32_t seq;
+
+    /*! number of pending operations */
+    int pending;
+
+    /*! pending operations */
+    LCDSchedEntry entries[LCD_SCHED_MAX_OPS];
+
+    /*! scheduler statistics */
+    LCDSchedStats stats;
+
+    /*! start of the current utilisation interval */
+    struct timespec intervalStart;
+
+    /*! time (us) spent performing operations in the current interval */
+    long busy_us;
+};
+
+/*==============================================================================
+        Private Function Declarations
+==============================================================================*/
+
+static bool isBarrier( LCDOp *pOp );
+static bool sameTarget( LCDOp *pA, LCDOp *pB );
+static bool overlap( LCDOp *pA, LCDOp *pB );
+static int lineEnd( LCDOp *pOp );
+static bool eligible( LCDSched *pSched, LCDSchedEntry *pEntry );
+static bool before( LCDSchedEntry *pA, LCDSchedEntry *pB );
+static LCDSchedEntry *selectNext( LCDSched *pSched, int *next );
+static int perform( LCDOp *pOp );
+static int recover( LCDSched *pSched, LCDOp *pOp, int result );
+static void complete( LCDSched *pSched, LCDOp *pOp, int result );
+static long diff_us( struct timespec *a, struct timespec *b );
+static void updateUtilisation( LCDSched *pSched, struct timespec *now );
+
+/*==============================================================================
+        Function Definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  SchedInit                                                                 */
+/*!
+    Initialize a bus scheduler
+
+    The SchedInit function creates a scheduler for the operations on
+    the LCD devices attached to the specified I2C bus.
+
+    @param[in]
+        pBus
+            pointer to the I2C bus
+
+    @param[in]
+        notify
+            function to notify of completed operations, or NULL
+
+    @param[in]
+        ctx
+            context passed to the notification function
+
+    @retval pointer to the new LCDSched object
+    @retval NULL if the scheduler could not be created
+
+==============================================================================*/
+LCDSched *SchedInit( LCDBus *pBus, LCDSchedNotifyFn notify, void *ctx )
+{
+    LCDSched *pSched = NULL;
+
+    if ( pBus != NULL )
+    {
+        pSched = calloc( 1, sizeof( LCDSched ) );
+        if ( pSched != NULL )
+        {
+            pSched->pBus = pBus;
+            pSched->notify = notify;
+            pSched->ctx = ctx;
+            clock_gettime( CLOCK_MONOTONIC, &pSched->intervalStart );
+        }
+    }
+
+    return pSched;
+}
+
+/*============================================================================*/
+/*  SchedDelete                                                               */
+/*!
+    Delete a bus scheduler
+
+    The SchedDelete function frees the scheduler.  Any pending
+    operations are discarded without being reported.
+
+    @param[in]
+        pSched
+            pointer to the scheduler
+
+    @retval EOK the scheduler was deleted
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int SchedDelete( LCDSched *pSched )
+{
+    int result = EINVAL;
+
+    if ( pSched != NULL )
+    {
+        free( pSched );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SchedSubmit                                                               */
+/*!
+    Submit an operation to the scheduler
+
+    The SchedSubmit function adds an operation to the set of pending
+    operations.  If a line or backlight operation for the same target is
+    already pending (for a line, one which the new operation covers), and no clear or home operation for the device was
+    submitted after it, the pending operation is updated with the new
+    content instead.  It keeps its place in the schedule, and the earlier
+    of the two deadlines.  The completion of the replaced operation is
+    reported as ECANCELED.
+
+    @param[in]
+        pSched
+            pointer to the scheduler
+
+    @param[in]
+        pOp
+            pointer to the operation to submit.  The operation is copied.
+
+    @retval EOK the operation was submitted
+    @retval EAGAIN there is no room for the operation
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int SchedSubmit( LCDSched *pSched, LCDOp *pOp )
+{
+    int result = EINVAL;
+    LCDSchedEntry *pMatch = NULL;
+    LCDSchedEntry *pFree = NULL;
+    LCDSchedEntry *pEntry;
+    struct timespec deadline;
+    LCDPriority priority;
+    int i;
+
+    if ( ( pSched != NULL ) &&
+         ( pOp != NULL ) &&
+         ( pOp->pDev != NULL ) &&
+         ( pOp->priority < LCD_PRIO_LEVELS ) )
+    {
+        for ( i = 0; i < LCD_SCHED_MAX_OPS; i++ )
+        {
+            pEntry = &pSched->entries[i];
+            if ( pEntry->inUse == false )
+            {
+                pFree = ( pFree == NULL ) ? pEntry : pFree;
+            }
+            else if ( ( isBarrier( pOp ) == false ) &&
+                      ( sameTarget( &pEntry->op, pOp ) ) &&
+                      ( ( pMatch == NULL ) ||
+                        ( pEntry->seq > pMatch->seq ) ) )
+            {
+                /* a narrower update may be pending after a wider one
+                   at the same address, so replace the newest */
+                pMatch = pEntry;
+            }
+        }
+
+        /* nothing submitted before a clear or home can be replaced,
+           and neither can anything submitted before another update
+           of some of the same characters */
+        for ( i = 0; ( pMatch != NULL ) && ( i < LCD_SCHED_MAX_OPS ); i++ )
+        {
+            pEntry = &pSched->entries[i];
+            if ( ( pEntry->inUse == true ) &&
+                 ( pEntry->op.pDev == pOp->pDev ) &&
+                 ( ( isBarrier( &pEntry->op ) ) ||
+                   ( overlap( &pEntry->op, pOp ) ) ) &&
+                 ( pEntry->seq > pMatch->seq ) )
+            {
+                pMatch = NULL;
+            }
+        }
+
+        if ( pMatch != NULL )
+        {
+            /* replace the pending operation with the newer content */
+            complete( pSched, &pMatch->op, ECANCELED );
+
+            deadline = pMatch->op.deadline;
+            priority = pMatch->op.priority;
+            pMatch->op = *pOp;
+            if ( diff_us( &deadline, &pOp->deadline ) < 0 )
+            {
+                pMatch->op.deadline = deadline;
+            }
+
+            if ( priority < pOp->priority )
+            {
+                pMatch->op.priority = priority;
+            }
+
+            pSched->stats.superseded++;
+            result = EOK;
+        }
+        else if ( pFree != NULL )
+        {
+            pFree->op = *pOp;
+            pFree->seq = pSched->seq++;
+            pFree->inUse = true;
+            pSched->pending++;
+            result = EOK;
+        }
+        else
+        {
+            result = EAGAIN;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SchedRun                                                                  */
+/*!
+    Perform the pending operations
+
+    The SchedRun function performs all of the pending operations which
+    can be performed now, in schedule order.  Operations for devices
+    which are still executing a long instruction are left pending.
+    A device which may have lost nibble sync during a failed operation
+    is resynchronized before the next operation is performed.
+
+    @param[in]
+        pSched
+            pointer to the scheduler
+
+    @param[out]
+        next
+            pointer to the location to store the time (ms) until SchedRun
+            should be called again, or -1 if there are no pending
+            operations.  May be NULL.
+
+    @retval EOK the operations were performed
+    @retval EINVAL invalid arguments
+    @retval other error from the last failed operation
+
+==============================================================================*/
+int SchedRun( LCDSched *pSched, int *next )
+{
+    int result = EINVAL;
+    LCDSchedEntry *pEntry;
+    struct timespec start;
+    struct timespec end;
+    int wait = -1;
+    int rc;
+
+    if ( pSched != NULL )
+    {
+        result = EOK;
+
+        while ( ( pEntry = selectNext( pSched, &wait ) ) != NULL )
+        {
+            clock_gettime( CLOCK_MONOTONIC, &start );
+            if ( diff_us( &start, &pEntry->op.deadline ) > 0 )
+            {
+                pSched->stats.late++;
+            }
+
+            rc = perform( &pEntry->op );
+            if ( rc != EOK )
+            {
+                rc = recover( pSched, &pEntry->op, rc );
+            }
+
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+
+            complete( pSched, &pEntry->op, rc );
+
+            pEntry->inUse = false;
+            pSched->pending--;
+            pSched->stats.ops++;
+
+            clock_gettime( CLOCK_MONOTONIC, &end );
+            pSched->busy_us += diff_us( &end, &start );
+            updateUtilisation( pSched, &end );
+        }
+
+        pSched->stats.pending = pSched->pending;
+
+        if ( next != NULL )
+        {
+            /* round the wait up to the next millisecond */
+            *next = ( wait < 0 ) ? -1 : ( wait + 999 ) / 1000;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SchedFull                                                                 */
+/*!
+    Check if the scheduler can accept more operations
+
+    @param[in]
+        pSched
+            pointer to the scheduler
+
+    @retval true there is no room for another operation
+    @retval false another operation can be submitted
+
+==============================================================================*/
+bool SchedFull( LCDSched *pSched )
+{
+    return ( ( pSched == NULL ) ||
+             ( pSched->pending >= LCD_SCHED_MAX_OPS ) ) ? true : false;
+}
+
+/*============================================================================*/
+/*  SchedGetStats                                                             */
+/*!
+    Get the scheduler statistics
+
+    The SchedGetStats function gets a snapshot of the scheduler statistics,
+    including how busy the bus has been.
+
+    @param[in]
+        pSched
+            pointer to the scheduler
+
+    @param[out]
+        pStats
+            pointer to the location to store the statistics
+
+    @retval EOK the statistics were retrieved
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int SchedGetStats( LCDSched *pSched, LCDSchedStats *pStats )
+{
+    int result = EINVAL;
+
+    if ( ( pSched != NULL ) &&
+         ( pStats != NULL ) )
+    {
+        *pStats = pSched->stats;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  selectNext                                                                */
+/*!
+    Select the next operation to perform
+
+    The selectNext function selects the eligible pending operation which
+    should be performed first, skipping operations for devices which are
+    not ready.
+
+    @param[in]
+        pSched
+            pointer to the scheduler
+
+    @param[in,out]
+        next
+            pointer to the location to store the shortest time (us) until
+            a device with pending operations becomes ready, or -1 if
+            there are no operations waiting for a device
+
+    @retval pointer to the selected entry
+    @retval NULL no operation can be performed now
+
+==============================================================================*/
+static LCDSchedEntry *selectNext( LCDSched *pSched, int *next )
+{
+    LCDSchedEntry *pBest = NULL;
+    LCDSchedEntry *pEntry;
+    int delay;
+    int i;
+
+    *next = -1;
+
+    for ( i = 0; i < LCD_SCHED_MAX_OPS; i++ )
+    {
+        pEntry = &pSched->entries[i];
+        if ( ( pEntry->inUse == false ) ||
+             ( eligible( pSched, pEntry ) == false ) )
+        {
+            continue;
+        }
+
+        delay = 0;
+        if ( pEntry->op.type != LCD_OP_BACKLIGHT )
+        {
+            /* backlight changes do not need the controller to be ready */
+            GetReadyDelay( pEntry->op.pDev, &delay );
+        }
+
+        if ( delay > 0 )
+        {
+            if ( ( *next < 0 ) || ( delay < *next ) )
+            {
+                *next = delay;
+            }
+        }
+        else if ( ( pBest == NULL ) || before( pEntry, pBest ) )
+        {
+            pBest = pEntry;
+        }
+    }
+
+    return pBest;
+}
+
+/*============================================================================*/
+/*  eligible                                                                  */
+/*!
+    Check if an operation may be performed before the other pending ones
+
+    An operation is not eligible if an operation for the same device
+    with the same or a higher priority was submitted before it.
+
+    @param[in]
+        pSched
+            pointer to the scheduler
+
+    @param[in]
+        pEntry
+            pointer to the entry to check
+
+    @retval true the operation is eligible
+    @retval false the operation must wait for an earlier operation
+
+==============================================================================*/
+static bool eligible( LCDSched *pSched, LCDSchedEntry *pEntry )
+{
+    LCDSchedEntry *pOther;
+    int i;
+
+    for ( i = 0; i < LCD_SCHED_MAX_OPS; i++ )
+    {
+        pOther = &pSched->entries[i];
+        if ( ( pOther->inUse == true ) &&
+             ( pOther != pEntry ) &&
+             ( pOther->op.pDev == pEntry->op.pDev ) &&
+             ( pOther->seq < pEntry->seq ) &&
+             ( pOther->op.priority <= pEntry->op.priority ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*============================================================================*/
+/*  before                                                                    */
+/*!
+    Compare the schedule order of two operations
+
+    @param[in]
+        pA
+            pointer to the first entry
+
+    @param[in]
+        pB
+            pointer to the second entry
+
+    @retval true the first operation should be performed first
+    @retval false the second operation should be performed first
+
+==============================================================================*/
+static bool before( LCDSchedEntry *pA, LCDSchedEntry *pB )
+{
+    long d;
+
+    if ( pA->op.priority != pB->op.priority )
+    {
+        return ( pA->op.priority < pB->op.priority );
+    }
+
+    d = diff_us( &pA->op.deadline, &pB->op.deadline );
+    if ( d != 0 )
+    {
+        return ( d < 0 );
+    }
+
+    return ( pA->seq < pB->seq );
+}
+
+/*============================================================================*/
+/*  isBarrier                                                                 */
+/*!
+    Check if an operation affects the whole display
+
+    Operations which affect the whole display (clear, home, shift, origin)
+    must not be reordered with respect to the other operations on the
+    device.
+
+    @param[in]
+        pOp
+            pointer to the operation
+
+    @retval true the operation affects the whole display
+    @retval false the operation only affects its own target
+
+==============================================================================*/
+static bool isBarrier( LCDOp *pOp )
+{
+    return ( ( pOp->type != LCD_OP_LINE ) &&
+             ( pOp->type != LCD_OP_FRAME ) &&
+             ( pOp->type != LCD_OP_BACKLIGHT ) ) ? true : false;
+}
+
+/*============================================================================*/
+/*  sameTarget                                                                */
+/*!
+    Check if two operations update the same target
+
+    Line updates have the same target if they start at the same display
+    data address, and the newer one writes at least as many characters
+    as the older one.  A narrower update only writes part of the older
+    one's span, so it must be performed after it instead.
+
+    @param[in]
+        pA
+            pointer to the first (older) operation
+
+    @param[in]
+        pB
+            pointer to the second (newer) operation
+
+    @retval true a newer pB replaces pA
+    @retval false the operations update different targets
+
+==============================================================================*/
+static bool sameTarget( LCDOp *pA, LCDOp *pB )
+{
+    return ( ( pA->pDev == pB->pDev ) &&
+             ( pA->type == pB->type ) &&
+             ( ( pA->type != LCD_OP_LINE ) ||
+               ( ( pA->offset == pB->offset ) &&
+                 ( lineEnd( pB ) >= lineEnd( pA ) ) ) ) ) ? true : false;
+}
+
+/*============================================================================*/
+/*  overlap                                                                   */
+/*!
+    Check if two operations with different targets update the same cells
+
+    A frame update writes every row of the display, so it overlaps
+    with any line update on the same device.  Line updates with
+    different start addresses overlap if any of their characters are
+    at the same display data addresses, for example a field which is
+    part of a row.
+
+    @param[in]
+        pA
+            pointer to the first operation
+
+    @param[in]
+        pB
+            pointer to the second operation
+
+    @retval true the operations write some of the same characters
+    @retval false the operations are independent (or have the same target)
+
+==============================================================================*/
+static bool overlap( LCDOp *pA, LCDOp *pB )
+{
+    bool result = false;
+
+    if ( ( pA->pDev == pB->pDev ) &&
+         ( sameTarget( pA, pB ) == false ) )
+    {
+        if ( ( pA->type == LCD_OP_LINE ) && ( pB->type == LCD_OP_LINE ) )
+        {
+            result = ( ( pA->offset < lineEnd( pB ) ) &&
+                       ( pB->offset < lineEnd( pA ) ) ) ? true : false;
+        }
+        else
+        {
+            result = ( ( ( pA->type == LCD_OP_FRAME ) &&
+                         ( pB->type == LCD_OP_LINE ) ) ||
+                       ( ( pA->type == LCD_OP_LINE ) &&
+                         ( pB->type == LCD_OP_FRAME ) ) ) ? true : false;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  lineEnd                                                                   */
+/*!
+    Get the display data address after the end of a line operation
+
+    @param[in]
+        pOp
+            pointer to the LCD_OP_LINE operation
+
+    @retval display data address after the last character written.  A
+            standard display line (width 0) is one display row wide, or
+            extends to the end of the display data RAM row if the device
+            geometry is not known.
+
+==============================================================================*/
+static int lineEnd( LCDOp *pOp )
+{
+    const LCDGeometry *pGeometry;
+    int end;
+
+    if ( pOp->width > 0 )
+    {
+        end = pOp->offset + pOp->width;
+    }
+    else if ( GetGeometry( pOp->pDev, &pGeometry ) == EOK )
+    {
+        end = pOp->offset + pGeometry->cols;
+    }
+    else
+    {
+        end = ( pOp->offset & 0x40 ) + LCD_DDRAM_COLS;
+    }
+
+    return end;
+}
+
+/*============================================================================*/
+/*  perform                                                                   */
+/*!
+    Perform an operation
+
+    @param[in]
+        pOp
+            pointer to the operation to perform
+
+    @retval EOK the operation was successful
+    @retval ENOTSUP the operation type is not supported
+    @retval other error from the lcd_ctrl or lcd_io function
+
+==============================================================================*/
+static int perform( LCDOp *pOp )
+{
+    int result = ENOTSUP;
+
+    switch( pOp->type )
+    {
+        case LCD_OP_LINE:
+            result = ( pOp->width > 0 )
+                   ? DisplayText( pOp->pDev,
+                                  pOp->offset,
+                                  pOp->text,
+                                  pOp->width )
+                   : DisplayLine( pOp->pDev, pOp->offset, pOp->text );
+            break;
+
+        case LCD_OP_BACKLIGHT:
+            /* the requested state was recorded when the operation was
+               queued, and may already have been merged into a write */
+            result = SyncBacklight( pOp->pDev );
+            break;
+
+        case LCD_OP_CLEAR:
+            result = ClearDisplay( pOp->pDev );
+            break;
+
+        case LCD_OP_HOME:
+            result = CursorHome( pOp->pDev );
+            break;
+
+        case LCD_OP_SHIFT:
+            result = ShiftDisplay( pOp->pDev, pOp->left );
+            break;
+
+        case LCD_OP_FRAME:
+            result = DisplayFrame( pOp->pDev,
+                                   pOp->offset,
+                                   pOp->frame,
+                                   pOp->rows,
+                                   pOp->width );
+            break;
+
+        case LCD_OP_ORIGIN:
+            result = SetDisplayOrigin( pOp->pDev, pOp->offset );
+            break;
+
+        default:
+            break;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  recover                                                                   */
+/*!
+    Recover from a failed operation
+
+    If the operation failed in a way which may have left the device
+    out of nibble sync (see GetSyncLost()), the device is resynchronized
+    and its shadow state replayed (see LCDResync()).  The shadow state
+    includes the changes made by the failed operation, so if the resync
+    succeeds the operation has been completed.
+
+    @param[in]
+        pSched
+            pointer to the scheduler
+
+    @param[in]
+        pOp
+            pointer to the failed operation
+
+    @param[in]
+        result
+            result of the failed operation
+
+    @retval EOK the device was recovered and the operation completed
+    @retval other the result of the failed operation
+
+==============================================================================*/
+static int recover( LCDSched *pSched, LCDOp *pOp, int result )
+{
+    bool lost = false;
+
+    GetSyncLost( pOp->pDev, &lost );
+    if ( lost == true )
+    {
+        if ( LCDResync( pOp->pDev ) == EOK )
+        {
+            pSched->stats.resyncs++;
+            result = EOK;
+        }
+        else
+        {
+            pSched->stats.resyncFailures++;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  complete                                                                  */
+/*!
+    Report the completion of an operation
+
+    The complete function passes an operation which has a completion
+    function to the scheduler's notification function.
+
+    @param[in]
+        pSched
+            pointer to the scheduler
+
+    @param[in]
+        pOp
+            pointer to the completed operation
+
+    @param[in]
+        result
+            result of the operation
+
+==============================================================================*/
+static void complete( LCDSched *pSched, LCDOp *pOp, int result )
+{
+    if ( ( pOp->done != NULL ) &&
+         ( pSched->notify != NULL ) )
+    {
+        pSched->notify( pSched->ctx, pOp, result );
+    }
+}
+
+/*============================================================================*/
+/*  updateUtilisation                                                         */
+/*!
+    Update the bus utilisation statistic
+
+    The updateUtilisation function calculates the percentage of the
+    last measurement interval which was spent performing operations.
+
+    @param[in]
+        pSched
+            pointer to the scheduler
+
+    @param[in]
+        now
+            pointer to the current time
+
+==============================================================================*/
+static void updateUtilisation( LCDSched *pSched, struct timespec *now )
+{
+    long elapsed;
+
+    elapsed = diff_us( now, &pSched->intervalStart );
+    if ( elapsed >= LCD_SCHED_STATS_INTERVAL_MS * 1000L )
+    {
+        pSched->stats.utilisation = (int)( pSched->busy_us * 100 / elapsed );
+        pSched->busy_us = 0;
+        pSched->intervalStart = *now;
+    }
+}
+
+/*============================================================================*/
+/*  diff_us                                                                   */
+/*!
+    Calculate the difference between two times
+
+    @param[in]
+        a
+            pointer to the first time
+
+    @param[in]
+        b
+            pointer to the second time
+
+    @retval number of microseconds from b to a
+
+==============================================================================*/
+static long diff_us( struct timespec *a, struct timespec *b )
+{
+    return ( a->tv_sec - b->tv_sec ) * 1000000L +
+           ( a->tv_nsec - b->tv_nsec ) / 1000L;
+}
+
+/*! @}
+ * end of lcdsched group */
@@ -0,0 +1,210 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup lcdstate lcdstate
+ * @brief Persistent display state
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file lcd_state.c
+
+    Persistent display state for the character based display driver
+
+    The lcd_state module keeps the shadow state of a display (see
+    AttachShadow()) in a memory mapped file, typically under /run.  The
+    driver updates the mapped shadow state as each byte is queued to the
+    bus, so the file always holds the current display contents, custom
+    characters, cursor mode and backlight state, without any extra
+    writes or system calls.  The file survives a restart (or crash) of
+    the service, so the display can be restored on start up before any
+    other services are available (see LCDRestore()).
+
+    The shadow state is marked as pending while a bus transaction is in
+    progress, so state which was saved part way through a transaction
+    is not trusted.
+
+    Each mapped state file is locked, so a second instance of the
+    service driving the same display cannot attach the same state.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include "lcd_io.h"
+#include "lcd_state.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+#define EOK 0
+#endif
+
+/*==============================================================================
+        Function Definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  StateMap                                                                  */
+/*!
+    Map a display state file
+
+    The StateMap function maps the specified display state file into
+    memory, creating it if it does not exist.  A file which was not
+    created by StateMap(), or which was written by a different version
+    of the driver, is reset.  The mapping remains valid until it is
+    released with StateUnmap().
+
+    The file is locked exclusively while it is mapped, so the state
+    file of a display cannot be mapped by another process at the same
+    time.  The lock belongs to the open file, which the mapping keeps
+    open, so it is released by StateUnmap() or when the process exits.
+
+    @param[in]
+        name
+            name of the display state file
+
+    @param[out]
+        valid
+            set to true if the file holds a complete saved state
+
+    @retval pointer to the mapped display state
+    @retval NULL if the file could not be mapped, with errno set to
+            EWOULDBLOCK if it is mapped by another process
+
+==============================================================================*/
+LCDShadow *StateMap( const char *name, bool *valid )
+{
+    LCDShadow *pState = NULL;
+    struct stat sb;
+    bool sized = false;
+    void *p;
+    int err;
+    int fd;
+
+    if ( ( name != NULL ) &&
+         ( valid != NULL ) )
+    {
+        *valid = false;
+
+        fd = open( name, O_RDWR | O_CREAT | O_CLOEXEC, 0644 );
+        if ( fd >= 0 )
+        {
+            /* a file of a different size was written by a different
+               version of the driver */
+            sized = ( fstat( fd, &sb ) == 0 ) &&
+                    ( sb.st_size == sizeof( LCDShadow ) );
+
+            /* the lock fails if another instance owns the state */
+            if ( ( flock( fd, LOCK_EX | LOCK_NB ) == 0 ) &&
+                 ( ( sized == true ) ||
+                   ( ftruncate( fd, sizeof( LCDShadow ) ) == 0 ) ) )
+            {
+                p = mmap( NULL,
+                          sizeof( LCDShadow ),
+                          PROT_READ | PROT_WRITE,
+                          MAP_SHARED,
+                          fd,
+                          0 );
+                if ( p != MAP_FAILED )
+                {
+                    pState = (LCDShadow *)p;
+                }
+            }
+
+            /* the mapping does not need the file descriptor */
+            err = errno;
+            close( fd );
+            errno = err;
+        }
+    }
+
+    if ( pState != NULL )
+    {
+        if ( ( sized == true ) &&
+             ( pState->magic == LCD_STATE_MAGIC ) &&
+             ( pState->pending == false ) )
+        {
+            *valid = true;
+        }
+        else
+        {
+            memset( pState, 0, sizeof( LCDShadow ) );
+            pState->magic = LCD_STATE_MAGIC;
+        }
+    }
+
+    return pState;
+}
+
+/*============================================================================*/
+/*  StateUnmap                                                                */
+/*!
+    Release a display state file mapping
+
+    The StateUnmap function releases a mapping created by StateMap().
+    The display state remains in the file.  The mapping must not be
+    attached to a device (see AttachShadow()) when it is released.
+
+    @param[in]
+        pState
+            pointer to the mapped display state
+
+    @retval EOK the mapping was released
+    @retval EINVAL invalid arguments
+    @retval other error from munmap()
+
+==============================================================================*/
+int StateUnmap( LCDShadow *pState )
+{
+    int result = EINVAL;
+
+    if ( pState != NULL )
+    {
+        result = ( munmap( pState, sizeof( LCDShadow ) ) == 0 ) ? EOK : errno;
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of lcdstate group
+ *
+ */
@@ -0,0 +1,1167 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup lcdtrace lcdtrace
+ * @brief Bus trace capture and replay
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file lcd_trace.c
+
+    Bus trace capture and replay for the character based display driver
+
+    The lcd_trace module records each byte written to or read from the
+    PCF8574 by the lcd_io module (see SetTrace()), together with a
+    timestamp and the lcd_ctrl operation which caused it (see
+    BeginTrace()).  The RS, RW and EN signals are part of each recorded
+    PCF8574 port value, and the trace keeps the wiring of each device
+    (see TraceSetWiring()) so the port values can be decoded whichever
+    backpack the display is connected through.
+
+    The events are held in a ring buffer, so only the most recent events
+    are kept.  Events are recorded by the thread which owns the bus, and
+    the ring can be read from any other thread without locking: each
+    event is published by advancing the ring head after it has been
+    written, and a reader discards any events which may have been
+    overwritten while it was copying them (see TraceSnapshot()).
+
+    A trace can be printed, saved to a binary file, and replayed into a
+    bus backend, for example the emulator, to compare the cost of the
+    same display traffic with different bus or batching settings.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <stdatomic.h>
+#include "lcd_bus.h"
+#include "lcd_trace.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+#define EOK 0
+#endif
+
+/*! largest number of bytes replayed in one bus message */
+#define LCD_TRACE_MAX_MSG   ( 256 )
+
+/*==============================================================================
+        Data Types
+==============================================================================*/
+
+/*! The LCDTraceHeader type is the header of a bus trace file, which is
+    followed by the wiring of each traced device, and then the trace
+    events in the order they were recorded */
+typedef struct _LCDTraceHeader
+{
+    /*! LCD_TRACE_MAGIC */
+    uint32_t magic;
+
+    /*! LCD_TRACE_VERSION */
+    uint32_t version;
+
+    /*! number of trace events in the file */
+    uint64_t count;
+
+    /*! number of device wirings in the file */
+    uint32_t devices;
+
+    /*! unused, zero */
+    uint32_t reserved;
+
+} LCDTraceHeader;
+
+/*! The LCDTrace type holds a ring buffer of bus trace events */
+struct _LCDTrace
+{
+    /*! trace event ring */
+    LCDTraceEvent *events;
+
+    /*! number of events in the ring (a power of two) */
+    size_t size;
+
+    /*! total number of events recorded.  The next event is written
+        at index ( head & ( size - 1 ) ) */
+    atomic_uint_fast64_t head;
+
+    /*! number of events whose ring entries have been claimed by the
+        writer.  It is advanced before an entry is overwritten, so a
+        reader can tell which of the entries it copied may have been
+        changed while it was copying them */
+    atomic_uint_fast64_t claim;
+
+    /*! time at which the trace was created */
+    struct timespec start;
+
+    /*! wiring of each traced device (see TraceSetWiring()) */
+    LCDTraceWiring wiring[LCD_TRACE_MAX_DEVICES];
+
+    /*! number of devices in the wiring table */
+    size_t devices;
+
+};
+
+/*==============================================================================
+        Private Function Declarations
+==============================================================================*/
+
+static uint64_t elapsedNs( struct timespec *since );
+static int replayMessage( LCDBus *pBus, LCDTraceEvent *events, size_t n );
+static int readFully( int fd, void *buf, size_t len );
+static bool validWiring( const LCDTraceWiring *pWiring );
+static const LCDTraceWiring *findWiring( LCDTrace *pTrace, uint8_t address );
+static uint8_t decodeData( const LCDTraceWiring *pWiring, uint8_t value );
+
+/*==============================================================================
+        File Scoped Variables
+==============================================================================*/
+
+/*! trace origin names, indexed by LCDTraceOrigin */
+static const char *originNames[LCD_TRACE_ORIGINS] =
+{
+    "-",
+    "LCDInit",
+    "LCDRestore",
+    "ClearDisplay",
+    "CursorHome",
+    "Cursor",
+    "SetADD",
+    "DisplayLine",
+    "DisplayText",
+    "DisplayFrame",
+    "ShiftDisplay",
+    "LoadGlyph",
+    "GetStatus",
+    "SyncBacklight"
+};
+
+/*! wiring assumed for devices which have none recorded: the standard
+    PCF8574 backpack */
+static const LCDTraceWiring standardWiring =
+{
+    .address = 0,
+    .rs = 0,
+    .rw = 1,
+    .en = 2,
+    .led = 3,
+    .data = { 4, 5, 6, 7 },
+    .ledActiveLow = 0
+};
+
+/*==============================================================================
+        Function Definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  TraceInit                                                                 */
+/*!
+    Create a bus trace
+
+    The TraceInit function creates a trace ring buffer which holds the
+    specified number of bus bytes, rounded up to a power of two.
+
+    @param[in]
+        size
+            number of trace events to keep
+
+    @retval pointer to the new trace
+    @retval NULL if the trace could not be created
+
+==============================================================================*/
+LCDTrace *TraceInit( size_t size )
+{
+    LCDTrace *pTrace = NULL;
+    size_t n = 1;
+
+    if ( size > 0 )
+    {
+        while ( n < size )
+        {
+            n <<= 1;
+        }
+
+        pTrace = calloc( 1, sizeof( LCDTrace ) );
+        if ( pTrace != NULL )
+        {
+            pTrace->events = calloc( n, sizeof( LCDTraceEvent ) );
+            if ( pTrace->events != NULL )
+            {
+                pTrace->size = n;
+                atomic_init( &pTrace->head, 0 );
+                atomic_init( &pTrace->claim, 0 );
+                clock_gettime( CLOCK_MONOTONIC, &pTrace->start );
+            }
+            else
+            {
+                free( pTrace );
+                pTrace = NULL;
+            }
+        }
+    }
+
+    return pTrace;
+}
+
+/*============================================================================*/
+/*  TraceRecord                                                               */
+/*!
+    Record bus bytes in a trace
+
+    The TraceRecord function records each byte of one bus message as a
+    trace event, with the time of the call.  It must only be called by
+    one thread at a time, normally the thread which owns the bus.
+
+    @param[in]
+        pTrace
+            pointer to the trace
+
+    @param[in]
+        address
+            I2C address of the device
+
+    @param[in]
+        flags
+            LCD_TRACE_READ if the bytes were read from the bus
+
+    @param[in]
+        origin
+            operation which caused the bus message (see LCDTraceOrigin)
+
+    @param[in]
+        buf
+            pointer to the bytes written or read
+
+    @param[in]
+        len
+            number of bytes
+
+    @retval EOK the bytes were recorded
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int TraceRecord( LCDTrace *pTrace,
+                 uint8_t address,
+                 uint8_t flags,
+                 uint8_t origin,
+                 const uint8_t *buf,
+                 size_t len )
+{
+    int result = EINVAL;
+    LCDTraceEvent *pEvent;
+    uint_fast64_t head;
+    uint64_t ns;
+    size_t i;
+
+    if ( ( pTrace != NULL ) &&
+         ( buf != NULL ) )
+    {
+        ns = elapsedNs( &pTrace->start );
+        head = atomic_load_explicit( &pTrace->head, memory_order_relaxed );
+
+        for ( i = 0; i < len; i++ )
+        {
+            /* claim the ring entry before it is overwritten */
+            atomic_store_explicit( &pTrace->claim,
+                                   head + i + 1,
+                                   memory_order_relaxed );
+            atomic_thread_fence( memory_order_release );
+
+            pEvent = &pTrace->events[( head + i ) & ( pTrace->size - 1 )];
+            pEvent->ns = ns;
+            pEvent->address = address;
+            pEvent->value = buf[i];
+            pEvent->flags = ( flags & LCD_TRACE_READ ) |
+                            ( ( i == 0 ) ? LCD_TRACE_FIRST : 0 );
+            pEvent->origin = origin;
+
+            /* publish the event */
+            atomic_store_explicit( &pTrace->head,
+                                   head + i + 1,
+                                   memory_order_release );
+        }
+
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  TraceSnapshot                                                             */
+/*!
+    Copy the events held in a trace
+
+    The TraceSnapshot function copies the most recent trace events, oldest
+    first, while they may still be being recorded by another thread.
+    After copying, the writer's claim index is read, and any copied events
+    whose ring entries may have been claimed for reuse in the meantime are
+    dropped, so an entry which was being overwritten is never returned
+    (seqlock pattern).
+
+    @param[in]
+        pTrace
+            pointer to the trace
+
+    @param[out]
+        events
+            pointer to an array to store the events
+
+    @param[in]
+        max
+            maximum number of events to store
+
+    @param[out]
+        n
+            pointer to the location to store the number of events stored
+
+    @param[out]
+        dropped
+            pointer to the location to store the number of events which
+            were recorded before the stored events and are no longer held.
+            May be NULL.
+
+    @retval EOK the events were copied
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int TraceSnapshot( LCDTrace *pTrace,
+                   LCDTraceEvent *events,
+                   size_t max,
+                   size_t *n,
+                   uint64_t *dropped )
+{
+    int result = EINVAL;
+    uint_fast64_t head;
+    uint_fast64_t claim;
+    uint_fast64_t first;
+    uint_fast64_t oldest;
+    uint_fast64_t i;
+    size_t count;
+
+    if ( ( pTrace != NULL ) &&
+         ( events != NULL ) &&
+         ( n != NULL ) )
+    {
+        head = atomic_load_explicit( &pTrace->head, memory_order_acquire );
+        count = ( head < pTrace->size ) ? head : pTrace->size;
+        count = ( count < max ) ? count : max;
+        first = head - count;
+
+        for ( i = 0; i < count; i++ )
+        {
+            events[i] = pTrace->events[( first + i ) & ( pTrace->size - 1 )];
+        }
+
+        /* the copies must complete before the claim index is read.  Any
+           entry within a ring of the claim index may have been claimed
+           and partly overwritten while it was being copied */
+        atomic_thread_fence( memory_order_acquire );
+        claim = atomic_load_explicit( &pTrace->claim, memory_order_relaxed );
+        oldest = ( claim >= pTrace->size ) ? claim - pTrace->size : 0;
+        if ( first < oldest )
+        {
+            i = ( oldest - first < count ) ? oldest - first : count;
+            memmove( events, &events[i], ( count - i ) * sizeof( *events ) );
+            count -= i;
+            first += i;
+        }
+
+        *n = count;
+        if ( dropped != NULL )
+        {
+            *dropped = first;
+        }
+
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  TraceSetWiring                                                            */
+/*!
+    Record the wiring of a traced device
+
+    The TraceSetWiring function records which PCF8574 port bit drives
+    each display interface signal of the device at the address given in
+    the wiring, replacing any wiring previously recorded for it.  The
+    wiring is used to decode the port values when the trace is printed,
+    and is saved with the trace.  It must be set before the device is
+    traced by another thread.
+
+    @param[in]
+        pTrace
+            pointer to the trace
+
+    @param[in]
+        pWiring
+            pointer to the wiring of the device
+
+    @retval EOK the wiring was recorded
+    @retval ENOSPC the wiring table is full
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int TraceSetWiring( LCDTrace *pTrace, const LCDTraceWiring *pWiring )
+{
+    int result = EINVAL;
+    size_t i;
+
+    if ( ( pTrace != NULL ) &&
+         ( pWiring != NULL ) )
+    {
+        for ( i = 0; i < pTrace->devices; i++ )
+        {
+            if ( pTrace->wiring[i].address == pWiring->address )
+            {
+                break;
+            }
+        }
+
+        if ( i < LCD_TRACE_MAX_DEVICES )
+        {
+            pTrace->wiring[i] = *pWiring;
+            if ( i == pTrace->devices )
+            {
+                pTrace->devices++;
+            }
+
+            result = EOK;
+        }
+        else
+        {
+            result = ENOSPC;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  TracePrint                                                                */
+/*!
+    Print the events held in a trace
+
+    The TracePrint function writes one line for each trace event held in
+    the trace, showing the time, the device address, the direction, the
+    PCF8574 port value decoded into its RS, RW, EN, backlight and data
+    signals, and the operation which caused it.  The port value is
+    decoded using the wiring recorded for the device (see
+    TraceSetWiring()), or the standard wiring if there is none.
+
+    @param[in]
+        pTrace
+            pointer to the trace
+
+    @param[in]
+        fd
+            output file descriptor
+
+    @retval EOK the trace was printed
+    @retval ENOMEM memory allocation failed
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int TracePrint( LCDTrace *pTrace, int fd )
+{
+    int result = EINVAL;
+    LCDTraceEvent *events;
+    LCDTraceEvent *pEvent;
+    const LCDTraceWiring *pWiring;
+    uint64_t dropped = 0;
+    size_t n = 0;
+    size_t i;
+
+    if ( ( pTrace != NULL ) &&
+         ( fd != -1 ) )
+    {
+        events = calloc( pTrace->size, sizeof( LCDTraceEvent ) );
+        if ( events != NULL )
+        {
+            result = TraceSnapshot( pTrace,
+                                    events,
+                                    pTrace->size,
+                                    &n,
+                                    &dropped );
+            if ( result == EOK )
+            {
+                dprintf( fd,
+                         "Trace Events: %zu (%llu dropped)\n",
+                         n,
+                         (unsigned long long)dropped );
+
+                for ( i = 0; i < n; i++ )
+                {
+                    pEvent = &events[i];
+                    pWiring = findWiring( pTrace, pEvent->address );
+                    dprintf( fd,
+                             "%10llu.%03llu 0x%02x %c 0x%02x "
+                             "RS=%d RW=%d EN=%d BL=%d D=%x %s\n",
+                             (unsigned long long)( pEvent->ns / 1000 ),
+                             (unsigned long long)( pEvent->ns % 1000 ),
+                             pEvent->address,
+                             ( pEvent->flags & LCD_TRACE_READ ) ? 'R' : 'W',
+                             pEvent->value,
+                             ( pEvent->value >> pWiring->rs ) & 1,
+                             ( pEvent->value >> pWiring->rw ) & 1,
+                             ( pEvent->value >> pWiring->en ) & 1,
+                             ( ( pEvent->value >> pWiring->led ) & 1 ) ^
+                             ( pWiring->ledActiveLow ? 1 : 0 ),
+                             decodeData( pWiring, pEvent->value ),
+                             TraceOriginName( pEvent->origin ) );
+                }
+            }
+
+            free( events );
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  TraceSave                                                                 */
+/*!
+    Save the events held in a trace to a binary file
+
+    The TraceSave function writes a trace file header followed by the
+    wiring of each traced device and the trace events held in the
+    trace, oldest first.  The file can be read
+    back using TraceLoad().
+
+    @param[in]
+        pTrace
+            pointer to the trace
+
+    @param[in]
+        name
+            name of the trace file to create
+
+    @retval EOK the trace was saved
+    @retval ENOMEM memory allocation failed
+    @retval EIO short write
+    @retval EINVAL invalid arguments
+    @retval other error from open() or write()
+
+==============================================================================*/
+int TraceSave( LCDTrace *pTrace, const char *name )
+{
+    int result = EINVAL;
+    LCDTraceHeader header;
+    LCDTraceEvent *events;
+    size_t n = 0;
+    size_t len;
+    ssize_t rc;
+    int fd;
+
+    if ( ( pTrace != NULL ) &&
+         ( name != NULL ) )
+    {
+        events = calloc( pTrace->size, sizeof( LCDTraceEvent ) );
+        if ( events != NULL )
+        {
+            TraceSnapshot( pTrace, events, pTrace->size, &n, NULL );
+
+            fd = open( name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+            if ( fd != -1 )
+            {
+                header.magic = LCD_TRACE_MAGIC;
+                header.version = LCD_TRACE_VERSION;
+                header.count = n;
+                header.devices = pTrace->devices;
+                header.reserved = 0;
+
+                result = EOK;
+
+                rc = write( fd, &header, sizeof( header ) );
+                if ( rc != (ssize_t)sizeof( header ) )
+                {
+                    result = ( rc == -1 ) ? errno : EIO;
+                }
+
+                len = pTrace->devices * sizeof( LCDTraceWiring );
+                if ( ( result == EOK ) && ( len > 0 ) )
+                {
+                    rc = write( fd, pTrace->wiring, len );
+                    if ( rc != (ssize_t)len )
+                    {
+                        result = ( rc == -1 ) ? errno : EIO;
+                    }
+                }
+
+                len = n * sizeof( LCDTraceEvent );
+                if ( ( result == EOK ) && ( len > 0 ) )
+                {
+                    rc = write( fd, events, len );
+                    if ( rc != (ssize_t)len )
+                    {
+                        result = ( rc == -1 ) ? errno : EIO;
+                    }
+                }
+
+                close( fd );
+            }
+            else
+            {
+                result = errno;
+            }
+
+            free( events );
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  TraceLoad                                                                 */
+/*!
+    Load the events from a binary trace file
+
+    The TraceLoad function reads a trace file written by TraceSave().
+    The returned event array must be freed by the caller.
+
+    @param[in]
+        name
+            name of the trace file
+
+    @param[out]
+        events
+            pointer to the location to store a pointer to the events
+
+    @param[out]
+        n
+            pointer to the location to store the number of events
+
+    @param[out]
+        wiring
+            pointer to an array of LCD_TRACE_MAX_DEVICES entries to store
+            the wiring of each traced device.  May be NULL.
+
+    @param[out]
+        devices
+            pointer to the location to store the number of device
+            wirings.  May be NULL.
+
+    @retval EOK the trace was loaded
+    @retval EBADMSG the file is not a trace file, its header does not
+            match its size, or a device wiring does not give each signal
+            its own port bit (0 - 7)
+    @retval ENOMEM memory allocation failed
+    @retval EIO the file is truncated
+    @retval EINVAL invalid arguments
+    @retval other error from open(), fstat() or read()
+
+==============================================================================*/
+int TraceLoad( const char *name,
+               LCDTraceEvent **events,
+               size_t *n,
+               LCDTraceWiring *wiring,
+               size_t *devices )
+{
+    int result = EINVAL;
+    LCDTraceHeader header;
+    LCDTraceWiring table[LCD_TRACE_MAX_DEVICES];
+    LCDTraceEvent *pEvents = NULL;
+    struct stat sb;
+    size_t len;
+    off_t size;
+    uint32_t i;
+    int fd;
+
+    if ( ( name != NULL ) &&
+         ( events != NULL ) &&
+         ( n != NULL ) )
+    {
+        fd = open( name, O_RDONLY | O_CLOEXEC );
+        if ( fd != -1 )
+        {
+            result = ( fstat( fd, &sb ) == 0 ) ? EOK : errno;
+            if ( result == EOK )
+            {
+                result = readFully( fd, &header, sizeof( header ) );
+            }
+
+            if ( ( result == EOK ) &&
+                 ( ( header.magic != LCD_TRACE_MAGIC ) ||
+                   ( header.version != LCD_TRACE_VERSION ) ||
+                   ( header.devices > LCD_TRACE_MAX_DEVICES ) ) )
+            {
+                result = EBADMSG;
+            }
+
+            if ( result == EOK )
+            {
+                len = header.devices * sizeof( LCDTraceWiring );
+                result = readFully( fd, table, len );
+            }
+
+            for ( i = 0; ( result == EOK ) && ( i < header.devices ); i++ )
+            {
+                if ( validWiring( &table[i] ) == false )
+                {
+                    result = EBADMSG;
+                }
+            }
+
+            if ( result == EOK )
+            {
+                /* the events must fill the rest of the file, which also
+                   keeps the event array size from overflowing */
+                size = sb.st_size - (off_t)sizeof( header ) - (off_t)len;
+                if ( ( size < 0 ) ||
+                     ( header.count !=
+                       (uint64_t)size / sizeof( LCDTraceEvent ) ) )
+                {
+                    result = EBADMSG;
+                }
+            }
+
+            if ( result == EOK )
+            {
+                len = header.count * sizeof( LCDTraceEvent );
+                pEvents = malloc( ( len > 0 ) ? len : 1 );
+                result = ( pEvents != NULL )
+                       ? readFully( fd, pEvents, len )
+                       : ENOMEM;
+            }
+
+            close( fd );
+        }
+        else
+        {
+            result = errno;
+        }
+
+        if ( result == EOK )
+        {
+            *events = pEvents;
+            *n = header.count;
+
+            if ( wiring != NULL )
+            {
+                memcpy( wiring,
+                        table,
+                        header.devices * sizeof( LCDTraceWiring ) );
+            }
+
+            if ( devices != NULL )
+            {
+                *devices = header.devices;
+            }
+        }
+        else
+        {
+            free( pEvents );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  TraceReplay                                                               */
+/*!
+    Replay trace events into a bus
+
+    The TraceReplay function sends the recorded bus messages to the
+    specified bus, for example the emulator (see BusInit()), in the order
+    they were recorded, and writes a report of the time taken and the
+    bus cost to the output file descriptor.  Recorded reads are performed
+    as reads of the same length, so the replayed device sees the same
+    sequence of port updates.
+
+    If the replay is paced, each message is sent no earlier than its
+    recorded time relative to the start of the trace, so a display
+    which depends on the recorded delays (eg. to complete a clear
+    display) receives the traffic in the same way.  Otherwise the
+    messages are sent as fast as the bus allows.
+
+    @param[in]
+        pBus
+            pointer to the bus to replay into
+
+    @param[in]
+        events
+            pointer to the trace events
+
+    @param[in]
+        n
+            number of trace events
+
+    @param[in]
+        paced
+            true to keep the recorded timing of the messages
+
+    @param[in]
+        fd
+            output file descriptor for the report, or -1 for no report
+
+    @retval EOK the trace was replayed
+    @retval EINVAL invalid arguments
+    @retval other error from BusOpen(), BusWrite() or BusRead()
+
+==============================================================================*/
+int TraceReplay( LCDBus *pBus,
+                 LCDTraceEvent *events,
+                 size_t n,
+                 bool paced,
+                 int fd )
+{
+    int result = EINVAL;
+    LCDBusStats stats;
+    struct timespec start;
+    uint64_t elapsed;
+    uint64_t ns;
+    size_t messages = 0;
+    size_t i = 0;
+    size_t len;
+    int rc;
+
+    if ( ( pBus != NULL ) &&
+         ( events != NULL ) )
+    {
+        result = BusOpen( pBus );
+        if ( result == EOK )
+        {
+            ResetBusStats( pBus );
+            clock_gettime( CLOCK_MONOTONIC, &start );
+
+            while ( i < n )
+            {
+                /* find the bytes of the next message */
+                len = 1;
+                while ( ( i + len < n ) &&
+                        ( len < LCD_TRACE_MAX_MSG ) &&
+                        ( ( events[i + len].flags & LCD_TRACE_FIRST ) == 0 ) )
+                {
+                    len++;
+                }
+
+                if ( paced == true )
+                {
+                    ns = events[i].ns - events[0].ns;
+                    elapsed = elapsedNs( &start );
+                    if ( ns > elapsed )
+                    {
+                        usleep( ( ns - elapsed ) / 1000 );
+                    }
+                }
+
+                rc = replayMessage( pBus, &events[i], len );
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+
+                messages++;
+                i += len;
+            }
+
+            BusFlush( pBus );
+            elapsed = elapsedNs( &start );
+            GetBusStats( pBus, &stats );
+
+            BusRelease( pBus );
+
+            if ( fd != -1 )
+            {
+                dprintf( fd, "Trace Replay: %zu bytes, %zu messages, %s\n",
+                         n,
+                         messages,
+                         paced ? "paced" : "unpaced" );
+                dprintf( fd, "Elapsed: %llu us\n",
+                         (unsigned long long)( elapsed / 1000 ) );
+                dprintf( fd, "Throughput: %.0f bytes/s\n",
+                         ( elapsed > 0 ) ? n * 1e9 / elapsed : 0.0 );
+                dprintf( fd, "Bus Syscalls: %llu\n",
+                         (unsigned long long)stats.syscalls );
+                dprintf( fd, "Bus Bytes: %llu\n",
+                         (unsigned long long)stats.bytes );
+                dprintf( fd, "Result: %s\n", strerror( result ) );
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  TraceOriginName                                                           */
+/*!
+    Get the name of a trace origin
+
+    @param[in]
+        origin
+            trace origin (see LCDTraceOrigin)
+
+    @retval name of the operation
+
+==============================================================================*/
+const char *TraceOriginName( uint8_t origin )
+{
+    return ( origin < LCD_TRACE_ORIGINS ) ? originNames[origin] : "?";
+}
+
+/*============================================================================*/
+/*  replayMessage                                                             */
+/*!
+    Replay one recorded bus message
+
+    @param[in]
+        pBus
+            pointer to the open bus
+
+    @param[in]
+        events
+            pointer to the trace events of the message
+
+    @param[in]
+        n
+            number of bytes in the message
+
+    @retval EOK the message was replayed
+    @retval other error from BusWrite() or BusRead()
+
+==============================================================================*/
+static int replayMessage( LCDBus *pBus, LCDTraceEvent *events, size_t n )
+{
+    uint8_t buf[LCD_TRACE_MAX_MSG];
+    size_t i;
+
+    for ( i = 0; i < n; i++ )
+    {
+        buf[i] = events[i].value;
+    }
+
+    return ( events[0].flags & LCD_TRACE_READ )
+           ? BusRead( pBus, events[0].address, buf, n )
+           : BusWrite( pBus, events[0].address, buf, n );
+}
+
+/*============================================================================*/
+/*  readFully                                                                 */
+/*!
+    Read a block of a file
+
+    The readFully function reads the specified number of bytes from a
+    file, continuing after short reads.
+
+    @param[in]
+        fd
+            file descriptor
+
+    @param[out]
+        buf
+            pointer to the buffer to store the bytes
+
+    @param[in]
+        len
+            number of bytes to read
+
+    @retval EOK the bytes were read
+    @retval EIO the end of the file was reached first
+    @retval other error from read()
+
+==============================================================================*/
+static int readFully( int fd, void *buf, size_t len )
+{
+    int result = EOK;
+    uint8_t *p = buf;
+    ssize_t rc;
+
+    while ( ( result == EOK ) && ( len > 0 ) )
+    {
+        rc = read( fd, p, len );
+        if ( rc > 0 )
+        {
+            p += rc;
+            len -= (size_t)rc;
+        }
+        else if ( rc == 0 )
+        {
+            result = EIO;
+        }
+        else if ( errno != EINTR )
+        {
+            result = errno;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  validWiring                                                               */
+/*!
+    Check the wiring of a traced device
+
+    The validWiring function checks that a device wiring loaded from a
+    trace file gives each of the display interface signals and the
+    backlight its own PCF8574 port bit, as SetPinMap() requires, so a
+    corrupt or foreign trace cannot set up an impossible wiring.
+
+    @param[in]
+        pWiring
+            pointer to the wiring of the device
+
+    @retval true every port bit (0 - 7) is used exactly once
+    @retval false the wiring is invalid
+
+==============================================================================*/
+static bool validWiring( const LCDTraceWiring *pWiring )
+{
+    uint8_t bits[8];
+    uint8_t used = 0;
+    int i;
+
+    bits[0] = pWiring->rs;
+    bits[1] = pWiring->rw;
+    bits[2] = pWiring->en;
+    bits[3] = pWiring->led;
+    memcpy( &bits[4], pWiring->data, sizeof( pWiring->data ) );
+
+    for ( i = 0; i < 8; i++ )
+    {
+        used |= ( bits[i] < 8 ) ? 1 << bits[i] : 0;
+    }
+
+    return ( used == 0xFF );
+}
+
+/*============================================================================*/
+/*  findWiring                                                                */
+/*!
+    Get the wiring of a traced device
+
+    @param[in]
+        pTrace
+            pointer to the trace
+
+    @param[in]
+        address
+            I2C address of the device
+
+    @retval pointer to the wiring recorded for the device, or to the
+            standard wiring if there is none
+
+==============================================================================*/
+static const LCDTraceWiring *findWiring( LCDTrace *pTrace, uint8_t address )
+{
+    const LCDTraceWiring *pWiring = &standardWiring;
+    size_t i;
+
+    for ( i = 0; i < pTrace->devices; i++ )
+    {
+        if ( pTrace->wiring[i].address == address )
+        {
+            pWiring = &pTrace->wiring[i];
+            break;
+        }
+    }
+
+    return pWiring;
+}
+
+/*============================================================================*/
+/*  decodeData                                                                */
+/*!
+    Get the D4-D7 data signals from a PCF8574 port value
+
+    @param[in]
+        pWiring
+            pointer to the wiring of the device
+
+    @param[in]
+        value
+            PCF8574 port value
+
+    @retval 4-bit value on D4-D7
+
+==============================================================================*/
+static uint8_t decodeData( const LCDTraceWiring *pWiring, uint8_t value )
+{
+    uint8_t data = 0;
+    int i;
+
+    for ( i = 0; i < 4; i++ )
+    {
+        data |= ( ( value >> pWiring->data[i] ) & 1 ) << i;
+    }
+
+    return data;
+}
+
+/*============================================================================*/
+/*  elapsedNs                                                                 */
+/*!
+    Get the time elapsed since a monotonic clock time
+
+    @param[in]
+        since
+            pointer to the start time
+
+    @retval number of nanoseconds since the start time
+
+==============================================================================*/
+static uint64_t elapsedNs( struct timespec *since )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return (uint64_t)( now.tv_sec - since->tv_sec ) * 1000000000ULL +
+           (uint64_t)now.tv_nsec - (uint64_t)since->tv_nsec;
+}
+
+/*! @}
+ * end of lcdtrace group */